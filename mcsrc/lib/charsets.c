@@ -464,6 +464,10 @@ convert_from_utf_to_current_c (int input_char, GIConv conv)
     unsigned char ch = '.';
     int res;
 
+    /* all supported 8-bit codepages are ASCII-compatible */
+    if (input_char >= 0 && input_char < 0x80)
+        return (unsigned char) input_char;
+
     res = g_unichar_to_utf8 (input_char, (char *) str);
     if (res == 0)
         return ch;
@@ -520,6 +524,17 @@ convert_from_8bit_to_utf_c (char input_char, GIConv conv)
 
 /* --------------------------------------------------------------------------------------------- */
 
+void
+convert_from_8bit_to_utf_table (int *table, GIConv conv)
+{
+    int i;
+
+    for (i = 0; i < 256; i++)
+        table[i] = convert_from_8bit_to_utf_c ((char) i, conv);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 int
 convert_from_8bit_to_utf_c2 (char input_char)
 {
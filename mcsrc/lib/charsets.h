@@ -59,6 +59,14 @@ unsigned char convert_from_utf_to_current_c (int input_char, GIConv conv);
  */
 int convert_from_8bit_to_utf_c (char input_char, GIConv conv);
 
+/*
+ * Build translation table from 8-bit codepage to Unicode
+ * param table, array of 256 elements to fill
+ * param conv, GIConv converter from codepage to utf-8
+ * table[c] is the same as convert_from_8bit_to_utf_c (c, conv)
+ */
+void convert_from_8bit_to_utf_table (int *table, GIConv conv);
+
 /*
  * Converter from display codepage 8-bit to utf-8
  * param char input_char, GIConv converter
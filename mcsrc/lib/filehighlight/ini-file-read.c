@@ -29,7 +29,6 @@
 
 #include "lib/global.h"
 #include "lib/fileloc.h"
-#include "lib/strescape.h"
 #include "lib/skin.h"
 #include "lib/util.h"           /* exist_file() */
 #include "lib/filehighlight.h"
@@ -141,27 +140,30 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
 
     buf = g_string_sized_new (64);
 
+    /* all extensions are searched at once as list of shell patterns "*.ext" */
     for (exts = exts_orig; *exts != NULL; exts++)
     {
-        char *esc_ext;
+        const char *p;
 
-        esc_ext = strutils_regex_escape (*exts);
         if (buf->len != 0)
-            g_string_append_c (buf, '|');
-        g_string_append (buf, esc_ext);
-        g_free (esc_ext);
+            g_string_append_c (buf, ' ');
+        g_string_append (buf, "*.");
+        for (p = *exts; *p != '\0'; p++)
+        {
+            if (*p == '\\' || *p == '*' || *p == '?' || g_ascii_isspace (*p))
+                g_string_append_c (buf, '\\');
+            g_string_append_c (buf, *p);
+        }
     }
     g_strfreev (exts_orig);
 
-    g_string_prepend (buf, ".*\\.(");
-    g_string_append (buf, ")$");
-
     mc_filter = g_new0 (mc_fhl_filter_t, 1);
     mc_filter->type = MC_FLHGH_T_FREGEXP;
     mc_filter->search_condition = mc_search_new_len (buf->str, buf->len, MC_DEFAULT_CHARSET);
     mc_filter->search_condition->is_case_sensitive =
         mc_config_get_bool (fhl->config, group_name, "extensions_case", FALSE);
-    mc_filter->search_condition->search_type = MC_SEARCH_T_REGEX;
+    mc_filter->search_condition->search_type = MC_SEARCH_T_MULTI;
+    mc_filter->search_condition->is_entire_line = TRUE;
 
     mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
     g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
@@ -72,6 +72,7 @@
 #define EDIT_CLIP_FILE          EDIT_DIR PATH_SEP_STR "mcedit.clip"
 #define EDIT_BLOCK_FILE         EDIT_DIR PATH_SEP_STR "mcedit.block"
 #define EDIT_TEMP_FILE          EDIT_DIR PATH_SEP_STR "mcedit.temp"
+#define EDIT_SYNTAX_CACHE_DIR   EDIT_DIR PATH_SEP_STR "syntax.cache"
 
 #define EDIT_GLOBAL_MENU        "mcedit.menu"
 #define EDIT_LOCAL_MENU         ".cedit.menu"
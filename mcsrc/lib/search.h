@@ -41,7 +41,8 @@ typedef enum
     MC_SEARCH_T_NORMAL,
     MC_SEARCH_T_REGEX,
     MC_SEARCH_T_HEX,
-    MC_SEARCH_T_GLOB
+    MC_SEARCH_T_GLOB,
+    MC_SEARCH_T_MULTI
 } mc_search_type_t;
 
 typedef enum
@@ -56,6 +57,8 @@ typedef enum
 typedef mc_search_cbret_t (*mc_search_fn) (const void *user_data, gsize char_offset,
                                            int *current_char);
 typedef mc_search_cbret_t (*mc_update_fn) (const void *user_data, gsize char_offset);
+typedef mc_search_cbret_t (*mc_search_span_fn) (const void *user_data, gsize char_offset,
+                                                const char **span, gsize * span_len);
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
@@ -74,7 +77,7 @@ typedef struct mc_search_struct
     /* search only once.  Is this for replace? */
     gboolean is_once_only;
 
-    /* search only whole words (from begin to end). Used only with NORMAL search type */
+    /* search only whole words (from begin to end). Used only with NORMAL and MULTI search types */
     gboolean whole_words;
 
     /* search entire string (from begin to end). Used only with GLOB search type */
@@ -83,6 +86,10 @@ typedef struct mc_search_struct
     /* function, used for getting data. NULL if not used */
     mc_search_fn search_fn;
 
+    /* function, used for getting contiguous blocks of data. NULL if not used.
+       If set, it takes precedence over search_fn */
+    mc_search_span_fn span_fn;
+
     /* function, used for updatin current search status. NULL if not used */
     mc_update_fn update_fn;
 
@@ -103,6 +110,8 @@ typedef struct mc_search_struct
 #ifdef SEARCH_TYPE_PCRE
     int iovector[MC_SEARCH__NUM_REPLACE_ARGS * 2];
 #endif                          /* SEARCH_TYPE_PCRE */
+    /* some data for multi-pattern search: indexes (guint) of patterns found in matched line */
+    GArray *multi_matches;
 
     /* private data */
 
@@ -121,6 +130,15 @@ typedef struct mc_search_struct
     gchar *error_str;
 } mc_search_t;
 
+/* counters of search engine usage, time is in microseconds */
+typedef struct mc_search_stats_struct
+{
+    guint64 compile_count;
+    guint64 compile_time;
+    guint64 match_count;
+    guint64 cache_hits;
+} mc_search_stats_t;
+
 typedef struct mc_search_type_str_struct
 {
     const char *str;
@@ -166,6 +184,11 @@ gboolean mc_search (const gchar * pattern, const gchar * pattern_charset, const
 int mc_search_getstart_result_by_num (mc_search_t *, int);
 int mc_search_getend_result_by_num (mc_search_t *, int);
 
+const mc_search_stats_t *mc_search_get_stats (void);
+void mc_search_reset_stats (void);
+void mc_search_log_stats (void);
+void mc_search_cache_free (void);
+
 /* *INDENT-OFF* */
 void mc_search_set_error (mc_search_t * lc_mc_search, mc_search_error_t code, const gchar * format, ...)
      G_GNUC_PRINTF (3, 4);
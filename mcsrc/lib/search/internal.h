@@ -23,12 +23,19 @@ typedef enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* automaton of multi-pattern search */
+typedef struct mc_search_multi_struct mc_search_multi_t;
+
 typedef struct mc_search_cond_struct
 {
     GString *str;
     GString *upper;
     GString *lower;
     mc_search_regex_t *regex_handle;
+#ifdef SEARCH_TYPE_PCRE
+    pcre_extra *regex_extra;    /* result of pcre_study() */
+#endif
+    mc_search_multi_t *multi;
     gchar *charset;
 } mc_search_cond_t;
 
@@ -78,6 +85,25 @@ gboolean mc_search__run_hex (mc_search_t *, const void *, gsize, gsize, gsize *)
 
 GString *mc_search_hex_prepare_replace_str (mc_search_t *, GString *);
 
+/* search/multi.c : */
+
+void mc_search__cond_struct_new_init_multi (const char *, mc_search_t *, mc_search_cond_t *);
+
+gboolean mc_search__run_multi (mc_search_t *, const void *, gsize, gsize, gsize *);
+
+GString *mc_search_multi_prepare_replace_str (mc_search_t *, GString *);
+
+mc_search__found_cond_t mc_search__multi_found_cond (mc_search_t *, mc_search_multi_t *,
+                                                     const GString *, gint *, gint *);
+
+mc_search_multi_t *mc_search__multi_new (const mc_search_t *, const char *, gboolean);
+
+void mc_search__multi_add_literal (mc_search_multi_t *, const char *, const char *, gsize);
+
+void mc_search__multi_build (mc_search_multi_t *);
+
+void mc_search__multi_free (mc_search_multi_t *);
+
 /*** inline functions ****************************************************************************/
 
 #endif
@@ -0,0 +1,788 @@
+/*
+   Search text engine.
+   Multi-pattern search
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Search string is a list of patterns separated by whitespaces. Use backslash to
+ * put a whitespace, '*', '?' or backslash itself into pattern. Pattern containing
+ * unescaped '*' or '?' is a wildcard one.
+ *
+ * All patterns are searched at once with Aho-Corasick automaton: every byte of
+ * text is processed only once regardless of number of patterns. For wildcard
+ * pattern, the longest literal fragment is put into automaton and whole pattern
+ * is checked only in lines where that fragment is found.
+ */
+
+#include <config.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+#include "internal.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define MULTI_NODE(m, i) (&g_array_index ((m)->nodes, mc_search_multi_node_t, (i)))
+#define MULTI_KEY(m, i) (&g_array_index ((m)->keys, mc_search_multi_key_t, (i)))
+
+/* states of pattern while line is processed */
+#define MULTI_PATTERN_UNKNOWN 0
+#define MULTI_PATTERN_FOUND   1
+#define MULTI_PATTERN_FAILED  2
+
+/*** file scope type declarations ****************************************************************/
+
+/* node of automaton. Node 0 is root, so 0 as link means "no node" */
+typedef struct
+{
+    guint32 child;              /* first child */
+    guint32 sibling;            /* next child of the same parent */
+    guint32 fail;               /* longest proper suffix which is a prefix of some key */
+    guint32 dict;               /* nearest node in the fail chain which ends some key */
+    gint key;                   /* first key ending in this node, -1 if none */
+    guchar c;
+} mc_search_multi_node_t;
+
+/* key (literal string) put into automaton */
+typedef struct
+{
+    guint pattern;              /* index of pattern */
+    gsize len;
+    gint next;                  /* next key ending in the same node, -1 if none */
+} mc_search_multi_key_t;
+
+typedef struct
+{
+    GString *str;               /* unescaped string for literal pattern, as is for wildcard one */
+    gboolean is_glob;
+} mc_search_multi_pattern_t;
+
+struct mc_search_multi_struct
+{
+    GArray *nodes;
+    GArray *keys;
+    GPtrArray *patterns;
+    GArray *unkeyed;            /* wildcard patterns without literal fragments */
+    guint8 *state;              /* per line state of patterns */
+    guint32 root[256];          /* transitions from root */
+    guchar fold[256];           /* case folding table */
+    gboolean is_utf8;
+    gboolean case_sensitive;
+    gboolean whole_words;
+    gboolean entire_line;
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+
+static void
+mc_search__multi_pattern_free (gpointer data)
+{
+    mc_search_multi_pattern_t *pattern = (mc_search_multi_pattern_t *) data;
+
+    g_string_free (pattern->str, TRUE);
+    g_free (pattern);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__multi_add_pattern (mc_search_multi_t * multi, GString * str, gboolean is_glob)
+{
+    mc_search_multi_pattern_t *pattern;
+
+    pattern = g_new (mc_search_multi_pattern_t, 1);
+    pattern->str = str;
+    pattern->is_glob = is_glob;
+    g_ptr_array_add (multi->patterns, pattern);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__multi_add_split_pattern (mc_search_multi_t * multi, GString * str, gboolean is_glob)
+{
+    if (!is_glob)
+    {
+        /* remove escapes */
+        gsize from, to;
+
+        for (from = 0, to = 0; from < str->len; from++, to++)
+        {
+            if (str->str[from] == '\\' && from + 1 < str->len)
+                from++;
+            str->str[to] = str->str[from];
+        }
+        g_string_truncate (str, to);
+    }
+
+    mc_search__multi_add_pattern (multi, str, is_glob);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split search string to patterns.
+ */
+
+static void
+mc_search__multi_split (mc_search_multi_t * multi, const GString * astr)
+{
+    GString *buff = NULL;
+    gboolean is_glob = FALSE;
+    gsize loop;
+
+    for (loop = 0; loop < astr->len; loop++)
+    {
+        char c = astr->str[loop];
+
+        if (g_ascii_isspace (c))
+        {
+            if (buff != NULL)
+            {
+                mc_search__multi_add_split_pattern (multi, buff, is_glob);
+                buff = NULL;
+                is_glob = FALSE;
+            }
+            continue;
+        }
+
+        if (buff == NULL)
+            buff = g_string_sized_new (16);
+
+        if (c == '\\' && loop + 1 < astr->len)
+        {
+            /* escape is kept to be processed later */
+            g_string_append_c (buff, c);
+            c = astr->str[++loop];
+        }
+        else if (c == '*' || c == '?')
+            is_glob = TRUE;
+
+        g_string_append_c (buff, c);
+    }
+
+    if (buff != NULL)
+        mc_search__multi_add_split_pattern (multi, buff, is_glob);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the longest literal fragment of wildcard pattern.
+ */
+
+static GString *
+mc_search__multi_glob_get_key (const GString * astr)
+{
+    GString *ret, *buff;
+    gsize loop;
+
+    ret = g_string_new ("");
+    buff = g_string_sized_new (16);
+
+    for (loop = 0; loop <= astr->len; loop++)
+    {
+        char c = loop < astr->len ? astr->str[loop] : '*';
+
+        if (c == '*' || c == '?')
+        {
+            if (buff->len > ret->len)
+            {
+                g_string_set_size (ret, 0);
+                g_string_append_len (ret, buff->str, buff->len);
+            }
+            g_string_set_size (buff, 0);
+            continue;
+        }
+
+        if (c == '\\' && loop + 1 < astr->len)
+            c = astr->str[++loop];
+
+        g_string_append_c (buff, c);
+    }
+
+    g_string_free (buff, TRUE);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline guint32
+mc_search__multi_goto (const mc_search_multi_t * multi, guint32 node, guchar c)
+{
+    guint32 n;
+
+    if (node == 0)
+        return multi->root[c];
+
+    for (n = MULTI_NODE (multi, node)->child; n != 0; n = MULTI_NODE (multi, n)->sibling)
+        if (MULTI_NODE (multi, n)->c == c)
+            break;
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__multi_add_key (mc_search_multi_t * multi, guint pattern, const char *str, gsize len)
+{
+    mc_search_multi_key_t key;
+    guint32 node = 0;
+    gint k;
+    gsize loop;
+
+    if (len == 0)
+        return;
+
+    for (loop = 0; loop < len; loop++)
+    {
+        guchar c = multi->fold[(guchar) str[loop]];
+        guint32 next = 0;
+        guint32 n;
+
+        for (n = MULTI_NODE (multi, node)->child; n != 0; n = MULTI_NODE (multi, n)->sibling)
+            if (MULTI_NODE (multi, n)->c == c)
+            {
+                next = n;
+                break;
+            }
+
+        if (next == 0)
+        {
+            mc_search_multi_node_t new_node;
+
+            memset (&new_node, 0, sizeof (new_node));
+            new_node.key = -1;
+            new_node.c = c;
+            new_node.sibling = MULTI_NODE (multi, node)->child;
+            g_array_append_val (multi->nodes, new_node);
+            next = multi->nodes->len - 1;
+            MULTI_NODE (multi, node)->child = next;
+        }
+
+        node = next;
+    }
+
+    /* the same key of the same pattern (case variants) */
+    for (k = MULTI_NODE (multi, node)->key; k >= 0; k = MULTI_KEY (multi, k)->next)
+        if (MULTI_KEY (multi, k)->pattern == pattern)
+            return;
+
+    key.pattern = pattern;
+    key.len = len;
+    key.next = MULTI_NODE (multi, node)->key;
+    g_array_append_val (multi->keys, key);
+    MULTI_NODE (multi, node)->key = multi->keys->len - 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put literal string into automaton. For case insensitive search, upper and lower
+ * variants of non-ASCII symbols are added: ASCII ones are folded while searching.
+ */
+
+static void
+mc_search__multi_add_key_variants (mc_search_multi_t * multi, const char *charset, guint pattern,
+                                   const GString * str)
+{
+    mc_search__multi_add_key (multi, pattern, str->str, str->len);
+
+    if (!multi->case_sensitive)
+    {
+        GString *tmp;
+
+        tmp = mc_search__toupper_case_str (charset, str->str, str->len);
+        mc_search__multi_add_key (multi, pattern, tmp->str, tmp->len);
+        g_string_free (tmp, TRUE);
+
+        tmp = mc_search__tolower_case_str (charset, str->str, str->len);
+        mc_search__multi_add_key (multi, pattern, tmp->str, tmp->len);
+        g_string_free (tmp, TRUE);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Calculate failure and dictionary links using breadth-first traversal of trie.
+ */
+
+static void
+mc_search__multi_build_links (mc_search_multi_t * multi)
+{
+    GArray *queue;
+    guint head;
+    guint32 n;
+
+    queue = g_array_sized_new (FALSE, FALSE, sizeof (guint32), multi->nodes->len);
+
+    for (n = MULTI_NODE (multi, 0)->child; n != 0; n = MULTI_NODE (multi, n)->sibling)
+    {
+        multi->root[MULTI_NODE (multi, n)->c] = n;
+        g_array_append_val (queue, n);
+    }
+
+    for (head = 0; head < queue->len; head++)
+    {
+        guint32 r;
+
+        r = g_array_index (queue, guint32, head);
+
+        for (n = MULTI_NODE (multi, r)->child; n != 0; n = MULTI_NODE (multi, n)->sibling)
+        {
+            guint32 f;
+            guint32 t;
+
+            g_array_append_val (queue, n);
+
+            for (f = MULTI_NODE (multi, r)->fail;; f = MULTI_NODE (multi, f)->fail)
+            {
+                t = mc_search__multi_goto (multi, f, MULTI_NODE (multi, n)->c);
+                if (t != 0 || f == 0)
+                    break;
+            }
+
+            MULTI_NODE (multi, n)->fail = t;
+            MULTI_NODE (multi, n)->dict =
+                MULTI_NODE (multi, t)->key >= 0 ? t : MULTI_NODE (multi, t)->dict;
+        }
+    }
+
+    g_array_free (queue, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+mc_search__multi_is_word_char (char c)
+{
+    /* non-ASCII symbols are treated as letters */
+    return (g_ascii_isalnum (c) || c == '_' || (guchar) c >= 0x80);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__multi_is_match_ok (const mc_search_multi_t * multi, const char *str, gsize len,
+                              gsize start, gsize end)
+{
+    if (multi->entire_line)
+        return (start == 0 && end == len);
+
+    if (multi->whole_words)
+    {
+        if (start > 0 && mc_search__multi_is_word_char (str[start - 1]))
+            return FALSE;
+        if (end < len && mc_search__multi_is_word_char (str[end]))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Match wildcard pattern at the beginning of string.
+ *
+ * @param to_end if TRUE, pattern shall match the whole string
+ *
+ * @return length of the shortest match, -1 if not matched
+ */
+
+static gssize
+mc_search__multi_glob_match (const mc_search_multi_t * multi, const GString * pattern,
+                             const char *str, gsize len, gboolean to_end)
+{
+    const char *pat = pattern->str;
+    gsize p = 0, s = 0;
+    gsize star_p = 0, star_s = 0;
+    gboolean star = FALSE;
+
+    while (TRUE)
+    {
+        if (p < pattern->len && pat[p] == '*')
+        {
+            star = TRUE;
+            star_p = ++p;
+            star_s = s;
+            continue;
+        }
+
+        if (p == pattern->len)
+        {
+            if (!to_end || s == len)
+                return (gssize) s;
+        }
+        else if (s < len)
+        {
+            if (pat[p] == '?')
+            {
+                gsize n = 1;
+
+                if (multi->is_utf8)
+                    n = MIN ((gsize) g_utf8_skip[(guchar) str[s]], len - s);
+
+                p++;
+                s += n;
+                continue;
+            }
+            else
+            {
+                gsize n = 1;
+                char c = pat[p];
+
+                if (c == '\\' && p + 1 < pattern->len)
+                {
+                    c = pat[p + 1];
+                    n = 2;
+                }
+
+                if (multi->fold[(guchar) c] == multi->fold[(guchar) str[s]])
+                {
+                    p += n;
+                    s++;
+                    continue;
+                }
+            }
+        }
+
+        /* mismatch: let the last '*' take one more byte */
+        if (!star || star_s >= len)
+            return -1;
+
+        p = star_p;
+        s = ++star_s;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the leftmost match of wildcard pattern in line.
+ */
+
+static gboolean
+mc_search__multi_glob_find (const mc_search_multi_t * multi, const GString * pattern,
+                            const char *str, gsize len, gsize * start_pos, gsize * end_pos)
+{
+    gsize start;
+
+    for (start = 0; start <= len; start++)
+    {
+        gssize match_len;
+
+        match_len =
+            mc_search__multi_glob_match (multi, pattern, str + start, len - start,
+                                         multi->entire_line);
+        if (match_len >= 0
+            && mc_search__multi_is_match_ok (multi, str, len, start, start + match_len))
+        {
+            *start_pos = start;
+            *end_pos = start + match_len;
+            return TRUE;
+        }
+
+        if (multi->entire_line)
+            break;
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__multi_found_pattern (mc_search_t * lc_mc_search, mc_search_multi_t * multi,
+                                guint pattern, gsize start, gsize end, gsize * start_pos,
+                                gsize * end_pos)
+{
+    if (multi->state[pattern] != MULTI_PATTERN_FOUND)
+    {
+        multi->state[pattern] = MULTI_PATTERN_FOUND;
+        g_array_append_val (lc_mc_search->multi_matches, pattern);
+    }
+
+    /* leftmost-longest match is reported */
+    if (start < *start_pos || (start == *start_pos && end > *end_pos))
+    {
+        *start_pos = start;
+        *end_pos = end;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__multi_check_glob (mc_search_t * lc_mc_search, mc_search_multi_t * multi,
+                             guint pattern, const char *str, gsize len, gsize * start_pos,
+                             gsize * end_pos)
+{
+    const mc_search_multi_pattern_t *p;
+    gsize start, end;
+
+    /* wildcard pattern is checked once per line */
+    if (multi->state[pattern] != MULTI_PATTERN_UNKNOWN)
+        return;
+
+    p = (const mc_search_multi_pattern_t *) g_ptr_array_index (multi->patterns, pattern);
+
+    if (mc_search__multi_glob_find (multi, p->str, str, len, &start, &end))
+        mc_search__multi_found_pattern (lc_mc_search, multi, pattern, start, end, start_pos,
+                                        end_pos);
+    else
+        multi->state[pattern] = MULTI_PATTERN_FAILED;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search__cond_struct_new_init_multi (const char *charset, mc_search_t * lc_mc_search,
+                                       mc_search_cond_t * mc_search_cond)
+{
+    mc_search_multi_t *multi;
+    guint loop;
+
+    multi = mc_search__multi_new (lc_mc_search, charset, lc_mc_search->is_entire_line);
+
+    mc_search__multi_split (multi, mc_search_cond->str);
+
+    for (loop = 0; loop < multi->patterns->len; loop++)
+    {
+        const mc_search_multi_pattern_t *p;
+
+        p = (const mc_search_multi_pattern_t *) g_ptr_array_index (multi->patterns, loop);
+
+        if (!p->is_glob)
+            mc_search__multi_add_key_variants (multi, charset, loop, p->str);
+        else
+        {
+            GString *key;
+
+            key = mc_search__multi_glob_get_key (p->str);
+            if (key->len == 0)
+                g_array_append_val (multi->unkeyed, loop);
+            else
+                mc_search__multi_add_key_variants (multi, charset, loop, key);
+            g_string_free (key, TRUE);
+        }
+    }
+
+    mc_search__multi_build (multi);
+
+    mc_search_cond->multi = multi;
+    lc_mc_search->is_utf8 = multi->is_utf8;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create empty automaton. Use mc_search__multi_add_literal() to fill it and
+ * mc_search__multi_build() to make it ready for search.
+ *
+ * @param charset charset of patterns
+ * @param entire_line if TRUE, pattern shall match the whole line
+ */
+
+mc_search_multi_t *
+mc_search__multi_new (const mc_search_t * lc_mc_search, const char *charset, gboolean entire_line)
+{
+    mc_search_multi_t *multi;
+    mc_search_multi_node_t root;
+    guint loop;
+
+    multi = g_new0 (mc_search_multi_t, 1);
+    multi->nodes = g_array_new (FALSE, FALSE, sizeof (mc_search_multi_node_t));
+    multi->keys = g_array_new (FALSE, FALSE, sizeof (mc_search_multi_key_t));
+    multi->patterns = g_ptr_array_new_with_free_func (mc_search__multi_pattern_free);
+    multi->unkeyed = g_array_new (FALSE, FALSE, sizeof (guint));
+    multi->is_utf8 = str_isutf8 (charset);
+    multi->case_sensitive = lc_mc_search->is_case_sensitive;
+    multi->entire_line = entire_line;
+    multi->whole_words = lc_mc_search->whole_words && !entire_line;
+
+    for (loop = 0; loop < G_N_ELEMENTS (multi->fold); loop++)
+        multi->fold[loop] = multi->case_sensitive ? loop : g_ascii_tolower (loop);
+
+    memset (&root, 0, sizeof (root));
+    root.key = -1;
+    g_array_append_val (multi->nodes, root);
+
+    return multi;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add literal pattern. Nothing is added if the same pattern already exists.
+ *
+ * @param charset charset of #str, used to make case variants of non-ASCII symbols
+ */
+
+void
+mc_search__multi_add_literal (mc_search_multi_t * multi, const char *charset, const char *str,
+                              gsize len)
+{
+    GString *s;
+    guint loop;
+
+    for (loop = 0; loop < multi->patterns->len; loop++)
+    {
+        const mc_search_multi_pattern_t *p;
+
+        p = (const mc_search_multi_pattern_t *) g_ptr_array_index (multi->patterns, loop);
+        if (!p->is_glob && p->str->len == len && memcmp (p->str->str, str, len) == 0)
+            return;
+    }
+
+    s = g_string_new_len (str, len);
+    mc_search__multi_add_pattern (multi, s, FALSE);
+    mc_search__multi_add_key_variants (multi, charset, multi->patterns->len - 1, s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search__multi_build (mc_search_multi_t * multi)
+{
+    mc_search__multi_build_links (multi);
+
+    multi->state = g_new0 (guint8, multi->patterns->len + 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search__multi_free (mc_search_multi_t * multi)
+{
+    if (multi == NULL)
+        return;
+
+    g_array_free (multi->nodes, TRUE);
+    g_array_free (multi->keys, TRUE);
+    g_ptr_array_free (multi->patterns, TRUE);
+    g_array_free (multi->unkeyed, TRUE);
+    g_free (multi->state);
+    g_free (multi);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search all patterns in one line.
+ *
+ * Indexes of all patterns found in line are stored in lc_mc_search->multi_matches.
+ *
+ * @param start_pos start of the leftmost match (output)
+ * @param end_pos end of the leftmost match (output)
+ *
+ * @return COND__FOUND_OK if any pattern is found, COND__NOT_FOUND otherwise
+ */
+
+mc_search__found_cond_t
+mc_search__multi_found_cond (mc_search_t * lc_mc_search, mc_search_multi_t * multi,
+                             const GString * search_str, gint * start_pos, gint * end_pos)
+{
+    const char *str = search_str->str;
+    gsize len = search_str->len;
+    gsize best_start = G_MAXSIZE, best_end = 0;
+    guint32 node = 0;
+    gsize loop;
+
+    if (lc_mc_search->multi_matches == NULL)
+        lc_mc_search->multi_matches = g_array_new (FALSE, FALSE, sizeof (guint));
+    else
+        g_array_set_size (lc_mc_search->multi_matches, 0);
+
+    memset (multi->state, MULTI_PATTERN_UNKNOWN, multi->patterns->len);
+
+    /* line end is not a part of line */
+    if (len != 0 && str[len - 1] == '\n')
+        len--;
+
+    for (loop = 0; loop < len; loop++)
+    {
+        guchar c = multi->fold[(guchar) str[loop]];
+        guint32 next, n;
+
+        while ((next = mc_search__multi_goto (multi, node, c)) == 0 && node != 0)
+            node = MULTI_NODE (multi, node)->fail;
+        node = next;
+
+        n = MULTI_NODE (multi, node)->key >= 0 ? node : MULTI_NODE (multi, node)->dict;
+
+        for (; n != 0; n = MULTI_NODE (multi, n)->dict)
+        {
+            gint k;
+
+            for (k = MULTI_NODE (multi, n)->key; k >= 0; k = MULTI_KEY (multi, k)->next)
+            {
+                const mc_search_multi_key_t *key = MULTI_KEY (multi, k);
+                const mc_search_multi_pattern_t *p;
+                gsize start = loop + 1 - key->len;
+
+                p = (const mc_search_multi_pattern_t *) g_ptr_array_index (multi->patterns,
+                                                                           key->pattern);
+                if (p->is_glob)
+                    mc_search__multi_check_glob (lc_mc_search, multi, key->pattern, str, len,
+                                                 &best_start, &best_end);
+                else if (mc_search__multi_is_match_ok (multi, str, len, start, loop + 1))
+                    mc_search__multi_found_pattern (lc_mc_search, multi, key->pattern, start,
+                                                    loop + 1, &best_start, &best_end);
+            }
+        }
+    }
+
+    for (loop = 0; loop < multi->unkeyed->len; loop++)
+        mc_search__multi_check_glob (lc_mc_search, multi,
+                                     g_array_index (multi->unkeyed, guint, loop), str, len,
+                                     &best_start, &best_end);
+
+    if (lc_mc_search->multi_matches->len == 0)
+        return COND__NOT_FOUND;
+
+    lc_mc_search->num_results = 1;
+    *start_pos = (gint) best_start;
+    *end_pos = (gint) best_end;
+    return COND__FOUND_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+mc_search__run_multi (mc_search_t * lc_mc_search, const void *user_data,
+                      gsize start_search, gsize end_search, gsize * found_len)
+{
+    return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+GString *
+mc_search_multi_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str)
+{
+    (void) lc_mc_search;
+    return g_string_new_len (replace_str->str, replace_str->len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
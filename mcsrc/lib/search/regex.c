@@ -319,14 +319,14 @@ mc_search__g_regex_match_full_safe (const GRegex * regex,
 /* --------------------------------------------------------------------------------------------- */
 
 static mc_search__found_cond_t
-mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t * regex,
+mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_cond_t * mc_search_cond,
                                  GString * search_str)
 {
 #ifdef SEARCH_TYPE_GLIB
     GError *mcerror = NULL;
 
     if (!mc_search__g_regex_match_full_safe
-        (regex, search_str->str, search_str->len, 0, G_REGEX_MATCH_NEWLINE_ANY,
+        (mc_search_cond->regex_handle, search_str->str, search_str->len, 0, G_REGEX_MATCH_NEWLINE_ANY,
          &lc_mc_search->regex_match_info, &mcerror))
     {
         g_match_info_free (lc_mc_search->regex_match_info);
@@ -344,7 +344,8 @@ mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t *
     }
     lc_mc_search->num_results = g_match_info_get_match_count (lc_mc_search->regex_match_info);
 #else /* SEARCH_TYPE_GLIB */
-    lc_mc_search->num_results = pcre_exec (regex, lc_mc_search->regex_match_info,
+    lc_mc_search->num_results = pcre_exec (mc_search_cond->regex_handle,
+                                           mc_search_cond->regex_extra,
                                            search_str->str, search_str->len, 0, 0,
                                            lc_mc_search->iovector, MC_SEARCH__NUM_REPLACE_ARGS);
     if (lc_mc_search->num_results < 0)
@@ -359,7 +360,8 @@ mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t *
 /* --------------------------------------------------------------------------------------------- */
 
 static mc_search__found_cond_t
-mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
+mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str, gint * start_pos,
+                             gint * end_pos)
 {
     gsize loop1;
 
@@ -370,12 +372,26 @@ mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
 
         mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop1);
 
-        if (!mc_search_cond->regex_handle)
+        if (mc_search_cond->multi != NULL)
+            ret =
+                mc_search__multi_found_cond (lc_mc_search, mc_search_cond->multi, search_str,
+                                             start_pos, end_pos);
+        else if (!mc_search_cond->regex_handle)
             continue;
+        else
+        {
+            ret = mc_search__regex_found_cond_one (lc_mc_search, mc_search_cond, search_str);
+            if (ret == COND__FOUND_OK)
+            {
+#ifdef SEARCH_TYPE_GLIB
+                g_match_info_fetch_pos (lc_mc_search->regex_match_info, 0, start_pos, end_pos);
+#else /* SEARCH_TYPE_GLIB */
+                *start_pos = lc_mc_search->iovector[0];
+                *end_pos = lc_mc_search->iovector[1];
+#endif /* SEARCH_TYPE_GLIB */
+            }
+        }
 
-        ret =
-            mc_search__regex_found_cond_one (lc_mc_search, mc_search_cond->regex_handle,
-                                             search_str);
         if (ret != COND__NOT_FOUND)
             return ret;
     }
@@ -865,8 +881,14 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
             mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_COMPILE, "%s", error);
             return;
         }
-        lc_mc_search->regex_match_info = pcre_study (mc_search_cond->regex_handle, 0, &error);
-        if (lc_mc_search->regex_match_info == NULL && error != NULL)
+#ifdef PCRE_STUDY_JIT_COMPILE
+        /* JIT compiled code is used by pcre_exec() transparently */
+        mc_search_cond->regex_extra =
+            pcre_study (mc_search_cond->regex_handle, PCRE_STUDY_JIT_COMPILE, &error);
+#else
+        mc_search_cond->regex_extra = pcre_study (mc_search_cond->regex_handle, 0, &error);
+#endif
+        if (mc_search_cond->regex_extra == NULL && error != NULL)
         {
             mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_COMPILE, "%s", error);
             MC_PTR_FREE (mc_search_cond->regex_handle);
@@ -900,7 +922,43 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
         g_string_set_size (lc_mc_search->regex_buffer, 0);
         lc_mc_search->start_buffer = current_pos;
 
-        if (lc_mc_search->search_fn != NULL)
+        if (lc_mc_search->span_fn != NULL)
+        {
+            /* data source returns contiguous blocks: copy up to end of line at once,
+             * a line which crosses the block boundary is collected from several blocks */
+            while (TRUE)
+            {
+                const char *span = NULL;
+                gsize span_len = 0;
+                const char *eol;
+
+                ret = lc_mc_search->span_fn (user_data, current_pos, &span, &span_len);
+
+                if (ret != MC_SEARCH_CB_OK || span == NULL || span_len == 0)
+                {
+                    if (ret == MC_SEARCH_CB_OK)
+                        ret = MC_SEARCH_CB_NOTFOUND;
+                    break;
+                }
+
+                span_len = MIN (span_len, end_search - virtual_pos + 1);
+                eol = memchr (span, '\n', span_len);
+                if (eol != NULL)
+                    span_len = eol - span + 1;
+
+                g_string_append_len (lc_mc_search->regex_buffer, span, span_len);
+                current_pos += span_len;
+                virtual_pos += span_len;
+
+                if (eol != NULL || virtual_pos > end_search)
+                    break;
+            }
+
+            /* no more data */
+            if (ret != MC_SEARCH_CB_OK && lc_mc_search->regex_buffer->len == 0)
+                break;
+        }
+        else if (lc_mc_search->search_fn != NULL)
         {
             while (TRUE)
             {
@@ -952,15 +1010,10 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
             virtual_pos = current_pos;
         }
 
-        switch (mc_search__regex_found_cond (lc_mc_search, lc_mc_search->regex_buffer))
+        switch (mc_search__regex_found_cond
+                (lc_mc_search, lc_mc_search->regex_buffer, &start_pos, &end_pos))
         {
         case COND__FOUND_OK:
-#ifdef SEARCH_TYPE_GLIB
-            g_match_info_fetch_pos (lc_mc_search->regex_match_info, 0, &start_pos, &end_pos);
-#else /* SEARCH_TYPE_GLIB */
-            start_pos = lc_mc_search->iovector[0];
-            end_pos = lc_mc_search->iovector[1];
-#endif /* SEARCH_TYPE_GLIB */
             if (found_len != NULL)
                 *found_len = end_pos - start_pos;
             lc_mc_search->normal_offset = lc_mc_search->start_buffer + start_pos;
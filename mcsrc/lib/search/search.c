@@ -34,6 +34,7 @@
 #include "lib/global.h"
 #include "lib/strutil.h"
 #include "lib/search.h"
+#include "lib/timer.h"
 #include "lib/util.h"
 #ifdef HAVE_CHARSET
 #include "lib/charsets.h"
@@ -45,10 +46,30 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* max number of prepared conditions kept for reuse */
+#define MC_SEARCH_CACHE_SIZE 32
+
+/* timer isn't started in some programs (tests) */
+#define MC_SEARCH_NOW() (mc_global.timer != NULL ? mc_timer_elapsed (mc_global.timer) : 0)
+
 /*** file scope type declarations ****************************************************************/
 
+typedef struct
+{
+    GString *key;
+    GPtrArray *conditions;
+    gboolean is_utf8;
+} mc_search_cache_entry_t;
+
 /*** file scope variables ************************************************************************/
 
+/* prepared conditions: most recently used are at the head */
+static GQueue mc_search_cache = G_QUEUE_INIT;
+/* key -> link in mc_search_cache */
+static GHashTable *mc_search_cache_index = NULL;
+
+static mc_search_stats_t mc_search_stats;
+
 static const mc_search_type_str_t mc_search__list_types[] = {
     {N_("No&rmal"), MC_SEARCH_T_NORMAL},
     {N_("Re&gular expression"), MC_SEARCH_T_REGEX},
@@ -83,6 +104,9 @@ mc_search__cond_struct_new (mc_search_t * lc_mc_search, const char *str,
     case MC_SEARCH_T_HEX:
         mc_search__cond_struct_new_init_hex (charset, lc_mc_search, mc_search_cond);
         break;
+    case MC_SEARCH_T_MULTI:
+        mc_search__cond_struct_new_init_multi (charset, lc_mc_search, mc_search_cond);
+        break;
     default:
         break;
     }
@@ -108,8 +132,15 @@ mc_search__cond_struct_free (mc_search_cond_t * mc_search_cond)
         g_regex_unref (mc_search_cond->regex_handle);
 #else /* SEARCH_TYPE_GLIB */
     g_free (mc_search_cond->regex_handle);
+#ifdef PCRE_STUDY_JIT_COMPILE
+    pcre_free_study (mc_search_cond->regex_extra);
+#else
+    g_free (mc_search_cond->regex_extra);
+#endif
 #endif /* SEARCH_TYPE_GLIB */
 
+    mc_search__multi_free (mc_search_cond->multi);
+
     g_free (mc_search_cond);
 }
 
@@ -118,10 +149,218 @@ mc_search__cond_struct_free (mc_search_cond_t * mc_search_cond)
 static void
 mc_search__conditions_free (GPtrArray * array)
 {
-    g_ptr_array_foreach (array, (GFunc) mc_search__cond_struct_free, NULL);
-    g_ptr_array_free (array, TRUE);
+    /* conditions can be shared with cache */
+    g_ptr_array_unref (array);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__cache_entry_free (mc_search_cache_entry_t * entry)
+{
+    g_string_free (entry->key, TRUE);
+    mc_search__conditions_free (entry->conditions);
+    g_free (entry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make key of prepared conditions: everything what conditions depend on.
+ */
+
+static GString *
+mc_search__cache_key (const mc_search_t * lc_mc_search)
+{
+    GString *key;
+    const char *charset;
+    gboolean all_charsets = FALSE;
+
+#ifdef HAVE_CHARSET
+    charset = lc_mc_search->original_charset;
+    all_charsets = lc_mc_search->is_all_charsets;
+#else
+    charset = str_detect_termencoding ();
+#endif
+
+    key = g_string_sized_new (lc_mc_search->original_len + 32);
+    g_string_printf (key, "%d:%d%d%d%d%d:%s:", (int) lc_mc_search->search_type,
+                     lc_mc_search->is_case_sensitive ? 1 : 0, lc_mc_search->whole_words ? 1 : 0,
+                     lc_mc_search->is_entire_line ? 1 : 0, all_charsets ? 1 : 0,
+                     mc_global.utf8_display ? 1 : 0, charset);
+    g_string_append_len (key, lc_mc_search->original, lc_mc_search->original_len);
+
+    return key;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__cache_lookup (mc_search_t * lc_mc_search, const GString * key)
+{
+    GList *link;
+    mc_search_cache_entry_t *entry;
+
+    if (mc_search_cache_index == NULL)
+        return FALSE;
+
+    link = (GList *) g_hash_table_lookup (mc_search_cache_index, key);
+    if (link == NULL)
+        return FALSE;
+
+    /* move to the head */
+    g_queue_unlink (&mc_search_cache, link);
+    g_queue_push_head_link (&mc_search_cache, link);
+
+    entry = (mc_search_cache_entry_t *) link->data;
+    lc_mc_search->conditions = g_ptr_array_ref (entry->conditions);
+    /* the only side effect of conditions preparing */
+    lc_mc_search->is_utf8 = entry->is_utf8;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__cache_add (const mc_search_t * lc_mc_search, GString * key)
+{
+    mc_search_cache_entry_t *entry;
+
+    if (mc_search_cache_index == NULL)
+        mc_search_cache_index =
+            g_hash_table_new ((GHashFunc) g_string_hash, (GEqualFunc) g_string_equal);
+
+    entry = g_new (mc_search_cache_entry_t, 1);
+    entry->key = key;
+    entry->conditions = g_ptr_array_ref (lc_mc_search->conditions);
+    entry->is_utf8 = lc_mc_search->is_utf8;
+
+    g_queue_push_head (&mc_search_cache, entry);
+    g_hash_table_insert (mc_search_cache_index, key, mc_search_cache.head);
+
+    if (mc_search_cache.length > MC_SEARCH_CACHE_SIZE)
+    {
+        entry = (mc_search_cache_entry_t *) g_queue_pop_tail (&mc_search_cache);
+        g_hash_table_remove (mc_search_cache_index, entry->key);
+        mc_search__cache_entry_free (entry);
+    }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_CHARSET
+static gboolean
+mc_search__is_ascii_str (const char *str, gsize len)
+{
+    gsize i;
+
+    for (i = 0; i < len; i++)
+        if ((guchar) str[i] >= 0x80)
+            return FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make conditions for search in all charsets.
+ *
+ * Search string is recoded to every codepage, codepages which give the same bytes share
+ * one condition. Plain search is done in one pass: all recoded strings are put into one
+ * multi-pattern automaton. This is impossible for case insensitive search of non-ASCII
+ * string because automaton folds only ASCII letters.
+ */
+
+static void
+mc_search__prepare_all_charsets (mc_search_t * lc_mc_search, GPtrArray * conditions)
+{
+    GPtrArray *strs, *ids;
+    gsize loop1;
+
+    strs = g_ptr_array_new ();
+    ids = g_ptr_array_new ();
+
+    for (loop1 = 0; loop1 < codepages->len; loop1++)
+    {
+        const char *id;
+        GString *buffer;
+        gsize loop2;
+
+        id = ((codepage_desc *) g_ptr_array_index (codepages, loop1))->id;
+        if (g_ascii_strcasecmp (id, lc_mc_search->original_charset) == 0)
+        {
+            buffer = g_string_new_len (lc_mc_search->original, lc_mc_search->original_len);
+            id = lc_mc_search->original_charset;
+        }
+        else
+        {
+            gchar *recoded_str;
+            gsize recoded_str_len;
+
+            recoded_str =
+                mc_search__recode_str (lc_mc_search->original, lc_mc_search->original_len,
+                                       lc_mc_search->original_charset, id, &recoded_str_len);
+            buffer = g_string_new_len (recoded_str, recoded_str_len);
+            g_free (recoded_str);
+        }
+
+        /* UTF-8 and 8-bit strings are compiled with different options */
+        for (loop2 = 0; loop2 < strs->len; loop2++)
+            if (g_string_equal (buffer, (GString *) g_ptr_array_index (strs, loop2))
+                && str_isutf8 (id) == str_isutf8 ((const char *) g_ptr_array_index (ids, loop2)))
+                break;
+
+        if (loop2 < strs->len)
+            g_string_free (buffer, TRUE);
+        else
+        {
+            g_ptr_array_add (strs, buffer);
+            g_ptr_array_add (ids, (gpointer) id);
+        }
+    }
+
+    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL
+        && (lc_mc_search->is_case_sensitive
+            || mc_search__is_ascii_str (lc_mc_search->original, lc_mc_search->original_len)))
+    {
+        mc_search_cond_t *mc_search_cond;
+
+        mc_search_cond = g_new0 (mc_search_cond_t, 1);
+        mc_search_cond->str = g_string_new_len (lc_mc_search->original, lc_mc_search->original_len);
+        mc_search_cond->charset = g_strdup (lc_mc_search->original_charset);
+        mc_search_cond->multi =
+            mc_search__multi_new (lc_mc_search, lc_mc_search->original_charset, FALSE);
+
+        for (loop1 = 0; loop1 < strs->len; loop1++)
+        {
+            const GString *str = (const GString *) g_ptr_array_index (strs, loop1);
+
+            mc_search__multi_add_literal (mc_search_cond->multi,
+                                          (const char *) g_ptr_array_index (ids, loop1),
+                                          str->str, str->len);
+        }
+
+        mc_search__multi_build (mc_search_cond->multi);
+        lc_mc_search->is_utf8 = str_isutf8 (lc_mc_search->original_charset);
+        g_ptr_array_add (conditions, mc_search_cond);
+    }
+    else
+        for (loop1 = 0; loop1 < strs->len; loop1++)
+        {
+            const GString *str = (const GString *) g_ptr_array_index (strs, loop1);
+            const char *id = (const char *) g_ptr_array_index (ids, loop1);
+
+            g_ptr_array_add (conditions,
+                             mc_search__cond_struct_new (lc_mc_search, str->str, str->len, id));
+        }
+
+    for (loop1 = 0; loop1 < strs->len; loop1++)
+        g_string_free ((GString *) g_ptr_array_index (strs, loop1), TRUE);
+    g_ptr_array_free (strs, TRUE);
+    g_ptr_array_free (ids, TRUE);
+}
+#endif /* HAVE_CHARSET */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -201,6 +440,9 @@ mc_search_free (mc_search_t * lc_mc_search)
     if (lc_mc_search->regex_buffer != NULL)
         g_string_free (lc_mc_search->regex_buffer, TRUE);
 
+    if (lc_mc_search->multi_matches != NULL)
+        g_array_free (lc_mc_search->multi_matches, TRUE);
+
     g_free (lc_mc_search);
 }
 
@@ -210,39 +452,23 @@ gboolean
 mc_search_prepare (mc_search_t * lc_mc_search)
 {
     GPtrArray *ret;
+    GString *key;
+    guint64 start_time;
 
-    ret = g_ptr_array_new ();
-#ifdef HAVE_CHARSET
-    if (lc_mc_search->is_all_charsets)
+    key = mc_search__cache_key (lc_mc_search);
+    if (mc_search__cache_lookup (lc_mc_search, key))
     {
-        gsize loop1;
+        mc_search_stats.cache_hits++;
+        g_string_free (key, TRUE);
+        return TRUE;
+    }
 
-        for (loop1 = 0; loop1 < codepages->len; loop1++)
-        {
-            const char *id;
-            gsize recoded_str_len;
-            gchar *buffer;
-
-            id = ((codepage_desc *) g_ptr_array_index (codepages, loop1))->id;
-            if (g_ascii_strcasecmp (id, lc_mc_search->original_charset) == 0)
-            {
-                g_ptr_array_add (ret,
-                                 mc_search__cond_struct_new (lc_mc_search, lc_mc_search->original,
-                                                             lc_mc_search->original_len,
-                                                             lc_mc_search->original_charset));
-                continue;
-            }
-
-            buffer =
-                mc_search__recode_str (lc_mc_search->original, lc_mc_search->original_len,
-                                       lc_mc_search->original_charset, id, &recoded_str_len);
+    start_time = MC_SEARCH_NOW ();
 
-            g_ptr_array_add (ret,
-                             mc_search__cond_struct_new (lc_mc_search, buffer,
-                                                         recoded_str_len, id));
-            g_free (buffer);
-        }
-    }
+    ret = g_ptr_array_new_with_free_func ((GDestroyNotify) mc_search__cond_struct_free);
+#ifdef HAVE_CHARSET
+    if (lc_mc_search->is_all_charsets)
+        mc_search__prepare_all_charsets (lc_mc_search, ret);
     else
     {
         g_ptr_array_add (ret,
@@ -258,7 +484,17 @@ mc_search_prepare (mc_search_t * lc_mc_search)
 #endif
     lc_mc_search->conditions = ret;
 
-    return (lc_mc_search->error == MC_SEARCH_E_OK);
+    mc_search_stats.compile_count++;
+    mc_search_stats.compile_time += MC_SEARCH_NOW () - start_time;
+
+    if (lc_mc_search->error != MC_SEARCH_E_OK)
+    {
+        g_string_free (key, TRUE);
+        return FALSE;
+    }
+
+    mc_search__cache_add (lc_mc_search, key);
+    return TRUE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -302,6 +538,9 @@ mc_search_run (mc_search_t * lc_mc_search, const void *user_data,
     if ((lc_mc_search->conditions == NULL) && !mc_search_prepare (lc_mc_search))
         return FALSE;
 
+    /* search is run for every line or position: only count, don't read timer */
+    mc_search_stats.match_count++;
+
     switch (lc_mc_search->search_type)
     {
     case MC_SEARCH_T_NORMAL:
@@ -316,9 +555,13 @@ mc_search_run (mc_search_t * lc_mc_search, const void *user_data,
     case MC_SEARCH_T_HEX:
         ret = mc_search__run_hex (lc_mc_search, user_data, start_search, end_search, found_len);
         break;
+    case MC_SEARCH_T_MULTI:
+        ret = mc_search__run_multi (lc_mc_search, user_data, start_search, end_search, found_len);
+        break;
     default:
         break;
     }
+
     return ret;
 }
 
@@ -333,6 +576,7 @@ mc_search_is_type_avail (mc_search_type_t search_type)
     case MC_SEARCH_T_NORMAL:
     case MC_SEARCH_T_REGEX:
     case MC_SEARCH_T_HEX:
+    case MC_SEARCH_T_MULTI:
         return TRUE;
     default:
         break;
@@ -379,6 +623,9 @@ mc_search_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str
     case MC_SEARCH_T_HEX:
         ret = mc_search_hex_prepare_replace_str (lc_mc_search, replace_str);
         break;
+    case MC_SEARCH_T_MULTI:
+        ret = mc_search_multi_prepare_replace_str (lc_mc_search, replace_str);
+        break;
     default:
         ret = g_string_new_len (replace_str->str, replace_str->len);
         break;
@@ -411,6 +658,7 @@ mc_search_is_fixed_search_str (mc_search_t * lc_mc_search)
     {
     case MC_SEARCH_T_REGEX:
     case MC_SEARCH_T_GLOB:
+    case MC_SEARCH_T_MULTI:
         return FALSE;
     default:
         return TRUE;
@@ -423,7 +671,7 @@ mc_search_is_fixed_search_str (mc_search_t * lc_mc_search)
  * @param pattern string to search
  * @param pattern_charset charset of #pattern. If NULL then cp_display will be used
  * @param str string where search #pattern
- * @param search type (normal, regex, hex or glob)
+ * @param search type (normal, regex, hex, glob or multi)
  *
  * @return TRUE if found is successful, FALSE otherwise.
  */
@@ -460,7 +708,8 @@ mc_search_getstart_result_by_num (mc_search_t * lc_mc_search, int lc_index)
 {
     if (lc_mc_search == NULL)
         return 0;
-    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL)
+    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL
+        || lc_mc_search->search_type == MC_SEARCH_T_MULTI)
         return 0;
 #ifdef SEARCH_TYPE_GLIB
     {
@@ -482,7 +731,8 @@ mc_search_getend_result_by_num (mc_search_t * lc_mc_search, int lc_index)
 {
     if (lc_mc_search == NULL)
         return 0;
-    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL)
+    if (lc_mc_search->search_type == MC_SEARCH_T_NORMAL
+        || lc_mc_search->search_type == MC_SEARCH_T_MULTI)
         return 0;
 #ifdef SEARCH_TYPE_GLIB
     {
@@ -524,3 +774,54 @@ mc_search_set_error (mc_search_t * lc_mc_search, mc_search_error_t code, const g
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Get counters of conditions preparing and search running.
+ */
+
+const mc_search_stats_t *
+mc_search_get_stats (void)
+{
+    return &mc_search_stats;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search_reset_stats (void)
+{
+    memset (&mc_search_stats, 0, sizeof (mc_search_stats));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write counters of conditions preparing and search running to log.
+ */
+
+void
+mc_search_log_stats (void)
+{
+    mc_log ("search: %" G_GUINT64_FORMAT " conditions prepared in %" G_GUINT64_FORMAT
+            " us, %" G_GUINT64_FORMAT " reused, %" G_GUINT64_FORMAT " searches run\n",
+            mc_search_stats.compile_count, mc_search_stats.compile_time,
+            mc_search_stats.cache_hits, mc_search_stats.match_count);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free all prepared conditions kept for reuse.
+ */
+
+void
+mc_search_cache_free (void)
+{
+    if (mc_search_cache_index != NULL)
+    {
+        g_hash_table_destroy (mc_search_cache_index);
+        mc_search_cache_index = NULL;
+    }
+
+    g_queue_foreach (&mc_search_cache, (GFunc) mc_search__cache_entry_free, NULL);
+    g_queue_clear (&mc_search_cache);
+}
+
+/* --------------------------------------------------------------------------------------------- */
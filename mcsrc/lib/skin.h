@@ -107,7 +107,10 @@
 #define DFF_DEL_COLOR             mc_skin_color__cache[64]
 #define DFF_ERROR_COLOR           mc_skin_color__cache[65]
 
-#define MC_SKIN_COLOR_CACHE_COUNT 66
+/* color of misspelled words in editor */
+#define EDITOR_SPELL_COLOR        mc_skin_color__cache[66]
+
+#define MC_SKIN_COLOR_CACHE_COUNT 67
 
 /*** enums ***************************************************************************************/
 
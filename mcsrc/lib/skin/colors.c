@@ -306,6 +306,7 @@ mc_skin_color_cache_init (void)
     EDITOR_FRAME = mc_skin_color_get ("editor", "editframe");
     EDITOR_FRAME_ACTIVE = mc_skin_color_get ("editor", "editframeactive");
     EDITOR_FRAME_DRAG = mc_skin_color_get ("editor", "editframedrag");
+    EDITOR_SPELL_COLOR = mc_skin_color_get ("editor", "editspellerror");
 
     BOOK_MARK_COLOR = mc_skin_color_get ("editor", "bookmark");
     BOOK_MARK_FOUND_COLOR = mc_skin_color_get ("editor", "bookmarkfound");
@@ -35,6 +35,7 @@
 #include <config.h>
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -43,6 +44,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "lib/global.h"
@@ -71,10 +73,55 @@
 #define ASCII_a (0x60 + 1)
 #define ASCII_z (0x60 + 26)
 
+/* record of default position, it's saved to forget the previous position */
+#define FILEPOS_DEFAULT_RECORD "1;0;0"
+#define FILEPOS_LOCK_SUFFIX ".lock"
+/* lock of file with positions left by crashed instance is removed after timeout (in seconds) */
+#define FILEPOS_LOCK_TIMEOUT 60
+/* how many bytes before the end of read part are compared to detect replaced file */
+#define FILEPOS_TAIL_LEN 64
+/* the first line of file with positions kept as log, skipped by older versions */
+#define FILEPOS_LOG_HEADER "#mc-filepos-log"
+
 /*** file scope type declarations ****************************************************************/
 
+/* the last saved position of a file */
+typedef struct
+{
+    char *name;                 /* file name */
+    char *record;               /* "line;column;offset[;bookmark...]" */
+    size_t seq;                 /* number of the record in file with positions */
+} filepos_entry_t;
+
+/* index of file with positions */
+typedef struct
+{
+    GHashTable *entries;        /* file name -> filepos_entry_t */
+    size_t lines;               /* number of records read */
+    long size;                  /* number of bytes read */
+    char tail[FILEPOS_TAIL_LEN];        /* bytes before 'size' */
+    size_t tail_len;
+    gboolean legacy;            /* file of older version: records are read in reverse order */
+    /* state of file when it was read */
+    dev_t dev;
+    ino_t ino;
+    off_t file_size;
+} filepos_index_t;
+
 /*** file scope variables ************************************************************************/
 
+/*-
+ * File with positions is a log: new records are appended, the last record of file is valid.
+ * Instances of mc append records with single write, so they don't lose updates of each other.
+ * Records are read into index once, later only the appended part of file is read.
+ * When there are too many outdated records, the file is compacted: the last records are written
+ * to a new file which replaces the old one.
+ *
+ * Older versions kept the most recent record first. Such file doesn't start with header line,
+ * it's converted to log by compaction before the first record is appended.
+ */
+static filepos_index_t *filepos_index = NULL;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -217,6 +264,373 @@ mc_util_write_backup_content (const char *from_file_name, const char *to_file_na
     return ret1;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+filepos_entry_free (gpointer data)
+{
+    filepos_entry_t *entry = (filepos_entry_t *) data;
+
+    g_free (entry->name);
+    g_free (entry->record);
+    g_free (entry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+filepos_index_free (void)
+{
+    if (filepos_index != NULL)
+    {
+        g_hash_table_destroy (filepos_index->entries);
+        MC_PTR_FREE (filepos_index);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read records from the current position of file up to the last complete line.
+ */
+
+static void
+filepos_index_read (FILE * f)
+{
+    char buf[MC_MAXPATHLEN + 100];
+    gboolean too_long = FALSE;
+    gboolean from_start, has_header = FALSE;
+    size_t first_line;
+
+    from_start = filepos_index->size == 0;
+    first_line = filepos_index->lines;
+
+    while (fgets (buf, sizeof (buf), f) != NULL)
+    {
+        size_t len;
+        char *p;
+        filepos_entry_t *entry;
+
+        len = strlen (buf);
+        if (len == 0 || buf[len - 1] != '\n')
+        {
+            /* the last line without newline is read again next time */
+            if (feof (f))
+                break;
+
+            /* too long line is skipped */
+            too_long = TRUE;
+            continue;
+        }
+
+        filepos_index->size = ftell (f);
+        filepos_index->tail_len = MIN (len, FILEPOS_TAIL_LEN);
+        memcpy (filepos_index->tail, buf + len - filepos_index->tail_len,
+                filepos_index->tail_len);
+
+        if (too_long)
+        {
+            too_long = FALSE;
+            continue;
+        }
+
+        if (from_start && filepos_index->size == (long) len
+            && strcmp (buf, FILEPOS_LOG_HEADER "\n") == 0)
+        {
+            has_header = TRUE;
+            continue;
+        }
+
+        /* file name is followed by single space and string without spaces */
+        buf[len - 1] = '\0';
+        p = strrchr (buf, ' ');
+        if (p == NULL || p == buf)
+            continue;
+        *p++ = '\0';
+
+        filepos_index->lines++;
+
+        entry = (filepos_entry_t *) g_hash_table_lookup (filepos_index->entries, buf);
+        if (entry == NULL)
+        {
+            entry = g_new (filepos_entry_t, 1);
+            entry->name = g_strdup (buf);
+            entry->record = NULL;
+            g_hash_table_insert (filepos_index->entries, entry->name, entry);
+        }
+
+        g_free (entry->record);
+        entry->record = g_strdup (p);
+        entry->seq = filepos_index->lines;
+    }
+
+    /* file of older version: the first record is the most recent one */
+    if (from_start && !has_header && filepos_index->lines != first_line)
+    {
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init (&iter, filepos_index->entries);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+        {
+            filepos_entry_t *entry = (filepos_entry_t *) value;
+
+            entry->seq = filepos_index->lines + 1 - entry->seq;
+        }
+
+        filepos_index->legacy = TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check if the read part of file with positions is still at the start of file. If so, file
+ * position is moved to the end of read part.
+ */
+
+static gboolean
+filepos_index_is_valid (FILE * f, const struct stat *st)
+{
+    char buf[FILEPOS_TAIL_LEN];
+    size_t len = filepos_index->tail_len;
+
+    if (st->st_dev != filepos_index->dev || st->st_ino != filepos_index->ino
+        || st->st_size < filepos_index->size)
+        return FALSE;
+
+    return (fseek (f, filepos_index->size - (long) len, SEEK_SET) == 0
+            && fread (buf, 1, len, f) == len && memcmp (buf, filepos_index->tail, len) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Bring index of file with positions up to date: read records appended since the last time,
+ * or the whole file if it was replaced.
+ *
+ * @param fn file with positions
+ * @return FALSE if file can't be read
+ */
+
+static gboolean
+filepos_index_update (const char *fn)
+{
+    FILE *f;
+    struct stat st;
+
+    f = fopen (fn, "r");
+    if (f == NULL || fstat (fileno (f), &st) != 0)
+    {
+        if (f != NULL)
+            fclose (f);
+        filepos_index_free ();
+        return FALSE;
+    }
+
+    if (filepos_index != NULL && !filepos_index_is_valid (f, &st))
+    {
+        filepos_index_free ();
+        rewind (f);
+    }
+
+    if (filepos_index == NULL)
+    {
+        filepos_index = g_new0 (filepos_index_t, 1);
+        filepos_index->entries =
+            g_hash_table_new_full (g_str_hash, g_str_equal, NULL, filepos_entry_free);
+    }
+
+    filepos_index_read (f);
+    filepos_index->dev = st.st_dev;
+    filepos_index->ino = st.st_ino;
+    filepos_index->file_size = st.st_size;
+    fclose (f);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append text to file with positions. If the file is replaced by other instance at the same time,
+ * text is appended to the new file.
+ */
+
+static void
+filepos_append (const char *fn, const char *text, size_t len)
+{
+    int attempt;
+
+    for (attempt = 0; attempt < 3; attempt++)
+    {
+        int fd;
+        ssize_t ret;
+        struct stat st1, st2;
+        gboolean replaced;
+
+        fd = open (fn, O_WRONLY | O_APPEND | O_CREAT, 0666);
+        if (fd == -1)
+            return;
+
+        /* write at once, so that text isn't mixed with lines of other instances */
+        ret = write (fd, text, len);
+        (void) ret;
+
+        replaced = fstat (fd, &st1) == 0 && stat (fn, &st2) == 0
+            && (st1.st_dev != st2.st_dev || st1.st_ino != st2.st_ino);
+        close (fd);
+
+        if (!replaced)
+            break;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+filepos_entry_compare (gconstpointer a, gconstpointer b)
+{
+    const filepos_entry_t *e1 = *(const filepos_entry_t * const *) a;
+    const filepos_entry_t *e2 = *(const filepos_entry_t * const *) b;
+
+    return e1->seq < e2->seq ? -1 : (e1->seq > e2->seq ? 1 : 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write the last records of recently used files to new file with positions.
+ */
+
+static gboolean
+filepos_write (const char *fn, size_t max_entries)
+{
+    FILE *f;
+    GPtrArray *entries;
+    GHashTableIter iter;
+    gpointer value;
+    guint i;
+    gboolean ret = TRUE;
+
+    f = fopen (fn, "w");
+    if (f == NULL)
+        return FALSE;
+
+    ret = fprintf (f, "%s\n", FILEPOS_LOG_HEADER) >= 0;
+
+    entries = g_ptr_array_sized_new (g_hash_table_size (filepos_index->entries));
+    g_hash_table_iter_init (&iter, filepos_index->entries);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        if (strcmp (((filepos_entry_t *) value)->record, FILEPOS_DEFAULT_RECORD) != 0)
+            g_ptr_array_add (entries, value);
+
+    g_ptr_array_sort (entries, filepos_entry_compare);
+
+    /* the most recent records are the last ones */
+    for (i = entries->len > max_entries ? entries->len - max_entries : 0;
+         ret && i < entries->len; i++)
+    {
+        const filepos_entry_t *entry = (const filepos_entry_t *) g_ptr_array_index (entries, i);
+
+        ret = fprintf (f, "%s %s\n", entry->name, entry->record) >= 0;
+    }
+
+    g_ptr_array_free (entries, TRUE);
+
+    if (fclose (f) != 0)
+        ret = FALSE;
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Replace file with positions with the file containing only the last records.
+ * Only one instance of mc compacts the file at a time.
+ */
+
+static void
+filepos_compact (const char *fn, size_t max_entries)
+{
+    char *lock_fn, *tmp_fn;
+    int fd, attempt;
+
+    lock_fn = g_strconcat (fn, FILEPOS_LOCK_SUFFIX, (char *) NULL);
+    fd = open (lock_fn, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd == -1)
+    {
+        struct stat st;
+
+        /* lock left by crashed instance: file will be compacted next time */
+        if (stat (lock_fn, &st) == 0 && st.st_mtime + FILEPOS_LOCK_TIMEOUT < time (NULL))
+            unlink (lock_fn);
+        g_free (lock_fn);
+        return;
+    }
+    close (fd);
+
+    tmp_fn = g_strconcat (fn, TMP_SUFFIX, (char *) NULL);
+
+    for (attempt = 0; attempt < 3; attempt++)
+    {
+        FILE *f;
+        struct stat st;
+        long size;
+
+        /* keep the old file to get records appended to it until it's replaced */
+        f = fopen (fn, "r");
+        if (f == NULL)
+            break;
+
+        if (!filepos_index_update (fn) || !filepos_write (tmp_fn, max_entries)
+            || fstat (fileno (f), &st) != 0)
+        {
+            fclose (f);
+            break;
+        }
+
+        /* start again if records were appended while new file was written */
+        if (st.st_dev != filepos_index->dev || st.st_ino != filepos_index->ino
+            || st.st_size != filepos_index->file_size)
+        {
+            fclose (f);
+            continue;
+        }
+
+        size = filepos_index->size;
+
+#if defined(WIN32)              //WIN32, opened file can't be replaced
+        fclose (f);
+        f = NULL;
+        unlink (fn);
+#endif
+        if (rename (tmp_fn, fn) == 0)
+        {
+            filepos_index_free ();
+
+            /* move records appended after the check */
+            if (f != NULL && fseek (f, size, SEEK_SET) == 0)
+            {
+                GString *tail;
+                char buf[BUF_8K];
+                size_t len;
+
+                tail = g_string_new (NULL);
+                while ((len = fread (buf, 1, sizeof (buf), f)) != 0)
+                    g_string_append_len (tail, buf, len);
+                if (tail->len != 0)
+                    filepos_append (fn, tail->str, tail->len);
+                g_string_free (tail, TRUE);
+            }
+        }
+
+        if (f != NULL)
+            fclose (f);
+        break;
+    }
+
+    unlink (tmp_fn);
+    g_free (tmp_fn);
+    unlink (lock_fn);
+    g_free (lock_fn);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1125,85 +1539,56 @@ load_file_position (const vfs_path_t * filename_vpath, long *line, long *column,
                     GArray ** bookmarks)
 {
     char *fn;
-    FILE *f;
-    char buf[MC_MAXPATHLEN + 100];
-    const size_t len = vfs_path_len (filename_vpath);
+    gboolean ok;
+    const filepos_entry_t *entry;
+    gchar **pos_tokens;
 
     /* defaults */
     *line = 1;
     *column = 0;
     *offset = 0;
 
-    /* open file with positions */
+    /* read new records of file with positions */
     fn = mc_config_get_full_path (MC_FILEPOS_FILE);
-    f = fopen (fn, "r");
+    ok = fn != NULL && filepos_index_update (fn);
     g_free (fn);
-    if (f == NULL)
+    if (!ok)
         return;
 
     /* prepare array for serialized bookmarks */
     if (bookmarks != NULL)
         *bookmarks = g_array_sized_new (FALSE, FALSE, sizeof (size_t), MAX_SAVED_BOOKMARKS);
 
-    while (fgets (buf, sizeof (buf), f) != NULL)
-    {
-        const char *p;
-        gchar **pos_tokens;
-
-        /* check if the filename matches the beginning of string */
-        if (strncmp (buf, vfs_path_as_str (filename_vpath), len) != 0)
-            continue;
-
-        /* followed by single space */
-        if (buf[len] != ' ')
-            continue;
-
-        /* and string without spaces */
-        p = &buf[len + 1];
-        if (strchr (p, ' ') != NULL)
-            continue;
+    entry = (const filepos_entry_t *) g_hash_table_lookup (filepos_index->entries,
+                                                           vfs_path_as_str (filename_vpath));
+    if (entry == NULL)
+        return;
 
-        pos_tokens = g_strsplit (p, ";", 3 + MAX_SAVED_BOOKMARKS);
-        if (pos_tokens[0] == NULL)
-        {
-            *line = 1;
-            *column = 0;
-            *offset = 0;
-        }
-        else
+    pos_tokens = g_strsplit (entry->record, ";", 3 + MAX_SAVED_BOOKMARKS);
+    if (pos_tokens[0] != NULL)
+    {
+        *line = strtol (pos_tokens[0], NULL, 10);
+        if (pos_tokens[1] != NULL)
         {
-            *line = strtol (pos_tokens[0], NULL, 10);
-            if (pos_tokens[1] == NULL)
-            {
-                *column = 0;
-                *offset = 0;
-            }
-            else
+            *column = strtol (pos_tokens[1], NULL, 10);
+            if (pos_tokens[2] != NULL && bookmarks != NULL)
             {
-                *column = strtol (pos_tokens[1], NULL, 10);
-                if (pos_tokens[2] == NULL)
-                    *offset = 0;
-                else if (bookmarks != NULL)
-                {
-                    size_t i;
+                size_t i;
 
-                    *offset = (off_t) g_ascii_strtoll (pos_tokens[2], NULL, 10);
+                *offset = (off_t) g_ascii_strtoll (pos_tokens[2], NULL, 10);
 
-                    for (i = 0; i < MAX_SAVED_BOOKMARKS && pos_tokens[3 + i] != NULL; i++)
-                    {
-                        size_t val;
+                for (i = 0; i < MAX_SAVED_BOOKMARKS && pos_tokens[3 + i] != NULL; i++)
+                {
+                    size_t val;
 
-                        val = strtoul (pos_tokens[3 + i], NULL, 10);
-                        g_array_append_val (*bookmarks, val);
-                    }
+                    val = strtoul (pos_tokens[3 + i], NULL, 10);
+                    g_array_append_val (*bookmarks, val);
                 }
             }
         }
-
-        g_strfreev (pos_tokens);
     }
 
-    fclose (f);
+    g_strfreev (pos_tokens);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1216,12 +1601,11 @@ save_file_position (const vfs_path_t * filename_vpath, long line, long column, o
                     GArray * bookmarks)
 {
     static size_t filepos_max_saved_entries = 0;
-    char *fn, *tmp_fn;
-    FILE *f, *tmp_f;
-    char buf[MC_MAXPATHLEN + 100];
-    size_t i;
-    const size_t len = vfs_path_len (filename_vpath);
-    gboolean src_error = FALSE;
+    char *fn;
+    const char *name;
+    GString *record;
+    gboolean ok;
+    const filepos_entry_t *entry = NULL;
 
     if (filepos_max_saved_entries == 0)
         filepos_max_saved_entries = mc_config_get_int (mc_global.main_config, CONFIG_APP_SECTION,
@@ -1231,59 +1615,55 @@ save_file_position (const vfs_path_t * filename_vpath, long line, long column, o
     if (fn == NULL)
         goto early_error;
 
-    mc_util_make_backup_if_possible (fn, TMP_SUFFIX);
-
-    /* open file */
-    f = fopen (fn, "w");
-    if (f == NULL)
-        goto open_target_error;
-
-    tmp_fn = g_strdup_printf ("%s" TMP_SUFFIX, fn);
-    tmp_f = fopen (tmp_fn, "r");
-    if (tmp_f == NULL)
-    {
-        src_error = TRUE;
-        goto open_source_error;
-    }
+    name = vfs_path_as_str (filename_vpath);
 
-    /* put the new record */
+    record = g_string_new (FILEPOS_DEFAULT_RECORD);
     if (line != 1 || column != 0 || bookmarks != NULL)
     {
-        if (fprintf
-            (f, "%s %ld;%ld;%" PRIuMAX, vfs_path_as_str (filename_vpath), line, column,
-             (uintmax_t) offset) < 0)
-            goto write_position_error;
+        g_string_printf (record, "%ld;%ld;%" PRIuMAX, line, column, (uintmax_t) offset);
         if (bookmarks != NULL)
-            for (i = 0; i < bookmarks->len && i < MAX_SAVED_BOOKMARKS; i++)
-                if (fprintf (f, ";%zu", g_array_index (bookmarks, size_t, i)) < 0)
-                    goto write_position_error;
+        {
+            size_t i;
 
-        if (fprintf (f, "\n") < 0)
-            goto write_position_error;
+            for (i = 0; i < bookmarks->len && i < MAX_SAVED_BOOKMARKS; i++)
+                g_string_append_printf (record, ";%zu", g_array_index (bookmarks, size_t, i));
+        }
     }
 
-    i = 1;
-    while (fgets (buf, sizeof (buf), tmp_f) != NULL)
+    ok = filepos_index_update (fn);
+
+    /* convert file of older version before new records are appended to it */
+    if (ok && filepos_index->legacy)
     {
-        if (buf[len] == ' ' && strncmp (buf, vfs_path_as_str (filename_vpath), len) == 0
-            && strchr (&buf[len + 1], ' ') == NULL)
-            continue;
+        filepos_compact (fn, filepos_max_saved_entries);
+        ok = filepos_index_update (fn);
+    }
 
-        fprintf (f, "%s", buf);
-        if (++i > filepos_max_saved_entries)
-            break;
+    if (ok)
+        entry = (const filepos_entry_t *) g_hash_table_lookup (filepos_index->entries, name);
+
+    /* put the new record, default one only to forget the previous position */
+    if (entry != NULL || strcmp (record->str, FILEPOS_DEFAULT_RECORD) != 0)
+    {
+        const char *prefix = "";
+        char *text;
+
+        /* new file starts with header, line left by crashed instance isn't continued */
+        if (!ok || filepos_index->file_size == 0)
+            prefix = FILEPOS_LOG_HEADER "\n";
+        else if (filepos_index->file_size > filepos_index->size)
+            prefix = "\n";
+
+        text = g_strdup_printf ("%s%s %s\n", prefix, name, record->str);
+        filepos_append (fn, text, strlen (text));
+        g_free (text);
     }
 
-  write_position_error:
-    fclose (tmp_f);
-  open_source_error:
-    g_free (tmp_fn);
-    fclose (f);
-    if (src_error)
-        mc_util_restore_from_backup_if_possible (fn, TMP_SUFFIX);
-    else
-        mc_util_unlink_backup_if_possible (fn, TMP_SUFFIX);
-  open_target_error:
+    /* remove outdated records */
+    if (filepos_index != NULL && filepos_index->lines > 2 * filepos_max_saved_entries)
+        filepos_compact (fn, filepos_max_saved_entries);
+
+    g_string_free (record, TRUE);
     g_free (fn);
   early_error:
     if (bookmarks != NULL)
@@ -18,6 +18,7 @@
 #include "lib/vfs/vfs.h"        /* vfs_path_t */
 
 #include "edit.h"
+#include "editundo.h"
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
@@ -39,26 +40,6 @@
 #define EDIT_TOP_EXTREME 0
 #define EDIT_BOTTOM_EXTREME 0
 
-/* Initial size of the undo stack, in bytes */
-#define START_STACK_SIZE 32
-
-/* Some codes that may be pushed onto or returned from the undo stack */
-#define CURS_LEFT       601
-#define CURS_RIGHT      602
-#define DELCHAR         603
-#define BACKSPACE       604
-#define STACK_BOTTOM    605
-#define CURS_LEFT_LOTS  606
-#define CURS_RIGHT_LOTS 607
-#define COLUMN_ON       608
-#define COLUMN_OFF      609
-#define DELCHAR_BR      610
-#define BACKSPACE_BR    611
-#define MARK_1          1000
-#define MARK_2          500000000
-#define MARK_CURS       1000000000
-#define KEY_PRESS       1500000000
-
 /* Tabs spaces: (sofar only HALF_TAB_SIZE is used: */
 #define TAB_SIZE      option_tab_spacing
 #define HALF_TAB_SIZE ((int) option_tab_spacing / 2)
@@ -113,6 +94,8 @@ typedef struct edit_stack_type
     vfs_path_t *filename_vpath;
 } edit_stack_type;
 
+struct edit_syntax_rule_t;
+
 /*** global variables defined in .c file *********************************************************/
 
 extern const char VERTICAL_MAGIC[5];
@@ -148,6 +131,7 @@ void edit_save_mode_cmd (void);
 off_t edit_move_forward3 (const WEdit * edit, off_t current, long cols, off_t upto);
 void edit_scroll_screen_over_cursor (WEdit * edit);
 void edit_render_keypress (WEdit * edit);
+void edit_screen_clean (WEdit * edit);
 void edit_scroll_upward (WEdit * edit, long i);
 void edit_scroll_downward (WEdit * edit, long i);
 void edit_scroll_right (WEdit * edit, long i);
@@ -160,6 +144,7 @@ void edit_update_curs_row (WEdit * edit);
 void edit_update_curs_col (WEdit * edit);
 void edit_find_bracket (WEdit * edit);
 gboolean edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line);
+gboolean edit_check_mapped_file (WEdit * edit);
 void edit_set_codeset (WEdit * edit);
 
 void edit_block_copy_cmd (WEdit * edit);
@@ -168,14 +153,16 @@ int edit_block_delete_cmd (WEdit * edit);
 void edit_delete_line (WEdit * edit);
 
 int edit_delete (WEdit * edit, gboolean byte_delete);
+off_t edit_delete_block (WEdit * edit, off_t len, char *deleted);
 int edit_backspace (WEdit * edit, gboolean byte_delete);
 void edit_insert (WEdit * edit, int c);
+void edit_insert_block (WEdit * edit, const char *text, off_t len);
 void edit_insert_over (WEdit * edit);
 void edit_cursor_move (WEdit * edit, off_t increment);
-void edit_push_undo_action (WEdit * edit, long c);
-void edit_push_redo_action (WEdit * edit, long c);
+void edit_push_undo_action (WEdit * edit, edit_undo_action_t action, off_t value);
 void edit_push_key_press (WEdit * edit);
 void edit_insert_ahead (WEdit * edit, int c);
+void edit_insert_ahead_block (WEdit * edit, const char *text, off_t len);
 off_t edit_write_stream (WEdit * edit, FILE * f);
 char *edit_get_write_filter (const vfs_path_t * write_name_vpath,
                              const vfs_path_t * filename_vpath);
@@ -198,6 +185,8 @@ void edit_replace_cmd (WEdit * edit, gboolean again);
 void edit_search_cmd (WEdit * edit, gboolean again);
 mc_search_cbret_t edit_search_cmd_callback (const void *user_data, gsize char_offset,
                                             int *current_char);
+mc_search_cbret_t edit_search_span_callback (const void *user_data, gsize char_offset,
+                                             const char **span, gsize * span_len);
 mc_search_cbret_t edit_search_update_callback (const void *user_data, gsize char_offset);
 
 void edit_complete_word_cmd (WEdit * edit);
@@ -259,6 +248,12 @@ void edit_set_filename (WEdit * edit, const vfs_path_t * name_vpath);
 void edit_load_syntax (WEdit * edit, GPtrArray * pnames, const char *type);
 void edit_free_syntax_rules (WEdit * edit);
 int edit_get_syntax_color (WEdit * edit, off_t byte_index);
+void edit_get_syntax_rule (WEdit * edit, off_t byte_index, struct edit_syntax_rule_t *rule);
+gboolean edit_get_syntax_spelling (WEdit * edit, off_t byte_index);
+gboolean edit_syntax_rule_equal (const struct edit_syntax_rule_t *r1,
+                                 const struct edit_syntax_rule_t *r2, off_t end_shift,
+                                 off_t offset);
+void edit_syntax_text_changed (WEdit * edit, off_t offset, off_t len);
 
 void book_mark_insert (WEdit * edit, long line, int c);
 gboolean book_mark_query_color (WEdit * edit, long line, int c);
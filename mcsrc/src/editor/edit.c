@@ -69,6 +69,7 @@
 
 #include "edit-impl.h"
 #include "editwidget.h"
+#include "etags.h"              /* etags_cache_free() */
 #ifdef HAVE_ASPELL
 #include "spell.h"
 #endif
@@ -84,7 +85,8 @@ gboolean option_backspace_through_tabs = FALSE;
 gboolean option_fake_half_tabs = TRUE;
 int option_save_mode = EDIT_QUICK_SAVE;
 gboolean option_save_position = TRUE;
-int option_max_undo = 32768;
+/* limit of memory used by undo log, in bytes */
+int option_max_undo = 32 * 1024 * 1024;
 gboolean option_persistent_selections = TRUE;
 gboolean option_cursor_beyond_eol = FALSE;
 gboolean option_line_state = FALSE;
@@ -109,10 +111,49 @@ const char VERTICAL_MAGIC[] = { '\1', '\1', '\1', '\1', '\n' };
 
 #define TEMP_BUF_LEN 1024
 
+/* chunk size for inserting of files and streams */
+#define INSERT_BUF_LEN (1024 * 1024)
+
 #define space_width 1
 
+/* distance between checkpoints of column in long lines */
+#define EDIT_COLUMN_STEP 4096
+/* number of long lines which have checkpoints */
+#define EDIT_COLUMN_CACHE_LINES 8
+/* number of bytes after current one which can be read to get column of the next one */
+#define EDIT_COLUMN_LOOKAHEAD 8
+
 /*** file scope type declarations ****************************************************************/
 
+/* state of edit_move_forward3() at some offset of line */
+typedef struct
+{
+    off_t offset;
+    long col;                   /* column of offset */
+    long max_col;               /* maximum column passed from beginning of line upto offset */
+} edit_column_point_t;
+
+typedef struct
+{
+    off_t bol;                  /* beginning of line, -1 if unused */
+    GArray *points;             /* edit_column_point_t every EDIT_COLUMN_STEP bytes from bol */
+} edit_column_line_t;
+
+typedef struct edit_column_cache_struct
+{
+    edit_column_line_t lines[EDIT_COLUMN_CACHE_LINES];
+    unsigned int next;          /* line to be reused */
+
+    /* settings which columns depend on */
+    int tab_size;
+#ifdef HAVE_CHARSET
+    gboolean utf8;
+    gboolean utf8_display;
+    int source_codepage;
+    int display_codepage;
+#endif
+} edit_column_cache_t;
+
 /*** file scope variables ************************************************************************/
 
 /* detecting an error on save is easy: just check if every byte has been written. */
@@ -181,6 +222,7 @@ edit_load_file_fast (edit_buffer_t * buf, const vfs_path_t * filename_vpath)
 {
     int file;
     gboolean ret;
+    off_t loaded;
     edit_buffer_read_file_status_msg_t rsm;
     gboolean aborted;
 
@@ -203,7 +245,14 @@ edit_load_file_fast (edit_buffer_t * buf, const vfs_path_t * filename_vpath)
     status_msg_init (STATUS_MSG (&rsm), _("Load file"), 1.0, simple_status_msg_init_cb,
                      edit_load_status_update_cb, NULL);
 
-    ret = (edit_buffer_read_file (buf, file, buf->size, &rsm, &aborted) == buf->size);
+    /* large local files are mapped to memory rather than read */
+    loaded = -1;
+    if (vfs_file_is_local (filename_vpath))
+        loaded = edit_buffer_map_file (buf, vfs_path_as_str (filename_vpath), buf->size, &rsm,
+                                       &aborted);
+    if (loaded == -1 && !aborted)
+        loaded = edit_buffer_read_file (buf, file, buf->size, &rsm, &aborted);
+    ret = (loaded == buf->size);
 
     status_msg_deinit (STATUS_MSG (&rsm));
 
@@ -267,14 +316,19 @@ edit_get_filter (const vfs_path_t * filename_vpath)
 static off_t
 edit_insert_stream (WEdit * edit, FILE * f)
 {
-    int c;
+    char *buf;
+    size_t n;
     off_t i = 0;
 
-    while ((c = fgetc (f)) >= 0)
+    buf = g_malloc (INSERT_BUF_LEN);
+
+    while ((n = fread (buf, 1, INSERT_BUF_LEN, f)) > 0)
     {
-        edit_insert (edit, c);
-        i++;
+        edit_insert_block (edit, buf, (off_t) n);
+        i += n;
     }
+
+    g_free (buf);
     return i;
 }
 
@@ -449,6 +503,8 @@ edit_load_file (WEdit * edit)
                 return FALSE;
             }
             edit->undo_stack_disable = 0;
+            /* loading isn't an action to redo */
+            edit_undo_log_clear (&edit->redo_log);
         }
     }
     edit->lb = LB_ASIS;
@@ -526,106 +582,280 @@ edit_purge_widget (WEdit * edit)
 
 /* --------------------------------------------------------------------------------------------- */
 
-/*
-   TODO: if the user undos until the stack bottom, and the stack has not wrapped,
-   then the file should be as it was when he loaded up. Then set edit->modified to 0.
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Save deleted bytes onto the undo log.
+ *
+ * @param edit editor object
+ * @param action EDIT_UNDO_INSERT (text was deleted before cursor) or
+ *               EDIT_UNDO_INSERT_AHEAD (text was deleted after cursor)
+ * @param text deleted bytes
+ * @param len number of bytes
  */
 
-static long
-edit_pop_undo_action (WEdit * edit)
+static void
+edit_push_undo_text (WEdit * edit, edit_undo_action_t action, const char *text, off_t len)
 {
-    long c;
-    unsigned long sp = edit->undo_stack_pointer;
+    if (edit->undo_stack_disable)
+    {
+        edit_undo_log_push_text (&edit->redo_log, action, text, len);
+        return;
+    }
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+    if (edit->redo_stack_reset)
+        edit_undo_log_clear (&edit->redo_log);
+
+    edit_undo_log_push_text (&edit->undo_log, action, text, len);
+}
 
-    sp = (sp - 1) & edit->undo_stack_size_mask;
-    c = edit->undo_stack[sp];
-    if (c >= 0)
+/* --------------------------------------------------------------------------------------------- */
+/** is called whenever a modification is made by one of the four routines below */
+
+static void
+edit_modification (WEdit * edit)
+{
+    /* raise lock when file modified */
+    if (!edit->modified && !edit->delete_file)
+        edit->locked = lock_file (edit->filename_vpath);
+    edit->modified = 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_column_cache_t *
+edit_column_cache_new (void)
+{
+    edit_column_cache_t *cache;
+    unsigned int i;
+
+    cache = g_new0 (edit_column_cache_t, 1);
+    cache->tab_size = -1;
+
+    for (i = 0; i < EDIT_COLUMN_CACHE_LINES; i++)
     {
-        /*      edit->undo_stack[sp] = '@'; */
-        edit->undo_stack_pointer = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
-        return c;
+        cache->lines[i].bol = -1;
+        cache->lines[i].points = g_array_new (FALSE, FALSE, sizeof (edit_column_point_t));
     }
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+    return cache;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_column_cache_free (edit_column_cache_t * cache)
+{
+    unsigned int i;
+
+    if (cache == NULL)
+        return;
+
+    for (i = 0; i < EDIT_COLUMN_CACHE_LINES; i++)
+        g_array_free (cache->lines[i].points, TRUE);
+
+    g_free (cache);
+}
 
-    c = edit->undo_stack[(sp - 1) & edit->undo_stack_size_mask];
-    if (edit->undo_stack[sp] == -2)
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find checkpoints of line. All checkpoints are dropped if settings which affect columns were
+ * changed since they were calculated.
+ *
+ * @param edit editor object
+ * @param bol beginning of line
+ *
+ * @return checkpoints of line, NULL if line has none
+ */
+
+static edit_column_line_t *
+edit_column_cache_find (const WEdit * edit, off_t bol)
+{
+    edit_column_cache_t *cache = edit->column_cache;
+    unsigned int i;
+
+    if (cache->tab_size != TAB_SIZE
+#ifdef HAVE_CHARSET
+        || cache->utf8 != edit->utf8 || cache->utf8_display != mc_global.utf8_display
+        || cache->source_codepage != mc_global.source_codepage
+        || cache->display_codepage != mc_global.display_codepage
+#endif
+        )
     {
-        /*      edit->undo_stack[sp] = '@'; */
-        edit->undo_stack_pointer = sp;
+        for (i = 0; i < EDIT_COLUMN_CACHE_LINES; i++)
+            cache->lines[i].bol = -1;
+
+        cache->tab_size = TAB_SIZE;
+#ifdef HAVE_CHARSET
+        cache->utf8 = edit->utf8;
+        cache->utf8_display = mc_global.utf8_display;
+        cache->source_codepage = mc_global.source_codepage;
+        cache->display_codepage = mc_global.display_codepage;
+#endif
+        return NULL;
     }
-    else
-        edit->undo_stack[sp]++;
 
-    return c;
+    for (i = 0; i < EDIT_COLUMN_CACHE_LINES; i++)
+        if (cache->lines[i].bol == bol)
+            return &cache->lines[i];
+
+    return NULL;
 }
 
-static long
-edit_pop_redo_action (WEdit * edit)
+/* --------------------------------------------------------------------------------------------- */
+/** Get empty checkpoints for line, the ones of least recently added line are reused */
+
+static edit_column_line_t *
+edit_column_cache_add (edit_column_cache_t * cache, off_t bol)
 {
-    long c;
-    unsigned long sp = edit->redo_stack_pointer;
+    edit_column_line_t *line;
+
+    line = &cache->lines[cache->next];
+    cache->next = (cache->next + 1) % EDIT_COLUMN_CACHE_LINES;
+
+    line->bol = bol;
+    g_array_set_size (line->points, 0);
+
+    return line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last checkpoint which edit_move_forward3() can start from.
+ *
+ * @param line checkpoints of line
+ * @param cols column to move to, used if upto is 0
+ * @param upto offset to count columns upto
+ *
+ * @return checkpoint, NULL if calculation should start from beginning of line
+ */
 
-    if (sp == edit->redo_stack_bottom)
-        return STACK_BOTTOM;
+static const edit_column_point_t *
+edit_column_line_seek (const edit_column_line_t * line, long cols, off_t upto)
+{
+    guint lo = 0, hi = line->points->len;
 
-    sp = (sp - 1) & edit->redo_stack_size_mask;
-    c = edit->redo_stack[sp];
-    if (c >= 0)
+    /* the first checkpoint which cannot be used */
+    while (lo < hi)
     {
-        edit->redo_stack_pointer = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
-        return c;
+        guint mid = lo + (hi - lo) / 2;
+        const edit_column_point_t *pt;
+
+        pt = &g_array_index (line->points, edit_column_point_t, mid);
+        if (upto != 0 ? line->bol + pt->offset <= upto : pt->max_col < cols)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
-    if (sp == edit->redo_stack_bottom)
-        return STACK_BOTTOM;
+    return (lo == 0 ? NULL : &g_array_index (line->points, edit_column_point_t, lo - 1));
+}
 
-    c = edit->redo_stack[(sp - 1) & edit->redo_stack_size_mask];
-    if (edit->redo_stack[sp] == -2)
-        edit->redo_stack_pointer = sp;
-    else
-        edit->redo_stack[sp]++;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count printable ASCII characters starting at specified offset.
+ * Each of them takes exactly one column on the screen in any codepage.
+ *
+ * @param buf editor buffer
+ * @param offset offset of first character
+ * @param limit offset to stop at
+ *
+ * @return number of characters, only contiguous part of buffer is scanned
+ */
+
+static off_t
+edit_count_ascii (const edit_buffer_t * buf, off_t offset, off_t limit)
+{
+    const unsigned char *text;
+    off_t len, i;
 
-    return c;
+    if (offset >= limit)
+        return 0;
+
+    text = (const unsigned char *) edit_buffer_get_span (buf, offset, &len);
+    if (text == NULL)
+        return 0;
+
+    len = MIN (len, limit - offset);
+    for (i = 0; i < len && text[i] >= ' ' && text[i] < 127; i++)
+        ;
+
+    return i;
 }
 
-static long
-get_prev_undo_action (WEdit * edit)
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update checkpoints of columns after the text was changed.
+ *
+ * @param cache column checkpoints
+ * @param offset offset of change
+ * @param del_len number of deleted bytes
+ * @param ins_len number of inserted bytes
+ */
+
+static void
+edit_column_cache_text_changed (edit_column_cache_t * cache, off_t offset, off_t del_len,
+                                off_t ins_len)
 {
-    long c;
-    unsigned long sp = edit->undo_stack_pointer;
+    unsigned int i;
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+    if (cache == NULL)
+        return;
 
-    sp = (sp - 1) & edit->undo_stack_size_mask;
-    c = edit->undo_stack[sp];
-    if (c >= 0)
-        return c;
+    for (i = 0; i < EDIT_COLUMN_CACHE_LINES; i++)
+    {
+        edit_column_line_t *line = &cache->lines[i];
 
-    if (sp == edit->undo_stack_bottom)
-        return STACK_BOTTOM;
+        if (line->bol < 0)
+            continue;
 
-    c = edit->undo_stack[(sp - 1) & edit->undo_stack_size_mask];
-    return c;
+        if (offset + del_len < line->bol)
+            line->bol += ins_len - del_len;
+        else if (offset < line->bol)
+        {
+            /* newline before the line was deleted */
+            line->bol = -1;
+        }
+        else
+        {
+            /* keep checkpoints which don't depend on the changed text */
+            guint n;
+
+            for (n = line->points->len; n != 0; n--)
+            {
+                const edit_column_point_t *pt;
+
+                pt = &g_array_index (line->points, edit_column_point_t, n - 1);
+                if (line->bol + pt->offset + EDIT_COLUMN_LOOKAHEAD <= offset)
+                    break;
+            }
+
+            g_array_set_size (line->points, n);
+        }
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** is called whenever a modification is made by one of the four routines below */
+/**
+ * Update syntax highlighting, word and bracket indexes and column checkpoints after the text was
+ * changed.
+ *
+ * @param edit editor object
+ * @param offset offset of change
+ * @param deleted bytes deleted at offset, NULL if text was inserted
+ * @param del_len number of deleted bytes
+ * @param ins_len number of inserted bytes
+ */
 
 static void
-edit_modification (WEdit * edit)
+edit_text_changed (WEdit * edit, off_t offset, const char *deleted, off_t del_len, off_t ins_len)
 {
-    edit->caches_valid = FALSE;
-
-    /* raise lock when file modified */
-    if (!edit->modified && !edit->delete_file)
-        edit->locked = lock_file (edit->filename_vpath);
-    edit->modified = 1;
+    edit_column_cache_text_changed (edit->column_cache, offset, del_len, ins_len);
+    edit_syntax_text_changed (edit, offset, ins_len - del_len);
+    edit_word_index_update (&edit->word_index, &edit->buffer, offset, deleted, del_len, ins_len);
+    edit_bracket_index_update (&edit->bracket_index, &edit->buffer, offset, del_len, ins_len);
+#ifdef HAVE_ASPELL
+    edit_spell_update (&edit->spell, &edit->buffer, offset, del_len, ins_len);
+#endif
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -683,52 +913,7 @@ is_blank (const edit_buffer_t * buf, off_t offset)
 static off_t
 edit_find_line (WEdit * edit, long line)
 {
-    long i, j = 0;
-    long m = 2000000000;        /* what is the magic number? */
-
-    if (!edit->caches_valid)
-    {
-        memset (edit->line_numbers, 0, sizeof (edit->line_numbers));
-        memset (edit->line_offsets, 0, sizeof (edit->line_offsets));
-        /* three offsets that we *know* are line 0 at 0 and these two: */
-        edit->line_numbers[1] = edit->buffer.curs_line;
-        edit->line_offsets[1] = edit_buffer_get_current_bol (&edit->buffer);
-        edit->line_numbers[2] = edit->buffer.lines;
-        edit->line_offsets[2] = edit_buffer_get_bol (&edit->buffer, edit->buffer.size);
-        edit->caches_valid = TRUE;
-    }
-    if (line >= edit->buffer.lines)
-        return edit->line_offsets[2];
-    if (line <= 0)
-        return 0;
-    /* find the closest known point */
-    for (i = 0; i < N_LINE_CACHES; i++)
-    {
-        long n;
-
-        n = labs (edit->line_numbers[i] - line);
-        if (n < m)
-        {
-            m = n;
-            j = i;
-        }
-    }
-    if (m == 0)
-        return edit->line_offsets[j];   /* know the offset exactly */
-    if (m == 1 && j >= 3)
-        i = j;                  /* one line different - caller might be looping, so stay in this cache */
-    else
-        i = 3 + (rand () % (N_LINE_CACHES - 3));
-    if (line > edit->line_numbers[j])
-        edit->line_offsets[i] =
-            edit_buffer_get_forward_offset (&edit->buffer, edit->line_offsets[j],
-                                            line - edit->line_numbers[j], 0);
-    else
-        edit->line_offsets[i] =
-            edit_buffer_get_backward_offset (&edit->buffer, edit->line_offsets[j],
-                                             edit->line_numbers[j] - line);
-    edit->line_numbers[i] = line;
-    return edit->line_offsets[i];
+    return edit_buffer_get_line_offset (&edit->buffer, line);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1136,173 +1321,205 @@ edit_left_delete_word (WEdit * edit)
 
 /* --------------------------------------------------------------------------------------------- */
 /**
-   the start column position is not recorded, and hence does not
-   undo as it happed. But who would notice.
+ * Delete block of bytes at the cursor in one operation. Same as edit_delete (edit, TRUE) or
+ * edit_backspace (edit, TRUE) for every byte of block, but line counters, bookmarks and markers
+ * are updated once for all block.
+ *
+ * @param edit editor object
+ * @param len number of bytes to delete
+ * @param deleted buffer to store deleted bytes, may be NULL
+ * @param backspace if TRUE, delete bytes before cursor
+ *
+ * @return number of deleted bytes
  */
 
-static void
-edit_do_undo (WEdit * edit)
+static off_t
+edit_delete_block_at_cursor (WEdit * edit, off_t len, char *deleted, gboolean backspace)
 {
-    long ac;
-    long count = 0;
+    off_t start, i, d;
+    long lines;
+    char *text;
 
-    edit->undo_stack_disable = 1;       /* don't record undo's onto undo stack! */
-    edit->over_col = 0;
-    while ((ac = edit_pop_undo_action (edit)) < KEY_PRESS)
+    len = MIN (len, backspace ? edit->buffer.curs1 : edit->buffer.curs2);
+    if (len <= 0)
+        return 0;
+
+    start = backspace ? edit->buffer.curs1 - len : edit->buffer.curs1;
+
+    if (edit->mark2 != edit->mark1)
+        edit_push_markers (edit);
+
+    /* save deleted bytes onto the undo stack */
+    text = deleted != NULL ? deleted : g_malloc (len);
+    for (i = 0; i < len;)
     {
-        switch ((int) ac)
-        {
-        case STACK_BOTTOM:
-            goto done_undo;
-        case CURS_RIGHT:
-            edit_cursor_move (edit, 1);
-            break;
-        case CURS_LEFT:
-            edit_cursor_move (edit, -1);
-            break;
-        case BACKSPACE:
-        case BACKSPACE_BR:
-            edit_backspace (edit, TRUE);
-            break;
-        case DELCHAR:
-        case DELCHAR_BR:
-            edit_delete (edit, TRUE);
-            break;
-        case COLUMN_ON:
-            edit->column_highlight = 1;
-            break;
-        case COLUMN_OFF:
-            edit->column_highlight = 0;
-            break;
-        default:
-            break;
-        }
-        if (ac >= 256 && ac < 512)
-            edit_insert_ahead (edit, ac - 256);
-        if (ac >= 0 && ac < 256)
-            edit_insert (edit, ac);
+        const char *p;
+        off_t span;
 
-        if (ac >= MARK_1 - 2 && ac < MARK_2 - 2)
-        {
-            edit->mark1 = ac - MARK_1;
-            edit->column1 =
-                (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark1),
-                                           0, edit->mark1);
-        }
-        if (ac >= MARK_2 - 2 && ac < MARK_CURS - 2)
-        {
-            edit->mark2 = ac - MARK_2;
-            edit->column2 =
-                (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark2),
-                                           0, edit->mark2);
-        }
-        else if (ac >= MARK_CURS - 2 && ac < KEY_PRESS)
-        {
-            edit->end_mark_curs = ac - MARK_CURS;
-        }
-        if (count++)
-            edit->force |= REDRAW_PAGE; /* more than one pop usually means something big */
+        p = edit_buffer_get_span (&edit->buffer, start + i, &span);
+        span = MIN (span, len - i);
+        memcpy (text + i, p, span);
+        i += span;
     }
+    edit_push_undo_text (edit, backspace ? EDIT_UNDO_INSERT : EDIT_UNDO_INSERT_AHEAD, text, len);
 
-    if (edit->start_display > ac - KEY_PRESS)
+    /* update markers */
+    if (edit->mark1 > start)
     {
-        edit->start_line -=
-            edit_buffer_count_lines (&edit->buffer, ac - KEY_PRESS, edit->start_display);
-        edit->force |= REDRAW_PAGE;
+        d = MIN (len, edit->mark1 - start);
+        edit->mark1 -= d;
+        edit->end_mark_curs -= d;
     }
-    else if (edit->start_display < ac - KEY_PRESS)
+    if (edit->mark2 > start)
+        edit->mark2 -= MIN (len, edit->mark2 - start);
+    lines = edit_buffer_count_lines (&edit->buffer, start, start + len);
+
+    if (start < edit->start_display)
     {
-        edit->start_line +=
-            edit_buffer_count_lines (&edit->buffer, edit->start_display, ac - KEY_PRESS);
-        edit->force |= REDRAW_PAGE;
+        d = MIN (len, edit->start_display - start);
+        edit->start_line -= edit_buffer_count_lines (&edit->buffer, start, start + d);
+        edit->start_display -= d;
     }
-    edit->start_display = ac - KEY_PRESS;       /* see push and pop above */
-    edit_update_curs_row (edit);
 
-  done_undo:
-    edit->undo_stack_disable = 0;
+    if (backspace)
+        edit_buffer_set_cursor (&edit->buffer, start);
+    edit_buffer_delete_block (&edit->buffer, len);
+    edit_text_changed (edit, start, text, len, 0);
+    if (text != deleted)
+        g_free (text);
+
+    edit_modification (edit);
+    if (lines != 0)
+    {
+        long l;
+
+        for (l = 0; l < lines; l++)
+            book_mark_dec (edit, edit->buffer.curs_line - (backspace ? l : 0));
+        if (backspace)
+            edit->buffer.curs_line -= lines;
+        edit->buffer.lines -= lines;
+        edit->force |= REDRAW_AFTER_CURSOR;
+    }
+
+    return len;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Replay records of one user action from undo or redo log. Replayed actions record their reverse
+ * actions in the other log.
+ *
+ * The start column position is not recorded, and hence does not undo as it happed.
+ * But who would notice.
+ *
+ * @param edit editor object
+ * @param log undo or redo log
+ */
 
 static void
-edit_do_redo (WEdit * edit)
+edit_replay_log (WEdit * edit, edit_undo_log_t * log)
 {
-    long ac;
+    edit_undo_record_t r;
+    const char *text;
     long count = 0;
 
-    if (edit->redo_stack_reset)
-        return;
-
     edit->over_col = 0;
-    while ((ac = edit_pop_redo_action (edit)) < KEY_PRESS)
+
+    while (edit_undo_log_pop (log, &r, &text))
     {
-        switch ((int) ac)
+        switch (r.action)
         {
-        case STACK_BOTTOM:
-            goto done_redo;
-        case CURS_RIGHT:
-            edit_cursor_move (edit, 1);
+        case EDIT_UNDO_KEY_PRESS:
+            if (edit->start_display > r.value)
+            {
+                edit->start_line -=
+                    edit_buffer_count_lines (&edit->buffer, r.value, edit->start_display);
+                edit->force |= REDRAW_PAGE;
+            }
+            else if (edit->start_display < r.value)
+            {
+                edit->start_line +=
+                    edit_buffer_count_lines (&edit->buffer, edit->start_display, r.value);
+                edit->force |= REDRAW_PAGE;
+            }
+            edit->start_display = r.value;
+            edit_update_curs_row (edit);
+            return;
+        case EDIT_UNDO_CURS_RIGHT:
+            edit_cursor_move (edit, r.value);
             break;
-        case CURS_LEFT:
-            edit_cursor_move (edit, -1);
+        case EDIT_UNDO_CURS_LEFT:
+            edit_cursor_move (edit, -r.value);
             break;
-        case BACKSPACE:
-            edit_backspace (edit, TRUE);
+        case EDIT_UNDO_BACKSPACE:
+        case EDIT_UNDO_BACKSPACE_BR:
+            edit_delete_block_at_cursor (edit, r.value, NULL, TRUE);
             break;
-        case DELCHAR:
-            edit_delete (edit, TRUE);
+        case EDIT_UNDO_DELCHAR:
+        case EDIT_UNDO_DELCHAR_BR:
+            edit_delete_block_at_cursor (edit, r.value, NULL, FALSE);
+            break;
+        case EDIT_UNDO_INSERT:
+            edit_insert_block (edit, text, r.value);
+            break;
+        case EDIT_UNDO_INSERT_AHEAD:
+            edit_insert_ahead_block (edit, text, r.value);
             break;
-        case COLUMN_ON:
+        case EDIT_UNDO_COLUMN_ON:
             edit->column_highlight = 1;
             break;
-        case COLUMN_OFF:
+        case EDIT_UNDO_COLUMN_OFF:
             edit->column_highlight = 0;
             break;
-        default:
-            break;
-        }
-        if (ac >= 256 && ac < 512)
-            edit_insert_ahead (edit, ac - 256);
-        if (ac >= 0 && ac < 256)
-            edit_insert (edit, ac);
-
-        if (ac >= MARK_1 - 2 && ac < MARK_2 - 2)
-        {
-            edit->mark1 = ac - MARK_1;
+        case EDIT_UNDO_MARK_1:
+            edit->mark1 = r.value;
             edit->column1 =
                 (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark1),
                                            0, edit->mark1);
-        }
-        else if (ac >= MARK_2 - 2 && ac < KEY_PRESS)
-        {
-            edit->mark2 = ac - MARK_2;
+            break;
+        case EDIT_UNDO_MARK_2:
+            edit->mark2 = r.value;
             edit->column2 =
                 (long) edit_move_forward3 (edit, edit_buffer_get_bol (&edit->buffer, edit->mark2),
                                            0, edit->mark2);
+            break;
+        case EDIT_UNDO_MARK_CURS:
+            edit->end_mark_curs = r.value;
+            break;
+        default:
+            break;
         }
+
         /* more than one pop usually means something big */
         if (count++)
             edit->force |= REDRAW_PAGE;
     }
+}
 
-    if (edit->start_display > ac - KEY_PRESS)
-    {
-        edit->start_line -=
-            edit_buffer_count_lines (&edit->buffer, ac - KEY_PRESS, edit->start_display);
-        edit->force |= REDRAW_PAGE;
-    }
-    else if (edit->start_display < ac - KEY_PRESS)
-    {
-        edit->start_line +=
-            edit_buffer_count_lines (&edit->buffer, edit->start_display, ac - KEY_PRESS);
-        edit->force |= REDRAW_PAGE;
-    }
-    edit->start_display = ac - KEY_PRESS;       /* see push and pop above */
-    edit_update_curs_row (edit);
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_do_undo (WEdit * edit)
+{
+    if (edit_undo_log_top (&edit->undo_log) == EDIT_UNDO_NONE)
+        return;
+
+    edit->undo_stack_disable = 1;       /* don't record undo's onto undo log! */
+    /* start of action in redo log */
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
+    edit_replay_log (edit, &edit->undo_log);
+    edit->undo_stack_disable = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_do_redo (WEdit * edit)
+{
+    if (edit->redo_stack_reset)
+        return;
 
-  done_redo:
-    ;
+    edit_replay_log (edit, &edit->redo_log);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1310,18 +1527,19 @@ edit_do_redo (WEdit * edit)
 static void
 edit_group_undo (WEdit * edit)
 {
-    long ac = KEY_PRESS;
-    long cur_ac = KEY_PRESS;
-    while (ac != STACK_BOTTOM && ac == cur_ac)
+    edit_undo_action_t ac = EDIT_UNDO_KEY_PRESS;
+    edit_undo_action_t cur_ac = EDIT_UNDO_KEY_PRESS;
+
+    while (ac != EDIT_UNDO_NONE && ac == cur_ac)
     {
-        cur_ac = get_prev_undo_action (edit);
+        cur_ac = edit_undo_log_top (&edit->undo_log);
         edit_do_undo (edit);
-        ac = get_prev_undo_action (edit);
+        ac = edit_undo_log_top (&edit->undo_log);
         /* exit from cycle if option_group_undo is not set,
          * and make single UNDO operation
          */
         if (!option_group_undo)
-            ac = STACK_BOTTOM;
+            ac = EDIT_UNDO_NONE;
     }
 }
 
@@ -1501,7 +1719,8 @@ check_and_wrap_line (WEdit * edit)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** this find the matching bracket in either direction, and sets edit->bracket
+/** this find the matching bracket in either direction, and sets edit->bracket.
+ * Brackets of code are looked up in bracket index, others are searched for byte by byte.
  *
  * @param edit editor object
  * @param in_screen seach only on the current screen
@@ -1516,7 +1735,7 @@ edit_get_bracket (WEdit * edit, gboolean in_screen, unsigned long furthest_brack
     const char *const b = "{}{[][()(", *p;
     int i = 1, inc = -1, c, d, n = 0;
     unsigned long j = 0;
-    off_t q;
+    off_t q, screen_end = edit->buffer.size;
 
     edit_update_curs_row (edit);
     c = edit_buffer_get_current_byte (&edit->buffer);
@@ -1529,6 +1748,26 @@ edit_get_bracket (WEdit * edit, gboolean in_screen, unsigned long furthest_brack
     /* going left or right? */
     if (strchr ("{[(", c) != NULL)
         inc = 1;
+
+    /* bracket of code: look it up in index */
+    if (in_screen)
+    {
+        long line;
+
+        line = edit->start_line + WIDGET (edit)->lines;
+        screen_end = line > edit->buffer.lines ? edit->buffer.size
+            : edit_buffer_get_line_offset (&edit->buffer, line);
+    }
+
+    if (edit_bracket_index_build (edit, inc > 0 ? screen_end : edit->buffer.curs1 + 1,
+                                  in_screen ? EDIT_BRACKET_INDEX_STEP : -1))
+    {
+        q = edit_bracket_index_match (&edit->bracket_index, &edit->buffer, edit->buffer.curs1);
+        if (q != -2)
+            return (in_screen && (q < edit->start_display || q >= screen_end)) ? -1 : q;
+    }
+
+    /* bracket in string or comment */
     /* no limit */
     if (furthest_bracket_search == 0)
         furthest_bracket_search--;      /* ULONG_MAX */
@@ -2025,25 +2264,23 @@ edit_insert_file (WEdit * edit, const vfs_path_t * filename_vpath)
             if (!option_persistent_selections && edit->modified)
             {
                 if (!edit->column_highlight)
-                    edit_push_undo_action (edit, COLUMN_OFF);
+                    edit_push_undo_action (edit, EDIT_UNDO_COLUMN_OFF, 0);
                 edit->column_highlight = 1;
             }
         }
         else
         {
-            off_t i;
+            buf = g_realloc (buf, INSERT_BUF_LEN);
+
+            while ((blocklen = mc_read (file, (char *) buf, INSERT_BUF_LEN)) > 0)
+                edit_insert_block (edit, buf, blocklen);
 
-            while ((blocklen = mc_read (file, (char *) buf, TEMP_BUF_LEN)) > 0)
-            {
-                for (i = 0; i < blocklen; i++)
-                    edit_insert (edit, buf[i]);
-            }
             /* highlight inserted text then not persistent blocks */
             if (!option_persistent_selections && edit->modified)
             {
                 edit_set_markers (edit, edit->buffer.curs1, current, 0, 0);
                 if (edit->column_highlight)
-                    edit_push_undo_action (edit, COLUMN_ON);
+                    edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
                 edit->column_highlight = 0;
             }
 
@@ -2129,13 +2366,8 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
     /* set file name before load file */
     edit_set_filename (edit, filename_vpath);
 
-    edit->undo_stack_size = START_STACK_SIZE;
-    edit->undo_stack_size_mask = START_STACK_SIZE - 1;
-    edit->undo_stack = g_malloc0 ((edit->undo_stack_size + 10) * sizeof (long));
-
-    edit->redo_stack_size = START_STACK_SIZE;
-    edit->redo_stack_size_mask = START_STACK_SIZE - 1;
-    edit->redo_stack = g_malloc0 ((edit->redo_stack_size + 10) * sizeof (long));
+    edit_undo_log_init (&edit->undo_log, (gsize) MAX (option_max_undo, 4096));
+    edit_undo_log_init (&edit->redo_log, (gsize) MAX (option_max_undo, 4096));
 
 #ifdef HAVE_CHARSET
     edit->utf8 = FALSE;
@@ -2153,6 +2385,12 @@ edit_init (WEdit * edit, int y, int x, int lines, int cols, const vfs_path_t * f
 
     edit->loading_done = 1;
     edit->modified = 0;
+    edit_word_index_init (&edit->word_index);
+    edit_bracket_index_init (&edit->bracket_index);
+#ifdef HAVE_ASPELL
+    edit_spell_init (&edit->spell);
+#endif
+    edit->column_cache = edit_column_cache_new ();
     edit->locked = 0;
     edit_load_syntax (edit, NULL, NULL);
     edit_get_syntax_color (edit, -1);
@@ -2202,8 +2440,15 @@ edit_clean (WEdit * edit)
 
     edit_buffer_clean (&edit->buffer);
 
-    g_free (edit->undo_stack);
-    g_free (edit->redo_stack);
+    edit_undo_log_clean (&edit->undo_log);
+    edit_undo_log_clean (&edit->redo_log);
+    edit_word_index_clean (&edit->word_index);
+    edit_bracket_index_clean (&edit->bracket_index);
+#ifdef HAVE_ASPELL
+    edit_spell_clean (&edit->spell);
+#endif
+    edit_column_cache_free (edit->column_cache);
+    edit_screen_clean (edit);
     vfs_path_free (edit->filename_vpath);
     vfs_path_free (edit->dir_vpath);
     mc_search_free (edit->search);
@@ -2257,6 +2502,50 @@ edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether large file that the text is read from directly was changed by another program.
+ * If so, the text is copied from the file as it is now and all indexes are rebuilt.
+ *
+ * @param edit editor object
+ *
+ * @return TRUE if the file was changed
+ */
+
+gboolean
+edit_check_mapped_file (WEdit * edit)
+{
+    char *msg;
+
+    if (!edit_buffer_unmap_changed (&edit->buffer))
+        return FALSE;
+
+    edit_column_cache_free (edit->column_cache);
+    edit->column_cache = edit_column_cache_new ();
+    edit_word_index_clean (&edit->word_index);
+    edit_word_index_init (&edit->word_index);
+    edit_bracket_index_reset (&edit->bracket_index);
+#ifdef HAVE_ASPELL
+    edit_spell_clean (&edit->spell);
+    edit_spell_init (&edit->spell);
+#endif
+    if (option_syntax_highlighting)
+        edit_load_syntax (edit, NULL, edit->syntax_type);
+
+    edit->start_line = MIN (edit->start_line, edit->buffer.curs_line);
+    edit->start_display = edit_buffer_get_line_offset (&edit->buffer, edit->start_line);
+    edit_update_curs_row (edit);
+    edit->force |= REDRAW_COMPLETELY;
+
+    msg = g_strdup_printf (_("File \"%s\" was changed by another program.\n"
+                             "The text was read from the file again, save it with care."),
+                           vfs_path_as_str (edit->filename_vpath));
+    edit_error_dialog (_("Warning"), msg);
+    g_free (msg);
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 #ifdef HAVE_CHARSET
@@ -2283,222 +2572,46 @@ edit_set_codeset (WEdit * edit)
 
     if (cp_id != NULL)
         edit->utf8 = str_isutf8 (cp_id);
+
+    convert_from_8bit_to_utf_table (edit->utf_table, edit->converter);
 }
 #endif
 
 /* --------------------------------------------------------------------------------------------- */
 
 /**
- * Recording stack for undo:
- * The following is an implementation of a compressed stack. Identical
- * pushes are recorded by a negative prefix indicating the number of times the
- * same char was pushed. This saves space for repeated curs-left or curs-right
- * delete etc.
- *
- * eg:
- *
- * pushed:       stored:
- *
- * a
- * b             a
- * b            -3
- * b             b
- * c  -->       -4
- * c             c
- * c             d
- * c
- * d
- *
- * If the stack long int is 0-255 it represents a normal insert (from a backspace),
- * 256-512 is an insert ahead (from a delete), If it is betwen 600 and 700 it is one
- * of the cursor functions define'd in edit-impl.h. 1000 through 700'000'000 is to
- * set edit->mark1 position. 700'000'000 through 1400'000'000 is to set edit->mark2
- * position.
- *
+ * Recording log for undo:
  * The only way the cursor moves or the buffer is changed is through the routines:
- * insert, backspace, insert_ahead, delete, and cursor_move.
- * These record the reverse undo movements onto the stack each time they are
- * called.
+ * insert, backspace, insert_ahead, delete, their block variants and cursor_move.
+ * These record the reverse undo movements onto the log each time they are
+ * called. Identical pushes are merged into one record (see editundo.c), so
+ * repeated curs-left, curs-right, typed text or deletions cost one record.
  *
  * Each key press results in a set of actions (insert; delete ...). So each time
  * a key is pressed the current position of start_display is pushed as
- * KEY_PRESS + start_display. Then for undoing, we pop until we get to a number
- * over KEY_PRESS. We then assign this number less KEY_PRESS to start_display. So undo
- * tracks scrolling and key actions exactly. (KEY_PRESS is about (2^31) * (2/3) = 1400'000'000)
- *
+ * EDIT_UNDO_KEY_PRESS record. Then for undoing, we pop until we get to this record
+ * and assign its value to start_display. So undo tracks scrolling and key actions exactly.
  *
+ * While undo is replayed, reverse actions are recorded onto the redo log.
  *
  * @param edit editor object
- * @param c code of the action
+ * @param action the action
+ * @param value counter or position of the action
  */
 
 void
-edit_push_undo_action (WEdit * edit, long c)
-{
-    unsigned long sp = edit->undo_stack_pointer;
-    unsigned long spm1;
-    long *t;
-
-    /* first enlarge the stack if necessary */
-    if (sp > edit->undo_stack_size - 10)
-    {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->undo_stack_size < (unsigned long) option_max_undo)
-        {
-            t = g_realloc (edit->undo_stack, (edit->undo_stack_size * 2 + 10) * sizeof (long));
-            if (t)
-            {
-                edit->undo_stack = t;
-                edit->undo_stack_size <<= 1;
-                edit->undo_stack_size_mask = edit->undo_stack_size - 1;
-            }
-        }
-    }
-    spm1 = (edit->undo_stack_pointer - 1) & edit->undo_stack_size_mask;
+edit_push_undo_action (WEdit * edit, edit_undo_action_t action, off_t value)
+{
     if (edit->undo_stack_disable)
     {
-        edit_push_redo_action (edit, KEY_PRESS);
-        edit_push_redo_action (edit, c);
+        edit_undo_log_push (&edit->redo_log, action, value);
         return;
     }
 
     if (edit->redo_stack_reset)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
-
-    if (edit->undo_stack_bottom != sp
-        && spm1 != edit->undo_stack_bottom
-        && ((sp - 2) & edit->undo_stack_size_mask) != edit->undo_stack_bottom)
-    {
-        long d;
-        if (edit->undo_stack[spm1] < 0)
-        {
-            d = edit->undo_stack[(sp - 2) & edit->undo_stack_size_mask];
-            if (d == c && edit->undo_stack[spm1] > -1000000000)
-            {
-                if (c < KEY_PRESS)      /* --> no need to push multiple do-nothings */
-                    edit->undo_stack[spm1]--;
-                return;
-            }
-        }
-        else
-        {
-            d = edit->undo_stack[spm1];
-            if (d == c)
-            {
-                if (c >= KEY_PRESS)
-                    return;     /* --> no need to push multiple do-nothings */
-                edit->undo_stack[sp] = -2;
-                goto check_bottom;
-            }
-        }
-    }
-    edit->undo_stack[sp] = c;
-
-  check_bottom:
-    edit->undo_stack_pointer = (edit->undo_stack_pointer + 1) & edit->undo_stack_size_mask;
-
-    /* if the sp wraps round and catches the undo_stack_bottom then erase
-     * the first set of actions on the stack to make space - by moving
-     * undo_stack_bottom forward one "key press" */
-    c = (edit->undo_stack_pointer + 2) & edit->undo_stack_size_mask;
-    if ((unsigned long) c == edit->undo_stack_bottom ||
-        (((unsigned long) c + 1) & edit->undo_stack_size_mask) == edit->undo_stack_bottom)
-        do
-        {
-            edit->undo_stack_bottom = (edit->undo_stack_bottom + 1) & edit->undo_stack_size_mask;
-        }
-        while (edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS
-               && edit->undo_stack_bottom != edit->undo_stack_pointer);
-
-    /*If a single key produced enough pushes to wrap all the way round then we would notice that the [undo_stack_bottom] does not contain KEY_PRESS. The stack is then initialised: */
-    if (edit->undo_stack_pointer != edit->undo_stack_bottom
-        && edit->undo_stack[edit->undo_stack_bottom] < KEY_PRESS)
-    {
-        edit->undo_stack_bottom = edit->undo_stack_pointer = 0;
-    }
-}
-
-/* --------------------------------------------------------------------------------------------- */
-
-void
-edit_push_redo_action (WEdit * edit, long c)
-{
-    unsigned long sp = edit->redo_stack_pointer;
-    unsigned long spm1;
-    long *t;
-    /* first enlarge the stack if necessary */
-    if (sp > edit->redo_stack_size - 10)
-    {                           /* say */
-        if (option_max_undo < 256)
-            option_max_undo = 256;
-        if (edit->redo_stack_size < (unsigned long) option_max_undo)
-        {
-            t = g_realloc (edit->redo_stack, (edit->redo_stack_size * 2 + 10) * sizeof (long));
-            if (t)
-            {
-                edit->redo_stack = t;
-                edit->redo_stack_size <<= 1;
-                edit->redo_stack_size_mask = edit->redo_stack_size - 1;
-            }
-        }
-    }
-    spm1 = (edit->redo_stack_pointer - 1) & edit->redo_stack_size_mask;
-
-    if (edit->redo_stack_bottom != sp
-        && spm1 != edit->redo_stack_bottom
-        && ((sp - 2) & edit->redo_stack_size_mask) != edit->redo_stack_bottom)
-    {
-        long d;
-        if (edit->redo_stack[spm1] < 0)
-        {
-            d = edit->redo_stack[(sp - 2) & edit->redo_stack_size_mask];
-            if (d == c && edit->redo_stack[spm1] > -1000000000)
-            {
-                if (c < KEY_PRESS)      /* --> no need to push multiple do-nothings */
-                    edit->redo_stack[spm1]--;
-                return;
-            }
-        }
-        else
-        {
-            d = edit->redo_stack[spm1];
-            if (d == c)
-            {
-                if (c >= KEY_PRESS)
-                    return;     /* --> no need to push multiple do-nothings */
-                edit->redo_stack[sp] = -2;
-                goto redo_check_bottom;
-            }
-        }
-    }
-    edit->redo_stack[sp] = c;
-
-  redo_check_bottom:
-    edit->redo_stack_pointer = (edit->redo_stack_pointer + 1) & edit->redo_stack_size_mask;
-
-    /* if the sp wraps round and catches the redo_stack_bottom then erase
-     * the first set of actions on the stack to make space - by moving
-     * redo_stack_bottom forward one "key press" */
-    c = (edit->redo_stack_pointer + 2) & edit->redo_stack_size_mask;
-    if ((unsigned long) c == edit->redo_stack_bottom ||
-        (((unsigned long) c + 1) & edit->redo_stack_size_mask) == edit->redo_stack_bottom)
-        do
-        {
-            edit->redo_stack_bottom = (edit->redo_stack_bottom + 1) & edit->redo_stack_size_mask;
-        }
-        while (edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS
-               && edit->redo_stack_bottom != edit->redo_stack_pointer);
-
-    /*
-     * If a single key produced enough pushes to wrap all the way round then
-     * we would notice that the [redo_stack_bottom] does not contain KEY_PRESS.
-     * The stack is then initialised:
-     */
+        edit_undo_log_clear (&edit->redo_log);
 
-    if (edit->redo_stack_pointer != edit->redo_stack_bottom
-        && edit->redo_stack[edit->redo_stack_bottom] < KEY_PRESS)
-        edit->redo_stack_bottom = edit->redo_stack_pointer = 0;
+    edit_undo_log_push (&edit->undo_log, action, value);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2533,15 +2646,15 @@ edit_insert (WEdit * edit, int c)
     /* save the reverse command onto the undo stack */
     /* ordinary char and not space */
     if (c > 32)
-        edit_push_undo_action (edit, BACKSPACE);
+        edit_push_undo_action (edit, EDIT_UNDO_BACKSPACE, 1);
     else
-        edit_push_undo_action (edit, BACKSPACE_BR);
+        edit_push_undo_action (edit, EDIT_UNDO_BACKSPACE_BR, 1);
     /* update markers */
     edit->mark1 += (edit->mark1 > edit->buffer.curs1) ? 1 : 0;
     edit->mark2 += (edit->mark2 > edit->buffer.curs1) ? 1 : 0;
-    edit->last_get_rule += (edit->last_get_rule > edit->buffer.curs1) ? 1 : 0;
 
     edit_buffer_insert (&edit->buffer, c);
+    edit_text_changed (edit, edit->buffer.curs1 - 1, NULL, 0, 1);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2565,15 +2678,99 @@ edit_insert_ahead (WEdit * edit, int c)
     }
     /* ordinary char and not space */
     if (c > 32)
-        edit_push_undo_action (edit, DELCHAR);
+        edit_push_undo_action (edit, EDIT_UNDO_DELCHAR, 1);
     else
-        edit_push_undo_action (edit, DELCHAR_BR);
+        edit_push_undo_action (edit, EDIT_UNDO_DELCHAR_BR, 1);
 
     edit->mark1 += (edit->mark1 >= edit->buffer.curs1) ? 1 : 0;
     edit->mark2 += (edit->mark2 >= edit->buffer.curs1) ? 1 : 0;
-    edit->last_get_rule += (edit->last_get_rule >= edit->buffer.curs1) ? 1 : 0;
 
     edit_buffer_insert_ahead (&edit->buffer, c);
+    edit_text_changed (edit, edit->buffer.curs1, NULL, 0, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert block of text at the cursor in one operation. Same as edit_insert() for every byte
+ * of block, but line counters, bookmarks and markers are updated once for all block.
+ *
+ * @param edit editor object
+ * @param text bytes to insert
+ * @param len number of bytes
+ * @param ahead if TRUE, cursor stays before the inserted text (as edit_insert_ahead() does)
+ */
+
+static void
+edit_insert_block_at_cursor (WEdit * edit, const char *text, off_t len, gboolean ahead)
+{
+    off_t curs1 = edit->buffer.curs1;
+    long lines, i;
+
+    if (len <= 0)
+        return;
+
+    if (ahead)
+        edit_buffer_insert_ahead_block (&edit->buffer, text, len);
+    else
+        edit_buffer_insert_block (&edit->buffer, text, len);
+
+    lines = edit_buffer_count_lines (&edit->buffer, curs1, curs1 + len);
+
+    /* first we must update the position of the display window */
+    if (curs1 < edit->start_display)
+    {
+        edit->start_display += len;
+        edit->start_line += lines;
+    }
+
+    /* Mark file as modified, unless the file hasn't been fully loaded */
+    if (ahead || edit->loading_done)
+        edit_modification (edit);
+
+    if (lines != 0)
+    {
+        for (i = 0; i < lines; i++)
+            book_mark_inc (edit, edit->buffer.curs_line + (ahead ? 0 : i));
+        if (!ahead)
+            edit->buffer.curs_line += lines;
+        edit->buffer.lines += lines;
+        edit->force |= ahead ? REDRAW_AFTER_CURSOR : REDRAW_LINE_ABOVE | REDRAW_AFTER_CURSOR;
+    }
+
+    /* save the reverse command onto the undo stack */
+    edit_push_undo_action (edit, ahead ? EDIT_UNDO_DELCHAR : EDIT_UNDO_BACKSPACE, len);
+
+    /* update markers */
+    if (ahead)
+    {
+        edit->mark1 += (edit->mark1 >= curs1) ? len : 0;
+        edit->mark2 += (edit->mark2 >= curs1) ? len : 0;
+    }
+    else
+    {
+        edit->mark1 += (edit->mark1 > curs1) ? len : 0;
+        edit->mark2 += (edit->mark2 > curs1) ? len : 0;
+    }
+
+    edit_text_changed (edit, curs1, NULL, 0, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** same as edit_insert for every byte of block */
+
+void
+edit_insert_block (WEdit * edit, const char *text, off_t len)
+{
+    edit_insert_block_at_cursor (edit, text, len, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** same as edit_insert_block and move left */
+
+void
+edit_insert_ahead_block (WEdit * edit, const char *text, off_t len)
+{
+    edit_insert_block_at_cursor (edit, text, len, TRUE);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2597,6 +2794,7 @@ edit_delete (WEdit * edit, gboolean byte_delete)
     int p = 0;
     int char_length = 1;
     int i;
+    char c;
 
     if (edit->buffer.curs2 == 0)
         return 0;
@@ -2625,12 +2823,12 @@ edit_delete (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 > edit->buffer.curs1)
             edit->mark2--;
-        if (edit->last_get_rule > edit->buffer.curs1)
-            edit->last_get_rule--;
 
         p = edit_buffer_delete (&edit->buffer);
+        c = (char) p;
+        edit_text_changed (edit, edit->buffer.curs1, &c, 1, 0);
 
-        edit_push_undo_action (edit, p + 256);
+        edit_push_undo_text (edit, EDIT_UNDO_INSERT_AHEAD, &c, 1);
     }
 
     edit_modification (edit);
@@ -2650,6 +2848,24 @@ edit_delete (WEdit * edit, gboolean byte_delete)
     return p;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete block of bytes at the cursor in one operation. Same as edit_delete (edit, TRUE) for
+ * every byte of block.
+ *
+ * @param edit editor object
+ * @param len number of bytes to delete
+ * @param deleted buffer to store deleted bytes, may be NULL
+ *
+ * @return number of deleted bytes
+ */
+
+off_t
+edit_delete_block (WEdit * edit, off_t len, char *deleted)
+{
+    return edit_delete_block_at_cursor (edit, len, deleted, FALSE);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
@@ -2658,6 +2874,7 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
     int p = 0;
     int char_length = 1;
     int i;
+    char c;
 
     if (edit->buffer.curs1 == 0)
         return 0;
@@ -2685,12 +2902,12 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 >= edit->buffer.curs1)
             edit->mark2--;
-        if (edit->last_get_rule >= edit->buffer.curs1)
-            edit->last_get_rule--;
 
         p = edit_buffer_backspace (&edit->buffer);
+        c = (char) p;
+        edit_text_changed (edit, edit->buffer.curs1, &c, 1, 0);
 
-        edit_push_undo_action (edit, p);
+        edit_push_undo_text (edit, EDIT_UNDO_INSERT, &c, 1);
     }
     edit_modification (edit);
     if (p == '\n')
@@ -2717,42 +2934,41 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
 void
 edit_cursor_move (WEdit * edit, off_t increment)
 {
+    long lines;
+
     if (increment < 0)
     {
-        for (; increment < 0 && edit->buffer.curs1 != 0; increment++)
-        {
-            int c;
+        increment = MAX (increment, -edit->buffer.curs1);
 
-            edit_push_undo_action (edit, CURS_RIGHT);
+        if (increment != 0)
+            edit_push_undo_action (edit, EDIT_UNDO_CURS_RIGHT, -increment);
 
-            c = edit_buffer_get_previous_byte (&edit->buffer);
-            edit_buffer_insert_ahead (&edit->buffer, c);
-            c = edit_buffer_backspace (&edit->buffer);
-            if (c == '\n')
-            {
-                edit->buffer.curs_line--;
-                edit->force |= REDRAW_LINE_BELOW;
-            }
+        lines = edit_buffer_count_lines (&edit->buffer, edit->buffer.curs1 + increment,
+                                         edit->buffer.curs1);
+        if (lines != 0)
+        {
+            edit->buffer.curs_line -= lines;
+            edit->force |= REDRAW_LINE_BELOW;
         }
     }
     else
     {
-        for (; increment > 0 && edit->buffer.curs2 != 0; increment--)
-        {
-            int c;
+        increment = MIN (increment, edit->buffer.curs2);
 
-            edit_push_undo_action (edit, CURS_LEFT);
+        if (increment != 0)
+            edit_push_undo_action (edit, EDIT_UNDO_CURS_LEFT, increment);
 
-            c = edit_buffer_get_current_byte (&edit->buffer);
-            edit_buffer_insert (&edit->buffer, c);
-            c = edit_buffer_delete (&edit->buffer);
-            if (c == '\n')
-            {
-                edit->buffer.curs_line++;
-                edit->force |= REDRAW_LINE_ABOVE;
-            }
+        lines = edit_buffer_count_lines (&edit->buffer, edit->buffer.curs1,
+                                         edit->buffer.curs1 + increment);
+        if (lines != 0)
+        {
+            edit->buffer.curs_line += lines;
+            edit->force |= REDRAW_LINE_ABOVE;
         }
     }
+
+    /* piece table doesn't need to move the text */
+    edit_buffer_set_cursor (&edit->buffer, edit->buffer.curs1 + increment);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2762,8 +2978,10 @@ edit_cursor_move (WEdit * edit, off_t increment)
 off_t
 edit_move_forward3 (const WEdit * edit, off_t current, long cols, off_t upto)
 {
-    off_t p, q;
-    long col;
+    off_t p, q, limit, n;
+    long col = 0, max_col = 0;
+    gboolean at_bol;
+    edit_column_line_t *line = NULL;
 
     if (upto != 0)
     {
@@ -2773,10 +2991,49 @@ edit_move_forward3 (const WEdit * edit, off_t current, long cols, off_t upto)
     else
         q = edit->buffer.size + 2;
 
-    for (col = 0, p = current; p < q; p++)
+    p = current;
+
+    /* long lines have checkpoints to start from */
+    at_bol = edit->column_cache != NULL
+        && (current == 0 || edit_buffer_get_byte (&edit->buffer, current - 1) == '\n');
+    if (at_bol)
+    {
+        line = edit_column_cache_find (edit, current);
+        if (line != NULL)
+        {
+            const edit_column_point_t *pt;
+
+            pt = edit_column_line_seek (line, cols, upto);
+            if (pt != NULL)
+            {
+                p = current + pt->offset;
+                col = pt->col;
+                max_col = pt->max_col;
+            }
+        }
+    }
+
+    for (; p < q; p++)
     {
         int c, orig_c;
 
+        if (col > max_col)
+            max_col = col;
+
+        if (at_bol && p - current == (off_t) ((line == NULL ? 0 : line->points->len) + 1) *
+            EDIT_COLUMN_STEP)
+        {
+            edit_column_point_t pt;
+
+            if (line == NULL)
+                line = edit_column_cache_add (edit->column_cache, current);
+
+            pt.offset = p - current;
+            pt.col = col;
+            pt.max_col = max_col;
+            g_array_append_val (line->points, pt);
+        }
+
         if (cols != -10)
         {
             if (col == cols)
@@ -2785,6 +3042,21 @@ edit_move_forward3 (const WEdit * edit, off_t current, long cols, off_t upto)
                 return p - 1;
         }
 
+        /* skip run of printable ASCII characters up to the next position which should be checked:
+           the last character of run is processed below */
+        limit = q;
+        if (cols != -10)
+            limit = MIN (limit, p + (cols - col));
+        if (at_bol)
+            limit = MIN (limit, current + (off_t) ((line == NULL ? 0 : line->points->len) + 1) *
+                         EDIT_COLUMN_STEP);
+        n = edit_count_ascii (&edit->buffer, p, limit);
+        if (n > 1)
+        {
+            p += n - 1;
+            col += n - 1;
+        }
+
         orig_c = c = edit_buffer_get_byte (&edit->buffer, p);
 
 #ifdef HAVE_CHARSET
@@ -3046,9 +3318,9 @@ edit_move_display (WEdit * e, long line)
 void
 edit_push_markers (WEdit * edit)
 {
-    edit_push_undo_action (edit, MARK_1 + edit->mark1);
-    edit_push_undo_action (edit, MARK_2 + edit->mark2);
-    edit_push_undo_action (edit, MARK_CURS + edit->end_mark_curs);
+    edit_push_undo_action (edit, EDIT_UNDO_MARK_1, edit->mark1);
+    edit_push_undo_action (edit, EDIT_UNDO_MARK_2, edit->mark2);
+    edit_push_undo_action (edit, EDIT_UNDO_MARK_CURS, edit->end_mark_curs);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3171,11 +3443,11 @@ edit_delete_line (WEdit * edit)
 void
 edit_push_key_press (WEdit * edit)
 {
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
     if (edit->mark2 == -1)
     {
-        edit_push_undo_action (edit, MARK_1 + edit->mark1);
-        edit_push_undo_action (edit, MARK_CURS + edit->end_mark_curs);
+        edit_push_undo_action (edit, EDIT_UNDO_MARK_1, edit->mark1);
+        edit_push_undo_action (edit, EDIT_UNDO_MARK_CURS, edit->end_mark_curs);
     }
 }
 
@@ -3428,7 +3700,7 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         if (!option_persistent_selections && edit->mark2 >= 0)
         {
             if (edit->column_highlight)
-                edit_push_undo_action (edit, COLUMN_ON);
+                edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
             edit->column_highlight = 0;
             edit_mark_cmd (edit, TRUE);
         }
@@ -3690,14 +3962,14 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         if (edit->mark2 >= 0)
         {
             if (edit->column_highlight)
-                edit_push_undo_action (edit, COLUMN_ON);
+                edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
             edit->column_highlight = 0;
         }
         edit_mark_cmd (edit, FALSE);
         break;
     case CK_MarkColumn:
         if (!edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_OFF);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN_OFF, 0);
         edit->column_highlight = 1;
         edit_mark_cmd (edit, FALSE);
         break;
@@ -3707,19 +3979,19 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         break;
     case CK_Unmark:
         if (edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_ON);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
         edit->column_highlight = 0;
         edit_mark_cmd (edit, TRUE);
         break;
     case CK_MarkWord:
         if (edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_ON);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
         edit->column_highlight = 0;
         edit_mark_current_word_cmd (edit);
         break;
     case CK_MarkLine:
         if (edit->column_highlight)
-            edit_push_undo_action (edit, COLUMN_ON);
+            edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
         edit->column_highlight = 0;
         edit_mark_current_line_cmd (edit);
         break;
@@ -3814,7 +4086,7 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
         if (!option_persistent_selections && edit->mark2 >= 0)
         {
             if (edit->column_highlight)
-                edit_push_undo_action (edit, COLUMN_ON);
+                edit_push_undo_action (edit, EDIT_UNDO_COLUMN_ON, 0);
             edit->column_highlight = 0;
             edit_mark_cmd (edit, TRUE);
         }
@@ -3873,12 +4145,17 @@ edit_execute_cmd (WEdit * edit, long command, int char_for_insertion)
 #ifdef HAVE_ASPELL
     case CK_SpellCheckCurrentWord:
         edit_suggest_current_word (edit);
+        /* the word may be added to dictionary */
+        widget_idle (WIDGET (WIDGET (edit)->owner), TRUE);
         break;
     case CK_SpellCheck:
         edit_spellcheck_file (edit);
+        widget_idle (WIDGET (WIDGET (edit)->owner), TRUE);
         break;
     case CK_SpellCheckSelectLang:
         edit_set_spell_lang ();
+        /* check text with new dictionary */
+        widget_idle (WIDGET (WIDGET (edit)->owner), TRUE);
         break;
 #endif
 
@@ -4031,6 +4308,8 @@ edit_stack_free (void)
 {
     for (edit_stack_iterator = 0; edit_stack_iterator < MAX_HISTORY_MOVETO; edit_stack_iterator++)
         vfs_path_free (edit_history_moveto[edit_stack_iterator].filename_vpath);
+
+    etags_cache_free ();
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,857 @@
+/*
+   Editor index of brackets for bracket matching.
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor index of brackets for bracket matching.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+
+#include "edit-impl.h"          /* edit_get_syntax_rule() */
+#include "editwidget.h"
+#include "editbrackets.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * Brackets of every kind are kept in a treap ordered by offset. Node of tree holds the distance
+ * from the previous bracket, so that a change of text moves all following brackets by updating
+ * one node. Every subtree knows the sum of its bracket directions (+1 for opening bracket,
+ * -1 for closing one) and the extremes of prefix and suffix sums, so the matching bracket is
+ * found by descending the tree and skipping the subtrees where the depth doesn't reach zero:
+ *
+ *     ( [ ( ) ] )      depth after '(' at 2:  ) -1
+ *     0 1 2 3 4 5
+ *
+ * Only brackets of code are indexed: with syntax highlighting on, brackets in strings and
+ * comments (any context but the default one) are skipped.
+ *
+ * Index is built from the start of text, all brackets before 'indexed' offset are known.
+ * A change of text can alter highlighting of everything after it, so brackets after the start
+ * of changed line are moved aside as "old" ones and the text is scanned again. Highlighting
+ * states are saved at checkpoints while scanning: when the state after the change becomes equal
+ * to the saved one, the old brackets after the checkpoint are taken back without scanning.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* distance between checkpoints of highlighting state */
+#define EDIT_BRACKET_STATE_DENSITY 4096
+
+#define NODE_TOTAL(n) ((n) != NULL ? (n)->total : 0)
+#define NODE_SUM(n) ((n) != NULL ? (n)->sum : 0)
+
+#define BRACKET_STATE(a, i) (&g_array_index ((a), edit_bracket_state_t, (i)))
+#define BRACKET_STATE_LAST(a) BRACKET_STATE ((a), (a)->len - 1)
+
+/*** file scope type declarations ****************************************************************/
+
+struct edit_bracket_node_struct
+{
+    off_t len;                  /* bytes after the previous bracket up to this one inclusive */
+    off_t total;                /* sum of len of subtree */
+    int dir;                    /* +1 for opening bracket, -1 for closing one */
+    int sum;                    /* sum of dir of subtree */
+    int min_prefix;             /* minimal sum of dir of leading brackets of subtree */
+    int max_suffix;             /* maximal sum of dir of trailing brackets of subtree */
+    guint32 prio;               /* random priority, parent's one is greater */
+    struct edit_bracket_node_struct *left;
+    struct edit_bracket_node_struct *right;
+};
+
+typedef struct edit_bracket_node_struct edit_bracket_node_t;
+
+/* checkpoint of highlighting state */
+typedef struct
+{
+    off_t offset;
+    edit_syntax_rule_t rule;    /* state after byte at offset */
+} edit_bracket_state_t;
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get kind of bracket.
+ *
+ * @param c byte
+ * @param dir where to store direction of bracket
+ *
+ * @return kind of bracket, -1 if c isn't a bracket
+ */
+
+static inline int
+edit_bracket_kind (int c, int *dir)
+{
+    switch (c)
+    {
+    case '(':
+        *dir = 1;
+        return 0;
+    case ')':
+        *dir = -1;
+        return 0;
+    case '[':
+        *dir = 1;
+        return 1;
+    case ']':
+        *dir = -1;
+        return 1;
+    case '{':
+        *dir = 1;
+        return 2;
+    case '}':
+        *dir = -1;
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline void
+edit_bracket_node_update (edit_bracket_node_t * n)
+{
+    int left_sum, right_sum;
+
+    left_sum = NODE_SUM (n->left);
+    right_sum = NODE_SUM (n->right);
+
+    n->total = NODE_TOTAL (n->left) + n->len + NODE_TOTAL (n->right);
+    n->sum = left_sum + n->dir + right_sum;
+
+    n->min_prefix = left_sum + n->dir;
+    if (n->left != NULL)
+        n->min_prefix = MIN (n->min_prefix, n->left->min_prefix);
+    if (n->right != NULL)
+        n->min_prefix = MIN (n->min_prefix, left_sum + n->dir + n->right->min_prefix);
+
+    n->max_suffix = n->dir + right_sum;
+    if (n->right != NULL)
+        n->max_suffix = MAX (n->max_suffix, n->right->max_suffix);
+    if (n->left != NULL)
+        n->max_suffix = MAX (n->max_suffix, n->dir + right_sum + n->left->max_suffix);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_bracket_node_t *
+edit_bracket_node_new (edit_bracket_index_t * index, int dir)
+{
+    edit_bracket_node_t *n;
+
+    /* xorshift32 */
+    index->seed ^= index->seed << 13;
+    index->seed ^= index->seed >> 17;
+    index->seed ^= index->seed << 5;
+
+    n = g_new (edit_bracket_node_t, 1);
+    n->len = 1;
+    n->dir = dir;
+    n->prio = index->seed;
+    n->left = NULL;
+    n->right = NULL;
+    edit_bracket_node_update (n);
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_bracket_node_free (edit_bracket_node_t * n)
+{
+    while (n != NULL)
+    {
+        edit_bracket_node_t *right = n->right;
+
+        edit_bracket_node_free (n->left);
+        g_free (n);
+        n = right;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** move all brackets of tree by delta bytes */
+
+static void
+edit_bracket_node_shift (edit_bracket_node_t * n, off_t delta)
+{
+    for (; n != NULL; n = n->left)
+    {
+        n->total += delta;
+        if (n->left == NULL)
+            n->len += delta;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split tree: brackets before pos go to the left tree. Offsets of the right tree are counted
+ * from the end of the left one.
+ */
+
+static void
+edit_bracket_node_split (edit_bracket_node_t * n, off_t pos, edit_bracket_node_t ** l,
+                         edit_bracket_node_t ** r)
+{
+    off_t left;
+
+    if (n == NULL)
+    {
+        *l = NULL;
+        *r = NULL;
+        return;
+    }
+
+    left = NODE_TOTAL (n->left);
+
+    if (left + n->len - 1 < pos)
+    {
+        edit_bracket_node_split (n->right, pos - left - n->len, &n->right, r);
+        edit_bracket_node_update (n);
+        *l = n;
+    }
+    else
+    {
+        edit_bracket_node_split (n->left, pos, l, &n->left);
+        edit_bracket_node_update (n);
+        *r = n;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** concatenate trees, all brackets of l are before brackets of r */
+
+static edit_bracket_node_t *
+edit_bracket_node_merge (edit_bracket_node_t * l, edit_bracket_node_t * r)
+{
+    if (l == NULL)
+        return r;
+    if (r == NULL)
+        return l;
+
+    if (l->prio > r->prio)
+    {
+        l->right = edit_bracket_node_merge (l->right, r);
+        edit_bracket_node_update (l);
+        return l;
+    }
+
+    r->left = edit_bracket_node_merge (l, r->left);
+    edit_bracket_node_update (r);
+    return r;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split tree at offset.
+ *
+ * @param n tree
+ * @param pos offset
+ * @param l where to store brackets before pos
+ * @param r where to store brackets at pos and after it, with offsets counted from pos
+ */
+
+static void
+edit_bracket_split (edit_bracket_node_t * n, off_t pos, edit_bracket_node_t ** l,
+                    edit_bracket_node_t ** r)
+{
+    edit_bracket_node_split (n, pos, l, r);
+    edit_bracket_node_shift (*r, NODE_TOTAL (*l) - pos);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append brackets to tree.
+ *
+ * @param l tree
+ * @param r brackets to append, offsets are counted from start
+ * @param start offset in l where r starts, not less than offset of the last bracket of l
+ *
+ * @return joined tree
+ */
+
+static edit_bracket_node_t *
+edit_bracket_join (edit_bracket_node_t * l, edit_bracket_node_t * r, off_t start)
+{
+    if (r == NULL)
+        return l;
+
+    edit_bracket_node_shift (r, start - NODE_TOTAL (l));
+    return edit_bracket_node_merge (l, r);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** drop brackets at offset and after it */
+
+static edit_bracket_node_t *
+edit_bracket_truncate (edit_bracket_node_t * n, off_t pos)
+{
+    edit_bracket_node_t *l, *r;
+
+    edit_bracket_node_split (n, pos, &l, &r);
+    edit_bracket_node_free (r);
+    return l;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+edit_bracket_node_find (const edit_bracket_node_t * n, off_t pos)
+{
+    while (n != NULL)
+    {
+        off_t left, at;
+
+        left = NODE_TOTAL (n->left);
+        at = left + n->len - 1;
+
+        if (pos == at)
+            return TRUE;
+
+        if (pos < at)
+            n = n->left;
+        else
+        {
+            pos -= left + n->len;
+            n = n->right;
+        }
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first bracket after offset where depth falls below zero.
+ *
+ * @param n subtree
+ * @param base offset where subtree starts
+ * @param from offset of opening bracket
+ * @param depth current depth, updated by brackets which are passed
+ *
+ * @return offset of matching bracket, -1 if it isn't in subtree
+ */
+
+static off_t
+edit_bracket_find_forward (const edit_bracket_node_t * n, off_t base, off_t from, int *depth)
+{
+    off_t q;
+
+    /* all brackets of subtree are before the opening one */
+    if (n == NULL || base + n->total - 1 <= from)
+        return -1;
+
+    /* whole subtree is after the opening bracket and depth stays non-negative in it */
+    if (base > from && *depth + n->min_prefix >= 0)
+    {
+        *depth += n->sum;
+        return -1;
+    }
+
+    q = edit_bracket_find_forward (n->left, base, from, depth);
+    if (q >= 0)
+        return q;
+
+    base += NODE_TOTAL (n->left) + n->len;
+    if (base - 1 > from)
+    {
+        *depth += n->dir;
+        if (*depth < 0)
+            return base - 1;
+    }
+
+    return edit_bracket_find_forward (n->right, base, from, depth);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last bracket before offset where depth rises above zero.
+ *
+ * @param n subtree
+ * @param base offset where subtree starts
+ * @param before offset of closing bracket
+ * @param depth current depth, updated by brackets which are passed
+ *
+ * @return offset of matching bracket, -1 if it isn't in subtree
+ */
+
+static off_t
+edit_bracket_find_backward (const edit_bracket_node_t * n, off_t base, off_t before, int *depth)
+{
+    off_t pos, q;
+
+    /* all brackets of subtree are after the closing one */
+    if (n == NULL || base >= before)
+        return -1;
+
+    /* whole subtree is before the closing bracket and depth stays non-positive in it */
+    if (base + n->total - 1 < before && *depth + n->max_suffix <= 0)
+    {
+        *depth += n->sum;
+        return -1;
+    }
+
+    pos = base + NODE_TOTAL (n->left) + n->len - 1;
+
+    q = edit_bracket_find_backward (n->right, pos + 1, before, depth);
+    if (q >= 0)
+        return q;
+
+    if (pos < before)
+    {
+        *depth += n->dir;
+        if (*depth > 0)
+            return pos;
+    }
+
+    return edit_bracket_find_backward (n->left, base, before, depth);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_bracket_old_free (edit_bracket_index_t * index)
+{
+    int k;
+
+    for (k = 0; k < EDIT_BRACKET_KINDS; k++)
+    {
+        edit_bracket_node_free (index->old_tree[k]);
+        index->old_tree[k] = NULL;
+    }
+
+    g_array_set_size (index->old_states, 0);
+    index->old_start = 0;
+    index->old_end = -1;
+    index->old_shift = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+edit_bracket_is_code (WEdit * edit, off_t offset)
+{
+    edit_syntax_rule_t rule;
+
+    if (!edit->bracket_index.code_only)
+        return TRUE;
+
+    edit_get_syntax_rule (edit, offset, &rule);
+    return (rule.context == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_bracket_state_add (WEdit * edit, off_t offset)
+{
+    edit_bracket_state_t s;
+
+    s.offset = offset;
+    if (edit->bracket_index.code_only)
+        edit_get_syntax_rule (edit, offset, &s.rule);
+    else
+        memset (&s.rule, 0, sizeof (s.rule));
+
+    g_array_append_val (edit->bracket_index.states, s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check old checkpoint. If highlighting state after it is the same as before the change of text,
+ * take back old brackets after the checkpoint.
+ *
+ * @param edit editor object
+ * @param offset offset of the last old checkpoint
+ */
+
+static void
+edit_bracket_state_verify (WEdit * edit, off_t offset)
+{
+    edit_bracket_index_t *index = &edit->bracket_index;
+    edit_bracket_state_t *s;
+    int k;
+
+    s = BRACKET_STATE_LAST (index->old_states);
+
+    if (index->code_only)
+    {
+        edit_syntax_rule_t rule;
+
+        edit_get_syntax_rule (edit, offset, &rule);
+        if (!edit_syntax_rule_equal (&rule, &s->rule, index->old_shift, offset))
+        {
+            g_array_set_size (index->old_states, index->old_states->len - 1);
+            return;
+        }
+    }
+
+    /* state is re-converged */
+    for (k = 0; k < EDIT_BRACKET_KINDS; k++)
+    {
+        edit_bracket_node_t *l, *r;
+
+        edit_bracket_split (index->old_tree[k], offset + 1 - index->old_start, &l, &r);
+        edit_bracket_node_free (l);
+        index->old_tree[k] = NULL;
+        index->tree[k] = edit_bracket_join (index->tree[k], r, offset + 1);
+    }
+
+    while (index->old_states->len != 0)
+    {
+        edit_bracket_state_t t;
+
+        t = *BRACKET_STATE_LAST (index->old_states);
+        t.offset += index->old_shift;
+        t.rule.end += index->old_shift;
+        if (index->states->len == 0 || t.offset > BRACKET_STATE_LAST (index->states)->offset)
+            g_array_append_val (index->states, t);
+        g_array_set_size (index->old_states, index->old_states->len - 1);
+    }
+
+    index->indexed = index->old_end;
+    edit_bracket_old_free (index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize empty bracket index.
+ *
+ * @param index bracket index
+ */
+
+void
+edit_bracket_index_init (edit_bracket_index_t * index)
+{
+    int k;
+
+    for (k = 0; k < EDIT_BRACKET_KINDS; k++)
+    {
+        index->tree[k] = NULL;
+        index->old_tree[k] = NULL;
+    }
+
+    index->indexed = 0;
+    index->code_only = FALSE;
+    index->states = g_array_new (FALSE, FALSE, sizeof (edit_bracket_state_t));
+    index->old_states = g_array_new (FALSE, FALSE, sizeof (edit_bracket_state_t));
+    index->old_start = 0;
+    index->old_end = -1;
+    index->old_shift = 0;
+    index->seed = 2463534242U;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget all indexed brackets.
+ *
+ * @param index bracket index
+ */
+
+void
+edit_bracket_index_reset (edit_bracket_index_t * index)
+{
+    int k;
+
+    for (k = 0; k < EDIT_BRACKET_KINDS; k++)
+    {
+        edit_bracket_node_free (index->tree[k]);
+        edit_bracket_node_free (index->old_tree[k]);
+        index->tree[k] = NULL;
+        index->old_tree[k] = NULL;
+    }
+
+    if (index->states != NULL)
+        g_array_set_size (index->states, 0);
+    if (index->old_states != NULL)
+        g_array_set_size (index->old_states, 0);
+
+    index->indexed = 0;
+    index->old_start = 0;
+    index->old_end = -1;
+    index->old_shift = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free memory of bracket index.
+ *
+ * @param index bracket index
+ */
+
+void
+edit_bracket_index_clean (edit_bracket_index_t * index)
+{
+    edit_bracket_index_reset (index);
+
+    if (index->states != NULL)
+        g_array_free (index->states, TRUE);
+    if (index->old_states != NULL)
+        g_array_free (index->old_states, TRUE);
+    index->states = NULL;
+    index->old_states = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Index next part of text.
+ *
+ * @param edit editor object
+ * @param upto offset up to which brackets are needed
+ * @param limit how many bytes to scan, negative value means no limit
+ *
+ * @return TRUE if all brackets before upto are indexed, FALSE otherwise
+ */
+
+gboolean
+edit_bracket_index_build (WEdit * edit, off_t upto, off_t limit)
+{
+    edit_bracket_index_t *index = &edit->bracket_index;
+    gboolean code_only;
+    off_t scanned = 0;
+
+    /* syntax highlighting was turned on or off */
+    code_only = edit->rules != NULL && option_syntax_highlighting;
+    if (code_only != index->code_only)
+    {
+        edit_bracket_index_reset (index);
+        index->code_only = code_only;
+    }
+
+    upto = MIN (upto, edit->buffer.size);
+
+    while (index->indexed < upto && (limit < 0 || scanned < limit))
+    {
+        off_t pos, stop, checkpoint, old_checkpoint = -1, len, i;
+        const char *p;
+
+        pos = index->indexed;
+
+        /* old checkpoints which are passed can't be verified */
+        while (index->old_states->len != 0
+               && BRACKET_STATE_LAST (index->old_states)->offset + index->old_shift < pos)
+            g_array_set_size (index->old_states, index->old_states->len - 1);
+
+        if (index->old_states->len != 0)
+            old_checkpoint = BRACKET_STATE_LAST (index->old_states)->offset + index->old_shift;
+
+        if (index->states->len == 0)
+            checkpoint = EDIT_BRACKET_STATE_DENSITY - 1;
+        else
+            checkpoint = BRACKET_STATE_LAST (index->states)->offset + EDIT_BRACKET_STATE_DENSITY;
+        checkpoint = MAX (checkpoint, pos);
+
+        stop = MIN (upto, checkpoint + 1);
+        if (old_checkpoint >= 0)
+            stop = MIN (stop, old_checkpoint + 1);
+        if (index->old_end >= 0)
+            stop = MIN (stop, index->old_end);
+
+        p = edit_buffer_get_span (&edit->buffer, pos, &len);
+        stop = MIN (stop, pos + len);
+
+        for (i = 0; pos + i < stop; i++)
+        {
+            int kind, dir;
+
+            kind = edit_bracket_kind ((unsigned char) p[i], &dir);
+            if (kind >= 0 && edit_bracket_is_code (edit, pos + i))
+                index->tree[kind] = edit_bracket_join (index->tree[kind],
+                                                       edit_bracket_node_new (index, dir), pos + i);
+        }
+
+        scanned += stop - pos;
+        index->indexed = stop;
+
+        if (stop - 1 == checkpoint)
+            edit_bracket_state_add (edit, checkpoint);
+        if (stop - 1 == old_checkpoint)
+            edit_bracket_state_verify (edit, old_checkpoint);
+        if (index->old_end >= 0 && index->indexed >= index->old_end)
+            edit_bracket_old_free (index);
+    }
+
+    return (index->indexed >= upto);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update index after the text was changed. The buffer must already contain the new text.
+ *
+ * @param index bracket index
+ * @param buf editor buffer
+ * @param offset offset of change
+ * @param del_len number of deleted bytes
+ * @param ins_len number of bytes inserted at offset
+ */
+
+void
+edit_bracket_index_update (edit_bracket_index_t * index, const edit_buffer_t * buf, off_t offset,
+                           off_t del_len, off_t ins_len)
+{
+    off_t bol;
+    int k;
+
+    /* highlighting can change from the start of changed line */
+    bol = edit_buffer_get_bol (buf, offset);
+
+    if (bol < index->indexed)
+    {
+        GArray *states = index->states;
+        gboolean had_old;
+
+        /* old brackets are valid after the last change only: text before it was scanned again,
+           brackets between it and 'indexed' will be scanned again */
+        had_old = index->old_end >= 0;
+
+        for (k = 0; k < EDIT_BRACKET_KINDS; k++)
+        {
+            edit_bracket_node_t *tail, *old = NULL;
+
+            edit_bracket_split (index->tree[k], bol, &index->tree[k], &tail);
+
+            if (had_old)
+            {
+                edit_bracket_node_free (tail);
+                tail = NULL;
+                /* old brackets before 'indexed' are indexed again already */
+                edit_bracket_split (index->old_tree[k], index->indexed - index->old_start, &tail,
+                                    &old);
+                edit_bracket_node_free (tail);
+                tail = NULL;
+            }
+
+            index->old_tree[k] = edit_bracket_join (tail, old, index->indexed - bol);
+        }
+
+        if (!had_old)
+        {
+            index->old_end = index->indexed;
+            index->old_shift = 0;
+        }
+
+        /* checkpoints which depend on changed line become old */
+        while (states->len != 0)
+        {
+            edit_bracket_state_t s;
+
+            s = *BRACKET_STATE_LAST (states);
+            if (s.offset < bol - 1 && s.rule.end < offset - 1)
+                break;
+
+            if (!had_old)
+            {
+                s.offset -= index->old_shift;
+                s.rule.end -= index->old_shift;
+                g_array_append_val (index->old_states, s);
+            }
+            g_array_set_size (states, states->len - 1);
+        }
+
+        index->old_start = bol;
+        index->indexed = bol;
+    }
+
+    if (index->old_end >= 0 && offset < index->old_end)
+    {
+        off_t rel;
+
+        rel = offset - index->old_start;
+
+        for (k = 0; k < EDIT_BRACKET_KINDS; k++)
+        {
+            if (offset + del_len >= index->old_end)
+                index->old_tree[k] = edit_bracket_truncate (index->old_tree[k], rel);
+            else
+            {
+                edit_bracket_node_t *l, *r;
+
+                edit_bracket_split (index->old_tree[k], rel, &l, &r);
+                edit_bracket_split (r, del_len, &index->old_tree[k], &r);
+                edit_bracket_node_free (index->old_tree[k]);
+                index->old_tree[k] = edit_bracket_join (l, r, rel + ins_len);
+            }
+        }
+
+        if (offset + del_len >= index->old_end)
+            index->old_end = offset;
+        else
+            index->old_end += ins_len - del_len;
+
+        /* checkpoints in deleted text are lost */
+        while (index->old_states->len != 0
+               && BRACKET_STATE_LAST (index->old_states)->offset + index->old_shift
+               < offset + del_len)
+            g_array_set_size (index->old_states, index->old_states->len - 1);
+
+        index->old_shift += ins_len - del_len;
+
+        if (index->old_end <= index->indexed)
+            edit_bracket_old_free (index);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find matching bracket in index.
+ *
+ * @param index bracket index
+ * @param buf editor buffer
+ * @param offset offset of bracket
+ *
+ * @return offset of matching bracket, -1 if there is no matching bracket before 'indexed',
+ *         -2 if bracket at offset isn't indexed
+ */
+
+off_t
+edit_bracket_index_match (const edit_bracket_index_t * index, const edit_buffer_t * buf,
+                          off_t offset)
+{
+    int kind, dir, depth = 0;
+
+    if (offset < 0 || offset >= index->indexed)
+        return -2;
+
+    kind = edit_bracket_kind (edit_buffer_get_byte (buf, offset), &dir);
+    if (kind < 0 || !edit_bracket_node_find (index->tree[kind], offset))
+        return -2;
+
+    if (dir > 0)
+        return edit_bracket_find_forward (index->tree[kind], 0, offset, &depth);
+
+    return edit_bracket_find_backward (index->tree[kind], 0, offset, &depth);
+}
+
+/* --------------------------------------------------------------------------------------------- */
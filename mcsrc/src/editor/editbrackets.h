@@ -0,0 +1,58 @@
+/** \file
+ *  \brief Header: index of brackets of WEdit buffer for bracket matching
+ */
+
+#ifndef MC__EDIT_BRACKETS_H
+#define MC__EDIT_BRACKETS_H
+
+#include "editbuffer.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* kinds of brackets: (), [] and {} */
+#define EDIT_BRACKET_KINDS 3
+
+/* how many bytes of text are indexed in one step in background */
+#define EDIT_BRACKET_INDEX_STEP (256 * 1024)
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+struct WEdit;
+struct edit_bracket_node_struct;
+
+typedef struct edit_bracket_index_struct
+{
+    struct edit_bracket_node_struct *tree[EDIT_BRACKET_KINDS];  /* brackets before 'indexed' */
+    off_t indexed;              /* all brackets before this offset are indexed */
+    gboolean code_only;         /* brackets in strings and comments aren't indexed */
+    GArray *states;             /* highlighting states at checkpoints before 'indexed' */
+
+    /* brackets after changed text, to be verified */
+    struct edit_bracket_node_struct *old_tree[EDIT_BRACKET_KINDS];
+    off_t old_start;            /* offset of text old brackets are counted from */
+    off_t old_end;              /* end of text covered by old brackets */
+    GArray *old_states;         /* checkpoints after changed text, reversed */
+    off_t old_shift;            /* offset shift of old_states */
+
+    guint32 seed;               /* state of priority generator */
+} edit_bracket_index_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void edit_bracket_index_init (edit_bracket_index_t * index);
+void edit_bracket_index_clean (edit_bracket_index_t * index);
+void edit_bracket_index_reset (edit_bracket_index_t * index);
+
+gboolean edit_bracket_index_build (struct WEdit *edit, off_t upto, off_t limit);
+void edit_bracket_index_update (edit_bracket_index_t * index, const edit_buffer_t * buf,
+                                off_t offset, off_t del_len, off_t ins_len);
+off_t edit_bracket_index_match (const edit_bracket_index_t * index, const edit_buffer_t * buf,
+                                off_t offset);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_BRACKETS_H */
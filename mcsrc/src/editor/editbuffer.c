@@ -31,12 +31,23 @@
 
 #include <config.h>
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(WIN32)  //WIN32, mapped file can't be replaced by saved one
+#undef HAVE_MMAP
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "lib/global.h"
 
+#include "lib/util.h"           /* MC_PTR_FREE */
 #include "lib/vfs/vfs.h"
 
 #include "edit-impl.h"
@@ -47,31 +58,42 @@
  *
  * here's a quick sketch of the layout: (don't run this through indent.)
  *
- *                                       |
- * \0\0\0\0\0m e _ f i l e . \nf i n . \n|T h i s _ i s _ s o\0\0\0\0\0\0\0\0\0
- * ______________________________________|______________________________________
- *                                       |
- * ...  |  b2[2]   |  b2[1]   |  b2[0]   |  b1[0]   |  b1[1]   |  b1[2]   | ...
- *      |->        |->        |->        |->        |->        |->        |
- *                                       |
- *           _<------------------------->|<----------------->_
- *                       curs2           |       curs1
- *           ^                           |                   ^
- *           |                          ^|^                  |
- *         cursor                       |||                cursor
- *                                      |||
- *                              file end|||file beginning
- *                                       |
- *                                       |
- *
- *           _
- * This_is_some_file
- * fin.
- *
- *
- * This is called a "gap buffer".
+ *   storage blocks (never changed after written):
+ *
+ *   original: |T h i s _ i s _ s o m e _ f i l e . \n|
+ *   added:    |f i n . \n|n e w _ |
+ *
+ *   pieces (in-order traversal of a balanced tree gives the text):
+ *
+ *                         [orig 0..7]
+ *                        /           \
+ *               [orig 0..3]         [added 5..8]
+ *                                  /            \
+ *                         [orig 8..17]      [added 0..4]
+ *
+ *   text: "This_is_new_some_file.\nfin.\n"
+ *
+ *                |<------------->|<------------------------>|
+ *                      curs1                curs2
+ *                               ^
+ *                             cursor
+ *
+ * This is called a "piece table".  Every piece refers to a run of bytes in one of storage
+ * blocks.  Inserted text is appended to the current "added" block and a piece for it is linked
+ * into the tree; deletion only splits and unlinks pieces.  Pieces are kept in a treap: every
+ * node stores the total length of its subtree, so lookup of any byte offset, insertion and
+ * deletion take O(log n) time wherever the cursor is.  The cursor itself is only an offset.
+ *
+ * Nodes also keep the number of newlines in their subtree: this is the line index of the
+ * file.  Conversions between line numbers and offsets take O(log n) time too.
+ *
+ * Large local files aren't read at all: the file is mapped to memory and serves as the
+ * "original" block, so its pages are loaded by the OS only when they are viewed.  If another
+ * program changes or truncates the file, its text is copied to the buffer and the mapping
+ * is dropped; pages lost by truncation are read as zeroes.
+ *
  * See also:
- * http://en.wikipedia.org/wiki/Gap_buffer
+ * https://en.wikipedia.org/wiki/Piece_table
  * http://stackoverflow.com/questions/4199694/data-structure-for-text-editor
  */
 
@@ -79,28 +101,377 @@
 
 /*** file scope macro definitions ****************************************************************/
 
-/*
- * The editor keeps data in two arrays of buffers.
- * All buffers have the same size, which must be a power of 2.
- */
-
-/* Configurable: log2 of the buffer size in bytes */
+/* Configurable: log2 of the storage block size in bytes */
 #ifndef S_EDIT_BUF_SIZE
 #define S_EDIT_BUF_SIZE 16
 #endif
 
-/* Size of the buffer */
+/* Size of the storage block. Loaded file is split to pieces of this size */
 #define EDIT_BUF_SIZE (((off_t) 1) << S_EDIT_BUF_SIZE)
 
-/* Buffer mask (used to find cursor position relative to the buffer) */
-#define M_EDIT_BUF_SIZE (EDIT_BUF_SIZE - 1)
+#ifdef HAVE_MMAP
+#ifndef MAP_FILE
+#define MAP_FILE 0
+#endif
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* Files of this size and larger are mapped to memory instead of reading */
+#define EDIT_MMAP_THRESHOLD (EDIT_BUF_SIZE * 64)
+#endif /* HAVE_MMAP */
+
+#define PIECE_TOTAL(p) ((p) != NULL ? (p)->total : 0)
+#define PIECE_TOTAL_NL(p) ((p) != NULL ? (p)->total_nl : 0)
 
 /*** file scope type declarations ****************************************************************/
 
+typedef struct edit_piece_struct
+{
+    const char *text;           /* first byte of piece in storage block */
+    off_t len;                  /* length of piece */
+    off_t orig;                 /* offset of the text in saved file, -1 if it isn't there */
+    off_t total;                /* length of all pieces in this subtree */
+    long nl;                    /* number of newlines in piece */
+    long total_nl;              /* number of newlines in all pieces in this subtree */
+    guint32 prio;               /* treap priority */
+    struct edit_piece_struct *left;
+    struct edit_piece_struct *right;
+} edit_piece_t;
+
+struct edit_buffer_pieces_struct
+{
+    edit_piece_t *root;
+    GPtrArray *blocks;          /* all storage blocks */
+    char *add;                  /* current block for added text */
+    off_t add_len;              /* used bytes in current block */
+    guint32 seed;               /* state of priority generator */
+    void *map;                  /* mapped file, if any */
+    off_t map_size;
+    dev_t map_dev;
+    ino_t map_ino;
+    int map_fd;                 /* kept open to notice changes of the mapped file */
+    off_t map_file_size;        /* the mapped file when it was seen last time */
+    time_t map_mtime;
+    long map_mtime_nsec;
+    volatile sig_atomic_t map_lost;     /* part of mapped file was truncated, zeroes are read */
+    off_t saved_size;           /* size of saved file, -1 if pieces don't refer to it */
+
+    /* last found piece: speeds up sequential access */
+    const edit_piece_t *cache;
+    off_t cache_start;
+};
+
 /*** file scope variables ************************************************************************/
 
+#if defined(HAVE_MMAP) && defined(SIGBUS) && defined(SA_SIGINFO) && defined(MAP_ANONYMOUS)
+#define EDIT_MMAP_GUARD 1
+
+/* mapped files of all editor buffers */
+static GSList *edit_mmap_list = NULL;
+static gboolean edit_mmap_guard_installed = FALSE;
+static struct sigaction edit_mmap_old_sigbus;
+static gsize edit_mmap_page_size;
+#endif
+
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static long
+edit_count_nl (const char *text, off_t len)
+{
+    const char *end = text + len;
+    long lines = 0;
+
+    /* memchr() is vectorized in most C libraries */
+    while ((text = memchr (text, '\n', end - text)) != NULL)
+    {
+        lines++;
+        text++;
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find n-th newline in the text.
+ *
+ * @return offset of newline, or len if the text contains less newlines
+ */
+
+static off_t
+edit_find_nl (const char *text, off_t len, long n)
+{
+    const char *p = text;
+    const char *end = text + len;
+
+    while ((p = memchr (p, '\n', end - p)) != NULL && --n != 0)
+        p++;
+
+    return (p != NULL) ? p - text : len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find last newline in the text.
+ *
+ * @return pointer to newline, or NULL if text doesn't contain newlines
+ */
+
+static const char *
+edit_find_last_nl (const char *text, off_t len)
+{
+#ifdef HAVE_MEMRCHR
+    return memrchr (text, '\n', len);
+#else
+    const char *p;
+
+    for (p = text + len; p != text;)
+        if (*--p == '\n')
+            return p;
+
+    return NULL;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+edit_piece_new (edit_buffer_pieces_t * pieces, const char *text, off_t len, long nl, off_t orig)
+{
+    edit_piece_t *p;
+
+    /* xorshift32 */
+    pieces->seed ^= pieces->seed << 13;
+    pieces->seed ^= pieces->seed >> 17;
+    pieces->seed ^= pieces->seed << 5;
+
+    p = g_new (edit_piece_t, 1);
+    p->text = text;
+    p->len = len;
+    p->orig = orig;
+    p->total = len;
+    p->nl = nl;
+    p->total_nl = nl;
+    p->prio = pieces->seed;
+    p->left = NULL;
+    p->right = NULL;
+
+    return p;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_piece_free (edit_piece_t * p)
+{
+    if (p != NULL)
+    {
+        edit_piece_free (p->left);
+        edit_piece_free (p->right);
+        g_free (p);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline void
+edit_piece_update (edit_piece_t * p)
+{
+    p->total = PIECE_TOTAL (p->left) + p->len + PIECE_TOTAL (p->right);
+    p->total_nl = PIECE_TOTAL_NL (p->left) + p->nl + PIECE_TOTAL_NL (p->right);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split tree of pieces into two trees at specified offset. A piece containing the offset
+ * is split into two pieces.
+ *
+ * @param p root of tree
+ * @param pos offset relative to the beginning of the tree
+ * @param l placeholder for tree of first @pos bytes
+ * @param r placeholder for tree of rest bytes
+ */
+
+static void
+edit_piece_split (edit_piece_t * p, off_t pos, edit_piece_t ** l, edit_piece_t ** r)
+{
+    off_t left;
+
+    if (p == NULL)
+    {
+        *l = NULL;
+        *r = NULL;
+        return;
+    }
+
+    left = PIECE_TOTAL (p->left);
+
+    if (pos <= left)
+    {
+        edit_piece_split (p->left, pos, l, &p->left);
+        edit_piece_update (p);
+        *r = p;
+    }
+    else if (pos >= left + p->len)
+    {
+        edit_piece_split (p->right, pos - left - p->len, &p->right, r);
+        edit_piece_update (p);
+        *l = p;
+    }
+    else
+    {
+        edit_piece_t *q;
+
+        /* new piece inherits the priority to keep the heap order with the right subtree */
+        pos -= left;
+        q = g_new (edit_piece_t, 1);
+        q->text = p->text + pos;
+        q->len = p->len - pos;
+        q->orig = p->orig < 0 ? -1 : p->orig + pos;
+        /* count newlines in the shorter part */
+        if (pos < q->len)
+            q->nl = p->nl - edit_count_nl (p->text, pos);
+        else
+            q->nl = edit_count_nl (q->text, q->len);
+        q->prio = p->prio;
+        q->left = NULL;
+        q->right = p->right;
+        edit_piece_update (q);
+
+        p->len = pos;
+        p->nl -= q->nl;
+        p->right = NULL;
+        edit_piece_update (p);
+
+        *l = p;
+        *r = q;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+edit_piece_merge (edit_piece_t * l, edit_piece_t * r)
+{
+    if (l == NULL)
+        return r;
+    if (r == NULL)
+        return l;
+
+    if (l->prio >= r->prio)
+    {
+        l->right = edit_piece_merge (l->right, r);
+        edit_piece_update (l);
+        return l;
+    }
+
+    r->left = edit_piece_merge (l, r->left);
+    edit_piece_update (r);
+    return r;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Extend the piece ending at specified offset if the text follows the piece in storage.
+ * Pieces of saved file are never extended: the text after them isn't in the file.
+ *
+ * @return TRUE if piece was extended, FALSE otherwise
+ */
+
+static gboolean
+edit_piece_extend (edit_piece_t * p, off_t pos, const char *text, off_t len, long nl)
+{
+    off_t left;
+    gboolean ret;
+
+    if (p == NULL)
+        return FALSE;
+
+    left = PIECE_TOTAL (p->left);
+
+    if (pos <= left)
+        ret = edit_piece_extend (p->left, pos, text, len, nl);
+    else if (pos > left + p->len)
+        ret = edit_piece_extend (p->right, pos - left - p->len, text, len, nl);
+    else if (pos < left + p->len || p->text + p->len != text || p->orig >= 0)
+        ret = FALSE;
+    else
+    {
+        p->len += len;
+        p->nl += nl;
+        ret = TRUE;
+    }
+
+    if (ret)
+    {
+        p->total += len;
+        p->total_nl += nl;
+    }
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find piece contained specified offset.
+ *
+ * @param buf pointer to editor buffer
+ * @param byte_index byte index
+ * @param start placeholder for offset of first byte of found piece
+ *
+ * @return NULL if byte_index is negative or larger than file size; piece otherwise.
+ */
+
+static const edit_piece_t *
+edit_buffer_find_piece (const edit_buffer_t * buf, off_t byte_index, off_t * start)
+{
+    edit_buffer_pieces_t *pieces = buf->pieces;
+    const edit_piece_t *p;
+    off_t offset = 0;
+
+    if (byte_index >= (buf->curs1 + buf->curs2) || byte_index < 0)
+        return NULL;
+
+    p = pieces->cache;
+    if (p != NULL && byte_index >= pieces->cache_start
+        && byte_index < pieces->cache_start + p->len)
+    {
+        *start = pieces->cache_start;
+        return p;
+    }
+
+    p = pieces->root;
+
+    while (p != NULL)
+    {
+        off_t left;
+
+        left = offset + PIECE_TOTAL (p->left);
+
+        if (byte_index < left)
+            p = p->left;
+        else if (byte_index < left + p->len)
+        {
+            offset = left;
+            break;
+        }
+        else
+        {
+            offset = left + p->len;
+            p = p->right;
+        }
+    }
+
+    pieces->cache = p;
+    pieces->cache_start = offset;
+    *start = offset;
+
+    return p;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
   * Get pointer to byte at specified index
@@ -110,26 +481,444 @@
   *
   * @return NULL if byte_index is negative or larger than file size; pointer to byte otherwise.
   */
-static char *
+
+static const char *
 edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
 {
-    void *b;
+    const edit_piece_t *p;
+    off_t start;
 
-    if (byte_index >= (buf->curs1 + buf->curs2) || byte_index < 0)
-        return NULL;
+    p = edit_buffer_find_piece (buf, byte_index, &start);
+
+    return (p != NULL) ? p->text + (byte_index - start) : NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add a storage block to the buffer.
+ *
+ * @param buf pointer to editor buffer
+ * @param size size of block
+ *
+ * @return pointer to new block
+ */
+
+static char *
+edit_buffer_add_block (edit_buffer_t * buf, off_t size)
+{
+    char *b;
+
+    b = g_malloc (size);
+    g_ptr_array_add (buf->pieces->blocks, b);
+
+    return b;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert bytes at specified offset. Cursor and file size are not changed.
+ *
+ * @param buf pointer to editor buffer
+ * @param pos byte offset
+ * @param text bytes to insert
+ * @param len number of bytes
+ */
+
+static void
+edit_buffer_insert_bytes (edit_buffer_t * buf, off_t pos, const char *text, off_t len)
+{
+    edit_buffer_pieces_t *pieces = buf->pieces;
+    char *b;
+    long nl;
+
+    if (len <= 0)
+        return;
 
-    if (byte_index >= buf->curs1)
+    if (pieces->add != NULL && pieces->add_len + len <= EDIT_BUF_SIZE)
     {
-        off_t p;
+        b = pieces->add + pieces->add_len;
+        pieces->add_len += len;
+    }
+    else if (len >= EDIT_BUF_SIZE / 2)
+    {
+        /* don't waste rest of current block */
+        b = edit_buffer_add_block (buf, len);
+    }
+    else
+    {
+        pieces->add = edit_buffer_add_block (buf, EDIT_BUF_SIZE);
+        pieces->add_len = len;
+        b = pieces->add;
+    }
+
+    memcpy (b, text, len);
+    nl = edit_count_nl (b, len);
+
+    pieces->cache = NULL;
+
+    /* sequential typing: grow the piece just before the insertion point */
+    if (!edit_piece_extend (pieces->root, pos, b, len, nl))
+    {
+        edit_piece_t *l, *r;
+
+        edit_piece_split (pieces->root, pos, &l, &r);
+        l = edit_piece_merge (l, edit_piece_new (pieces, b, len, nl, -1));
+        pieces->root = edit_piece_merge (l, r);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove bytes from specified offset. Cursor and file size are not changed.
+ *
+ * @param buf pointer to editor buffer
+ * @param pos byte offset
+ * @param len number of bytes
+ */
+
+static void
+edit_buffer_remove_bytes (edit_buffer_t * buf, off_t pos, off_t len)
+{
+    edit_buffer_pieces_t *pieces = buf->pieces;
+    edit_piece_t *l, *m, *r;
+
+    if (len <= 0)
+        return;
+
+    pieces->cache = NULL;
+
+    edit_piece_split (pieces->root, pos, &l, &r);
+    edit_piece_split (r, len, &m, &r);
+    edit_piece_free (m);
+    pieces->root = edit_piece_merge (l, r);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append loaded part of file to the buffer and show loading status.
+ *
+ * @return FALSE if loading was aborted by user, TRUE otherwise
+ */
+
+static gboolean
+edit_buffer_add_loaded (edit_buffer_t * buf, const char *text, off_t len, off_t loaded,
+                        edit_buffer_read_file_status_msg_t * sm, unsigned short *update_cnt)
+{
+    edit_buffer_pieces_t *pieces = buf->pieces;
+    status_msg_t *s = STATUS_MSG (sm);
+    long nl;
+
+    nl = edit_count_nl (text, len);
+    buf->lines += nl;
+    pieces->root =
+        edit_piece_merge (pieces->root, edit_piece_new (pieces, text, len, nl, loaded - len));
+
+    if (s != NULL && s->update != NULL)
+    {
+        *update_cnt = (*update_cnt + 1) & 0xf;
+        if (*update_cnt == 0)
+        {
+            /* FIXME: overcare */
+            if (sm->buf == NULL)
+                sm->buf = buf;
+
+            sm->loaded = loaded;
+            if (s->update (s) == B_CANCEL)
+                return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Collect ranges of text which differ from the saved file.
+ *
+ * @param p root of tree
+ * @param pos offset of the tree
+ * @param pieces storage of mapped file if it is the saved one, NULL otherwise
+ * @param ranges array of edit_buffer_range_t to append to
+ *
+ * @return FALSE if text of mapped file is moved: it would be overwritten before it is written
+ */
+
+static gboolean
+edit_piece_get_changes (const edit_piece_t * p, off_t pos, const edit_buffer_pieces_t * pieces,
+                        GArray * ranges)
+{
+    if (p == NULL)
+        return TRUE;
+
+    if (!edit_piece_get_changes (p->left, pos, pieces, ranges))
+        return FALSE;
+
+    pos += PIECE_TOTAL (p->left);
+
+    if (p->orig != pos)
+    {
+        edit_buffer_range_t *last = NULL;
+
+        if (pieces != NULL && p->text >= (const char *) pieces->map
+            && p->text < (const char *) pieces->map + pieces->map_size)
+            return FALSE;
+
+        if (ranges->len != 0)
+            last = &g_array_index (ranges, edit_buffer_range_t, ranges->len - 1);
+
+        if (last != NULL && last->offset + last->len == pos)
+            last->len += p->len;
+        else
+        {
+            edit_buffer_range_t r;
+
+            r.offset = pos;
+            r.len = p->len;
+            g_array_append_val (ranges, r);
+        }
+    }
+
+    return edit_piece_get_changes (p->right, pos + p->len, pieces, ranges);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_piece_set_saved (edit_piece_t * p, off_t pos)
+{
+    for (; p != NULL; p = p->right)
+    {
+        edit_piece_set_saved (p->left, pos);
+        pos += PIECE_TOTAL (p->left);
+        p->orig = pos;
+        pos += p->len;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_MMAP
+/**
+ * Copy text of pieces which refer to mapped file to storage blocks.
+ *
+ * @param buf pointer to editor buffer
+ * @param p root of tree
+ * @param b placeholder for free space in the last allocated block
+ * @param avail placeholder for size of free space
+ */
+
+static void
+edit_piece_unmap (edit_buffer_t * buf, edit_piece_t * p, char **b, off_t * avail)
+{
+    const char *map = (const char *) buf->pieces->map;
+
+    if (p == NULL)
+        return;
+
+    edit_piece_unmap (buf, p->left, b, avail);
+
+    if (p->text >= map && p->text < map + buf->pieces->map_size)
+    {
+        if (p->len > *avail)
+        {
+            *avail = MAX (p->len, EDIT_BUF_SIZE);
+            *b = edit_buffer_add_block (buf, *avail);
+        }
+
+        memcpy (*b, p->text, p->len);
+        p->text = *b;
+        p->nl = edit_count_nl (p->text, p->len);
+        *b += p->len;
+        *avail -= p->len;
+    }
+
+    edit_piece_unmap (buf, p->right, b, avail);
+    edit_piece_update (p);
+}
 
-        p = buf->curs1 + buf->curs2 - byte_index - 1;
-        b = g_ptr_array_index (buf->b2, p >> S_EDIT_BUF_SIZE);
-        return (char *) b + EDIT_BUF_SIZE - 1 - (p & M_EDIT_BUF_SIZE);
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef EDIT_MMAP_GUARD
+/**
+ * SIGBUS handler. Pages of mapped file beyond its end can't be read: if another program has
+ * truncated the file, replace them with zeroes instead of crash. The buffer should be detached
+ * from the file with edit_buffer_unmap_changed() as soon as possible.
+ */
+
+static void
+edit_mmap_sigbus_handler (int sig, siginfo_t * info, void *context)
+{
+    const char *addr = (const char *) info->si_addr;
+    GSList *l;
+
+    (void) sig;
+    (void) context;
+
+    for (l = edit_mmap_list; l != NULL; l = g_slist_next (l))
+    {
+        edit_buffer_pieces_t *pieces = (edit_buffer_pieces_t *) l->data;
+        char *map = (char *) pieces->map;
+
+        if (addr >= map && addr < map + pieces->map_size)
+        {
+            char *page;
+
+            page = map + ((gsize) (addr - map) & ~(edit_mmap_page_size - 1));
+            if (mmap (page, (size_t) (map + pieces->map_size - page), PROT_READ,
+                      MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
+                break;
+
+            pieces->map_lost = 1;
+            return;
+        }
     }
 
-    b = g_ptr_array_index (buf->b1, byte_index >> S_EDIT_BUF_SIZE);
-    return (char *) b + (byte_index & M_EDIT_BUF_SIZE);
+    /* not our fault: let it happen again with previous action */
+    sigaction (SIGBUS, &edit_mmap_old_sigbus, NULL);
 }
+#endif /* EDIT_MMAP_GUARD */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static long
+edit_stat_mtime_nsec (const struct stat *st)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return (long) st->st_mtim.tv_nsec;
+#else
+    (void) st;
+
+    return 0;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_buffer_map_remember (edit_buffer_pieces_t * pieces, const struct stat *st)
+{
+    pieces->map_file_size = st->st_size;
+    pieces->map_mtime = st->st_mtime;
+    pieces->map_mtime_nsec = edit_stat_mtime_nsec (st);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_buffer_map_add (edit_buffer_pieces_t * pieces, char *map, int fd, const struct stat *st)
+{
+    pieces->map = map;
+    pieces->map_size = st->st_size;
+    pieces->map_dev = st->st_dev;
+    pieces->map_ino = st->st_ino;
+    pieces->map_fd = fd;
+    pieces->map_lost = 0;
+    edit_buffer_map_remember (pieces, st);
+
+#ifdef EDIT_MMAP_GUARD
+    if (!edit_mmap_guard_installed)
+    {
+        struct sigaction sa;
+
+        memset (&sa, 0, sizeof (sa));
+        sa.sa_sigaction = edit_mmap_sigbus_handler;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset (&sa.sa_mask);
+
+        edit_mmap_page_size = (gsize) sysconf (_SC_PAGESIZE);
+        edit_mmap_guard_installed = sigaction (SIGBUS, &sa, &edit_mmap_old_sigbus) == 0;
+    }
+
+    edit_mmap_list = g_slist_prepend (edit_mmap_list, pieces);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_buffer_map_free (edit_buffer_pieces_t * pieces)
+{
+    if (pieces->map == NULL)
+        return;
+
+#ifdef EDIT_MMAP_GUARD
+    edit_mmap_list = g_slist_remove (edit_mmap_list, pieces);
+#endif
+    munmap (pieces->map, pieces->map_size);
+    close (pieces->map_fd);
+    pieces->map = NULL;
+}
+#endif /* HAVE_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_CHARSET
+/**
+  * Decode well-formed multibyte UTF-8 sequence.
+  *
+  * Only sequences that are valid regardless of GLib version are decoded here:
+  * overlong forms, surrogates, values above U+10FFFF and noncharacters are left
+  * for g_utf8_get_char_validated().
+  *
+  * @param s first byte of sequence
+  * @param len number of bytes available at s
+  * @param char_length length of decoded sequence
+  *
+  * @return decoded symbol or -1 if sequence should be decoded by slow path
+  */
+
+static inline int
+edit_buffer_decode_utf (const unsigned char *s, off_t len, int *char_length)
+{
+    unsigned int c1, c2, c3;
+    int res;
+
+    if (s[0] < 0xC2 || s[0] > 0xF4 || len < 2)
+        return -1;
+
+    c1 = s[1] ^ 0x80;
+
+    if (s[0] < 0xE0)
+    {
+        if (c1 > 0x3F)
+            return -1;
+        *char_length = 2;
+        return (int) (((s[0] & 0x1F) << 6) | c1);
+    }
+
+    if (len < 3)
+        return -1;
+
+    c2 = s[2] ^ 0x80;
+
+    if (s[0] < 0xF0)
+    {
+        if ((c1 | c2) > 0x3F)
+            return -1;
+        res = (int) (((s[0] & 0x0F) << 12) | (c1 << 6) | c2);
+        if (res < 0x800 || (res >= 0xD800 && res < 0xE000) || (res >= 0xFDD0 && res < 0xFDF0))
+            return -1;
+        *char_length = 3;
+    }
+    else
+    {
+        if (len < 4)
+            return -1;
+        c3 = s[3] ^ 0x80;
+        if ((c1 | c2 | c3) > 0x3F)
+            return -1;
+        res = (int) (((s[0] & 0x07) << 18) | (c1 << 12) | (c2 << 6) | c3);
+        if (res < 0x10000 || res > 0x10FFFF)
+            return -1;
+        *char_length = 4;
+    }
+
+    if ((res & 0xFFFE) == 0xFFFE)
+        return -1;
+
+    return res;
+}
+#endif /* HAVE_CHARSET */
 
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
@@ -143,8 +932,10 @@ edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
 void
 edit_buffer_init (edit_buffer_t * buf, off_t size)
 {
-    buf->b1 = g_ptr_array_sized_new (32);
-    buf->b2 = g_ptr_array_sized_new (32);
+    buf->pieces = g_new0 (edit_buffer_pieces_t, 1);
+    buf->pieces->blocks = g_ptr_array_sized_new (32);
+    buf->pieces->seed = 2463534242U;
+    buf->pieces->saved_size = -1;
 
     buf->curs1 = 0;
     buf->curs2 = 0;
@@ -163,37 +954,66 @@ edit_buffer_init (edit_buffer_t * buf, off_t size)
 void
 edit_buffer_clean (edit_buffer_t * buf)
 {
-    if (buf->b1 != NULL)
+    if (buf->pieces != NULL)
     {
-        g_ptr_array_foreach (buf->b1, (GFunc) g_free, NULL);
-        g_ptr_array_free (buf->b1, TRUE);
+        edit_piece_free (buf->pieces->root);
+#ifdef HAVE_MMAP
+        edit_buffer_map_free (buf->pieces);
+#endif
+        g_ptr_array_foreach (buf->pieces->blocks, (GFunc) g_free, NULL);
+        g_ptr_array_free (buf->pieces->blocks, TRUE);
+        MC_PTR_FREE (buf->pieces);
     }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+  * Get byte at specified index
+  *
+  * @param buf pointer to editor buffer
+  * @param byte_index byte index
+  *
+  * @return '\n' if byte_index is negative or larger than file size; byte at byte_index otherwise.
+  */
+
+int
+edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index)
+{
+    const char *p;
+
+    p = edit_buffer_get_byte_ptr (buf, byte_index);
 
-    if (buf->b2 != NULL)
-    {
-        g_ptr_array_foreach (buf->b2, (GFunc) g_free, NULL);
-        g_ptr_array_free (buf->b2, TRUE);
-    }
+    return (p != NULL) ? *(const unsigned char *) p : '\n';
 }
 
 /* --------------------------------------------------------------------------------------------- */
 /**
-  * Get byte at specified index
+  * Get pointer to contiguous block of bytes started at specified index
   *
   * @param buf pointer to editor buffer
   * @param byte_index byte index
+  * @param span_len length of contiguous block
   *
-  * @return '\n' if byte_index is negative or larger than file size; byte at byte_index otherwise.
+  * @return NULL if byte_index is negative or larger than file size; pointer to byte otherwise.
   */
 
-int
-edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index)
+const char *
+edit_buffer_get_span (const edit_buffer_t * buf, off_t byte_index, off_t * span_len)
 {
-    char *p;
+    const edit_piece_t *p;
+    off_t start;
 
-    p = edit_buffer_get_byte_ptr (buf, byte_index);
+    p = edit_buffer_find_piece (buf, byte_index, &start);
+    if (p == NULL)
+    {
+        *span_len = 0;
+        return NULL;
+    }
 
-    return (p != NULL) ? *(unsigned char *) p : '\n';
+    /* piece contains bytes up to its end */
+    *span_len = p->len - (byte_index - start);
+
+    return p->text + (byte_index - start);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -214,10 +1034,12 @@ edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index)
 int
 edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length)
 {
-    gchar *str = NULL;
+    const gchar *str = NULL;
+    off_t span_len;
     gunichar res;
     gunichar ch;
-    gchar *next_ch = NULL;
+    int fast_ch;
+    const gchar *next_ch = NULL;
 
     if (byte_index >= (buf->curs1 + buf->curs2) || byte_index < 0)
     {
@@ -225,17 +1047,30 @@ edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_leng
         return '\n';
     }
 
-    str = edit_buffer_get_byte_ptr (buf, byte_index);
+    str = edit_buffer_get_span (buf, byte_index, &span_len);
     if (str == NULL)
     {
         *char_length = 0;
         return 0;
     }
 
-    res = g_utf8_get_char_validated (str, -1);
+    /* fast paths: ASCII and well-formed sequence inside the piece */
+    if ((unsigned char) (*str - 1) < 0x7F)
+    {
+        *char_length = 1;
+        return (int) *str;
+    }
+
+    fast_ch = edit_buffer_decode_utf ((const unsigned char *) str, MIN (span_len, UTF8_CHAR_LEN),
+                                      char_length);
+    if (fast_ch >= 0)
+        return fast_ch;
+
+    /* don't look beyond the piece: it is not followed by the next one in memory */
+    res = g_utf8_get_char_validated (str, MIN (span_len, UTF8_CHAR_LEN));
     if (res == (gunichar) (-2) || res == (gunichar) (-1))
     {
-        /* Retry with explicit bytes to make sure it's not a buffer boundary */
+        /* Retry with explicit bytes to make sure it's not a piece boundary */
         size_t i;
         gchar utf8_buf[UTF8_CHAR_LEN + 1];
 
@@ -282,6 +1117,7 @@ edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char
     gchar *str;
     gchar *cursor_buf_ptr;
     gunichar res;
+    int c;
 
     if (byte_index > (buf->curs1 + buf->curs2) || byte_index <= 0)
     {
@@ -289,6 +1125,14 @@ edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char
         return 0;
     }
 
+    /* fast path: ASCII symbol can't be a tail of multibyte sequence */
+    c = edit_buffer_get_byte (buf, byte_index - 1);
+    if (c < 0x80)
+    {
+        *char_length = 1;
+        return c;
+    }
+
     for (i = 0; i < (3 * UTF8_CHAR_LEN); i++)
         utf8_buf[i] = edit_buffer_get_byte (buf, byte_index + i - (2 * UTF8_CHAR_LEN));
     utf8_buf[i] = '\0';
@@ -333,13 +1177,115 @@ edit_buffer_count_lines (const edit_buffer_t * buf, off_t first, off_t last)
     first = MAX (first, 0);
     last = MIN (last, buf->size);
 
+    if (last - first > EDIT_BUF_SIZE / 16)
+        return edit_buffer_get_line (buf, last) - edit_buffer_get_line (buf, first);
+
+    /* short distance: cheaper to count than to look up the line index */
     while (first < last)
-        if (edit_buffer_get_byte (buf, first++) == '\n')
-            lines++;
+    {
+        const char *p;
+        off_t len;
+
+        p = edit_buffer_get_span (buf, first, &len);
+        len = MIN (len, last - first);
+        lines += edit_count_nl (p, len);
+        first += len;
+    }
 
     return lines;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get number of line contained specified byte offset.
+ *
+ * @param buf editor buffer
+ * @param offset byte offset
+ *
+ * @return number of newlines before offset
+ */
+
+long
+edit_buffer_get_line (const edit_buffer_t * buf, off_t offset)
+{
+    const edit_piece_t *p = buf->pieces->root;
+    long line = 0;
+
+    while (p != NULL)
+    {
+        off_t left;
+
+        left = PIECE_TOTAL (p->left);
+
+        if (offset <= left)
+            p = p->left;
+        else
+        {
+            line += PIECE_TOTAL_NL (p->left);
+            offset -= left;
+
+            /* scan the shorter part of piece */
+            if (offset <= p->len / 2)
+                return line + edit_count_nl (p->text, offset);
+            if (offset <= p->len)
+                return line + p->nl - edit_count_nl (p->text + offset, p->len - offset);
+
+            line += p->nl;
+            offset -= p->len;
+            p = p->right;
+        }
+    }
+
+    return line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get offset of first char of line.
+ *
+ * @param buf editor buffer
+ * @param line line number
+ *
+ * @return offset of first char of line. Offset of last line is returned if line is too large
+ */
+
+off_t
+edit_buffer_get_line_offset (const edit_buffer_t * buf, long line)
+{
+    const edit_piece_t *p = buf->pieces->root;
+    off_t offset = 0;
+
+    if (line <= 0)
+        return 0;
+
+    line = MIN (line, PIECE_TOTAL_NL (p));
+
+    /* find the piece contained newline number "line" */
+    while (p != NULL)
+    {
+        long left;
+
+        left = PIECE_TOTAL_NL (p->left);
+
+        if (line <= left)
+            p = p->left;
+        else
+        {
+            offset += PIECE_TOTAL (p->left);
+            line -= left;
+
+            if (line <= p->nl)
+                return offset + edit_find_nl (p->text, p->len, line) + 1;
+
+            offset += p->len;
+            line -= p->nl;
+            p = p->right;
+        }
+    }
+
+    return offset;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Get "begin-of-line" offset of line contained specified byte offset
@@ -356,10 +1302,24 @@ edit_buffer_get_bol (const edit_buffer_t * buf, off_t current)
     if (current <= 0)
         return 0;
 
-    for (; edit_buffer_get_byte (buf, current - 1) != '\n'; current--)
-        ;
+    if (current > buf->size)
+        return current;
+
+    /* scan pieces backward */
+    while (current > 0)
+    {
+        const edit_piece_t *p;
+        const char *nl;
+        off_t start;
+
+        p = edit_buffer_find_piece (buf, current - 1, &start);
+        nl = edit_find_last_nl (p->text, current - start);
+        if (nl != NULL)
+            return start + (nl - p->text) + 1;
+        current = start;
+    }
 
-    return current;
+    return 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -378,10 +1338,23 @@ edit_buffer_get_eol (const edit_buffer_t * buf, off_t current)
     if (current >= buf->size)
         return buf->size;
 
-    for (; edit_buffer_get_byte (buf, current) != '\n'; current++)
-        ;
+    if (current < 0)
+        return current;
+
+    /* scan pieces forward */
+    while (current < buf->size)
+    {
+        const char *p, *nl;
+        off_t len;
+
+        p = edit_buffer_get_span (buf, current, &len);
+        nl = memchr (p, '\n', len);
+        if (nl != NULL)
+            return current + (nl - p);
+        current += len;
+    }
 
-    return current;
+    return buf->size;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -442,18 +1415,10 @@ edit_buffer_get_word_from_pos (const edit_buffer_t * buf, off_t start_pos, off_t
 void
 edit_buffer_insert (edit_buffer_t * buf, int c)
 {
-    void *b;
-    off_t i;
-
-    i = buf->curs1 & M_EDIT_BUF_SIZE;
-
-    /* add a new buffer if we've reached the end of the last one */
-    if (i == 0)
-        g_ptr_array_add (buf->b1, g_malloc0 (EDIT_BUF_SIZE));
+    char ch = (char) c;
 
     /* perform the insertion */
-    b = g_ptr_array_index (buf->b1, buf->curs1 >> S_EDIT_BUF_SIZE);
-    *((unsigned char *) b + i) = (unsigned char) c;
+    edit_buffer_insert_bytes (buf, buf->curs1, &ch, 1);
 
     /* update cursor position */
     buf->curs1++;
@@ -474,18 +1439,10 @@ edit_buffer_insert (edit_buffer_t * buf, int c)
 void
 edit_buffer_insert_ahead (edit_buffer_t * buf, int c)
 {
-    void *b;
-    off_t i;
-
-    i = buf->curs2 & M_EDIT_BUF_SIZE;
-
-    /* add a new buffer if we've reached the end of the last one */
-    if (i == 0)
-        g_ptr_array_add (buf->b2, g_malloc0 (EDIT_BUF_SIZE));
+    char ch = (char) c;
 
     /* perform the insertion */
-    b = g_ptr_array_index (buf->b2, buf->curs2 >> S_EDIT_BUF_SIZE);
-    *((unsigned char *) b + EDIT_BUF_SIZE - 1 - i) = (unsigned char) c;
+    edit_buffer_insert_bytes (buf, buf->curs1, &ch, 1);
 
     /* update cursor position */
     buf->curs2++;
@@ -506,28 +1463,12 @@ edit_buffer_insert_ahead (edit_buffer_t * buf, int c)
 int
 edit_buffer_delete (edit_buffer_t * buf)
 {
-    void *b;
-    unsigned char c;
-    off_t prev;
-    off_t i;
+    int c;
 
-    prev = buf->curs2 - 1;
+    c = edit_buffer_get_current_byte (buf);
+    edit_buffer_remove_bytes (buf, buf->curs1, 1);
 
-    b = g_ptr_array_index (buf->b2, prev >> S_EDIT_BUF_SIZE);
-    i = prev & M_EDIT_BUF_SIZE;
-    c = *((unsigned char *) b + EDIT_BUF_SIZE - 1 - i);
-
-    if (i == 0)
-    {
-        guint j;
-
-        j = buf->b2->len - 1;
-        b = g_ptr_array_index (buf->b2, j);
-        g_ptr_array_remove_index (buf->b2, j);
-        g_free (b);
-    }
-
-    buf->curs2 = prev;
+    buf->curs2--;
 
     /* update file length */
     buf->size--;
@@ -547,28 +1488,12 @@ edit_buffer_delete (edit_buffer_t * buf)
 int
 edit_buffer_backspace (edit_buffer_t * buf)
 {
-    void *b;
-    unsigned char c;
-    off_t prev;
-    off_t i;
-
-    prev = buf->curs1 - 1;
-
-    b = g_ptr_array_index (buf->b1, prev >> S_EDIT_BUF_SIZE);
-    i = prev & M_EDIT_BUF_SIZE;
-    c = *((unsigned char *) b + i);
-
-    if (i == 0)
-    {
-        guint j;
+    int c;
 
-        j = buf->b1->len - 1;
-        b = g_ptr_array_index (buf->b1, j);
-        g_ptr_array_remove_index (buf->b1, j);
-        g_free (b);
-    }
+    c = edit_buffer_get_previous_byte (buf);
+    edit_buffer_remove_bytes (buf, buf->curs1 - 1, 1);
 
-    buf->curs1 = prev;
+    buf->curs1--;
 
     /* update file length */
     buf->size--;
@@ -576,6 +1501,74 @@ edit_buffer_backspace (edit_buffer_t * buf)
     return c;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert block of bytes at the cursor position and move right.
+ *
+ * @param buf pointer to editor buffer
+ * @param text bytes to insert
+ * @param len number of bytes
+ */
+
+void
+edit_buffer_insert_block (edit_buffer_t * buf, const char *text, off_t len)
+{
+    edit_buffer_insert_bytes (buf, buf->curs1, text, len);
+    buf->curs1 += len;
+    buf->size += len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert block of bytes at the cursor position. Cursor isn't moved.
+ *
+ * @param buf pointer to editor buffer
+ * @param text bytes to insert
+ * @param len number of bytes
+ */
+
+void
+edit_buffer_insert_ahead_block (edit_buffer_t * buf, const char *text, off_t len)
+{
+    edit_buffer_insert_bytes (buf, buf->curs1, text, len);
+    buf->curs2 += len;
+    buf->size += len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete block of bytes at the cursor position.
+ *
+ * @param buf pointer to editor buffer
+ * @param len number of bytes, must not exceed buf->curs2
+ */
+
+void
+edit_buffer_delete_block (edit_buffer_t * buf, off_t len)
+{
+    edit_buffer_remove_bytes (buf, buf->curs1, len);
+    buf->curs2 -= len;
+    buf->size -= len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move cursor to specified position. Unlike the gap buffer, the text isn't moved at all.
+ *
+ * @param buf pointer to editor buffer
+ * @param offset new cursor position
+ */
+
+void
+edit_buffer_set_cursor (edit_buffer_t * buf, off_t offset)
+{
+    offset = MAX (offset, 0);
+    offset = MIN (offset, buf->size);
+
+    buf->curs1 = offset;
+    buf->curs2 = buf->size - offset;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Calculate forward offset with specified number of lines.
@@ -593,22 +1586,19 @@ edit_buffer_backspace (edit_buffer_t * buf)
 off_t
 edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long lines, off_t upto)
 {
+    long line;
+
     if (upto != 0)
         return (off_t) edit_buffer_count_lines (buf, current, upto);
 
-    lines = MAX (lines, 0);
-
-    while (lines-- != 0)
-    {
-        long next;
+    if (lines <= 0)
+        return current;
 
-        next = edit_buffer_get_eol (buf, current) + 1;
-        if (next > buf->size)
-            break;
-        current = next;
-    }
+    line = edit_buffer_get_line (buf, current);
+    if (line >= PIECE_TOTAL_NL (buf->pieces->root))
+        return current;         /* already in last line */
 
-    return current;
+    return edit_buffer_get_line_offset (buf, line + lines);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -626,12 +1616,8 @@ off_t
 edit_buffer_get_backward_offset (const edit_buffer_t * buf, off_t current, long lines)
 {
     lines = MAX (lines, 0);
-    current = edit_buffer_get_bol (buf, current);
-
-    while (lines-- != 0 && current != 0)
-        current = edit_buffer_get_bol (buf, current - 1);
 
-    return current;
+    return edit_buffer_get_line_offset (buf, edit_buffer_get_line (buf, current) - lines);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -650,103 +1636,143 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
                        edit_buffer_read_file_status_msg_t * sm, gboolean * aborted)
 {
     off_t ret = 0;
-    off_t i, j;
-    off_t data_size;
-    void *b;
-    status_msg_t *s = STATUS_MSG (sm);
     unsigned short update_cnt = 0;
 
     *aborted = FALSE;
 
     buf->lines = 0;
     buf->curs2 = size;
-    i = buf->curs2 >> S_EDIT_BUF_SIZE;
-
-    /* fill last part of b2 */
-    data_size = buf->curs2 & M_EDIT_BUF_SIZE;
-    if (data_size != 0)
-    {
-        b = g_malloc0 (EDIT_BUF_SIZE);
-        g_ptr_array_add (buf->b2, b);
-        b = (char *) b + EDIT_BUF_SIZE - data_size;
-        ret = mc_read (fd, b, data_size);
-
-        /* count lines */
-        for (j = 0; j < ret; j++)
-            if (*((char *) b + j) == '\n')
-                buf->lines++;
-
-        if (ret < 0 || ret != data_size)
-            return ret;
-    }
 
-    /* fulfill other parts of b2 from end to begin */
-    data_size = EDIT_BUF_SIZE;
-    for (--i; i >= 0; i--)
+    /* file is loaded to blocks from begin to end, one piece per block */
+    while (ret < size)
     {
-        off_t sz;
+        off_t data_size, sz;
+        char *b;
 
-        b = g_malloc0 (data_size);
-        g_ptr_array_add (buf->b2, b);
+        data_size = MIN (size - ret, EDIT_BUF_SIZE);
+        b = edit_buffer_add_block (buf, data_size);
         sz = mc_read (fd, b, data_size);
-        if (sz >= 0)
-            ret += sz;
-
-        /* count lines */
-        for (j = 0; j < sz; j++)
-            if (*((char *) b + j) == '\n')
-                buf->lines++;
+        if (sz <= 0)
+            return (ret == 0 ? sz : ret);
 
-        if (s != NULL && s->update != NULL)
+        ret += sz;
+        if (!edit_buffer_add_loaded (buf, b, sz, ret, sm, &update_cnt))
         {
-            update_cnt = (update_cnt + 1) & 0xf;
-            if (update_cnt == 0)
-            {
-                /* FIXME: overcare */
-                if (sm->buf == NULL)
-                    sm->buf = buf;
-
-                sm->loaded = ret;
-                if (s->update (s) == B_CANCEL)
-                {
-                    *aborted = TRUE;
-                    return (-1);
-                }
-            }
+            *aborted = TRUE;
+            return (-1);
         }
 
         if (sz != data_size)
             break;
     }
 
-    /* reverse buffer */
-    for (i = 0; i < (off_t) buf->b2->len / 2; i++)
+    buf->pieces->cache = NULL;
+    buf->pieces->saved_size = ret;
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Map large local file into editor buffer. File content isn't read: pages of file are loaded
+ * on demand, only inserted text takes memory.
+ *
+ * @param buf pointer to editor buffer
+ * @param path name of local file
+ * @param size file size
+ *
+ * @return number of mapped bytes, -1 if file cannot be mapped or loading was aborted.
+ *         In first case buffer is not changed and file should be read with
+ *         edit_buffer_read_file().
+ */
+
+off_t
+edit_buffer_map_file (edit_buffer_t * buf, const char *path, off_t size,
+                      edit_buffer_read_file_status_msg_t * sm, gboolean * aborted)
+{
+#ifdef HAVE_MMAP
+    edit_buffer_pieces_t *pieces = buf->pieces;
+    int fd;
+    struct stat st;
+    char *map;
+    off_t ret;
+    unsigned short update_cnt = 0;
+
+    *aborted = FALSE;
+
+    if (size < EDIT_MMAP_THRESHOLD || (off_t) (size_t) size != size || pieces->root != NULL)
+        return (-1);
+
+    fd = open (path, O_RDONLY | O_BINARY);
+    if (fd == -1)
+        return (-1);
+
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size != size)
+    {
+        close (fd);
+        return (-1);
+    }
+
+    map = mmap (NULL, (size_t) size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
     {
-        void **b1, **b2;
+        close (fd);
+        return (-1);
+    }
 
-        b1 = &g_ptr_array_index (buf->b2, i);
-        b2 = &g_ptr_array_index (buf->b2, buf->b2->len - 1 - i);
+    /* the file is watched while the buffer refers to it: don't pass it to child processes */
+    (void) fcntl (fd, F_SETFD, FD_CLOEXEC);
+    edit_buffer_map_add (pieces, map, fd, &st);
+
+    buf->lines = 0;
+    buf->curs2 = size;
 
-        b = *b1;
-        *b1 = *b2;
-        *b2 = b;
+    /* file is split to pieces of block size to keep line lookups short */
+    for (ret = 0; ret < size;)
+    {
+        off_t len;
 
-        if (s != NULL && s->update != NULL)
+        len = MIN (size - ret, EDIT_BUF_SIZE);
+        ret += len;
+        if (!edit_buffer_add_loaded (buf, map + ret - len, len, ret, sm, &update_cnt))
         {
-            update_cnt = (update_cnt + 1) & 0xf;
-            if (update_cnt == 0)
-            {
-                sm->loaded = ret;
-                if (s->update (s) == B_CANCEL)
-                {
-                    *aborted = TRUE;
-                    return (-1);
-                }
-            }
+            *aborted = TRUE;
+            return (-1);
         }
     }
 
+    pieces->cache = NULL;
+    pieces->saved_size = ret;
+
     return ret;
+#else
+    (void) buf;
+    (void) path;
+    (void) size;
+    (void) sm;
+
+    *aborted = FALSE;
+
+    return (-1);
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the buffer refers to mapped file.
+ *
+ * @param buf pointer to editor buffer
+ * @param st file information
+ *
+ * @return TRUE if the file must be kept untouched while the buffer is alive
+ */
+
+gboolean
+edit_buffer_is_mapped (const edit_buffer_t * buf, const struct stat *st)
+{
+    const edit_buffer_pieces_t *pieces = buf->pieces;
+
+    return (pieces->map != NULL && pieces->map_dev == st->st_dev && pieces->map_ino == st->st_ino);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -763,66 +1789,173 @@ off_t
 edit_buffer_write_file (edit_buffer_t * buf, int fd)
 {
     off_t ret = 0;
-    off_t i;
-    off_t data_size, sz;
-    void *b;
 
-    /* write all fulfilled parts of b1 from begin to end */
-    if (buf->b1->len != 0)
+    /* write all pieces from begin to end */
+    while (ret < buf->size)
     {
-        data_size = EDIT_BUF_SIZE;
-        for (i = 0; i < (off_t) buf->b1->len - 1; i++)
-        {
-            b = g_ptr_array_index (buf->b1, i);
-            sz = mc_write (fd, b, data_size);
-            if (sz >= 0)
-                ret += sz;
-            else if (i == 0)
-                ret = sz;
-            if (sz != data_size)
-                return ret;
-        }
+        const char *b;
+        off_t data_size, sz;
 
-        /* write last partially filled part of b1 */
-        data_size = ((buf->curs1 - 1) & M_EDIT_BUF_SIZE) + 1;
-        b = g_ptr_array_index (buf->b1, i);
+        b = edit_buffer_get_span (buf, ret, &data_size);
         sz = mc_write (fd, b, data_size);
-        if (sz >= 0)
+        if (sz < 0 && ret == 0)
+            return sz;
+        if (sz > 0)
             ret += sz;
         if (sz != data_size)
-            return ret;
+            break;
     }
 
-    /* write b2 from end to begin, if b2 contains some data */
-    if (buf->b2->len != 0)
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write part of editor buffer to the same offset of local file.
+ *
+ * @param buf pointer to editor buffer
+ * @param fd file descriptor of local file
+ * @param offset offset of first byte
+ * @param len number of bytes
+ *
+ * @return number of written bytes, -1 on error
+ */
+
+off_t
+edit_buffer_write_range (const edit_buffer_t * buf, int fd, off_t offset, off_t len)
+{
+    off_t ret = 0;
+
+    while (ret < len)
     {
-        /* write last partially filled part of b2 */
-        i = buf->b2->len - 1;
-        b = g_ptr_array_index (buf->b2, i);
-        data_size = ((buf->curs2 - 1) & M_EDIT_BUF_SIZE) + 1;
-        sz = mc_write (fd, (char *) b + EDIT_BUF_SIZE - data_size, data_size);
-        if (sz >= 0)
-            ret += sz;
+        const char *b;
+        off_t data_size;
+        ssize_t sz;
 
-        if (sz == data_size)
-        {
-            /* write other fulfilled parts of b2 from end to begin */
-            data_size = EDIT_BUF_SIZE;
-            while (--i >= 0)
-            {
-                b = g_ptr_array_index (buf->b2, i);
-                sz = mc_write (fd, b, data_size);
-                if (sz >= 0)
-                    ret += sz;
-                if (sz != data_size)
-                    break;
-            }
-        }
+        b = edit_buffer_get_span (buf, offset + ret, &data_size);
+        if (b == NULL)
+            break;
+
+        data_size = MIN (data_size, len - ret);
+        sz = pwrite (fd, b, (size_t) data_size, offset + ret);
+        if (sz < 0 && errno == EINTR)
+            continue;
+        if (sz <= 0)
+            return (-1);
+        ret += sz;
     }
 
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get parts of text which differ from the file the buffer was loaded from or saved to.
+ *
+ * @param buf pointer to editor buffer
+ * @param st information about the file
+ *
+ * @return array of edit_buffer_range_t sorted by offset, adjacent ranges are merged;
+ *         NULL if the file cannot be patched in place
+ */
+
+GArray *
+edit_buffer_get_changes (const edit_buffer_t * buf, const struct stat *st)
+{
+    const edit_buffer_pieces_t *pieces = buf->pieces;
+    GArray *ranges;
+
+    if (pieces->saved_size < 0 || pieces->saved_size != st->st_size)
+        return NULL;
+
+    ranges = g_array_new (FALSE, FALSE, sizeof (edit_buffer_range_t));
+
+    if (!edit_piece_get_changes (pieces->root, 0, edit_buffer_is_mapped (buf, st) ? pieces : NULL,
+                                 ranges))
+    {
+        g_array_free (ranges, TRUE);
+        ranges = NULL;
+    }
+
+    return ranges;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember what was written to file.
+ *
+ * @param buf pointer to editor buffer
+ * @param saved TRUE if the file contains the text as is,
+ *              FALSE if the text was converted while saving
+ */
+
+void
+edit_buffer_set_saved (edit_buffer_t * buf, gboolean saved)
+{
+    if (saved)
+    {
+        edit_piece_set_saved (buf->pieces->root, 0);
+        buf->pieces->saved_size = buf->size;
+    }
+    else
+        buf->pieces->saved_size = -1;
+
+#ifdef HAVE_MMAP
+    /* the mapped file may be just written in place by ourselves */
+    if (buf->pieces->map != NULL)
+    {
+        struct stat st;
+
+        if (fstat (buf->pieces->map_fd, &st) == 0)
+            edit_buffer_map_remember (buf->pieces, &st);
+    }
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop using mapped file if another program has changed it. The text is copied to the buffer
+ * as it is in the file now: changes written to the file in place are taken, truncated part of
+ * the file is read as zeroes.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return TRUE if the buffer was detached from changed file
+ */
+
+gboolean
+edit_buffer_unmap_changed (edit_buffer_t * buf)
+{
+#ifdef HAVE_MMAP
+    edit_buffer_pieces_t *pieces = buf->pieces;
+    struct stat st;
+    char *b = NULL;
+    off_t avail = 0;
+
+    if (pieces->map == NULL)
+        return FALSE;
+
+    if (pieces->map_lost == 0 && fstat (pieces->map_fd, &st) == 0
+        && st.st_size == pieces->map_file_size && st.st_mtime == pieces->map_mtime
+        && edit_stat_mtime_nsec (&st) == pieces->map_mtime_nsec)
+        return FALSE;
+
+    edit_piece_unmap (buf, pieces->root, &b, &avail);
+    edit_buffer_map_free (pieces);
+
+    pieces->cache = NULL;
+    pieces->saved_size = -1;
+    buf->lines = PIECE_TOTAL_NL (pieces->root);
+    buf->curs_line = edit_buffer_get_line (buf, buf->curs1);
+
+    return TRUE;
+#else
+    (void) buf;
+
+    return FALSE;
+#endif /* HAVE_MMAP */
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Calculate percentage of specified character offset
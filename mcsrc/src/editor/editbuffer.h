@@ -11,12 +11,14 @@
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* piece table: text storage is opaque */
+typedef struct edit_buffer_pieces_struct edit_buffer_pieces_t;
+
 typedef struct edit_buffer_struct
 {
     off_t curs1;                /* position of the cursor from the beginning of the file. */
     off_t curs2;                /* position from the end of the file */
-    GPtrArray *b1;              /* all data up to curs1 */
-    GPtrArray *b2;              /* all data from end of file down to curs2 */
+    edit_buffer_pieces_t *pieces;       /* all data of file */
     off_t size;                 /* file size */
     long lines;                 /* total lines in the file */
     long curs_line;             /* line number of the cursor. */
@@ -31,6 +33,13 @@ typedef struct edit_buffer_read_file_status_msg_struct
     off_t loaded;
 } edit_buffer_read_file_status_msg_t;
 
+/* part of text */
+typedef struct
+{
+    off_t offset;
+    off_t len;
+} edit_buffer_range_t;
+
 /*** global variables defined in .c file *********************************************************/
 
 /*** declarations of public functions ************************************************************/
@@ -39,11 +48,14 @@ void edit_buffer_init (edit_buffer_t * buf, off_t size);
 void edit_buffer_clean (edit_buffer_t * buf);
 
 int edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index);
+const char *edit_buffer_get_span (const edit_buffer_t * buf, off_t byte_index, off_t * span_len);
 #ifdef HAVE_CHARSET
 int edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
 int edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
 #endif
 long edit_buffer_count_lines (const edit_buffer_t * buf, off_t first, off_t last);
+long edit_buffer_get_line (const edit_buffer_t * buf, off_t offset);
+off_t edit_buffer_get_line_offset (const edit_buffer_t * buf, long line);
 off_t edit_buffer_get_bol (const edit_buffer_t * buf, off_t current);
 off_t edit_buffer_get_eol (const edit_buffer_t * buf, off_t current);
 GString *edit_buffer_get_word_from_pos (const edit_buffer_t * buf, off_t start_pos, off_t * start,
@@ -53,6 +65,10 @@ void edit_buffer_insert (edit_buffer_t * buf, int c);
 void edit_buffer_insert_ahead (edit_buffer_t * buf, int c);
 int edit_buffer_delete (edit_buffer_t * buf);
 int edit_buffer_backspace (edit_buffer_t * buf);
+void edit_buffer_insert_block (edit_buffer_t * buf, const char *text, off_t len);
+void edit_buffer_insert_ahead_block (edit_buffer_t * buf, const char *text, off_t len);
+void edit_buffer_delete_block (edit_buffer_t * buf, off_t len);
+void edit_buffer_set_cursor (edit_buffer_t * buf, off_t offset);
 
 off_t edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long lines,
                                       off_t upto);
@@ -60,7 +76,14 @@ off_t edit_buffer_get_backward_offset (const edit_buffer_t * buf, off_t current,
 
 off_t edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
                              edit_buffer_read_file_status_msg_t * sm, gboolean * aborted);
+off_t edit_buffer_map_file (edit_buffer_t * buf, const char *path, off_t size,
+                            edit_buffer_read_file_status_msg_t * sm, gboolean * aborted);
+gboolean edit_buffer_is_mapped (const edit_buffer_t * buf, const struct stat *st);
+gboolean edit_buffer_unmap_changed (edit_buffer_t * buf);
 off_t edit_buffer_write_file (edit_buffer_t * buf, int fd);
+off_t edit_buffer_write_range (const edit_buffer_t * buf, int fd, off_t offset, off_t len);
+GArray *edit_buffer_get_changes (const edit_buffer_t * buf, const struct stat *st);
+void edit_buffer_set_saved (edit_buffer_t * buf, gboolean saved);
 
 int edit_buffer_calc_percent (const edit_buffer_t * buf, off_t offset);
 
@@ -36,6 +36,8 @@
 #include <config.h>
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <inttypes.h>           /* PRIuMAX */
 #include <stdio.h>
 #include <stdarg.h>
 #include <sys/types.h>
@@ -58,6 +60,7 @@
 #include "lib/vfs/vfs.h"
 #include "lib/widget.h"
 #include "lib/event.h"          /* mc_event_raise() */
+#include "lib/logging.h"        /* mc_log() */
 #ifdef HAVE_CHARSET
 #include "lib/charsets.h"
 #endif
@@ -79,6 +82,7 @@
 #include "spell_dialogs.h"
 #endif
 #include "etags.h"
+#include "editsort.h"
 
 /*** global variables ****************************************************************************/
 
@@ -99,6 +103,15 @@ gboolean option_drop_selection_on_copy = TRUE;
 
 #define MAX_WORD_COMPLETIONS 100        /* in listbox */
 
+/* completions found within this distance from cursor are shown first */
+#define WORD_COMPLETION_NEAR (32 * 1024)
+
+/* smaller files are always written completely */
+#define EDIT_IN_PLACE_THRESHOLD (4 * 1024 * 1024)
+
+/* number of bytes written at once while saving in place */
+#define EDIT_IN_PLACE_BLOCK (1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef struct
@@ -110,6 +123,23 @@ typedef struct
     off_t offset;
 } edit_search_status_msg_t;
 
+typedef struct
+{
+    simple_status_msg_t status_msg;     /* base class */
+
+    gboolean first;
+    off_t written;
+    off_t total;
+} edit_save_status_msg_t;
+
+/* match collected by replace-all */
+typedef struct
+{
+    off_t start;                /* offset of match in the text before replace */
+    off_t len;                  /* length of match */
+    gsize repl_len;             /* length of replacement */
+} edit_replace_match_t;
+
 /*** file scope variables ************************************************************************/
 
 static unsigned long edit_save_mode_radio_id, edit_save_mode_input_id;
@@ -147,6 +177,146 @@ edit_search_status_update_cb (status_msg_t * sm)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+edit_save_status_update_cb (status_msg_t * sm)
+{
+    simple_status_msg_t *ssm = SIMPLE_STATUS_MSG (sm);
+    edit_save_status_msg_t *esm = (edit_save_status_msg_t *) sm;
+    Widget *wd = WIDGET (sm->dlg);
+
+    label_set_textv (ssm->label, _("Saving: %" PRIuMAX " of %" PRIuMAX " bytes written"),
+                     (uintmax_t) esm->written, (uintmax_t) esm->total);
+
+    if (esm->first)
+    {
+        int wd_width;
+        Widget *lw = WIDGET (ssm->label);
+
+        wd_width = MAX (wd->cols, lw->cols + 6);
+        widget_set_size (wd, wd->y, wd->x, wd->lines, wd_width);
+        widget_set_size (lw, lw->y, wd->x + (wd->cols - lw->cols) / 2, lw->lines, lw->cols);
+        esm->first = FALSE;
+    }
+
+    return status_msg_common_update (sm);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get prefix of temporary files created in the directory of file being saved */
+
+static char *
+edit_get_save_prefix (const vfs_path_t * filename_vpath)
+{
+    char *savedir, *saveprefix;
+
+    savedir = vfs_path_tokens_get (filename_vpath, 0, -1);
+    if (savedir == NULL)
+        savedir = g_strdup (".");
+
+    /* Token-related function never return leading slash, so we need add it manually */
+    saveprefix = mc_build_filename (PATH_SEP_STR, savedir, "cooledit", (char *) NULL);
+    g_free (savedir);
+
+    return saveprefix;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write changed parts of large local file in place instead of rewriting the whole file.
+ * Like quick save, this isn't atomic: the file is partially written if an error occurs.
+ *
+ * @param edit editor object
+ * @param filename_vpath file name
+ * @param sb information about the file
+ *
+ * @return 1 on success, 0 on error, -1 if the file should be saved as usual
+ */
+
+static int
+edit_save_in_place (WEdit * edit, const vfs_path_t * filename_vpath, const struct stat *sb)
+{
+    GArray *changes;
+    edit_save_status_msg_t esm;
+    int fd;
+    guint i;
+    gboolean ok = TRUE;
+
+    /* the file must be the one which was loaded or saved last time */
+    if (sb->st_size < EDIT_IN_PLACE_THRESHOLD || !S_ISREG (sb->st_mode)
+        || sb->st_dev != edit->stat1.st_dev || sb->st_ino != edit->stat1.st_ino
+        || sb->st_mtime != edit->stat1.st_mtime)
+        return -1;
+
+    changes = edit_buffer_get_changes (&edit->buffer, sb);
+    if (changes == NULL)
+        return -1;
+
+    esm.written = 0;
+    esm.total = 0;
+    for (i = 0; i < changes->len; i++)
+        esm.total += g_array_index (changes, edit_buffer_range_t, i).len;
+
+    /* the whole file is rewritten faster */
+    if (esm.total > edit->buffer.size / 2)
+    {
+        g_array_free (changes, TRUE);
+        return -1;
+    }
+
+    fd = open (vfs_path_as_str (filename_vpath), O_RDWR | O_BINARY);
+    if (fd == -1)
+    {
+        g_array_free (changes, TRUE);
+        return -1;
+    }
+
+    esm.first = TRUE;
+    status_msg_init (STATUS_MSG (&esm), _("Save file"), 1.0, simple_status_msg_init_cb,
+                     edit_save_status_update_cb, NULL);
+
+    for (i = 0; ok && i < changes->len; i++)
+    {
+        const edit_buffer_range_t *r = &g_array_index (changes, edit_buffer_range_t, i);
+        off_t offset, n;
+
+        for (offset = r->offset; ok && offset < r->offset + r->len; offset += n)
+        {
+            n = MIN (r->offset + r->len - offset, EDIT_IN_PLACE_BLOCK);
+            ok = edit_buffer_write_range (&edit->buffer, fd, offset, n) == n;
+            if (ok)
+                esm.written += n;
+            /* cancellation would leave the file half-written */
+            (void) STATUS_MSG (&esm)->update (STATUS_MSG (&esm));
+        }
+    }
+
+    status_msg_deinit (STATUS_MSG (&esm));
+
+    if (ok && edit->buffer.size < sb->st_size)
+        ok = ftruncate (fd, edit->buffer.size) == 0;
+
+    if (close (fd) != 0)
+        ok = FALSE;
+
+    g_array_free (changes, TRUE);
+
+    if (!ok)
+        return 0;
+
+    mc_log ("mcedit: %s: %" PRIuMAX " bytes written in place\n", vfs_path_as_str (filename_vpath),
+            (uintmax_t) esm.written);
+
+    /* Update the file information, especially the mtime. */
+    if (mc_stat (filename_vpath, &edit->stat1) == -1)
+        return 0;
+
+    edit_buffer_set_saved (&edit->buffer, TRUE);
+
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static cb_ret_t
 edit_save_mode_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *data)
 {
@@ -177,7 +347,8 @@ edit_save_mode_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm
    b) rename <tempnam> to <filename>;
    if 2 (do backups) then  a) save to <tempnam>,
    b) rename <filename> to <filename.backup_ext>,
-   c) rename <tempnam> to <filename>. */
+   c) rename <tempnam> to <filename>.
+   Small changes of large local file are written in place by quick save. */
 
 /* returns 0 on error, -1 on abort */
 
@@ -193,6 +364,10 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
     const char *start_filename;
     const vfs_path_element_t *vpath_element;
     struct stat sb;
+    gboolean as_is = FALSE;
+
+    /* the text to save may be still read from the file to be overwritten */
+    edit_check_mapped_file (edit);
 
     vpath_element = vfs_path_get_by_index (filename_vpath, 0);
     if (vpath_element == NULL)
@@ -262,17 +437,28 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
         }
     }
 
-    if (this_save_mode != EDIT_QUICK_SAVE)
+    if (rv == 0 && this_save_mode == EDIT_QUICK_SAVE && edit->lb == LB_ASIS
+        && vfs_file_is_local (real_filename_vpath))
     {
-        char *savedir, *saveprefix;
+        rv = edit_save_in_place (edit, real_filename_vpath, &sb);
+        if (rv >= 0)
+        {
+            vfs_path_free (real_filename_vpath);
+            return rv;
+        }
+        rv = 0;
+    }
 
-        savedir = vfs_path_tokens_get (real_filename_vpath, 0, -1);
-        if (savedir == NULL)
-            savedir = g_strdup (".");
+    /* the text may be still read from the mapped file: don't truncate it under our feet */
+    if (rv == 0 && this_save_mode == EDIT_QUICK_SAVE && vfs_file_is_local (real_filename_vpath)
+        && edit_buffer_is_mapped (&edit->buffer, &sb))
+        this_save_mode = EDIT_SAFE_SAVE;
+
+    if (this_save_mode != EDIT_QUICK_SAVE)
+    {
+        char *saveprefix;
 
-        /* Token-related function never return leading slash, so we need add it manually */
-        saveprefix = mc_build_filename (PATH_SEP_STR, savedir, "cooledit", (char *) NULL);
-        g_free (savedir);
+        saveprefix = edit_get_save_prefix (real_filename_vpath);
         fd = mc_mkstemps (&savename_vpath, saveprefix, NULL);
         g_free (saveprefix);
         if (savename_vpath == NULL)
@@ -346,6 +532,7 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
         /* Update the file information, especially the mtime. */
         if (mc_stat (savename_vpath, &edit->stat1) == -1)
             goto error_save;
+        as_is = TRUE;
     }
     else
     {                           /* change line breaks */
@@ -401,6 +588,9 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
         if (mc_rename (savename_vpath, real_filename_vpath) == -1)
             goto error_save;
 
+    /* next save can write changes in place if the file contains the text as is */
+    edit_buffer_set_saved (&edit->buffer, as_is);
+
     vfs_path_free (real_filename_vpath);
     vfs_path_free (savename_vpath);
     return 1;
@@ -596,7 +786,7 @@ edit_block_delete (WEdit * edit)
 
     if (edit->column_highlight && edit->mark2 < 0)
         edit_mark_cmd (edit, FALSE);
-    if ((end_mark - start_mark) > option_max_undo / 2)
+    if (!edit_undo_log_can_keep (&edit->undo_log, end_mark - start_mark))
     {
         /* Warning message with a query to continue or cancel the operation */
         if (edit_query_dialog2
@@ -641,12 +831,7 @@ edit_block_delete (WEdit * edit)
                 edit->over_col = curs_pos - line_width;
         }
         else
-        {
-            off_t count;
-
-            for (count = start_mark; count < end_mark; count++)
-                edit_delete (edit, TRUE);
-        }
+            edit_delete_block (edit, end_mark - start_mark, NULL);
     }
     edit_set_markers (edit, 0, 0, 0, 0);
     edit->force |= REDRAW_PAGE;
@@ -959,6 +1144,96 @@ edit_show_search_error (const WEdit * edit, const char *title)
         edit_query_dialog (title, edit->search->error_str);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Replace all matches from the current one up to the end of text. Text is scanned once and all
+ * matches with their replacements are collected before the buffer is changed. Then matches are
+ * replaced by blocks in one pass from the start to the end of text. Like sed does, the following
+ * matches are searched in the original text, not in the replaced one.
+ *
+ * @param edit editor object
+ * @param esm search status
+ * @param replace_str replace string with back-references
+ * @param len length of the current match found at edit->search_start
+ *
+ * @return number of replacements made
+ */
+
+static long
+edit_replace_all (WEdit * edit, edit_search_status_msg_t * esm, GString * replace_str, gsize len)
+{
+    GArray *matches;
+    GString *text;
+    off_t start = edit->search_start;
+    off_t delta = 0;
+    gsize i, text_offset = 0;
+
+    matches = g_array_new (FALSE, FALSE, sizeof (edit_replace_match_t));
+    text = g_string_sized_new (replace_str->len);
+
+    while (TRUE)
+    {
+        edit_replace_match_t m;
+        GString *repl_str;
+
+        repl_str = mc_search_prepare_replace_str (edit->search, replace_str);
+        if (edit->search->error != MC_SEARCH_E_OK)
+        {
+            edit_show_search_error (edit, _("Replace"));
+            g_string_free (repl_str, TRUE);
+            break;
+        }
+
+        m.start = start;
+        m.len = (off_t) len;
+        m.repl_len = repl_str->len;
+        g_array_append_val (matches, m);
+        g_string_append_len (text, repl_str->str, repl_str->len);
+        g_string_free (repl_str, TRUE);
+
+        /* so that we don't find the same string again */
+        edit->search_start = start + (off_t) len + (len == 0 ? 1 : 0);
+        if (edit->search_start >= edit->buffer.size)
+            break;
+
+        if (!editcmd_find (esm, &len))
+        {
+            if (!(edit->search->error == MC_SEARCH_E_OK
+                  || edit->search->error == MC_SEARCH_E_NOTFOUND))
+                edit_show_search_error (edit, _("Search"));
+            break;
+        }
+
+        start = edit->search->normal_offset;
+        if (start < 0 || start >= edit->buffer.size)
+            break;
+    }
+
+    /* apply all replacements as one user action */
+    for (i = 0; i < matches->len; i++)
+    {
+        const edit_replace_match_t *m;
+
+        m = &g_array_index (matches, edit_replace_match_t, i);
+        start = m->start + delta;
+        edit_cursor_move (edit, start - edit->buffer.curs1);
+        edit_delete_block (edit, m->len, NULL);
+        edit_insert_block (edit, text->str + text_offset, (off_t) m->repl_len);
+        text_offset += m->repl_len;
+        delta += (off_t) m->repl_len - m->len;
+
+        edit->found_start = start;
+        edit->found_len = m->repl_len;
+        edit->search_start = start + (off_t) m->repl_len + (m->len == 0 ? 1 : 0);
+    }
+
+    g_string_free (text, TRUE);
+    i = matches->len;
+    g_array_free (matches, TRUE);
+
+    return (long) i;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -970,7 +1245,7 @@ edit_do_search (WEdit * edit)
     if (edit->search == NULL)
         edit->search_start = edit->buffer.curs1;
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     esm.first = TRUE;
     esm.edit = edit;
@@ -1088,7 +1363,16 @@ edit_get_block (WEdit * edit, off_t start, off_t finish, off_t * l)
     {
         *l = finish - start;
         while (start < finish)
-            *s++ = edit_buffer_get_byte (&edit->buffer, start++);
+        {
+            const char *p;
+            off_t span;
+
+            p = edit_buffer_get_span (&edit->buffer, start, &span);
+            span = MIN (span, finish - start);
+            memcpy (s, p, span);
+            s += span;
+            start += span;
+        }
     }
     *s = '\0';
     return r;
@@ -1185,164 +1469,189 @@ edit_find_word_start (const edit_buffer_t * buf, off_t * word_start, gsize * wor
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * Get current word under cursor
+ * Find words to be completed around the cursor.
  *
- * @param esm status message window
- * @param srch mc_search object
- * @param word_start start word position
+ * @param edit editor object
+ * @param word_start start of word to be completed
+ * @param prefix beginning of word to be completed
+ * @param word_len length of prefix
  *
- * @return newly allocated string or NULL if no any words under cursor
+ * @return hash table: word of index -> distance from it to word_start plus one
  */
 
-static char *
-edit_collect_completions_get_current_word (edit_search_status_msg_t * esm, mc_search_t * srch,
-                                           off_t word_start)
+static GHashTable *
+edit_collect_completions_near (WEdit * edit, off_t word_start, const char *prefix,
+                               gsize word_len)
 {
-    WEdit *edit = esm->edit;
-    gsize len = 0;
-    off_t i;
-    GString *temp;
+    GHashTable *near;
+    GString *word;
+    off_t i, start, end;
 
-    if (!mc_search_run (srch, (void *) esm, word_start, edit->buffer.size, &len))
-        return NULL;
+    near = g_hash_table_new (g_direct_hash, g_direct_equal);
+    word = g_string_sized_new (32);
 
-    temp = g_string_sized_new (len);
+    start = MAX (0, word_start - WORD_COMPLETION_NEAR);
+    end = MIN (edit->buffer.size, edit->buffer.curs1 + WORD_COMPLETION_NEAR);
 
-    for (i = 0; i < (off_t) len; i++)
+    /* skip words which are cut by window */
+    while (start > 0 && start < end
+           && edit_word_index_is_word_char (edit_buffer_get_byte (&edit->buffer, start - 1)))
+        start++;
+    while (end < edit->buffer.size && end > start
+           && edit_word_index_is_word_char (edit_buffer_get_byte (&edit->buffer, end)))
+        end--;
+
+    for (i = start; i < end;)
     {
-        int chr;
+        off_t w_start = i;
+        const edit_word_t *w;
+        int c;
+
+        g_string_set_size (word, 0);
+        while (i < end
+               && edit_word_index_is_word_char (c = edit_buffer_get_byte (&edit->buffer, i)))
+        {
+            g_string_append_c (word, (char) c);
+            i++;
+        }
+
+        if (word->len == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (w_start == word_start || word->len <= word_len
+            || strncmp (word->str, prefix, word_len) != 0)
+            continue;
+
+        w = edit_word_index_find (&edit->word_index, word->str);
+        if (w != NULL)
+        {
+            int distance, old;
 
-        chr = edit_buffer_get_byte (&edit->buffer, word_start + i);
-        if (!isspace (chr))
-            g_string_append_c (temp, chr);
+            distance = (int) (w_start < word_start ? word_start - w_start : w_start - word_start);
+            old = GPOINTER_TO_INT (g_hash_table_lookup (near, w));
+            if (old == 0 || distance + 1 < old)
+                g_hash_table_insert (near, (gpointer) w, GINT_TO_POINTER (distance + 1));
+        }
     }
 
-    return g_string_free (temp, temp->len == 0);
+    g_string_free (word, TRUE);
+
+    return near;
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** collect the possible completions */
+/** words near the cursor first, then more frequent words */
 
-static gsize
-edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
-                          char *match_expr, GString ** compl, gsize * num)
+static int
+edit_collect_completions_compare (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-    gsize len = 0;
-    gsize max_len = 0;
-    gsize i;
-    int skip;
-    GString *temp;
-    mc_search_t *srch;
-    off_t last_byte, start = -1;
-    char *current_word;
-    gboolean entire_file;
-    edit_search_status_msg_t esm;
-
-#ifdef HAVE_CHARSET
-    srch = mc_search_new (match_expr, cp_source);
-#else
-    srch = mc_search_new (match_expr, NULL);
-#endif
-    if (srch == NULL)
-        return 0;
-
-    entire_file =
-        mc_config_get_bool (mc_global.main_config, CONFIG_APP_SECTION,
-                            "editor_wordcompletion_collect_entire_file", 0);
-
-    last_byte = entire_file ? edit->buffer.size : word_start;
+    GHashTable *near = (GHashTable *) user_data;
+    const edit_word_t *wa = *(const edit_word_t * const *) a;
+    const edit_word_t *wb = *(const edit_word_t * const *) b;
+    int da, db;
+
+    da = GPOINTER_TO_INT (g_hash_table_lookup (near, wa));
+    db = GPOINTER_TO_INT (g_hash_table_lookup (near, wb));
+    if (da != db)
+    {
+        if (da == 0)
+            return 1;
+        if (db == 0)
+            return -1;
+        return (da < db ? -1 : 1);
+    }
 
-    srch->search_type = MC_SEARCH_T_REGEX;
-    srch->is_case_sensitive = TRUE;
-    srch->search_fn = edit_search_cmd_callback;
-    srch->update_fn = edit_search_update_callback;
+    if (wa->count != wb->count)
+        return (wa->count > wb->count ? -1 : 1);
 
-    esm.first = TRUE;
-    esm.edit = edit;
-    esm.offset = entire_file ? 0 : word_start;
+    return strcmp (wa->word, wb->word);
+}
 
-    status_msg_init (STATUS_MSG (&esm), _("Collect completions"), 1.0, simple_status_msg_init_cb,
-                     edit_search_status_update_cb, NULL);
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Collect the possible completions from word index. The best completion is the last one.
+ *
+ * @param edit editor object
+ * @param word_start start of word to be completed
+ * @param word_len length of word before cursor
+ * @param compl array to store completions
+ * @param num where to store number of completions
+ *
+ * @return the maximal length of completion
+ */
 
-    current_word = edit_collect_completions_get_current_word (&esm, srch, word_start);
+static gsize
+edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len, GString ** compl,
+                          gsize * num)
+{
+    gsize max_len = 0;
+    GString *current_word;
+    GPtrArray *words;
+    GHashTable *near;
+    guint i;
+    off_t p;
 
-    temp = g_string_new ("");
+    /* text could be changed since the last idle time */
+    edit_word_index_build (&edit->word_index, &edit->buffer, -1);
 
-    /* collect max MAX_WORD_COMPLETIONS completions */
-    while (mc_search_run (srch, (void *) &esm, start + 1, last_byte, &len))
+    current_word = g_string_sized_new (32);
+    for (p = word_start; p < edit->buffer.size; p++)
     {
-        g_string_set_size (temp, 0);
-        start = srch->normal_offset;
+        int c;
 
-        /* add matched completion if not yet added */
-        for (i = 0; i < len; i++)
-        {
-            skip = edit_buffer_get_byte (&edit->buffer, start + i);
-            if (isspace (skip))
-                continue;
+        c = edit_buffer_get_byte (&edit->buffer, p);
+        if ((gsize) (p - word_start) >= word_len && !edit_word_index_is_word_char (c))
+            break;
+        g_string_append_c (current_word, (char) c);
+    }
 
-            /* skip current word */
-            if (start + (off_t) i == word_start)
-                break;
+    words = edit_word_index_lookup (&edit->word_index, current_word->str, word_len);
+    near = edit_collect_completions_near (edit, word_start, current_word->str, word_len);
+    g_ptr_array_sort_with_data (words, edit_collect_completions_compare, near);
 
-            g_string_append_c (temp, skip);
-        }
+    for (i = 0; i < words->len && *num < MAX_WORD_COMPLETIONS; i++)
+    {
+        const edit_word_t *w = (const edit_word_t *) g_ptr_array_index (words, i);
 
-        if (temp->len == 0)
+        /* skip the word to be completed itself */
+        if (w->len == word_len || strcmp (w->word, current_word->str) == 0)
             continue;
 
-        if (current_word != NULL && strcmp (current_word, temp->str) == 0)
-            continue;
+        compl[(*num)++] = g_string_new_len (w->word, w->len);
 
-        skip = 0;
+        /* note the maximal length needed for the completion dialog */
+        if (w->len > max_len)
+            max_len = w->len;
+    }
 
-        for (i = 0; i < *num; i++)
-        {
-            if (strncmp
-                ((char *) &compl[i]->str[word_len],
-                 (char *) &temp->str[word_len], MAX (len, compl[i]->len) - word_len) == 0)
-            {
-                GString *this = compl[i];
-                for (++i; i < *num; i++)
-                    compl[i - 1] = compl[i];
-                compl[*num - 1] = this;
-                skip = 1;
-                break;          /* skip it, already added */
-            }
-        }
-        if (skip != 0)
-            continue;
+    /* the best completion is the last one */
+    for (i = 0; i < *num / 2; i++)
+    {
+        GString *tmp = compl[i];
 
-        if (*num == MAX_WORD_COMPLETIONS)
-        {
-            g_string_free (compl[0], TRUE);
-            for (i = 1; i < *num; i++)
-                compl[i - 1] = compl[i];
-            (*num)--;
-        }
-#ifdef HAVE_CHARSET
-        {
-            GString *recoded;
+        compl[i] = compl[*num - 1 - i];
+        compl[*num - 1 - i] = tmp;
+    }
 
-            recoded = str_convert_to_display (temp->str);
-            if (recoded->len != 0)
-                g_string_assign (temp, recoded->str);
+#ifdef HAVE_CHARSET
+    for (i = 0; i < *num; i++)
+    {
+        GString *recoded;
 
-            g_string_free (recoded, TRUE);
-        }
-#endif
-        compl[(*num)++] = g_string_new_len (temp->str, temp->len);
-        start += len;
+        recoded = str_convert_to_display (compl[i]->str);
+        if (recoded->len != 0)
+            g_string_assign (compl[i], recoded->str);
 
-        /* note the maximal length needed for the completion dialog */
-        if (len > max_len)
-            max_len = len;
+        g_string_free (recoded, TRUE);
     }
+#endif
 
-    status_msg_deinit (STATUS_MSG (&esm));
-    mc_search_free (srch);
-    g_string_free (temp, TRUE);
-    g_free (current_word);
+    g_hash_table_destroy (near);
+    g_ptr_array_free (words, TRUE);
+    g_string_free (current_word, TRUE);
 
     return max_len;
 }
@@ -1504,6 +1813,8 @@ edit_syntax_onoff_cb (void *data, void *user_data)
     {
         WEdit *edit = (WEdit *) data;
 
+        /* brackets in strings and comments are skipped only with highlighting on */
+        edit_bracket_index_reset (&edit->bracket_index);
         if (option_syntax_highlighting)
             edit_load_syntax (edit, NULL, edit->syntax_type);
         edit->force |= REDRAW_PAGE;
@@ -1554,6 +1865,55 @@ edit_complete_word_insert_recoded_completion (WEdit * edit, char *completion, gs
 #endif
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort lines of block by built-in sort and replace block with them in one bulk edit.
+ *
+ * @param edit       editor object
+ * @param start_mark start of block
+ * @param end_mark   end of block
+ * @param options    sort options
+ *
+ * @return 1 if cancelled by user, 0 otherwise
+ */
+
+static int
+edit_sort_block (WEdit * edit, off_t start_mark, off_t end_mark,
+                 const edit_sort_options_t * options)
+{
+    unsigned char *block;
+    off_t len;
+    GString *sorted;
+
+    block = edit_get_block (edit, start_mark, end_mark, &len);
+
+    edit->force |= REDRAW_COMPLETELY;
+
+    if (edit_block_delete (edit) != 0)
+    {
+        g_free (block);
+        return 1;
+    }
+
+    sorted = edit_sort_text ((const char *) block, (size_t) len, options);
+    g_free (block);
+
+    edit_insert_block (edit, sorted->str, (off_t) sorted->len);
+
+    /* highlight sorted lines then not persistent blocks */
+    if (!option_persistent_selections)
+        edit_set_markers (edit, edit->buffer.curs1, start_mark, 0, 0);
+
+    /* Place cursor at the end of text selection */
+    if (!option_cursor_after_inserted_block)
+        edit_cursor_move (edit, start_mark - edit->buffer.curs1);
+
+    edit_scroll_screen_over_cursor (edit);
+    g_string_free (sorted, TRUE);
+
+    return 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1578,6 +1938,8 @@ edit_syntax_onoff_cmd (WDialog * h)
 {
     option_syntax_highlighting = !option_syntax_highlighting;
     g_list_foreach (h->widgets, edit_syntax_onoff_cb, NULL);
+    /* index brackets again while user doesn't type */
+    widget_idle (WIDGET (h), TRUE);
     dlg_redraw (h);
 }
 
@@ -1720,7 +2082,7 @@ edit_save_as_cmd (WEdit * edit)
         return FALSE;
 
     exp_vpath = edit_get_save_file_as (edit);
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     if (exp_vpath != NULL)
     {
@@ -1910,7 +2272,7 @@ edit_store_macro_cmd (WEdit * edit)
     if (macros_config == NULL)
         return FALSE;
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     marcros_string = g_string_sized_new (250);
     macros = g_array_new (TRUE, FALSE, sizeof (macro_action_t));
@@ -1982,7 +2344,7 @@ edit_repeat_macro_cmd (WEdit * edit)
 
     g_free (f);
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
     edit->force |= REDRAW_PAGE;
 
     for (j = 0; j < count_repeat; j++)
@@ -2385,14 +2747,11 @@ edit_block_copy_cmd (WEdit * edit)
     }
     else
     {
-        int size_orig = size;
-
-        while (size-- != 0)
-            edit_insert_ahead (edit, copy_buf[size]);
+        edit_insert_ahead_block (edit, (const char *) copy_buf, size);
 
         /* Place cursor at the end of text selection */
         if (option_cursor_after_inserted_block)
-            edit_cursor_move (edit, size_orig);
+            edit_cursor_move (edit, size);
     }
 
     g_free (copy_buf);
@@ -2476,31 +2835,26 @@ edit_block_move_cmd (WEdit * edit)
     }
     else
     {
-        off_t count, count_orig;
-
         current = edit->buffer.curs1;
         copy_buf = g_malloc0 (end_mark - start_mark);
         edit_cursor_move (edit, start_mark - edit->buffer.curs1);
         edit_scroll_screen_over_cursor (edit);
 
-        for (count = start_mark; count < end_mark; count++)
-            copy_buf[end_mark - count - 1] = edit_delete (edit, TRUE);
+        edit_delete_block (edit, end_mark - start_mark, (char *) copy_buf);
 
         edit_scroll_screen_over_cursor (edit);
         edit_cursor_move (edit,
                           current - edit->buffer.curs1 -
                           (((current - edit->buffer.curs1) > 0) ? end_mark - start_mark : 0));
         edit_scroll_screen_over_cursor (edit);
-        count_orig = count;
-        while (count-- > start_mark)
-            edit_insert_ahead (edit, copy_buf[end_mark - count - 1]);
+        edit_insert_ahead_block (edit, (const char *) copy_buf, end_mark - start_mark);
 
         edit_set_markers (edit, edit->buffer.curs1, edit->buffer.curs1 + end_mark - start_mark, 0,
                           0);
 
         /* Place cursor at the end of text selection */
         if (option_cursor_after_inserted_block)
-            edit_cursor_move (edit, count_orig - start_mark);
+            edit_cursor_move (edit, end_mark - start_mark);
     }
 
     edit_scroll_screen_over_cursor (edit);
@@ -2565,7 +2919,7 @@ edit_replace_cmd (WEdit * edit, gboolean again)
         disp1 = edit_replace_cmd__conv_to_display (saved1 ? saved1 : "");
         disp2 = edit_replace_cmd__conv_to_display (saved2 ? saved2 : "");
 
-        edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+        edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
         editcmd_dialog_replace_show (edit, disp1, disp2, &input1, &input2);
 
@@ -2615,6 +2969,7 @@ edit_replace_cmd (WEdit * edit, gboolean again)
         edit->search->is_case_sensitive = edit_search_options.case_sens;
         edit->search->whole_words = edit_search_options.whole_words;
         edit->search->search_fn = edit_search_cmd_callback;
+        edit->search->span_fn = edit_search_span_callback;
         edit->search->update_fn = edit_search_update_callback;
         edit->search_line_type = edit_get_search_line_type (edit->search);
         edit_search_fix_search_start_if_selection (edit);
@@ -2654,11 +3009,10 @@ edit_replace_cmd (WEdit * edit, gboolean again)
 
         if ((edit->search_start >= 0) && (edit->search_start < edit->buffer.size))
         {
-            gsize i;
             GString *repl_str;
 
             edit->found_start = edit->search_start;
-            i = edit->found_len = len;
+            edit->found_len = len;
 
             edit_cursor_move (edit, edit->search_start - edit->buffer.curs1);
             edit_scroll_screen_over_cursor (edit);
@@ -2704,6 +3058,12 @@ edit_replace_cmd (WEdit * edit, gboolean again)
                 }
             }
 
+            if (edit->replace_mode == 1 && !edit_search_options.backwards)
+            {
+                times_replaced += edit_replace_all (edit, &esm, input2_str, len);
+                break;          /* loop */
+            }
+
             repl_str = mc_search_prepare_replace_str (edit->search, input2_str);
 
             if (edit->search->error != MC_SEARCH_E_OK)
@@ -2714,11 +3074,8 @@ edit_replace_cmd (WEdit * edit, gboolean again)
             }
 
             /* delete then insert new */
-            for (i = 0; i < len; i++)
-                edit_delete (edit, TRUE);
-
-            for (i = 0; i < repl_str->len; i++)
-                edit_insert (edit, repl_str->str[i]);
+            edit_delete_block (edit, (off_t) len, NULL);
+            edit_insert_block (edit, repl_str->str, (off_t) repl_str->len);
 
             edit->found_len = repl_str->len;
             g_string_free (repl_str, TRUE);
@@ -2783,6 +3140,27 @@ edit_search_cmd_callback (const void *user_data, gsize char_offset, int *current
 
 /* --------------------------------------------------------------------------------------------- */
 
+mc_search_cbret_t
+edit_search_span_callback (const void *user_data, gsize char_offset, const char **span,
+                           gsize * span_len)
+{
+    WEdit *edit = ((const edit_search_status_msg_t *) user_data)->edit;
+    off_t len = 0;
+
+    *span = edit_buffer_get_span (&edit->buffer, (off_t) char_offset, &len);
+    if (*span == NULL)
+    {
+        /* like edit_buffer_get_byte(), return '\n' outside of buffer */
+        *span = "\n";
+        len = 1;
+    }
+
+    *span_len = (gsize) len;
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 mc_search_cbret_t
 edit_search_update_callback (const void *user_data, gsize char_offset)
 {
@@ -2839,6 +3217,7 @@ edit_search_cmd (WEdit * edit, gboolean again)
                 edit->search->is_case_sensitive = edit_search_options.case_sens;
                 edit->search->whole_words = edit_search_options.whole_words;
                 edit->search->search_fn = edit_search_cmd_callback;
+                edit->search->span_fn = edit_search_span_callback;
                 edit->search->update_fn = edit_search_update_callback;
                 edit->search_line_type = edit_get_search_line_type (edit->search);
                 edit_do_search (edit);
@@ -2959,21 +3338,23 @@ edit_save_block (WEdit * edit, const char *filename, off_t start, off_t finish)
     }
     else
     {
-        unsigned char *buf;
-        off_t i = start;
-        off_t end;
-
         len = finish - start;
-        buf = g_malloc0 (TEMP_BUF_LEN);
-        while (start != finish)
+
+        /* write contiguous parts of buffer as is */
+        while (start < finish)
         {
-            end = MIN (finish, start + TEMP_BUF_LEN);
-            for (; i < end; i++)
-                buf[i - start] = edit_buffer_get_byte (&edit->buffer, i);
-            len -= mc_write (file, (char *) buf, end - start);
-            start = end;
+            const char *p;
+            off_t span;
+            ssize_t r;
+
+            p = edit_buffer_get_span (&edit->buffer, start, &span);
+            span = MIN (span, finish - start);
+            r = mc_write (file, p, span);
+            if (r <= 0)
+                break;
+            len -= r;
+            start += r;
         }
-        g_free (buf);
     }
     mc_close (file);
 
@@ -3113,7 +3494,7 @@ edit_save_block_cmd (WEdit * edit)
         input_expand_dialog (_("Save block"), _("Enter file name:"),
                              MC_HISTORY_EDIT_SAVE_BLOCK, tmp, INPUT_COMPLETE_FILENAMES);
     g_free (tmp);
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     if (exp != NULL && *exp != '\0')
     {
@@ -3146,7 +3527,7 @@ edit_insert_file_cmd (WEdit * edit)
                                MC_HISTORY_EDIT_INSERT_FILE, tmp, INPUT_COMPLETE_FILENAMES);
     g_free (tmp);
 
-    edit_push_undo_action (edit, KEY_PRESS + edit->start_display);
+    edit_push_undo_action (edit, EDIT_UNDO_KEY_PRESS, edit->start_display);
 
     if (exp != NULL && *exp != '\0')
     {
@@ -3174,6 +3555,7 @@ edit_sort_cmd (WEdit * edit)
 {
     char *exp, *tmp, *tmp_edit_block_name, *tmp_edit_temp_name;
     off_t start_mark, end_mark;
+    edit_sort_options_t options;
     int e;
 
     if (!eval_marks (edit, &start_mark, &end_mark))
@@ -3182,10 +3564,6 @@ edit_sort_cmd (WEdit * edit)
         return 0;
     }
 
-    tmp = mc_config_get_full_path (EDIT_BLOCK_FILE);
-    edit_save_block (edit, tmp, start_mark, end_mark);
-    g_free (tmp);
-
     exp = input_dialog (_("Run sort"),
                         _("Enter sort options (see manpage) separated by whitespace:"),
                         MC_HISTORY_EDIT_SORT, INPUT_LAST_TEXT, INPUT_COMPLETE_NONE);
@@ -3193,6 +3571,17 @@ edit_sort_cmd (WEdit * edit)
     if (exp == NULL)
         return 1;
 
+    /* sort in place if options allow, run sort(1) otherwise */
+    if (!edit->column_highlight && edit_sort_parse_options (exp, &options))
+    {
+        g_free (exp);
+        return edit_sort_block (edit, start_mark, end_mark, &options);
+    }
+
+    tmp = mc_config_get_full_path (EDIT_BLOCK_FILE);
+    edit_save_block (edit, tmp, start_mark, end_mark);
+    g_free (tmp);
+
     tmp_edit_block_name = mc_config_get_full_path (EDIT_BLOCK_FILE);
     tmp_edit_temp_name = mc_config_get_full_path (EDIT_TEMP_FILE);
     tmp =
@@ -3369,8 +3758,8 @@ edit_mail_dialog (WEdit * edit)
 /*******************/
 
 /**
- * Complete current word using regular expression search
- * backwards beginning at the current cursor position.
+ * Complete current word using index of words of the text. The words found near the cursor
+ * are offered first, then the more frequent ones.
  */
 
 void
@@ -3378,26 +3767,15 @@ edit_complete_word_cmd (WEdit * edit)
 {
     gsize i, max_len, word_len = 0, num_compl = 0;
     off_t word_start = 0;
-    GString *match_expr;
     GString *compl[MAX_WORD_COMPLETIONS];       /* completions */
 
     /* search start of word to be completed */
     if (!edit_find_word_start (&edit->buffer, &word_start, &word_len))
         return;
 
-    /* prepare match expression */
-    /* match_expr = g_strdup_printf ("\\b%.*s[a-zA-Z_0-9]+", word_len, bufpos); */
-    match_expr = g_string_new ("(^|\\s+|\\b)");
-    for (i = 0; i < word_len; i++)
-        g_string_append_c (match_expr, edit_buffer_get_byte (&edit->buffer, word_start + i));
-    g_string_append (match_expr,
-                     "[^\\s\\.=\\+\\[\\]\\(\\)\\,\\;\\:\\\"\\'\\-\\?\\/\\|\\\\\\{\\}\\*\\&\\^\\%%\\$#@\\!]+");
-
-    /* collect the possible completions              */
-    /* start search from begin to end of file */
-    max_len =
-        edit_collect_completions (edit, word_start, word_len, match_expr->str, (GString **) & compl,
-                                  &num_compl);
+    /* collect the possible completions */
+    max_len = edit_collect_completions (edit, word_start, word_len, (GString **) & compl,
+                                        &num_compl);
 
     if (num_compl > 0)
     {
@@ -3426,7 +3804,6 @@ edit_complete_word_cmd (WEdit * edit)
         }
     }
 
-    g_string_free (match_expr, TRUE);
     /* release memory before return */
     for (i = 0; i < num_compl; i++)
         g_string_free (compl[i], TRUE);
@@ -3556,10 +3933,7 @@ edit_get_match_keyword_cmd (WEdit * edit)
 
     etags_hash_t def_hash[MAX_DEFINITIONS];
 
-    for (i = 0; i < MAX_DEFINITIONS; i++)
-    {
-        def_hash[i].filename = NULL;
-    }
+    memset (def_hash, 0, sizeof (def_hash));
 
     /* search start of word to be completed */
     if (!edit_find_word_start (&edit->buffer, &word_start, &word_len))
@@ -3574,23 +3948,22 @@ edit_get_match_keyword_cmd (WEdit * edit)
     path = g_strconcat (ptr, PATH_SEP_STR, (char *) NULL);
     g_free (ptr);
 
-    /* Recursive search file 'TAGS' in parent dirs */
-    do
+    /* Recursive search file 'TAGS' in parent dirs, definitions from all of them are shown */
+    while (num_def < MAX_DEFINITIONS - 1)
     {
         ptr = g_path_get_dirname (path);
+        if (strcmp (ptr, path) == 0)
+        {
+            g_free (ptr);
+            break;
+        }
         g_free (path);
         path = ptr;
-        g_free (tagfile);
         tagfile = mc_build_filename (path, TAGS_NAME, (char *) NULL);
         if (exist_file (tagfile))
-            break;
-    }
-    while (strcmp (path, PATH_SEP_STR) != 0);
-
-    if (tagfile)
-    {
-        num_def =
-            etags_set_definition_hash (tagfile, path, match_expr->str, (etags_hash_t *) & def_hash);
+            num_def += etags_set_definition_hash (tagfile, path, match_expr->str,
+                                                  def_hash + num_def,
+                                                  MAX_DEFINITIONS - 1 - num_def);
         g_free (tagfile);
     }
     g_free (path);
@@ -3603,6 +3976,13 @@ edit_get_match_keyword_cmd (WEdit * edit)
                                                (etags_hash_t *) & def_hash, num_def);
     }
     g_string_free (match_expr, TRUE);
+
+    for (i = 0; i < (gsize) num_def; i++)
+    {
+        g_free (def_hash[i].fullpath);
+        g_free (def_hash[i].filename);
+        g_free (def_hash[i].short_define);
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3708,22 +4088,28 @@ edit_spellcheck_file (WEdit * edit)
         edit_update_curs_row (edit);
     }
 
+    /* find all misspelled words at once */
+    edit_spell_build (&edit->spell, &edit->buffer, -1);
+
     do
     {
-        int c1, c2;
-
-        c2 = edit_buffer_get_current_byte (&edit->buffer);
+        const GArray *misspelled = edit->spell.misspelled;
+        const edit_spell_range_t *r = NULL;
+        guint i;
 
-        do
+        /* one-letter words are skipped */
+        for (i = edit_spell_lookup (&edit->spell, edit->buffer.curs1); i < misspelled->len; i++)
         {
-            if (edit->buffer.curs1 >= edit->buffer.size)
-                return;
-
-            c1 = c2;
-            edit_cursor_move (edit, 1);
-            c2 = edit_buffer_get_current_byte (&edit->buffer);
+            r = &g_array_index (misspelled, edit_spell_range_t, i);
+            if (r->start >= edit->buffer.curs1 && r->len > 1)
+                break;
         }
-        while (is_break_char (c1) || is_break_char (c2));
+
+        if (i >= misspelled->len)
+            return;
+
+        /* move cursor into the word */
+        edit_cursor_move (edit, r->start + 1 - edit->buffer.curs1);
     }
     while (edit_suggest_current_word (edit) != B_CANCEL);
 }
@@ -207,6 +207,7 @@ editcmd_dialog_search_show (WEdit * edit)
         edit->search->is_case_sensitive = edit_search_options.case_sens;
         edit->search->whole_words = edit_search_options.whole_words;
         edit->search->search_fn = edit_search_cmd_callback;
+        edit->search->span_fn = edit_search_span_callback;
         edit->search->update_fn = edit_search_update_callback;
     }
 
@@ -602,12 +603,6 @@ editcmd_dialog_select_definition_show (WEdit * edit, char *match_expr, int max_l
         }
     }
 
-    /* clear definition hash */
-    for (i = 0; i < MAX_DEFINITIONS; i++)
-    {
-        g_free (def_hash[i].filename);
-    }
-
     /* destroy dialog before return */
     dlg_destroy (def_dlg);
 }
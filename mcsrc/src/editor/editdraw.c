@@ -49,6 +49,7 @@
 #include "lib/strutil.h"        /* utf string functions */
 #include "lib/util.h"           /* is_printable() */
 #include "lib/widget.h"
+#include "lib/logging.h"        /* mc_log() */
 #ifdef HAVE_CHARSET
 #include "lib/charsets.h"
 #endif
@@ -76,6 +77,7 @@ gboolean visible_tabs = TRUE;
 #define MOD_MARKED              (1 << 10)
 #define MOD_CURSOR              (1 << 11)
 #define MOD_WHITESPACE          (1 << 12)
+#define MOD_SPELL               (1 << 13)
 
 #define edit_move(x,y) widget_move(edit, y, x);
 
@@ -83,6 +85,9 @@ gboolean visible_tabs = TRUE;
 
 #define EDITOR_MINIMUM_TERMINAL_WIDTH 30
 
+/* color of cell is set with tty_lowlevel_setcolor() */
+#define EDIT_CELL_LOWLEVEL      (1 << 30)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef struct
@@ -91,6 +96,21 @@ typedef struct
     unsigned int style;
 } line_s;
 
+/* cell of text area as it is drawn on the screen */
+typedef struct
+{
+    unsigned int ch;            /* 0 for second column of wide character */
+    int color;
+} edit_cell_t;
+
+/* row of text area as it is drawn on the screen */
+typedef struct
+{
+    int x;                      /* column of first cell */
+    int len;                    /* number of cells, 0 if content of row is unknown */
+    edit_cell_t *cells;
+} edit_screen_line_t;
+
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
@@ -389,6 +409,79 @@ edit_draw_window_icons (const WEdit * edit, int color)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Draw row of text area. Only cells which differ from the ones drawn before are output.
+ *
+ * @param edit editor object
+ * @param y row relative to the widget
+ * @param x column of first cell relative to the widget
+ * @param cells new content of row, it is owned by screen after call
+ * @param len number of cells
+ */
+
+static void
+edit_draw_cells (WEdit * edit, int y, int x, edit_cell_t * cells, int len)
+{
+    edit_screen_line_t *sl;
+    int old_len;
+    int color = -1;
+    int next_x = -1;
+    int i;
+    unsigned long drawn = 0;
+
+    if (edit->screen == NULL)
+        edit->screen = g_array_new (FALSE, TRUE, sizeof (edit_screen_line_t));
+    if ((guint) y >= edit->screen->len)
+        g_array_set_size (edit->screen, y + 1);
+
+    sl = &g_array_index (edit->screen, edit_screen_line_t, y);
+    old_len = sl->x == x ? sl->len : 0;
+
+    for (i = 0; i < len; i++)
+    {
+        const edit_cell_t *c = &cells[i];
+
+        if (i < old_len && c->ch == sl->cells[i].ch && c->color == sl->cells[i].color)
+            continue;
+
+        /* second column of wide character is drawn with the first one */
+        if (c->ch == 0)
+            continue;
+
+        if (i != next_x)
+            edit_move (x + i, y);
+
+        if (c->color != color)
+        {
+            color = c->color;
+            if ((color & EDIT_CELL_LOWLEVEL) != 0)
+                tty_lowlevel_setcolor (color & ~EDIT_CELL_LOWLEVEL);
+            else
+                tty_setcolor (color);
+        }
+
+        tty_print_anychar (c->ch);
+        drawn++;
+
+        next_x = i + 1;
+        if (i + 1 < len && cells[i + 1].ch == 0)
+            next_x++;
+    }
+
+    if (drawn != 0)
+    {
+        edit->drawn_lines++;
+        edit->drawn_cells += drawn;
+    }
+
+    g_free (sl->cells);
+    sl->cells = cells;
+    sl->x = x;
+    sl->len = len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static inline void
 print_to_widget (WEdit * edit, long row, int start_col, int start_col_real,
                  long end_col, line_s line[], char *status, int bookmarked)
@@ -396,6 +489,7 @@ print_to_widget (WEdit * edit, long row, int start_col, int start_col_real,
     Widget *w = WIDGET (edit);
 
     line_s *p;
+    edit_cell_t *cells, *c;
 
     int x = start_col_real;
     int x1 = start_col + EDIT_TEXT_HORIZONTAL_OFFSET + option_line_state_width;
@@ -404,6 +498,8 @@ print_to_widget (WEdit * edit, long row, int start_col, int start_col_real,
     int i;
     int wrap_start;
     int len;
+    int text_len = 0;
+    int fill_color;
 
     if (!edit->fullscreen)
     {
@@ -411,49 +507,43 @@ print_to_widget (WEdit * edit, long row, int start_col, int start_col_real,
         y++;
     }
 
-    tty_setcolor (EDITOR_NORMAL_COLOR);
-    if (bookmarked != 0)
-        tty_setcolor (bookmarked);
+    if (w->y + y < 0)
+        return;
 
-    len = end_col + 1 - start_col;
+    fill_color = bookmarked != 0 ? bookmarked : EDITOR_NORMAL_COLOR;
+
+    len = MAX (end_col + 1 - start_col, 0);
     wrap_start = option_word_wrap_line_length + edit->start_col;
 
-    if (len > 0 && w->y + y >= 0)
-    {
-        if (!show_right_margin || wrap_start > end_col)
-            tty_draw_hline (w->y + y, w->x + x1, ' ', len);
-        else if (wrap_start < 0)
-        {
-            tty_setcolor (EDITOR_RIGHT_MARGIN_COLOR);
-            tty_draw_hline (w->y + y, w->x + x1, ' ', len);
-        }
-        else
-        {
-            if (wrap_start > 0)
-                tty_draw_hline (w->y + y, w->x + x1, ' ', wrap_start);
+    for (p = line, i = 0; p->ch != 0; p++, i++)
+        if (i >= cols_to_skip)
+            text_len += mc_global.utf8_display && g_unichar_iswide (p->ch) ? 2 : 1;
 
-            len -= wrap_start;
-            if (len > 0)
-            {
-                tty_setcolor (EDITOR_RIGHT_MARGIN_COLOR);
-                tty_draw_hline (w->y + y, w->x + x1 + wrap_start, ' ', len);
-            }
-        }
+    /* cells of line state and text area */
+    cells = g_new (edit_cell_t, option_line_state_width + MAX (len, text_len));
+    c = cells;
+
+    for (i = 0; i < option_line_state_width; i++, c++)
+    {
+        if (status[i] == '\0')
+            status[i] = ' ';
+        c->ch = (unsigned char) status[i];
+        c->color = LINE_STATE_COLOR;
     }
 
-    if (option_line_state)
+    for (i = 0; i < MAX (len, text_len); i++)
     {
-        tty_setcolor (LINE_STATE_COLOR);
-        for (i = 0; i < LINE_STATE_WIDTH; i++)
-        {
-            edit_move (x1 + i - option_line_state_width, y);
-            if (status[i] == '\0')
-                status[i] = ' ';
-            tty_print_char (status[i]);
-        }
+        c[i].ch = ' ';
+        if (i >= len)
+            c[i].color = EDITOR_NORMAL_COLOR;
+        else if (!show_right_margin || wrap_start > end_col)
+            c[i].color = fill_color;
+        else if (wrap_start < 0 || i >= wrap_start)
+            c[i].color = EDITOR_RIGHT_MARGIN_COLOR;
+        else
+            c[i].color = fill_color;
     }
 
-    edit_move (x1, y);
     i = 1;
     for (p = line; p->ch != 0; p++)
     {
@@ -482,27 +572,41 @@ print_to_widget (WEdit * edit, long row, int start_col, int start_col_real,
             if (style & MOD_MARKED)
             {
                 textchar = ' ';
-                tty_setcolor (EDITOR_MARKED_COLOR);
+                color = EDITOR_MARKED_COLOR;
             }
             else
-                tty_setcolor (EDITOR_WHITESPACE_COLOR);
+                color = EDITOR_WHITESPACE_COLOR;
         }
         else if (style & MOD_BOLD)
-            tty_setcolor (EDITOR_BOLD_COLOR);
+            color = EDITOR_BOLD_COLOR;
         else if (style & MOD_MARKED)
-            tty_setcolor (EDITOR_MARKED_COLOR);
+            color = EDITOR_MARKED_COLOR;
+        else if (style & MOD_SPELL)
+            color = EDITOR_SPELL_COLOR;
         else
-            tty_lowlevel_setcolor (color);
+            color |= EDIT_CELL_LOWLEVEL;
 
         if (show_right_margin)
         {
             if (i > option_word_wrap_line_length + edit->start_col)
-                tty_setcolor (EDITOR_RIGHT_MARGIN_COLOR);
+                color = EDITOR_RIGHT_MARGIN_COLOR;
             i++;
         }
 
-        tty_print_anychar (textchar);
+        c->ch = textchar;
+        c->color = color;
+        c++;
+
+        if (mc_global.utf8_display && g_unichar_iswide (p->ch))
+        {
+            c->ch = 0;
+            c->color = color;
+            c++;
+        }
     }
+
+    edit_draw_cells (edit, y, x1 - option_line_state_width, cells,
+                     option_line_state_width + MAX (len, text_len));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -522,6 +626,9 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
     int abn_style;
     int book_mark = 0;
     char line_stat[LINE_STATE_WIDTH + 1] = "\0";
+#ifdef HAVE_ASPELL
+    guint spell_i;
+#endif
 
     if (row > w->lines - 1 - EDIT_TEXT_VERTICAL_OFFSET - 2 * (edit->fullscreen ? 0 : 1))
         return;
@@ -590,6 +697,10 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
                 }
             }
 
+#ifdef HAVE_ASPELL
+            spell_i = edit_spell_lookup (&edit->spell, q);
+#endif
+
             while (col <= end_col - edit->start_col)
             {
                 int char_length = 1;
@@ -621,6 +732,11 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
                     p->style |= MOD_BOLD;
                 if (q >= edit->found_start && q < (off_t) (edit->found_start + edit->found_len))
                     p->style |= MOD_BOLD;
+#ifdef HAVE_ASPELL
+                if (edit_spell_is_misspelled (&edit->spell, q, &spell_i)
+                    && edit_get_syntax_spelling (edit, q))
+                    p->style |= MOD_SPELL;
+#endif
 
 #ifdef HAVE_CHARSET
                 if (edit->utf8)
@@ -738,7 +854,7 @@ edit_draw_this_line (WEdit * edit, off_t b, long row, long start_col, long end_c
                     {
                         if (!edit->utf8)
                         {
-                            c = convert_from_8bit_to_utf_c ((unsigned char) c, edit->converter);
+                            c = edit->utf_table[(unsigned char) c];
                         }
                         else
                         {
@@ -1030,8 +1146,18 @@ edit_render (WEdit * edit, int page, int row_start, int col_start, int row_end,
     if (page)                   /* if it was an expose event, 'page' would be set */
         edit->force |= REDRAW_PAGE | REDRAW_IN_BOUNDS;
 
+    /* screen was erased or overdrawn by something else */
+    if ((edit->force & REDRAW_COMPLETELY) != 0)
+        edit_screen_clean (edit);
+
+    edit->drawn_lines = 0;
+    edit->drawn_cells = 0;
+
     render_edit_text (edit, row_start, col_start, row_end, col_end);
 
+    if (edit->drawn_lines != 0)
+        mc_log ("mcedit: %lu lines, %lu cells drawn\n", edit->drawn_lines, edit->drawn_cells);
+
     /*
      * edit->force != 0 means a key was pending and the redraw
      * was halted, so next time we must redraw everything in case stuff
@@ -1158,3 +1284,25 @@ edit_render_keypress (WEdit * edit)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget what is drawn on the screen, so text area will be drawn entirely next time.
+ *
+ * @param edit editor object
+ */
+
+void
+edit_screen_clean (WEdit * edit)
+{
+    guint i;
+
+    if (edit->screen == NULL)
+        return;
+
+    for (i = 0; i < edit->screen->len; i++)
+        g_free (g_array_index (edit->screen, edit_screen_line_t, i).cells);
+
+    g_array_free (edit->screen, TRUE);
+    edit->screen = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
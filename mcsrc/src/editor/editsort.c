@@ -0,0 +1,709 @@
+/*
+   Editor built-in sort of text block.
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor built-in sort of text block.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"        /* str_create_key(), str_key_collate() */
+
+#include "editsort.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * Block is split into lines which are sorted in place: line is a pointer into the block and
+ * a length, so that no text is copied until the result is built.
+ *
+ * Lines are sorted by stable merge sort. Large blocks are cut into runs, one per processor;
+ * every run gets its collation keys and is sorted in its own thread, then runs are merged
+ * pairwise, each pair in its own thread too. Threads share nothing but the read-only text
+ * and options, and every thread writes its own range of line array only.
+ *
+ * Lines with equal keys are compared bytewise as a whole, like sort(1) does.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* max number of threads to sort one block */
+#define EDIT_SORT_MAX_THREADS 8
+
+/* don't start a thread to sort less lines than this */
+#define EDIT_SORT_THREAD_MIN_LINES 16384
+
+/* ranges of this length are sorted by insertion */
+#define EDIT_SORT_INSERTION_MAX 16
+
+#define edit_sort_is_blank(c) ((c) == ' ' || (c) == '\t')
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    const char *text;           /* line without '\n' */
+    size_t len;
+    char *key;                  /* collation key of line, NULL if numeric */
+    double number;              /* numeric key of line */
+} edit_sort_line_t;
+
+/* sort or merge a range of lines */
+typedef struct
+{
+    const edit_sort_options_t *options;
+    edit_sort_line_t *lines;
+    edit_sort_line_t *tmp;
+    size_t lo;
+    size_t mid;                 /* start of the 2nd run to merge */
+    size_t hi;
+    char *keys;                 /* NUL-terminated copies of keys of lines in range */
+} edit_sort_job_t;
+
+/*** file scope variables ************************************************************************/
+
+static const struct
+{
+    const char *name;
+    char opt;
+} edit_sort_long_options[] =
+{
+    /* *INDENT-OFF* */
+    { "numeric-sort", 'n' },
+    { "reverse", 'r' },
+    { "unique", 'u' },
+    { "ignore-case", 'f' },
+    { "ignore-leading-blanks", 'b' },
+    { "key", 'k' },
+    { "field-separator", 't' }
+    /* *INDENT-ON* */
+};
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** parse "N[,M]" argument of -k option */
+
+static gboolean
+edit_sort_parse_key (const char *value, edit_sort_options_t * options)
+{
+    char *end;
+    long n;
+
+    if (!g_ascii_isdigit (value[0]))
+        return FALSE;
+
+    n = strtol (value, &end, 10);
+    if (n < 1 || n > G_MAXINT)
+        return FALSE;
+    options->key_start = (int) n;
+
+    if (*end == ',')
+    {
+        if (!g_ascii_isdigit (end[1]))
+            return FALSE;
+
+        n = strtol (end + 1, &end, 10);
+        if (n < 1 || n > G_MAXINT)
+            return FALSE;
+        options->key_end = (int) n;
+    }
+
+    /* character positions and per-key options aren't supported */
+    return (*end == '\0');
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+edit_sort_set_option (char opt, const char *value, edit_sort_options_t * options)
+{
+    switch (opt)
+    {
+    case 'n':
+        options->numeric = TRUE;
+        return TRUE;
+    case 'r':
+        options->reverse = TRUE;
+        return TRUE;
+    case 'u':
+        options->unique = TRUE;
+        return TRUE;
+    case 'f':
+        options->fold_case = TRUE;
+        return TRUE;
+    case 'b':
+        options->ignore_blanks = TRUE;
+        return TRUE;
+    case 'k':
+        /* only one key is supported */
+        return (value != NULL && options->key_start == 0 && edit_sort_parse_key (value, options));
+    case 't':
+        if (value == NULL || value[0] == '\0' || value[1] != '\0')
+            return FALSE;
+        options->separator = (unsigned char) value[0];
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse long option.
+ *
+ * @param argv arguments
+ * @param argc number of arguments
+ * @param i index of option in argv, index of its value if value is the next argument
+ * @param options options to set
+ *
+ * @return TRUE if option is known, FALSE otherwise
+ */
+
+static gboolean
+edit_sort_parse_long_option (char **argv, int argc, int *i, edit_sort_options_t * options)
+{
+    const char *name, *value;
+    size_t len, k;
+
+    name = argv[*i] + 2;
+    value = strchr (name, '=');
+    len = value != NULL ? (size_t) (value - name) : strlen (name);
+
+    for (k = 0; k < G_N_ELEMENTS (edit_sort_long_options); k++)
+        if (strncmp (name, edit_sort_long_options[k].name, len) == 0
+            && edit_sort_long_options[k].name[len] == '\0')
+        {
+            char opt = edit_sort_long_options[k].opt;
+
+            if (opt != 'k' && opt != 't')
+                return (value == NULL && edit_sort_set_option (opt, NULL, options));
+
+            if (value != NULL)
+                value++;
+            else if (*i + 1 < argc)
+                value = argv[++(*i)];
+
+            return edit_sort_set_option (opt, value, options);
+        }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** return end of field which starts at s */
+
+static const char *
+edit_sort_skip_field (const char *s, const char *end, const edit_sort_options_t * options)
+{
+    if (options->separator >= 0)
+    {
+        const char *sep;
+
+        sep = memchr (s, options->separator, end - s);
+        return (sep != NULL ? sep : end);
+    }
+
+    /* field is a run of blanks followed by a run of non-blanks */
+    while (s < end && edit_sort_is_blank (*s))
+        s++;
+    while (s < end && !edit_sort_is_blank (*s))
+        s++;
+
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the key of line.
+ *
+ * @param line line
+ * @param options sort options
+ * @param key_end where to store the end of key
+ *
+ * @return start of key
+ */
+
+static const char *
+edit_sort_find_key (const edit_sort_line_t * line, const edit_sort_options_t * options,
+                    const char **key_end)
+{
+    const char *s = line->text;
+    const char *end = line->text + line->len;
+    int i;
+
+    if (options->key_start > 0)
+    {
+        for (i = 1; i < options->key_start && s < end; i++)
+        {
+            s = edit_sort_skip_field (s, end, options);
+            if (options->separator >= 0 && s < end)
+                s++;
+        }
+
+        if (options->key_end > 0)
+        {
+            const char *e = s;
+
+            for (i = options->key_start; i <= options->key_end && e < end; i++)
+            {
+                if (i != options->key_start && options->separator >= 0)
+                    e++;
+                e = edit_sort_skip_field (e, end, options);
+            }
+            end = e;
+        }
+    }
+
+    if (options->ignore_blanks)
+        while (s < end && edit_sort_is_blank (*s))
+            s++;
+
+    *key_end = end;
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** convert leading number of key as sort -n does: blanks, optional minus, digits and fraction */
+
+static double
+edit_sort_get_number (const char *s, const char *end)
+{
+    double number = 0.0, scale;
+    gboolean negative;
+
+    while (s < end && edit_sort_is_blank (*s))
+        s++;
+
+    negative = s < end && *s == '-';
+    if (negative)
+        s++;
+
+    for (; s < end && g_ascii_isdigit (*s); s++)
+        number = number * 10.0 + (*s - '0');
+
+    if (s < end && *s == '.')
+        for (s++, scale = 0.1; s < end && g_ascii_isdigit (*s); s++, scale /= 10.0)
+            number += (*s - '0') * scale;
+
+    return (negative ? -number : number);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Make keys of lines.
+ *
+ * @param lines lines which follow each other in text
+ * @param n number of lines
+ * @param options sort options
+ *
+ * @return buffer with copies of keys which collation keys are made from, NULL if keys are numeric
+ */
+
+static char *
+edit_sort_make_keys (edit_sort_line_t * lines, size_t n, const edit_sort_options_t * options)
+{
+    char *keys = NULL, *copy = NULL;
+    size_t i;
+
+    if (n == 0)
+        return NULL;
+
+    /* key is a part of line, so copies of all keys with NULs take no more than lines */
+    if (!options->numeric)
+        keys = copy = g_malloc (lines[n - 1].text + lines[n - 1].len - lines[0].text + n);
+
+    for (i = 0; i < n; i++)
+    {
+        const char *start, *end;
+
+        start = edit_sort_find_key (&lines[i], options, &end);
+
+        if (options->numeric)
+            lines[i].number = edit_sort_get_number (start, end);
+        else
+        {
+            memcpy (copy, start, end - start);
+            copy[end - start] = '\0';
+            /* key may be the copy itself */
+            lines[i].key = str_create_key (copy, !options->fold_case);
+            copy += end - start + 1;
+        }
+    }
+
+    return keys;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_sort_free_keys (edit_sort_line_t * lines, size_t n, const edit_sort_options_t * options)
+{
+    size_t i;
+
+    if (options->numeric)
+        return;
+
+    for (i = 0; i < n; i++)
+        str_release_key (lines[i].key, !options->fold_case);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+edit_sort_compare_keys (const edit_sort_line_t * a, const edit_sort_line_t * b,
+                        const edit_sort_options_t * options)
+{
+    if (options->numeric)
+        return (a->number > b->number) - (a->number < b->number);
+
+    return str_key_collate (a->key, b->key, !options->fold_case);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+edit_sort_compare (const edit_sort_line_t * a, const edit_sort_line_t * b,
+                   const edit_sort_options_t * options)
+{
+    int result;
+
+    result = edit_sort_compare_keys (a, b, options);
+
+    /* last resort comparison, unless lines with equal keys are to be dropped */
+    if (result == 0 && !options->unique)
+    {
+        result = memcmp (a->text, b->text, MIN (a->len, b->len));
+        if (result == 0)
+            result = (a->len > b->len) - (a->len < b->len);
+    }
+
+    return (options->reverse ? -result : result);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** merge sorted runs [lo, mid) and [mid, hi) */
+
+static void
+edit_sort_merge (const edit_sort_options_t * options, edit_sort_line_t * lines,
+                 edit_sort_line_t * tmp, size_t lo, size_t mid, size_t hi)
+{
+    size_t i = lo, j = mid, k = lo;
+
+    if (lo == mid || mid == hi || edit_sort_compare (&lines[mid - 1], &lines[mid], options) <= 0)
+        return;
+
+    while (i < mid && j < hi)
+        tmp[k++] = edit_sort_compare (&lines[j], &lines[i], options) < 0 ? lines[j++] : lines[i++];
+    while (i < mid)
+        tmp[k++] = lines[i++];
+
+    /* the rest of the 2nd run is in place already */
+    memcpy (lines + lo, tmp + lo, (k - lo) * sizeof (lines[0]));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_sort_range (const edit_sort_options_t * options, edit_sort_line_t * lines,
+                 edit_sort_line_t * tmp, size_t lo, size_t hi)
+{
+    size_t mid;
+
+    if (hi - lo <= EDIT_SORT_INSERTION_MAX)
+    {
+        size_t i, j;
+
+        for (i = lo + 1; i < hi; i++)
+        {
+            edit_sort_line_t line = lines[i];
+
+            for (j = i; j > lo && edit_sort_compare (&line, &lines[j - 1], options) < 0; j--)
+                lines[j] = lines[j - 1];
+            lines[j] = line;
+        }
+        return;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    edit_sort_range (options, lines, tmp, lo, mid);
+    edit_sort_range (options, lines, tmp, mid, hi);
+    edit_sort_merge (options, lines, tmp, lo, mid, hi);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+edit_sort_job_sort (gpointer data)
+{
+    edit_sort_job_t *job = (edit_sort_job_t *) data;
+
+    job->keys = edit_sort_make_keys (job->lines + job->lo, job->hi - job->lo, job->options);
+    edit_sort_range (job->options, job->lines, job->tmp, job->lo, job->hi);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+edit_sort_job_merge (gpointer data)
+{
+    edit_sort_job_t *job = (edit_sort_job_t *) data;
+
+    edit_sort_merge (job->options, job->lines, job->tmp, job->lo, job->mid, job->hi);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+edit_sort_get_threads (size_t lines)
+{
+    size_t threads = 1;
+
+#if GLIB_CHECK_VERSION (2, 36, 0)
+    threads = MIN ((size_t) g_get_num_processors (), EDIT_SORT_MAX_THREADS);
+    threads = MIN (threads, lines / EDIT_SORT_THREAD_MIN_LINES);
+    threads = MAX (threads, 1);
+#else
+    (void) lines;
+#endif
+
+    return (int) threads;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** run jobs in parallel, the 1st one in the current thread */
+
+static void
+edit_sort_run_jobs (GThreadFunc func, edit_sort_job_t * jobs, int n)
+{
+#if GLIB_CHECK_VERSION (2, 36, 0)
+    GThread *threads[EDIT_SORT_MAX_THREADS];
+    int i;
+
+    for (i = 1; i < n; i++)
+    {
+        threads[i] = g_thread_try_new ("edit-sort", func, &jobs[i], NULL);
+        /* do the job here if thread cannot be created */
+        if (threads[i] == NULL)
+            func (&jobs[i]);
+    }
+
+    func (&jobs[0]);
+
+    for (i = 1; i < n; i++)
+        if (threads[i] != NULL)
+            g_thread_join (threads[i]);
+#else
+    int i;
+
+    for (i = 0; i < n; i++)
+        func (&jobs[i]);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse options of sort command.
+ *
+ * @param args options separated by whitespace, as given to sort(1)
+ * @param options where to store parsed options
+ *
+ * @return TRUE if all options are supported by edit_sort_text(), FALSE otherwise
+ */
+
+gboolean
+edit_sort_parse_options (const char *args, edit_sort_options_t * options)
+{
+    char **argv = NULL;
+    int argc = 0;
+    int i;
+    gboolean ok = TRUE;
+
+    memset (options, 0, sizeof (*options));
+    options->separator = -1;
+
+    while (edit_sort_is_blank (*args))
+        args++;
+
+    if (*args == '\0')
+        return TRUE;
+
+    if (!g_shell_parse_argv (args, &argc, &argv, NULL))
+        return FALSE;
+
+    for (i = 0; ok && i < argc; i++)
+    {
+        const char *a = argv[i];
+
+        if (strncmp (a, "--", 2) == 0)
+            ok = edit_sort_parse_long_option (argv, argc, &i, options);
+        else if (a[0] != '-' || a[1] == '\0')
+            ok = FALSE;         /* file names aren't allowed */
+        else
+            for (a++; ok && *a != '\0'; a++)
+            {
+                const char *value;
+
+                if (*a != 'k' && *a != 't')
+                {
+                    ok = edit_sort_set_option (*a, NULL, options);
+                    continue;
+                }
+
+                /* value is the rest of argument or the next argument */
+                if (a[1] != '\0')
+                    value = a + 1;
+                else
+                    value = i + 1 < argc ? argv[++i] : NULL;
+
+                ok = edit_sort_set_option (*a, value, options);
+                break;
+            }
+    }
+
+    g_strfreev (argv);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort lines of text. Last line of result is terminated by newline even if the last line of text
+ * isn't.
+ *
+ * @param text text to sort
+ * @param len length of text
+ * @param options sort options
+ *
+ * @return sorted text, must be freed with g_string_free()
+ */
+
+GString *
+edit_sort_text (const char *text, size_t len, const edit_sort_options_t * options)
+{
+    GString *result;
+    edit_sort_line_t *lines, *tmp;
+    edit_sort_job_t jobs[EDIT_SORT_MAX_THREADS];
+    char *keys[EDIT_SORT_MAX_THREADS];
+    const char *p, *end = text + len;
+    size_t n, i, last;
+    int threads, runs;
+
+    result = g_string_sized_new (len + 1);
+
+    /* count lines */
+    for (n = 0, p = text; p < end; n++)
+    {
+        p = memchr (p, '\n', end - p);
+        p = p != NULL ? p + 1 : end;
+    }
+
+    if (n == 0)
+        return result;
+
+    lines = g_new0 (edit_sort_line_t, n);
+    tmp = g_new (edit_sort_line_t, n);
+
+    for (i = 0, p = text; p < end; i++)
+    {
+        const char *eol;
+
+        eol = memchr (p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        lines[i].text = p;
+        lines[i].len = eol - p;
+        p = eol + 1;
+    }
+
+    /* sort runs */
+    threads = edit_sort_get_threads (n);
+    for (runs = 0; runs < threads; runs++)
+    {
+        jobs[runs].options = options;
+        jobs[runs].lines = lines;
+        jobs[runs].tmp = tmp;
+        jobs[runs].lo = n * runs / threads;
+        jobs[runs].hi = n * (runs + 1) / threads;
+    }
+
+    edit_sort_run_jobs (edit_sort_job_sort, jobs, threads);
+
+    for (runs = 0; runs < threads; runs++)
+        keys[runs] = jobs[runs].keys;
+
+    /* merge runs pairwise until one run remains */
+    while (runs > 1)
+    {
+        int pairs = runs / 2;
+        int k;
+
+        for (k = 0; k < pairs; k++)
+        {
+            jobs[k].lo = jobs[2 * k].lo;
+            jobs[k].mid = jobs[2 * k].hi;
+            jobs[k].hi = jobs[2 * k + 1].hi;
+        }
+
+        edit_sort_run_jobs (edit_sort_job_merge, jobs, pairs);
+
+        if (runs % 2 != 0)
+        {
+            jobs[pairs] = jobs[runs - 1];
+            pairs++;
+        }
+        runs = pairs;
+    }
+
+    for (i = 0, last = 0; i < n; i++)
+    {
+        if (options->unique && i != 0
+            && edit_sort_compare_keys (&lines[last], &lines[i], options) == 0)
+            continue;
+
+        g_string_append_len (result, lines[i].text, lines[i].len);
+        g_string_append_c (result, '\n');
+        last = i;
+    }
+
+    edit_sort_free_keys (lines, n, options);
+    for (runs = 0; runs < threads; runs++)
+        g_free (keys[runs]);
+    g_free (tmp);
+    g_free (lines);
+
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,34 @@
+#ifndef MC__EDIT_SORT_H
+#define MC__EDIT_SORT_H 1
+
+#include <sys/types.h>          /* size_t */
+#include "lib/global.h"         /* include <glib.h> */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/* subset of sort(1) options that built-in sort understands */
+typedef struct edit_sort_options_struct
+{
+    gboolean numeric;           /* -n: compare keys as numbers */
+    gboolean reverse;           /* -r: reverse the result of comparisons */
+    gboolean unique;            /* -u: output only the first of lines with equal keys */
+    gboolean fold_case;         /* -f: compare keys case insensitively */
+    gboolean ignore_blanks;     /* -b: ignore leading blanks of keys */
+    int key_start;              /* -k N[,M]: first field of key (1-based), 0 for whole line */
+    int key_end;                /* last field of key, 0 for end of line */
+    int separator;              /* -t C: field separator, -1 for blank-separated fields */
+} edit_sort_options_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean edit_sort_parse_options (const char *args, edit_sort_options_t * options);
+GString *edit_sort_text (const char *text, size_t len, const edit_sort_options_t * options);
+
+/*** inline functions ****************************************************************************/
+#endif /* MC__EDIT_SORT_H */
@@ -0,0 +1,406 @@
+/*
+   Editor list of misspelled words.
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor list of misspelled words.
+ */
+
+#include <config.h>
+
+#if defined(HAVE_ASPELL)
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+#ifdef HAVE_CHARSET
+#include "lib/charsets.h"       /* str_convert_to_display() */
+#endif
+
+#include "edit-impl.h"
+#include "editwords.h"          /* edit_word_index_is_word_char() */
+#include "spell.h"
+#include "editspell.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * Text is checked piece by piece from the start while user doesn't type: all words before
+ * 'checked' offset are checked, offsets of misspelled ones are kept sorted. Words of a piece are
+ * collected first, and every distinct word is checked once. Speller keeps results for every
+ * dictionary, so common words aren't looked up in dictionary again.
+ *
+ * A change of text checks words touched by it again and moves the following misspelled words.
+ * Results are dropped when dictionary is changed.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* longer words aren't checked */
+#define EDIT_SPELL_WORD_MAX_LEN 64
+
+#define SPELL_RANGE(a, i) (&g_array_index ((a), edit_spell_range_t, (i)))
+
+/*** file scope type declarations ****************************************************************/
+
+/* word of text */
+typedef struct
+{
+    off_t start;
+    off_t len;
+    guint word;                 /* index of distinct word */
+} edit_spell_word_t;
+
+/* collects words of text */
+typedef struct
+{
+    GHashTable *seen;           /* word -> index of distinct word + 1 */
+    GPtrArray *words;           /* distinct words to check */
+    GArray *found;              /* edit_spell_word_t */
+    GString *word;              /* current word */
+    off_t start;                /* offset of current word */
+    gboolean skip;              /* current word isn't checked */
+} edit_spell_scanner_t;
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_spell_scanner_flush (edit_spell_scanner_t * s)
+{
+    edit_spell_word_t w;
+    gpointer n;
+
+    if (!s->skip && s->word->len != 0)
+    {
+        n = g_hash_table_lookup (s->seen, s->word->str);
+        if (n == NULL)
+        {
+            char *word;
+
+#ifdef HAVE_CHARSET
+            if (mc_global.source_codepage >= 0
+                && mc_global.source_codepage != mc_global.display_codepage)
+                word = g_string_free (str_convert_to_display (s->word->str), FALSE);
+            else
+#endif
+                word = g_strndup (s->word->str, s->word->len);
+
+            g_ptr_array_add (s->words, word);
+            n = GUINT_TO_POINTER (s->words->len);
+            g_hash_table_insert (s->seen, g_strndup (s->word->str, s->word->len), n);
+        }
+
+        w.start = s->start;
+        w.len = (off_t) s->word->len;
+        w.word = GPOINTER_TO_UINT (n) - 1;
+        g_array_append_val (s->found, w);
+    }
+
+    g_string_set_size (s->word, 0);
+    s->skip = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check words of text.
+ *
+ * @param buf editor buffer
+ * @param start offset of the first word
+ * @param end offset after the last word
+ * @param misspelled array to append misspelled words to
+ *
+ * @return FALSE if spell checking isn't available, TRUE otherwise
+ */
+
+static gboolean
+edit_spell_check_range (const edit_buffer_t * buf, off_t start, off_t end, GArray * misspelled)
+{
+    edit_spell_scanner_t s;
+    gboolean *correct;
+    gboolean ret;
+    off_t pos;
+    guint i;
+
+    s.seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    s.words = g_ptr_array_new_with_free_func (g_free);
+    s.found = g_array_new (FALSE, FALSE, sizeof (edit_spell_word_t));
+    s.word = g_string_sized_new (EDIT_SPELL_WORD_MAX_LEN + 1);
+    s.start = start;
+    s.skip = FALSE;
+
+    for (pos = start; pos < end;)
+    {
+        const char *p;
+        off_t len;
+
+        p = edit_buffer_get_span (buf, pos, &len);
+        len = MIN (len, end - pos);
+
+        for (i = 0; i < len; i++, pos++)
+        {
+            int c = (unsigned char) p[i];
+
+            if (!edit_word_index_is_word_char (c))
+                edit_spell_scanner_flush (&s);
+            else
+            {
+                if (s.word->len == 0 && !s.skip)
+                    s.start = pos;
+
+                /* numbers and too long words aren't checked */
+                if (s.skip || (c >= '0' && c <= '9') || s.word->len >= EDIT_SPELL_WORD_MAX_LEN)
+                    s.skip = TRUE;
+                else
+                    g_string_append_c (s.word, (char) c);
+            }
+        }
+    }
+
+    edit_spell_scanner_flush (&s);
+
+    /* check all distinct words at once */
+    correct = g_new (gboolean, s.words->len + 1);
+    ret = aspell_check_words (s.words, correct);
+
+    if (ret)
+        for (i = 0; i < s.found->len; i++)
+        {
+            const edit_spell_word_t *w;
+
+            w = &g_array_index (s.found, edit_spell_word_t, i);
+            if (!correct[w->word])
+            {
+                edit_spell_range_t r;
+
+                r.start = w->start;
+                r.len = w->len;
+                g_array_append_val (misspelled, r);
+            }
+        }
+
+    g_free (correct);
+    g_string_free (s.word, TRUE);
+    g_array_free (s.found, TRUE);
+    g_ptr_array_free (s.words, TRUE);
+    g_hash_table_destroy (s.seen);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize empty list of misspelled words.
+ *
+ * @param spell list of misspelled words
+ */
+
+void
+edit_spell_init (edit_spell_t * spell)
+{
+    spell->checked = 0;
+    spell->misspelled = g_array_new (FALSE, FALSE, sizeof (edit_spell_range_t));
+    spell->generation = aspell_get_generation ();
+    spell->disabled = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free memory of list of misspelled words.
+ *
+ * @param spell list of misspelled words
+ */
+
+void
+edit_spell_clean (edit_spell_t * spell)
+{
+    if (spell->misspelled != NULL)
+        g_array_free (spell->misspelled, TRUE);
+    spell->misspelled = NULL;
+    spell->checked = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check if all text is checked with the current dictionary.
+ *
+ * @param spell list of misspelled words
+ * @param buf editor buffer
+ *
+ * @return TRUE if nothing is left to check
+ */
+
+gboolean
+edit_spell_is_done (const edit_spell_t * spell, const edit_buffer_t * buf)
+{
+    return (spell->generation == aspell_get_generation ()
+            && (spell->disabled || spell->checked >= buf->size));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check next part of text.
+ *
+ * @param spell list of misspelled words
+ * @param buf editor buffer
+ * @param limit how many bytes to check, negative value means up to end of text. The word at
+ *              the end of part is always checked as whole.
+ *
+ * @return TRUE if all text is checked, FALSE otherwise
+ */
+
+gboolean
+edit_spell_build (edit_spell_t * spell, const edit_buffer_t * buf, off_t limit)
+{
+    off_t end;
+
+    if (spell->generation != aspell_get_generation ())
+    {
+        /* dictionary is changed */
+        g_array_set_size (spell->misspelled, 0);
+        spell->checked = 0;
+        spell->generation = aspell_get_generation ();
+        spell->disabled = FALSE;
+    }
+
+    if (spell->disabled || spell->checked >= buf->size)
+        return TRUE;
+
+    end = limit < 0 ? buf->size : MIN (buf->size, spell->checked + limit);
+    while (end < buf->size && edit_word_index_is_word_char (edit_buffer_get_byte (buf, end)))
+        end++;
+
+    if (!edit_spell_check_range (buf, spell->checked, end, spell->misspelled))
+    {
+        /* spell checking isn't available: wait for dictionary */
+        g_array_set_size (spell->misspelled, 0);
+        spell->checked = 0;
+        spell->disabled = TRUE;
+        return TRUE;
+    }
+
+    spell->checked = end;
+
+    return (spell->checked >= buf->size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update list after the text was changed. The buffer must already contain the new text.
+ *
+ * @param spell list of misspelled words
+ * @param buf editor buffer
+ * @param offset offset of change
+ * @param del_len number of deleted bytes
+ * @param ins_len number of bytes inserted at offset
+ */
+
+void
+edit_spell_update (edit_spell_t * spell, const edit_buffer_t * buf, off_t offset, off_t del_len,
+                   off_t ins_len)
+{
+    GArray *misspelled = spell->misspelled;
+    GArray *found;
+    off_t left, right, old_right, delta;
+    guint i, j;
+
+    /* find words touched by change */
+    left = offset;
+    while (left > 0 && edit_word_index_is_word_char (edit_buffer_get_byte (buf, left - 1)))
+        left--;
+
+    /* change after the checked part will be checked later */
+    if (left >= spell->checked)
+        return;
+
+    right = offset + ins_len;
+    while (right < buf->size && edit_word_index_is_word_char (edit_buffer_get_byte (buf, right)))
+        right++;
+
+    delta = ins_len - del_len;
+    old_right = right - delta;
+
+    /* forget old words */
+    i = edit_spell_lookup (spell, left);
+    for (j = i; j < misspelled->len && SPELL_RANGE (misspelled, j)->start < old_right; j++)
+        ;
+    g_array_remove_range (misspelled, i, j - i);
+
+    if (old_right > spell->checked || right - left > EDIT_SPELL_STEP)
+    {
+        /* change crosses the end of checked part or is too big: the rest will be checked later */
+        g_array_set_size (misspelled, i);
+        spell->checked = left;
+        return;
+    }
+
+    for (j = i; j < misspelled->len; j++)
+        SPELL_RANGE (misspelled, j)->start += delta;
+    spell->checked += delta;
+
+    /* check new words */
+    found = g_array_new (FALSE, FALSE, sizeof (edit_spell_range_t));
+    if (edit_spell_check_range (buf, left, right, found) && found->len != 0)
+        g_array_insert_vals (misspelled, i, found->data, found->len);
+    g_array_free (found, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find misspelled word.
+ *
+ * @param spell list of misspelled words
+ * @param offset offset
+ *
+ * @return position of the first misspelled word which ends after offset in the list
+ */
+
+guint
+edit_spell_lookup (const edit_spell_t * spell, off_t offset)
+{
+    guint lo = 0, hi = spell->misspelled->len;
+
+    while (lo < hi)
+    {
+        guint mid;
+        const edit_spell_range_t *r;
+
+        mid = lo + (hi - lo) / 2;
+        r = SPELL_RANGE (spell->misspelled, mid);
+        if (r->start + r->len <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* HAVE_ASPELL */
@@ -0,0 +1,75 @@
+/** \file
+ *  \brief Header: misspelled words of WEdit buffer
+ */
+
+#ifndef MC__EDIT_SPELL_H
+#define MC__EDIT_SPELL_H
+
+#include "editbuffer.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* how many bytes of text are checked in one step in background */
+#define EDIT_SPELL_STEP (64 * 1024)
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_spell_range_struct
+{
+    off_t start;
+    off_t len;
+} edit_spell_range_t;
+
+typedef struct edit_spell_struct
+{
+    off_t checked;              /* all words before this offset are checked */
+    GArray *misspelled;         /* edit_spell_range_t of misspelled words, sorted by offset */
+    unsigned int generation;    /* aspell_get_generation() the results are valid for */
+    gboolean disabled;          /* no dictionary to check words */
+} edit_spell_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void edit_spell_init (edit_spell_t * spell);
+void edit_spell_clean (edit_spell_t * spell);
+
+gboolean edit_spell_is_done (const edit_spell_t * spell, const edit_buffer_t * buf);
+gboolean edit_spell_build (edit_spell_t * spell, const edit_buffer_t * buf, off_t limit);
+void edit_spell_update (edit_spell_t * spell, const edit_buffer_t * buf, off_t offset,
+                        off_t del_len, off_t ins_len);
+guint edit_spell_lookup (const edit_spell_t * spell, off_t offset);
+
+/*** inline functions ****************************************************************************/
+
+/**
+ * Check if byte belongs to misspelled word. Offsets must be checked in increasing order.
+ *
+ * @param spell misspelled words
+ * @param offset offset of byte
+ * @param i position in list of misspelled words, initialized by edit_spell_lookup()
+ *
+ * @return TRUE if byte at offset belongs to misspelled word
+ */
+
+static inline gboolean
+edit_spell_is_misspelled (const edit_spell_t * spell, off_t offset, guint * i)
+{
+    const edit_spell_range_t *r;
+
+    for (; *i < spell->misspelled->len; (*i)++)
+    {
+        r = &g_array_index (spell->misspelled, edit_spell_range_t, *i);
+        if (offset < r->start + r->len)
+            return (offset >= r->start);
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* MC__EDIT_SPELL_H */
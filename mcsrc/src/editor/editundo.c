@@ -0,0 +1,406 @@
+/*
+   Editor undo/redo log.
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor undo/redo log.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+
+#include "editundo.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * The log is a stack of records. Every record is one reverse action: an action which undoes
+ * some change of text, cursor or markers. Repeated identical actions are merged into one record
+ * by adding up their counters, so a typed word, a run of deletions or a block paste costs one
+ * record, not one per byte.
+ *
+ * Bytes removed from the text are kept in one arena in the order they were pushed. Every
+ * EDIT_UNDO_INSERT* record owns the last 'value' bytes of arena at the moment it is on top.
+ * EDIT_UNDO_INSERT text is stored reversed (backspace removes bytes from right to left), so
+ * that the following backspaces could be appended to the same record.
+ *
+ *   records: |KEY_PRESS 0|INSERT_AHEAD 3|KEY_PRESS 0|BACKSPACE 5|KEY_PRESS 12|INSERT 2|
+ *   text:    |a b c|y x|
+ *
+ * Records of one user action start with EDIT_UNDO_KEY_PRESS. When the log grows over the limit,
+ * the oldest user actions are dropped as a whole. Memory used by log is proportional to count
+ * of changed bytes.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* how many records are dropped when log overflows: all but this part of limit */
+#define EDIT_UNDO_TRIM_TO(limit) ((limit) / 4 * 3)
+
+/* records of one user action besides its text: key press, markers, cursor movements */
+#define EDIT_UNDO_ACTION_RECORDS 16
+
+/*** file scope type declarations ****************************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+edit_undo_action_has_text (edit_undo_action_t action)
+{
+    return (action == EDIT_UNDO_INSERT || action == EDIT_UNDO_INSERT_AHEAD);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline edit_undo_record_t *
+edit_undo_log_get_top (const edit_undo_log_t * log)
+{
+    if (log->records->len == 0)
+        return NULL;
+
+    return &g_array_index (log->records, edit_undo_record_t, log->records->len - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop the oldest user actions to fit log in its limit. If the current action doesn't fit in
+ * the limit alone, log is cleared and the rest of current action isn't recorded.
+ *
+ * @param log undo log
+ */
+
+static void
+edit_undo_log_trim (edit_undo_log_t * log)
+{
+    gsize size, i, cut = 0, cut_text = 0, text_len = 0;
+
+    size = edit_undo_log_get_size (log);
+
+    for (i = 0; i < log->records->len; i++)
+    {
+        const edit_undo_record_t *r;
+
+        r = &g_array_index (log->records, edit_undo_record_t, i);
+
+        if (i != 0 && r->action == EDIT_UNDO_KEY_PRESS)
+        {
+            cut = i;
+            cut_text = text_len;
+            if (size <= EDIT_UNDO_TRIM_TO (log->limit))
+                break;
+        }
+
+        size -= sizeof (edit_undo_record_t);
+        if (edit_undo_action_has_text (r->action))
+        {
+            size -= (gsize) r->value;
+            text_len += (gsize) r->value;
+        }
+    }
+
+    if (cut != 0)
+    {
+        g_array_remove_range (log->records, 0, cut);
+        g_byte_array_remove_range (log->text, 0, cut_text);
+    }
+
+    if (edit_undo_log_get_size (log) > log->limit)
+    {
+        edit_undo_log_clear (log);
+        log->overflow = TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize undo log.
+ *
+ * @param log undo log
+ * @param limit upper limit of memory used by log, in bytes
+ */
+
+void
+edit_undo_log_init (edit_undo_log_t * log, gsize limit)
+{
+    log->records = g_array_new (FALSE, FALSE, sizeof (edit_undo_record_t));
+    log->text = g_byte_array_new ();
+    log->limit = limit;
+    log->overflow = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free memory of undo log.
+ *
+ * @param log undo log
+ */
+
+void
+edit_undo_log_clean (edit_undo_log_t * log)
+{
+    if (log->records != NULL)
+        g_array_free (log->records, TRUE);
+    if (log->text != NULL)
+        g_byte_array_free (log->text, TRUE);
+    log->records = NULL;
+    log->text = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove all records from undo log.
+ *
+ * @param log undo log
+ */
+
+void
+edit_undo_log_clear (edit_undo_log_t * log)
+{
+    g_array_set_size (log->records, 0);
+    g_byte_array_set_size (log->text, 0);
+    log->overflow = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Push action without text onto undo log. Action is merged with the top record if possible.
+ *
+ * @param log undo log
+ * @param action action
+ * @param value counter of action (cursor moves, deleted bytes) or position
+ */
+
+void
+edit_undo_log_push (edit_undo_log_t * log, edit_undo_action_t action, off_t value)
+{
+    edit_undo_record_t *top;
+    edit_undo_record_t r;
+
+    if (action == EDIT_UNDO_KEY_PRESS)
+        log->overflow = FALSE;
+    else if (log->overflow)
+        return;
+
+    top = edit_undo_log_get_top (log);
+
+    if (top != NULL && top->action == action)
+        switch (action)
+        {
+        case EDIT_UNDO_KEY_PRESS:
+            /* user action did nothing: merge it with the next one */
+            top->value = value;
+            return;
+        case EDIT_UNDO_CURS_LEFT:
+        case EDIT_UNDO_CURS_RIGHT:
+        case EDIT_UNDO_BACKSPACE:
+        case EDIT_UNDO_BACKSPACE_BR:
+        case EDIT_UNDO_DELCHAR:
+        case EDIT_UNDO_DELCHAR_BR:
+            top->value += value;
+            return;
+        case EDIT_UNDO_COLUMN_ON:
+        case EDIT_UNDO_COLUMN_OFF:
+        case EDIT_UNDO_MARK_1:
+        case EDIT_UNDO_MARK_2:
+        case EDIT_UNDO_MARK_CURS:
+            /* the older state is restored anyway */
+            return;
+        default:
+            break;
+        }
+
+    r.action = action;
+    r.value = value;
+    g_array_append_val (log->records, r);
+
+    if (edit_undo_log_get_size (log) > log->limit)
+        edit_undo_log_trim (log);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Push deleted text onto undo log. Text is appended to the top record if it has the same action.
+ *
+ * @param log undo log
+ * @param action EDIT_UNDO_INSERT or EDIT_UNDO_INSERT_AHEAD
+ * @param text deleted bytes in order they were in the editor buffer
+ * @param len number of bytes
+ */
+
+void
+edit_undo_log_push_text (edit_undo_log_t * log, edit_undo_action_t action, const char *text,
+                         off_t len)
+{
+    edit_undo_record_t *top;
+
+    if (log->overflow || len <= 0)
+        return;
+
+    if (action == EDIT_UNDO_INSERT)
+    {
+        guint8 *p;
+        off_t i;
+
+        /* backspace removes text from right to left */
+        g_byte_array_set_size (log->text, log->text->len + len);
+        p = log->text->data + log->text->len - len;
+        for (i = 0; i < len; i++)
+            p[i] = (guint8) text[len - 1 - i];
+    }
+    else
+        g_byte_array_append (log->text, (const guint8 *) text, len);
+
+    top = edit_undo_log_get_top (log);
+
+    if (top != NULL && top->action == action)
+        top->value += len;
+    else
+    {
+        edit_undo_record_t r;
+
+        r.action = action;
+        r.value = len;
+        g_array_append_val (log->records, r);
+    }
+
+    if (edit_undo_log_get_size (log) > log->limit)
+        edit_undo_log_trim (log);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Pop the top record from undo log.
+ *
+ * @param log undo log
+ * @param record where to store the record
+ * @param text where to store pointer to text of EDIT_UNDO_INSERT* record. Text is valid until
+ *             the next push onto this log. May be NULL.
+ *
+ * @return FALSE if log is empty, TRUE otherwise
+ */
+
+gboolean
+edit_undo_log_pop (edit_undo_log_t * log, edit_undo_record_t * record, const char **text)
+{
+    edit_undo_record_t *top;
+
+    top = edit_undo_log_get_top (log);
+    if (top == NULL)
+        return FALSE;
+
+    *record = *top;
+    g_array_set_size (log->records, log->records->len - 1);
+
+    if (text != NULL)
+        *text = NULL;
+
+    if (edit_undo_action_has_text (record->action))
+    {
+        guint8 *p;
+
+        /* array is shrunk in place: data is kept until the next push */
+        g_byte_array_set_size (log->text, log->text->len - record->value);
+        p = log->text->data + log->text->len;
+
+        if (record->action == EDIT_UNDO_INSERT)
+        {
+            off_t i, j;
+
+            for (i = 0, j = record->value - 1; i < j; i++, j--)
+            {
+                guint8 c = p[i];
+
+                p[i] = p[j];
+                p[j] = c;
+            }
+        }
+
+        if (text != NULL)
+            *text = (const char *) p;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get action of the top record of undo log.
+ *
+ * @param log undo log
+ *
+ * @return action of the top record, EDIT_UNDO_NONE if log is empty
+ */
+
+edit_undo_action_t
+edit_undo_log_top (const edit_undo_log_t * log)
+{
+    const edit_undo_record_t *top;
+
+    top = edit_undo_log_get_top (log);
+
+    return (top == NULL ? EDIT_UNDO_NONE : top->action);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get memory used by undo log.
+ *
+ * @param log undo log
+ *
+ * @return size of records and text, in bytes
+ */
+
+gsize
+edit_undo_log_get_size (const edit_undo_log_t * log)
+{
+    return log->records->len * sizeof (edit_undo_record_t) + log->text->len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether an action which deletes text can be undone.
+ *
+ * @param log undo log
+ * @param len number of deleted bytes
+ *
+ * @return TRUE if the action fits in the limit of log
+ */
+
+gboolean
+edit_undo_log_can_keep (const edit_undo_log_t * log, off_t len)
+{
+    gsize records = EDIT_UNDO_ACTION_RECORDS * sizeof (edit_undo_record_t);
+
+    return (len >= 0 && (guint64) len + records <= log->limit);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,67 @@
+/** \file
+ *  \brief Header: undo/redo log for WEdit
+ */
+
+#ifndef MC__EDIT_UNDO_H
+#define MC__EDIT_UNDO_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/* Actions which restore the previous state of editor. Every record keeps one action. */
+typedef enum
+{
+    EDIT_UNDO_NONE = 0,         /* log is empty */
+    EDIT_UNDO_KEY_PRESS,        /* start of user action, value is start_display */
+    EDIT_UNDO_CURS_LEFT,        /* move cursor left by value bytes */
+    EDIT_UNDO_CURS_RIGHT,       /* move cursor right by value bytes */
+    EDIT_UNDO_BACKSPACE,        /* delete value bytes before cursor */
+    EDIT_UNDO_BACKSPACE_BR,     /* same, bytes are spaces or control chars */
+    EDIT_UNDO_DELCHAR,          /* delete value bytes after cursor */
+    EDIT_UNDO_DELCHAR_BR,       /* same, bytes are spaces or control chars */
+    EDIT_UNDO_INSERT,           /* insert value bytes of text before cursor */
+    EDIT_UNDO_INSERT_AHEAD,     /* insert value bytes of text after cursor */
+    EDIT_UNDO_COLUMN_ON,        /* turn column highlighting on */
+    EDIT_UNDO_COLUMN_OFF,       /* turn column highlighting off */
+    EDIT_UNDO_MARK_1,           /* set mark1 to value */
+    EDIT_UNDO_MARK_2,           /* set mark2 to value */
+    EDIT_UNDO_MARK_CURS         /* set end_mark_curs to value */
+} edit_undo_action_t;
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_undo_record_struct
+{
+    off_t value;                /* count of bytes, position or start_display */
+    edit_undo_action_t action;
+} edit_undo_record_t;
+
+typedef struct edit_undo_log_struct
+{
+    GArray *records;            /* edit_undo_record_t, the last pushed record is on top */
+    GByteArray *text;           /* deleted bytes of all EDIT_UNDO_INSERT* records */
+    gsize limit;                /* upper limit of memory used by log, in bytes */
+    gboolean overflow;          /* current action doesn't fit in log: skip it up to next key press */
+} edit_undo_log_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void edit_undo_log_init (edit_undo_log_t * log, gsize limit);
+void edit_undo_log_clean (edit_undo_log_t * log);
+void edit_undo_log_clear (edit_undo_log_t * log);
+
+void edit_undo_log_push (edit_undo_log_t * log, edit_undo_action_t action, off_t value);
+void edit_undo_log_push_text (edit_undo_log_t * log, edit_undo_action_t action, const char *text,
+                              off_t len);
+gboolean edit_undo_log_pop (edit_undo_log_t * log, edit_undo_record_t * record,
+                            const char **text);
+edit_undo_action_t edit_undo_log_top (const edit_undo_log_t * log);
+gsize edit_undo_log_get_size (const edit_undo_log_t * log);
+gboolean edit_undo_log_can_keep (const edit_undo_log_t * log, off_t len);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_UNDO_H */
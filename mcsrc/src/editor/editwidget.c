@@ -937,6 +937,41 @@ edit_dialog_mouse_callback (Widget * w, mouse_msg_t msg, mouse_event_t * event)
     event->result.abort = unhandled;
 }
 
+#ifdef HAVE_ASPELL
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check spelling of the next part of text, redraw page if misspelled words on it may change.
+ *
+ * @param edit editor object
+ *
+ * @return TRUE if all text is checked
+ */
+
+static gboolean
+edit_spell_idle (WEdit * edit)
+{
+    off_t checked = edit->spell.checked;
+    unsigned int generation = edit->spell.generation;
+    gboolean done;
+
+    done = edit_spell_build (&edit->spell, &edit->buffer, EDIT_SPELL_STEP);
+
+    if (edit->spell.generation != generation)
+        edit->force |= REDRAW_PAGE;
+    else if (edit->spell.checked != checked)
+    {
+        off_t screen_end;
+
+        screen_end = edit_buffer_get_forward_offset (&edit->buffer, edit->start_display,
+                                                     WIDGET (edit)->lines, 0);
+        if (checked <= screen_end && edit->spell.checked > edit->start_display)
+            edit->force |= REDRAW_PAGE;
+    }
+
+    return done;
+}
+
+#endif /* HAVE_ASPELL */
 /* --------------------------------------------------------------------------------------------- */
 
 static cb_ret_t
@@ -948,6 +983,14 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
     {
     case MSG_FOCUS:
         edit_set_buttonbar (e, find_buttonbar (w->owner));
+        /* large file may be changed while the user worked with other windows */
+        edit_check_mapped_file (e);
+        if (e->word_index.indexed < e->buffer.size || e->bracket_index.indexed < e->buffer.size)
+            widget_idle (WIDGET (w->owner), TRUE);
+#ifdef HAVE_ASPELL
+        if (!edit_spell_is_done (&e->spell, &e->buffer))
+            widget_idle (WIDGET (w->owner), TRUE);
+#endif
         return MSG_HANDLED;
 
     case MSG_DRAW:
@@ -995,7 +1038,16 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
         }
 
     case MSG_IDLE:
+#ifdef HAVE_ASPELL
+        /* check spelling while user doesn't type */
+        if (!edit_spell_idle (e))
+            widget_idle (WIDGET (w->owner), TRUE);
+#endif
         edit_update_screen (e);
+        /* index words for completion and brackets while user doesn't type */
+        if (!edit_word_index_build (&e->word_index, &e->buffer, EDIT_WORD_INDEX_STEP)
+            || !edit_bracket_index_build (e, e->buffer.size, EDIT_BRACKET_INDEX_STEP))
+            widget_idle (WIDGET (w->owner), TRUE);
         return MSG_HANDLED;
 
     case MSG_DESTROY:
@@ -1381,6 +1433,9 @@ edit_add_window (WDialog * h, int y, int x, int lines, int cols, const vfs_path_
     edit_set_buttonbar (edit, find_buttonbar (h));
     dlg_redraw (h);
 
+    /* start indexing of words in background */
+    widget_idle (WIDGET (h), TRUE);
+
     return TRUE;
 }
 
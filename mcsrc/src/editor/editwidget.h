@@ -10,11 +10,12 @@
 
 #include "edit-impl.h"
 #include "editbuffer.h"
+#include "editwords.h"
+#include "editbrackets.h"
+#include "editspell.h"
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
-#define N_LINE_CACHES 32
-
 /*** enums ***************************************************************************************/
 
 /**
@@ -81,6 +82,7 @@ struct WEdit
     /* multibyte support */
     gboolean utf8;              /* It's multibyte file codeset */
     GIConv converter;
+    int utf_table[256];         /* 8-bit codepage of file -> Unicode */
     char charbuf[4 + 1];
     int charpoint;
 #endif
@@ -103,7 +105,11 @@ struct WEdit
     long curs_row;              /* row position of cursor on the screen */
     long curs_col;              /* column position on screen */
     long over_col;              /* pos after '\n' */
+    struct edit_column_cache_struct *column_cache;      /* checkpoints of columns of long lines */
     int force;                  /* how much of the screen do we redraw? */
+    GArray *screen;             /* rows of text area as they are drawn on the screen */
+    unsigned long drawn_lines;  /* number of rows changed on the screen by last redraw */
+    unsigned long drawn_cells;  /* number of cells changed on the screen by last redraw */
     unsigned int overwrite:1;   /* Overwrite on type mode (as opposed to insert) */
     unsigned int modified:1;    /* File has been modified and needs saving */
     unsigned int loading_done:1;        /* File has been loaded into the editor */
@@ -125,35 +131,30 @@ struct WEdit
     off_t bracket;              /* position of a matching bracket */
     off_t last_bracket;         /* previous position of a matching bracket */
 
-    /* cache speedup for line lookups */
-    gboolean caches_valid;
-    long line_numbers[N_LINE_CACHES];
-    off_t line_offsets[N_LINE_CACHES];
-
     edit_book_mark_t *book_mark;
     GArray *serialized_bookmarks;
 
-    /* undo stack and pointers */
-    unsigned long undo_stack_pointer;
-    long *undo_stack;
-    unsigned long undo_stack_size;
-    unsigned long undo_stack_size_mask;
-    unsigned long undo_stack_bottom;
-    unsigned int undo_stack_disable:1;  /* If not 0, don't save events in the undo stack */
-
-    unsigned long redo_stack_pointer;
-    long *redo_stack;
-    unsigned long redo_stack_size;
-    unsigned long redo_stack_size_mask;
-    unsigned long redo_stack_bottom;
-    unsigned int redo_stack_reset:1;    /* If 1, need clear redo stack */
+    /* undo and redo logs */
+    edit_undo_log_t undo_log;
+    edit_undo_log_t redo_log;
+    unsigned int undo_stack_disable:1;  /* If not 0, save events in the redo log, not undo one */
+    unsigned int redo_stack_reset:1;    /* If 1, need clear redo log */
+
+    edit_word_index_t word_index;       /* words of text for word completion */
+    edit_bracket_index_t bracket_index; /* brackets of code for bracket matching */
+#ifdef HAVE_ASPELL
+    edit_spell_t spell;         /* misspelled words of text */
+#endif
 
     struct stat stat1;          /* Result of mc_fstat() on the file */
     unsigned int skip_detach_prompt:1;  /* Do not prompt whether to detach a file anymore */
 
     /* syntax higlighting */
-    GSList *syntax_marker;
+    GArray *syntax_marker;      /* checkpoints of highlighting state, sorted by offset */
+    GArray *syntax_marker_old;  /* checkpoints after changed text to be verified, reversed */
+    off_t syntax_marker_shift;  /* offset shift of syntax_marker_old */
     GPtrArray *rules;
+    struct syntax_rule_set_struct *rule_set;    /* shared rules, NULL if rules are not shared */
     off_t last_get_rule;
     edit_syntax_rule_t rule;
     char *syntax_type;          /* description of syntax highlighting type being used */
@@ -0,0 +1,560 @@
+/*
+   Editor word index for word completion.
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor word index for word completion.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "lib/global.h"
+
+#include "edit-impl.h"          /* is_break_char() */
+#include "editwords.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * Index keeps all words of text with their counts of occurrences. Word is a run of bytes which
+ * aren't break chars, as the word to be completed is found by edit_find_word_start().
+ *
+ * Index is built piece by piece from the start of text: all words before 'indexed' offset are
+ * counted. Every change of text is applied to index when it's made: words around the changed
+ * region are counted again, so that typing a char costs a couple of hash lookups.
+ *
+ *   "foo bar|baz"   insert 'x' at cursor:  barbaz -1, barxbaz +1
+ *
+ * Array of words sorted alphabetically is used for prefix lookups. It is built at the first
+ * lookup. After that new words are appended to its end and removed ones are left in place with
+ * zero count, so that typing doesn't move the whole array. Before the next lookup the appended
+ * words are sorted and merged into the array and the removed ones are dropped.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/*** file scope type declarations ****************************************************************/
+
+/* splits text into words and adds them to index or removes them from it */
+typedef struct
+{
+    edit_word_index_t *index;
+    int delta;                  /* +1 to add words, -1 to remove them */
+    off_t pos;                  /* offset of the next byte */
+    off_t limit;                /* skip words which end after this offset */
+    gsize len;                  /* length of current word, EDIT_WORD_MAX_LEN + 1 if too long */
+    char word[EDIT_WORD_MAX_LEN + 1];
+} edit_word_scanner_t;
+
+/*** file scope variables ************************************************************************/
+
+static gboolean word_chars[256];
+static gboolean word_chars_init = FALSE;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+edit_word_compare (gconstpointer a, gconstpointer b)
+{
+    const edit_word_t *wa = *(const edit_word_t * const *) a;
+    const edit_word_t *wb = *(const edit_word_t * const *) b;
+
+    return strcmp (wa->word, wb->word);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** more frequent words first */
+
+static int
+edit_word_compare_count (gconstpointer a, gconstpointer b)
+{
+    const edit_word_t *wa = *(const edit_word_t * const *) a;
+    const edit_word_t *wb = *(const edit_word_t * const *) b;
+
+    if (wa->count != wb->count)
+        return (wa->count > wb->count ? -1 : 1);
+
+    return strcmp (wa->word, wb->word);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find position of word in sorted array.
+ *
+ * @param sorted array of words sorted alphabetically
+ * @param word word
+ * @param len length of word to compare, or -1 to compare whole word
+ *
+ * @return index of the first word which isn't less than word
+ */
+
+static guint
+edit_word_index_lower_bound (const GPtrArray * sorted, const char *word, gssize len)
+{
+    guint lo = 0, hi = sorted->len;
+
+    while (lo < hi)
+    {
+        guint mid;
+        const edit_word_t *w;
+        int cmp;
+
+        mid = lo + (hi - lo) / 2;
+        w = (const edit_word_t *) g_ptr_array_index (sorted, mid);
+        cmp = len < 0 ? strcmp (w->word, word) : strncmp (w->word, word, (size_t) len);
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Bring sorted array up to date: drop removed words, sort new ones and merge them into array.
+ *
+ * @param index word index
+ */
+
+static void
+edit_word_index_sort (edit_word_index_t * index)
+{
+    gpointer *p = index->sorted->pdata;
+    guint head, i, n = 0, n_head = 0;
+
+    head = index->sorted->len - index->unsorted;
+
+    for (i = 0; i < index->sorted->len; i++)
+    {
+        edit_word_t *w = (edit_word_t *) p[i];
+
+        if (w->count == 0)
+            g_free (w);
+        else
+        {
+            p[n++] = w;
+            if (i < head)
+                n_head = n;
+        }
+    }
+
+    g_ptr_array_set_size (index->sorted, n);
+
+    if (n_head < n)
+    {
+        gpointer *tail;
+        guint n_tail;
+        gint j, k;
+
+        n_tail = n - n_head;
+        qsort (p + n_head, n_tail, sizeof (gpointer), edit_word_compare);
+
+        /* merge from the end: the tail is moved aside */
+        tail = g_memdup (p + n_head, n_tail * sizeof (gpointer));
+        i = n_head;
+        j = (gint) n_tail - 1;
+        for (k = (gint) n - 1; j >= 0; k--)
+        {
+            if (i > 0 && edit_word_compare (&p[i - 1], &tail[j]) > 0)
+                p[k] = p[--i];
+            else
+                p[k] = tail[j--];
+        }
+        g_free (tail);
+    }
+
+    index->unsorted = 0;
+    index->removed = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_word_index_add (edit_word_index_t * index, const char *word, gsize len, int delta)
+{
+    edit_word_t *w;
+
+    w = (edit_word_t *) g_hash_table_lookup (index->words, word);
+
+    if (delta > 0)
+    {
+        if (w == NULL)
+        {
+            w = g_malloc (sizeof (edit_word_t) + len);
+            w->count = 0;
+            w->len = len;
+            memcpy (w->word, word, len + 1);
+            g_hash_table_insert (index->words, w->word, w);
+
+            if (index->sorted != NULL)
+            {
+                g_ptr_array_add (index->sorted, w);
+                index->unsorted++;
+            }
+        }
+
+        w->count++;
+    }
+    else if (w != NULL && --w->count == 0)
+    {
+        if (index->sorted == NULL)
+            g_hash_table_remove (index->words, word);
+        else
+        {
+            /* word is freed when it is dropped from sorted array */
+            g_hash_table_steal (index->words, word);
+            index->removed++;
+            if (index->removed > g_hash_table_size (index->words))
+                edit_word_index_sort (index);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_word_scanner_init (edit_word_scanner_t * s, edit_word_index_t * index, int delta, off_t pos,
+                        off_t limit)
+{
+    s->index = index;
+    s->delta = delta;
+    s->pos = pos;
+    s->limit = limit;
+    s->len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** end of current word is reached */
+
+static inline void
+edit_word_scanner_flush (edit_word_scanner_t * s)
+{
+    if (s->len != 0 && s->len <= EDIT_WORD_MAX_LEN && s->pos <= s->limit)
+    {
+        s->word[s->len] = '\0';
+        edit_word_index_add (s->index, s->word, s->len, s->delta);
+    }
+
+    s->len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_word_scanner_feed (edit_word_scanner_t * s, const char *text, off_t len)
+{
+    off_t i;
+
+    for (i = 0; i < len; i++, s->pos++)
+    {
+        unsigned char c = (unsigned char) text[i];
+
+        if (!word_chars[c])
+            edit_word_scanner_flush (s);
+        else if (s->len < EDIT_WORD_MAX_LEN)
+            s->word[s->len++] = (char) c;
+        else
+            s->len = EDIT_WORD_MAX_LEN + 1;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_word_scanner_feed_buffer (edit_word_scanner_t * s, const edit_buffer_t * buf, off_t start,
+                               off_t end)
+{
+    while (start < end)
+    {
+        const char *p;
+        off_t span;
+
+        p = edit_buffer_get_span (buf, start, &span);
+        if (p == NULL || span <= 0)
+            break;
+        span = MIN (span, end - start);
+        edit_word_scanner_feed (s, p, span);
+        start += span;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check if byte can be a part of word.
+ *
+ * @param c byte
+ *
+ * @return TRUE if c isn't a break char
+ */
+
+gboolean
+edit_word_index_is_word_char (int c)
+{
+    if (!word_chars_init)
+    {
+        int i;
+
+        for (i = 0; i < 256; i++)
+            word_chars[i] = (i != '\0' && !is_break_char ((char) i));
+        word_chars_init = TRUE;
+    }
+
+    return word_chars[c & 0xff];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Initialize empty word index.
+ *
+ * @param index word index
+ */
+
+void
+edit_word_index_init (edit_word_index_t * index)
+{
+    (void) edit_word_index_is_word_char (0);
+
+    index->words = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    index->sorted = NULL;
+    index->unsorted = 0;
+    index->removed = 0;
+    index->indexed = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free memory of word index.
+ *
+ * @param index word index
+ */
+
+void
+edit_word_index_clean (edit_word_index_t * index)
+{
+    if (index->sorted != NULL)
+    {
+        /* removed words are owned by sorted array */
+        if (index->removed != 0)
+        {
+            guint i;
+
+            for (i = 0; i < index->sorted->len; i++)
+            {
+                edit_word_t *w = (edit_word_t *) g_ptr_array_index (index->sorted, i);
+
+                if (w->count == 0)
+                    g_free (w);
+            }
+        }
+        g_ptr_array_free (index->sorted, TRUE);
+    }
+    if (index->words != NULL)
+        g_hash_table_destroy (index->words);
+    index->sorted = NULL;
+    index->words = NULL;
+    index->unsorted = 0;
+    index->removed = 0;
+    index->indexed = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Index next part of text.
+ *
+ * @param index word index
+ * @param buf editor buffer
+ * @param limit how many bytes to index, negative value means up to end of text. The word at
+ *              the end of part is always indexed as whole.
+ *
+ * @return TRUE if all text is indexed, FALSE otherwise
+ */
+
+gboolean
+edit_word_index_build (edit_word_index_t * index, const edit_buffer_t * buf, off_t limit)
+{
+    edit_word_scanner_t s;
+    off_t end;
+
+    if (index->indexed >= buf->size)
+        return TRUE;
+
+    edit_word_scanner_init (&s, index, 1, index->indexed, buf->size);
+
+    /* index was stopped inside of too long word: skip the rest of it */
+    if (s.pos > 0 && edit_word_index_is_word_char (edit_buffer_get_byte (buf, s.pos - 1)))
+        s.len = EDIT_WORD_MAX_LEN + 1;
+
+    end = limit < 0 ? buf->size : MIN (buf->size, s.pos + limit);
+    edit_word_scanner_feed_buffer (&s, buf, s.pos, end);
+
+    /* finish the last word */
+    while (s.len != 0 && s.pos < buf->size)
+    {
+        char c;
+
+        c = (char) edit_buffer_get_byte (buf, s.pos);
+        if (!edit_word_index_is_word_char (c))
+            break;
+        edit_word_scanner_feed (&s, &c, 1);
+    }
+
+    edit_word_scanner_flush (&s);
+    index->indexed = s.pos;
+
+    return (index->indexed >= buf->size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update index after the text was changed. The buffer must already contain the new text.
+ *
+ * @param index word index
+ * @param buf editor buffer
+ * @param offset offset of change
+ * @param deleted bytes deleted at offset, NULL if nothing was deleted
+ * @param del_len number of deleted bytes
+ * @param ins_len number of bytes inserted at offset
+ */
+
+void
+edit_word_index_update (edit_word_index_t * index, const edit_buffer_t * buf, off_t offset,
+                        const char *deleted, off_t del_len, off_t ins_len)
+{
+    edit_word_scanner_t s;
+    off_t left, right, old_end, n;
+
+    /* find words touched by change. Longer runs are cut: they aren't indexed anyway */
+    left = offset;
+    for (n = 0; left > 0 && n <= EDIT_WORD_MAX_LEN; n++, left--)
+        if (!edit_word_index_is_word_char (edit_buffer_get_byte (buf, left - 1)))
+            break;
+
+    /* change after the indexed part will be indexed later */
+    if (left >= index->indexed && index->indexed < buf->size - ins_len + del_len)
+        return;
+
+    right = offset + ins_len;
+    for (n = 0; right < buf->size && n <= EDIT_WORD_MAX_LEN; n++, right++)
+        if (!edit_word_index_is_word_char (edit_buffer_get_byte (buf, right)))
+            break;
+
+    old_end = right - ins_len + del_len;
+
+    /* remove old words */
+    edit_word_scanner_init (&s, index, -1, left, index->indexed);
+    edit_word_scanner_feed_buffer (&s, buf, left, offset);
+    if (deleted != NULL)
+        edit_word_scanner_feed (&s, deleted, del_len);
+    edit_word_scanner_feed_buffer (&s, buf, offset + ins_len, right);
+    edit_word_scanner_flush (&s);
+
+    if (old_end > index->indexed)
+    {
+        /* change crosses the end of indexed part: the rest will be indexed later */
+        index->indexed = left;
+        return;
+    }
+
+    /* add new words */
+    edit_word_scanner_init (&s, index, 1, left, right);
+    edit_word_scanner_feed_buffer (&s, buf, left, right);
+    edit_word_scanner_flush (&s);
+
+    index->indexed += ins_len - del_len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find word in index.
+ *
+ * @param index word index
+ * @param word NUL-terminated word
+ *
+ * @return word with its count, NULL if there is no such word in the indexed part of text
+ */
+
+const edit_word_t *
+edit_word_index_find (const edit_word_index_t * index, const char *word)
+{
+    return (const edit_word_t *) g_hash_table_lookup (index->words, word);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find all words with specified prefix.
+ *
+ * @param index word index
+ * @param prefix prefix
+ * @param len length of prefix
+ *
+ * @return newly allocated array of edit_word_t owned by index, the more frequent words first
+ */
+
+GPtrArray *
+edit_word_index_lookup (edit_word_index_t * index, const char *prefix, gsize len)
+{
+    GPtrArray *found;
+    guint i;
+
+    if (index->sorted == NULL)
+    {
+        GHashTableIter iter;
+        gpointer value;
+
+        index->sorted = g_ptr_array_sized_new (g_hash_table_size (index->words));
+        g_hash_table_iter_init (&iter, index->words);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+            g_ptr_array_add (index->sorted, value);
+        g_ptr_array_sort (index->sorted, edit_word_compare);
+    }
+    else if (index->unsorted != 0 || index->removed != 0)
+        edit_word_index_sort (index);
+
+    found = g_ptr_array_new ();
+
+    for (i = edit_word_index_lower_bound (index->sorted, prefix, (gssize) len);
+         i < index->sorted->len; i++)
+    {
+        edit_word_t *w;
+
+        w = (edit_word_t *) g_ptr_array_index (index->sorted, i);
+        if (strncmp (w->word, prefix, len) != 0)
+            break;
+        g_ptr_array_add (found, w);
+    }
+
+    g_ptr_array_sort (found, edit_word_compare_count);
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,56 @@
+/** \file
+ *  \brief Header: index of words of WEdit buffer for word completion
+ */
+
+#ifndef MC__EDIT_WORDS_H
+#define MC__EDIT_WORDS_H
+
+#include "editbuffer.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* longer words aren't indexed */
+#define EDIT_WORD_MAX_LEN 256
+
+/* how many bytes of text are indexed in one step in background */
+#define EDIT_WORD_INDEX_STEP (256 * 1024)
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct edit_word_struct
+{
+    unsigned long count;        /* number of occurrences in the text */
+    gsize len;                  /* length of word in bytes */
+    char word[1];               /* NUL-terminated word */
+} edit_word_t;
+
+typedef struct edit_word_index_struct
+{
+    GHashTable *words;          /* word -> edit_word_t */
+    GPtrArray *sorted;          /* edit_word_t sorted by word, NULL if it should be rebuilt */
+    guint unsorted;             /* number of new words appended to sorted array */
+    guint removed;              /* number of words with zero count kept in sorted array */
+    off_t indexed;              /* all words before this offset are indexed */
+} edit_word_index_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void edit_word_index_init (edit_word_index_t * index);
+void edit_word_index_clean (edit_word_index_t * index);
+
+gboolean edit_word_index_build (edit_word_index_t * index, const edit_buffer_t * buf, off_t limit);
+void edit_word_index_update (edit_word_index_t * index, const edit_buffer_t * buf, off_t offset,
+                             const char *deleted, off_t del_len, off_t ins_len);
+
+const edit_word_t *edit_word_index_find (const edit_word_index_t * index, const char *word);
+GPtrArray *edit_word_index_lookup (edit_word_index_t * index, const char *prefix, gsize len);
+
+gboolean edit_word_index_is_word_char (int c);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__EDIT_WORDS_H */
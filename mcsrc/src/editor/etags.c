@@ -32,10 +32,10 @@
 #include <config.h>
 
 #include <stdlib.h>
-#include <stdio.h>
-#include <inttypes.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "lib/global.h"
 #include "lib/util.h"           /* canonicalize_pathname() */
@@ -46,215 +46,337 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* characters which end implicit tag name in the definition text */
+#define ETAGS_NAME_DELIMITERS " \f\t\n\r()=,;"
+
+#define ETAGS_NO_ENTRY G_MAXUINT32
+
 /*** file scope type declarations ****************************************************************/
 
+typedef struct
+{
+    const char *name;           /* tag name in the text of TAGS file, not NUL-terminated */
+    guint32 name_len;
+    guint32 file;               /* index of source file name */
+    guint32 next;               /* next entry with the same name or ETAGS_NO_ENTRY */
+} etags_entry_t;
+
+typedef struct
+{
+    char *path;                 /* name of TAGS file */
+    time_t mtime;
+    off_t size;
+    dev_t dev;
+    ino_t ino;
+
+    char *text;                 /* content of TAGS file */
+    gsize len;
+
+    GPtrArray *files;           /* names of source files */
+    GArray *entries;            /* etags_entry_t in order of TAGS file */
+    GHashTable *names;          /* first etags_entry_t for each tag name */
+} etags_index_t;
+
 /*** file scope variables ************************************************************************/
 
+/* name of TAGS file -> etags_index_t, shared by all editors */
+static GHashTable *etags_cache = NULL;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static guint
+etags_entry_hash (gconstpointer key)
+{
+    const etags_entry_t *e = (const etags_entry_t *) key;
+    guint h = 5381;
+    guint32 i;
+
+    for (i = 0; i < e->name_len; i++)
+        h = (h << 5) + h + (guchar) e->name[i];
+
+    return h;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static gboolean
-parse_define (const char *buf, char **long_name, char **short_name, long *line)
+etags_entry_equal (gconstpointer a, gconstpointer b)
 {
-    /* *INDENT-OFF* */
-    enum
+    const etags_entry_t *e1 = (const etags_entry_t *) a;
+    const etags_entry_t *e2 = (const etags_entry_t *) b;
+
+    return (e1->name_len == e2->name_len && memcmp (e1->name, e2->name, e1->name_len) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add tag definition line to the index.
+ *
+ * Line looks like "text\x7Fname\x01line,offset" or "text\x7Fline,offset". In last case the tag
+ * name is the last identifier of definition text.
+ */
+
+static void
+etags_index_add_define (etags_index_t * index, const char *p, const char *eol)
+{
+    const char *del;
+    const char *name, *name_end;
+    etags_entry_t e;
+
+    del = memchr (p, 0x7F, eol - p);
+    if (del == NULL)
+        return;
+
+    name_end = memchr (del + 1, 0x01, eol - del - 1);
+    if (name_end != NULL)
+        name = del + 1;
+    else
     {
-        in_longname,
-        in_shortname,
-        in_shortname_first_char,
-        in_line, finish
-    } def_state = in_longname;
-    /* *INDENT-ON* */
-
-    static char longdef[LONG_DEF_LEN];
-    static char shortdef[SHORT_DEF_LEN];
-    static char linedef[LINE_DEF_LEN];
-    int nlong = 0;
-    int nshort = 0;
-    int nline = 0;
-    char c = *buf;
-
-    while (!(c == '\0' || c == '\n'))
+        for (name_end = del; name_end > p && strchr (ETAGS_NAME_DELIMITERS, name_end[-1]) != NULL;
+             name_end--)
+            ;
+        for (name = name_end; name > p && strchr (ETAGS_NAME_DELIMITERS, name[-1]) == NULL; name--)
+            ;
+    }
+
+    if (name == name_end)
+        return;
+
+    e.name = name;
+    e.name_len = (guint32) (name_end - name);
+    e.file = index->files->len - 1;
+    e.next = ETAGS_NO_ENTRY;
+    g_array_append_val (index->entries, e);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+etags_index_parse (etags_index_t * index)
+{
+    const char *p = index->text;
+    const char *end = index->text + index->len;
+    guint i;
+
+    while (p < end)
     {
-        switch (def_state)
+        const char *eol;
+
+        eol = memchr (p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+
+        if (*p == 0x0C)
         {
-        case in_longname:
-            if (c == 0x01)
-            {
-                def_state = in_line;
-            }
-            else if (c == 0x7F)
-            {
-                def_state = in_shortname;
-            }
-            else
-            {
-                if (nlong < LONG_DEF_LEN - 1)
-                {
-                    longdef[nlong++] = c;
-                }
-            }
-            break;
-        case in_shortname_first_char:
-            if (isdigit (c))
-            {
-                nshort = 0;
-                buf--;
-                def_state = in_line;
-            }
-            else if (c == 0x01)
-            {
-                def_state = in_line;
-            }
-            else
-            {
-                if (nshort < SHORT_DEF_LEN - 1)
-                {
-                    shortdef[nshort++] = c;
-                    def_state = in_shortname;
-                }
-            }
-            break;
-        case in_shortname:
-            if (c == 0x01)
-            {
-                def_state = in_line;
-            }
-            else if (c == '\n')
-            {
-                def_state = finish;
-            }
-            else
-            {
-                if (nshort < SHORT_DEF_LEN - 1)
-                {
-                    shortdef[nshort++] = c;
-                }
-            }
-            break;
-        case in_line:
-            if (c == ',' || c == '\n')
-            {
-                def_state = finish;
-            }
-            else if (isdigit (c))
-            {
-                if (nline < LINE_DEF_LEN - 1)
-                {
-                    linedef[nline++] = c;
-                }
-            }
-            break;
-        case finish:
-            longdef[nlong] = '\0';
-            shortdef[nshort] = '\0';
-            linedef[nline] = '\0';
-            *long_name = longdef;
-            *short_name = shortdef;
-            *line = atol (linedef);
-            return TRUE;
-        default:
-            break;
+            /* section of source file: next line is "filename,size" */
+            const char *comma;
+
+            p = eol + 1;
+            if (p >= end)
+                break;
+
+            eol = memchr (p, '\n', end - p);
+            if (eol == NULL)
+                eol = end;
+
+            for (comma = eol; comma > p && comma[-1] != ','; comma--)
+                ;
+            comma = comma > p ? comma - 1 : eol;
+
+            g_ptr_array_add (index->files, g_strndup (p, comma - p));
         }
-        buf++;
-        c = *buf;
+        else if (index->files->len != 0)
+            etags_index_add_define (index, p, eol);
+
+        p = eol + 1;
+    }
+
+    /* chain entries with the same name in order of file */
+    for (i = index->entries->len; i != 0; i--)
+    {
+        etags_entry_t *e, *first;
+
+        e = &g_array_index (index->entries, etags_entry_t, i - 1);
+        first = (etags_entry_t *) g_hash_table_lookup (index->names, e);
+        if (first != NULL)
+            e->next = (guint32) (first - (etags_entry_t *) index->entries->data);
+        g_hash_table_replace (index->names, e, e);
     }
-    *long_name = NULL;
-    *short_name = NULL;
-    *line = 0;
-    return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
+
+static void
+etags_index_free (etags_index_t * index)
+{
+    if (index->names != NULL)
+        g_hash_table_destroy (index->names);
+    if (index->entries != NULL)
+        g_array_free (index->entries, TRUE);
+    if (index->files != NULL)
+    {
+        g_ptr_array_foreach (index->files, (GFunc) g_free, NULL);
+        g_ptr_array_free (index->files, TRUE);
+    }
+    g_free (index->text);
+    g_free (index->path);
+    g_free (index);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
-int
-etags_set_definition_hash (const char *tagfile, const char *start_path,
-                           const char *match_func, etags_hash_t * def_hash)
+static etags_index_t *
+etags_index_load (const char *tagfile, const struct stat *st)
+{
+    etags_index_t *index;
+
+    index = g_new0 (etags_index_t, 1);
+    index->path = g_strdup (tagfile);
+    index->mtime = st->st_mtime;
+    index->size = st->st_size;
+    index->dev = st->st_dev;
+    index->ino = st->st_ino;
+
+    /* TAGS is read, not mapped: it may be truncated by etags while the index is alive */
+    if (!g_file_get_contents (tagfile, &index->text, &index->len, NULL))
+    {
+        etags_index_free (index);
+        return NULL;
+    }
+
+    index->files = g_ptr_array_new ();
+    index->entries = g_array_new (FALSE, FALSE, sizeof (etags_entry_t));
+    index->names = g_hash_table_new (etags_entry_hash, etags_entry_equal);
+
+    etags_index_parse (index);
+
+    return index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get index of TAGS file. Index is built once and reused while the file is not changed.
+ */
+
+static etags_index_t *
+etags_index_get (const char *tagfile)
 {
-    /* *INDENT-OFF* */
-    enum
+    struct stat st;
+    etags_index_t *index;
+
+    if (stat (tagfile, &st) != 0 || !S_ISREG (st.st_mode))
+        return NULL;
+
+    if (etags_cache == NULL)
+        etags_cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                             (GDestroyNotify) etags_index_free);
+
+    index = (etags_index_t *) g_hash_table_lookup (etags_cache, tagfile);
+    if (index != NULL)
     {
-        start,
-        in_filename,
-        in_define
-    } state = start;
-    /* *INDENT-ON* */
+        if (index->mtime == st.st_mtime && index->size == st.st_size && index->dev == st.st_dev
+            && index->ino == st.st_ino)
+            return index;
+
+        g_hash_table_remove (etags_cache, tagfile);
+    }
+
+    index = etags_index_load (tagfile, &st);
+    if (index != NULL)
+        g_hash_table_insert (etags_cache, index->path, index);
+
+    return index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get line number of tag definition: it follows the tag name after \x7F or \x01 */
+
+static long
+etags_entry_get_line (const etags_index_t * index, const etags_entry_t * e)
+{
+    const char *p = e->name + e->name_len;
+    const char *end = index->text + index->len;
+    long line = 0;
 
-    FILE *f;
-    char buf[BUF_LARGE];
+    while (p < end && *p != 0x7F && *p != 0x01 && *p != '\n')
+        p++;
 
-    char *chekedstr = NULL;
+    if (p < end && *p != '\n')
+        for (p++; p < end && isdigit ((unsigned char) *p); p++)
+            line = line * 10 + (*p - '0');
 
+    return line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find definitions of tag in TAGS file.
+ *
+ * @param tagfile name of TAGS file
+ * @param start_path directory which file names in TAGS file are relative to
+ * @param match_func tag name
+ * @param def_hash array to store found definitions
+ * @param max_def size of def_hash
+ *
+ * @return number of found definitions
+ */
+
+int
+etags_set_definition_hash (const char *tagfile, const char *start_path,
+                           const char *match_func, etags_hash_t * def_hash, int max_def)
+{
+    etags_index_t *index;
+    etags_entry_t key;
+    const etags_entry_t *e;
     int num = 0;                /* returned value */
-    char *filename = NULL;
 
     if (!match_func || !tagfile)
         return 0;
 
-    /* open file with positions */
-    f = fopen (tagfile, "r");
-    if (f == NULL)
+    index = etags_index_get (tagfile);
+    if (index == NULL)
         return 0;
 
-    while (fgets (buf, sizeof (buf), f))
+    key.name = match_func;
+    key.name_len = (guint32) strlen (match_func);
+
+    for (e = (const etags_entry_t *) g_hash_table_lookup (index->names, &key);
+         e != NULL && num < max_def;
+         e = e->next == ETAGS_NO_ENTRY ? NULL :
+         &g_array_index (index->entries, etags_entry_t, e->next))
     {
-        switch (state)
-        {
-        case start:
-            if (buf[0] == 0x0C)
-            {
-                state = in_filename;
-            }
-            break;
-        case in_filename:
-            {
-                size_t pos;
-
-                pos = strcspn (buf, ",");
-                g_free (filename);
-                filename = g_strndup (buf, pos);
-                state = in_define;
-                break;
-            }
-        case in_define:
-            if (buf[0] == 0x0C)
-            {
-                state = in_filename;
-                break;
-            }
-            /* check if the filename matches the define pos */
-            chekedstr = strstr (buf, match_func);
-            if (chekedstr)
-            {
-                char *longname = NULL;
-                char *shortname = NULL;
-                long line = 0;
-
-                parse_define (chekedstr, &longname, &shortname, &line);
-                if (num < MAX_DEFINITIONS - 1)
-                {
-                    def_hash[num].filename_len = strlen (filename);
-                    def_hash[num].fullpath =
-                        mc_build_filename (start_path, filename, (char *) NULL);
-
-                    canonicalize_pathname (def_hash[num].fullpath);
-                    def_hash[num].filename = g_strdup (filename);
-                    def_hash[num].short_define = g_strdup (shortname ? shortname : longname);
-                    def_hash[num].line = line;
-                    num++;
-                }
-            }
-            break;
-        default:
-            break;
-        }
+        const char *filename;
+
+        filename = (const char *) g_ptr_array_index (index->files, e->file);
+
+        def_hash[num].filename_len = strlen (filename);
+        def_hash[num].fullpath = mc_build_filename (start_path, filename, (char *) NULL);
+        canonicalize_pathname (def_hash[num].fullpath);
+        def_hash[num].filename = g_strdup (filename);
+        def_hash[num].short_define = g_strndup (e->name, e->name_len);
+        def_hash[num].line = etags_entry_get_line (index, e);
+        num++;
     }
 
-    g_free (filename);
-    fclose (f);
     return num;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Free indexes of TAGS files.
+ */
+
+void
+etags_cache_free (void)
+{
+    if (etags_cache != NULL)
+    {
+        g_hash_table_destroy (etags_cache);
+        etags_cache = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
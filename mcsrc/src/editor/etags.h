@@ -8,9 +8,6 @@
 
 #define MAX_WIDTH_DEF_DIALOG 60 /* max width def dialog */
 #define MAX_DEFINITIONS 60      /* count found entries show */
-#define SHORT_DEF_LEN   30
-#define LONG_DEF_LEN    40
-#define LINE_DEF_LEN    16
 
 /*** enums ***************************************************************************************/
 
@@ -31,7 +28,8 @@ typedef struct etags_hash_struct
 
 
 int etags_set_definition_hash (const char *tagfile, const char *start_path,
-                               const char *match_func, etags_hash_t * def_hash);
+                               const char *match_func, etags_hash_t * def_hash, int max_def);
+void etags_cache_free (void);
 
 /*** inline functions ****************************************************************************/
 #endif /* MC__EDIT_ETAGS_H */
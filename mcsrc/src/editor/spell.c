@@ -46,6 +46,13 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* values of spell_cache */
+#define SPELL_WORD_CORRECT GINT_TO_POINTER (1)
+#define SPELL_WORD_WRONG GINT_TO_POINTER (2)
+
+/* longest word which is checked without allocation */
+#define SPELL_WORD_BUF_LEN 128
+
 /*** file scope type declarations ****************************************************************/
 
 typedef struct aspell_struct
@@ -59,6 +66,13 @@ typedef struct aspell_struct
 static GModule *spell_module = NULL;
 static spell_t *global_speller = NULL;
 
+/* results of spell checking: table of words for every dictionary */
+static GHashTable *spell_caches = NULL;
+/* results for the current dictionary */
+static GHashTable *spell_cache = NULL;
+/* changed when results of spell checking can change */
+static unsigned int spell_generation = 0;
+
 static AspellConfig *(*mc_new_aspell_config) (void);
 static int (*mc_aspell_config_replace) (AspellConfig * ths, const char *key, const char *value);
 static AspellCanHaveError *(*mc_new_aspell_speller) (AspellConfig * config);
@@ -274,6 +288,81 @@ spell_available (void)
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Select the table of results for the current dictionary and encoding of speller.
+ */
+
+static void
+spell_cache_select (void)
+{
+    char *key;
+
+    spell_generation++;
+    spell_cache = NULL;
+
+    if (global_speller == NULL || global_speller->speller == NULL)
+        return;
+
+    if (spell_caches == NULL)
+        spell_caches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) g_hash_table_destroy);
+
+    key = g_strconcat (mc_aspell_config_retrieve (global_speller->config, "lang"), ":",
+                       mc_aspell_config_retrieve (global_speller->config, "encoding"),
+                       (char *) NULL);
+
+    spell_cache = (GHashTable *) g_hash_table_lookup (spell_caches, key);
+    if (spell_cache != NULL)
+        g_free (key);
+    else
+    {
+        spell_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+        g_hash_table_insert (spell_caches, key, spell_cache);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget results of spell checking for a dictionary in one encoding.
+ *
+ * @param key dictionary and encoding of results
+ * @param value table of results
+ * @param user_data prefix "lang:" of keys to clear
+ */
+
+static void
+spell_cache_clear_lang (gpointer key, gpointer value, gpointer user_data)
+{
+    if (g_str_has_prefix ((const char *) key, (const char *) user_data))
+        g_hash_table_remove_all ((GHashTable *) value);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check NUL-terminated word using cache of results.
+ *
+ * @param word word
+ * @param word_size word size (in bytes)
+ * @return TRUE if word is in the dictionary
+ */
+
+static gboolean
+spell_check_cached (const char *word, int word_size)
+{
+    gpointer res;
+
+    res = g_hash_table_lookup (spell_cache, word);
+    if (res == NULL)
+    {
+        res = mc_aspell_speller_check (global_speller->speller, word, word_size) == 1
+            ? SPELL_WORD_CORRECT : SPELL_WORD_WRONG;
+        g_hash_table_insert (spell_cache, g_strndup (word, word_size), res);
+    }
+
+    return (res == SPELL_WORD_CORRECT);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -311,7 +400,10 @@ aspell_init (void)
     error = mc_new_aspell_speller (global_speller->config);
 
     if (mc_aspell_error_number (error) == 0)
+    {
         global_speller->speller = mc_to_aspell_speller (error);
+        spell_cache_select ();
+    }
     else
     {
         edit_error_dialog (_("Error"), mc_aspell_error_message (error));
@@ -339,6 +431,14 @@ aspell_clean (void)
 
     MC_PTR_FREE (global_speller);
 
+    if (spell_caches != NULL)
+    {
+        g_hash_table_destroy (spell_caches);
+        spell_caches = NULL;
+    }
+    spell_cache = NULL;
+    spell_generation++;
+
     g_module_close (spell_module);
     spell_module = NULL;
 }
@@ -463,17 +563,19 @@ aspell_set_lang (const char *lang)
         if (mc_aspell_error (error) != 0)
         {
             mc_delete_aspell_can_have_error (error);
+            spell_cache_select ();
             return FALSE;
         }
 
         global_speller->speller = mc_to_aspell_speller (error);
+        spell_cache_select ();
     }
     return TRUE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * Check word.
+ * Check word. Results are cached while dictionary is the same.
  *
  * @param word Word for spell check
  * @param word_size Word size (in bytes)
@@ -483,12 +585,67 @@ aspell_set_lang (const char *lang)
 gboolean
 aspell_check (const char *word, const int word_size)
 {
-    int res = 0;
+    char buf[SPELL_WORD_BUF_LEN];
+    char *w;
+    gboolean res;
 
-    if (word != NULL && global_speller != NULL && global_speller->speller != NULL)
-        res = mc_aspell_speller_check (global_speller->speller, word, word_size);
+    if (word == NULL || spell_cache == NULL)
+        return FALSE;
+
+    /* word isn't NUL-terminated */
+    w = word_size < SPELL_WORD_BUF_LEN ? buf : g_malloc (word_size + 1);
+    memcpy (w, word, word_size);
+    w[word_size] = '\0';
+
+    res = spell_check_cached (w, word_size);
+
+    if (w != buf)
+        g_free (w);
+
+    return res;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check many words at once. Every distinct word is looked up in dictionary only once, the results
+ * are kept for the following checks while dictionary is the same.
+ *
+ * @param words array of NUL-terminated words
+ * @param correct array of results, one for every word: TRUE if word is in the dictionary
+ * @return FALSE if spell checking isn't available
+ */
+
+gboolean
+aspell_check_words (const GPtrArray * words, gboolean * correct)
+{
+    guint i;
 
-    return (res == 1);
+    if (spell_cache == NULL)
+        return FALSE;
+
+    for (i = 0; i < words->len; i++)
+    {
+        const char *w;
+
+        w = (const char *) g_ptr_array_index (words, i);
+        correct[i] = spell_check_cached (w, (int) strlen (w));
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the number which is changed every time when the results of spell checking can change:
+ * the dictionary is switched or a word is added to it.
+ *
+ * @return generation of results
+ */
+
+unsigned int
+aspell_get_generation (void)
+{
+    return spell_generation;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -554,6 +711,18 @@ aspell_add_to_dict (const char *word, int word_size)
         return FALSE;
     }
 
+    /* results of the word in any encoding are changed */
+    if (spell_caches != NULL)
+    {
+        char *prefix;
+
+        prefix = g_strconcat (mc_aspell_config_retrieve (global_speller->config, "lang"), ":",
+                              (char *) NULL);
+        g_hash_table_foreach (spell_caches, spell_cache_clear_lang, prefix);
+        g_free (prefix);
+    }
+    spell_generation++;
+
     mc_aspell_speller_save_all_word_lists (global_speller->speller);
 
     if (mc_aspell_speller_error (global_speller->speller) != 0)
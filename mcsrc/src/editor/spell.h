@@ -16,6 +16,8 @@
 void aspell_init (void);
 void aspell_clean (void);
 gboolean aspell_check (const char *word, const int word_size);
+gboolean aspell_check_words (const GPtrArray * words, gboolean * correct);
+unsigned int aspell_get_generation (void);
 unsigned int aspell_suggest (GArray * suggest, const char *word, const int word_size);
 void aspell_array_clean (GArray * array);
 unsigned int aspell_get_lang_list (GArray * lang_list);
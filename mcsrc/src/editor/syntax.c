@@ -56,7 +56,7 @@
 #include "lib/global.h"
 #include "lib/search.h"         /* search engine */
 #include "lib/skin.h"
-#include "lib/fileloc.h"        /* EDIT_DIR, EDIT_SYNTAX_FILE */
+#include "lib/fileloc.h"        /* EDIT_DIR, EDIT_SYNTAX_FILE, EDIT_SYNTAX_CACHE_DIR */
 #include "lib/strutil.h"        /* utf string functions */
 #include "lib/util.h"
 #include "lib/widget.h"         /* message() */
@@ -82,6 +82,13 @@ gboolean option_auto_syntax = TRUE;
 #define SYNTAX_TOKEN_BRACKET    '\003'
 #define SYNTAX_TOKEN_BRACE      '\004'
 
+/* binary cache of parsed rules */
+#define SYNTAX_CACHE_MAGIC "MCSYNTAX"
+#define SYNTAX_CACHE_VERSION 2
+#define SYNTAX_CACHE_NULL_STR G_MAXUINT32
+/* flag of repeated string: the rest is index of string in cache */
+#define SYNTAX_CACHE_STR_REF 0x80000000U
+
 #define free_args(x)
 #define break_a {result=line;break;}
 #define check_a {if(!*a){result=line;break;}}
@@ -89,6 +96,8 @@ gboolean option_auto_syntax = TRUE;
 
 #define SYNTAX_KEYWORD(x) ((syntax_keyword_t *) (x))
 #define CONTEXT_RULE(x) ((context_rule_t *) (x))
+#define SYNTAX_MARKER(a,i) (&g_array_index ((a), syntax_marker_t, (i)))
+#define SYNTAX_TRIE_NODE(t,i) (&g_array_index ((t)->nodes, syntax_trie_node_t, (i)))
 
 /*** file scope type declarations ****************************************************************/
 
@@ -99,8 +108,42 @@ typedef struct
     char *whole_word_chars_right;
     long line_start;
     int color;
+    /* color as written in syntax file, interned strings */
+    const char *fg;
+    const char *bg;
+    const char *attrs;
 } syntax_keyword_t;
 
+/* node of keyword trie */
+typedef struct
+{
+    guint edges;                /* index of the first outgoing edge */
+    guint n_edges;
+    guint keywords;             /* index of the first candidate keyword */
+    guint n_keywords;
+} syntax_trie_node_t;
+
+typedef struct
+{
+    unsigned char c;
+    guint node;
+} syntax_trie_edge_t;
+
+/*
+ * Keywords of one context compiled into a trie of their literal prefixes (up to the first
+ * wildcard). Every node keeps sorted indexes of keywords whose prefix is matched on the way to
+ * this node, so one walk over the text finds all keywords which can start at the position.
+ * Keywords starting with wildcard are candidates of the root node. The trie is read-only after
+ * it is built and doesn't refer to the editor.
+ */
+typedef struct
+{
+    guint root[256];            /* node reached by the first byte, 0 if none */
+    GArray *nodes;              /* syntax_trie_node_t, 0 is the root */
+    GArray *edges;              /* syntax_trie_edge_t, edges of a node are sorted by byte */
+    GArray *keywords;           /* guint, candidate keywords of nodes */
+} syntax_trie_t;
+
 typedef struct
 {
     char *left;
@@ -112,22 +155,64 @@ typedef struct
     int between_delimiters;
     char *whole_word_chars_left;
     char *whole_word_chars_right;
-    char *keyword_first_chars;
+    syntax_trie_t *keyword_trie;
     gboolean spelling;
     /* first word is word[1] */
     GPtrArray *keyword;
 } context_rule_t;
 
+/* file which rules were read from */
+typedef struct
+{
+    char *path;
+    gint64 mtime;               /* -1 if the file must not exist: it would take priority */
+    gint64 size;
+} syntax_source_t;
+
+/* rules read from syntax file, shared by all editors which use the same syntax type */
+typedef struct syntax_rule_set_struct
+{
+    int ref_count;
+    char *key;                  /* path to Syntax file and syntax type */
+    GPtrArray *rules;           /* context_rule_t */
+    gboolean is_case_insensitive;
+    GPtrArray *sources;         /* syntax_source_t, rules are outdated if any of them is changed */
+} syntax_rule_set_t;
+
+/* writer of binary cache */
+typedef struct
+{
+    GByteArray *buf;
+    GHashTable *strings;        /* indexes of written strings */
+} syntax_cache_writer_t;
+
+/* reader of binary cache */
+typedef struct
+{
+    const guint8 *p;
+    const guint8 *end;
+    GPtrArray *strings;         /* strings read so far, point to cache data */
+    gboolean error;
+} syntax_cache_reader_t;
+
+/* checkpoint of highlighting state: state after byte at offset */
 typedef struct
 {
     off_t offset;
     edit_syntax_rule_t rule;
+    gboolean stale;             /* text before checkpoint was changed after it was computed */
 } syntax_marker_t;
 
 /*** file scope variables ************************************************************************/
 
 static char *error_file_name = NULL;
 
+/* rule sets in use */
+static GPtrArray *syntax_rule_sets = NULL;
+/* syntax_source_t: files opened or looked for while rules are read,
+   NULL if rules can't be cached */
+static GPtrArray *syntax_sources = NULL;
+
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -145,6 +230,173 @@ syntax_keyword_free (gpointer keyword)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Build trie of keywords of context.
+ *
+ * @param keywords keywords of context, the first one is the context itself and isn't added
+ *
+ * @return newly allocated trie
+ */
+
+static syntax_trie_t *
+syntax_trie_new (const GPtrArray * keywords)
+{
+    /* temporary node: children are kept in list sorted by byte */
+    typedef struct
+    {
+        unsigned char c;
+        guint child;
+        guint sibling;
+        GArray *ends;
+    } tmp_node_t;
+
+    /* node waiting for layout */
+    typedef struct
+    {
+        guint node;
+        guint parent;
+    } tmp_item_t;
+
+    syntax_trie_t *t;
+    GArray *tmp, *queue;
+    tmp_node_t root = { 0, 0, 0, NULL };
+    guint i;
+
+    tmp = g_array_new (FALSE, FALSE, sizeof (tmp_node_t));
+    root.ends = g_array_new (FALSE, FALSE, sizeof (guint));
+    g_array_append_val (tmp, root);
+
+    for (i = 1; i < keywords->len; i++)
+    {
+        const unsigned char *p;
+        guint n = 0;
+
+        p = (const unsigned char *) SYNTAX_KEYWORD (g_ptr_array_index (keywords, i))->keyword;
+        if (*p == '\0')
+            continue;
+
+        /* literal prefix: up to the first wildcard token */
+        for (; *p > SYNTAX_TOKEN_BRACE; p++)
+        {
+            guint *link;
+
+            link = &g_array_index (tmp, tmp_node_t, n).child;
+            while (*link != 0 && g_array_index (tmp, tmp_node_t, *link).c < *p)
+                link = &g_array_index (tmp, tmp_node_t, *link).sibling;
+
+            if (*link != 0 && g_array_index (tmp, tmp_node_t, *link).c == *p)
+                n = *link;
+            else
+            {
+                tmp_node_t node;
+
+                node.c = *p;
+                node.child = 0;
+                node.sibling = *link;
+                node.ends = g_array_new (FALSE, FALSE, sizeof (guint));
+                *link = tmp->len;
+                n = tmp->len;
+                g_array_append_val (tmp, node);
+            }
+        }
+
+        g_array_append_val (g_array_index (tmp, tmp_node_t, n).ends, i);
+    }
+
+    t = g_new0 (syntax_trie_t, 1);
+    t->nodes = g_array_sized_new (FALSE, FALSE, sizeof (syntax_trie_node_t), tmp->len);
+    t->edges = g_array_sized_new (FALSE, FALSE, sizeof (syntax_trie_edge_t), tmp->len);
+    t->keywords = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    /* lay nodes out breadth first: parent and its list of candidates precede its children */
+    queue = g_array_sized_new (FALSE, TRUE, sizeof (tmp_item_t), tmp->len);
+    g_array_set_size (queue, 1);
+
+    for (i = 0; i < queue->len; i++)
+    {
+        const tmp_item_t q = g_array_index (queue, tmp_item_t, i);
+        const tmp_node_t *tn = &g_array_index (tmp, tmp_node_t, q.node);
+        syntax_trie_node_t node;
+        guint c;
+
+        /* candidates: ones of parent and keywords ending here, both are sorted.
+           Candidates of root are matched everywhere and aren't inherited */
+        node.keywords = t->keywords->len;
+        if (q.parent != 0)
+        {
+            const syntax_trie_node_t *parent = SYNTAX_TRIE_NODE (t, q.parent);
+            guint a = 0, b = 0;
+
+            while (a < parent->n_keywords || b < tn->ends->len)
+            {
+                guint k1 = G_MAXUINT, k2 = G_MAXUINT;
+
+                if (a < parent->n_keywords)
+                    k1 = g_array_index (t->keywords, guint, parent->keywords + a);
+                if (b < tn->ends->len)
+                    k2 = g_array_index (tn->ends, guint, b);
+
+                if (k1 < k2)
+                {
+                    g_array_append_val (t->keywords, k1);
+                    a++;
+                }
+                else
+                {
+                    g_array_append_val (t->keywords, k2);
+                    b++;
+                }
+            }
+        }
+        else
+            g_array_append_vals (t->keywords, tn->ends->data, tn->ends->len);
+        node.n_keywords = t->keywords->len - node.keywords;
+
+        node.edges = t->edges->len;
+        for (c = tn->child; c != 0; c = g_array_index (tmp, tmp_node_t, c).sibling)
+        {
+            syntax_trie_edge_t e;
+            tmp_item_t qe;
+
+            e.c = g_array_index (tmp, tmp_node_t, c).c;
+            e.node = queue->len;
+            g_array_append_val (t->edges, e);
+            if (i == 0)
+                t->root[e.c] = e.node;
+
+            qe.node = c;
+            qe.parent = i;
+            g_array_append_val (queue, qe);
+        }
+        node.n_edges = t->edges->len - node.edges;
+
+        g_array_append_val (t->nodes, node);
+    }
+
+    g_array_free (queue, TRUE);
+    for (i = 0; i < tmp->len; i++)
+        g_array_free (g_array_index (tmp, tmp_node_t, i).ends, TRUE);
+    g_array_free (tmp, TRUE);
+
+    return t;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_trie_free (syntax_trie_t * t)
+{
+    if (t == NULL)
+        return;
+
+    g_array_free (t->nodes, TRUE);
+    g_array_free (t->edges, TRUE);
+    g_array_free (t->keywords, TRUE);
+    g_free (t);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
 context_rule_free (gpointer rule)
 {
@@ -154,7 +406,7 @@ context_rule_free (gpointer rule)
     g_free (r->right);
     g_free (r->whole_word_chars_left);
     g_free (r->whole_word_chars_right);
-    g_free (r->keyword_first_chars);
+    syntax_trie_free (r->keyword_trie);
 
     if (r->keyword != NULL)
     {
@@ -350,16 +602,82 @@ compare_word_to_right (const WEdit * edit, off_t i, const char *text,
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first keyword of context which starts at specified position.
+ *
+ * @param edit editor object
+ * @param r context
+ * @param i position in text
+ * @param c byte at position i
+ * @param end where to store end of found keyword
+ *
+ * @return index of found keyword, 0 if none
+ */
 
-static const char *
-xx_strchr (const WEdit * edit, const unsigned char *s, int char_byte)
+static int
+syntax_keyword_match (const WEdit * edit, const context_rule_t * r, off_t i, int c, off_t * end)
 {
-    while (*s >= '\005' && xx_tolower (edit, *s) != char_byte)
-        s++;
+    const syntax_trie_t *t = r->keyword_trie;
+    const syntax_trie_node_t *wild, *node = NULL;
+    guint n, a = 0, b = 0;
+    off_t j;
+
+    if (t == NULL)
+        return 0;
+
+    /* walk along the longest literal prefix */
+    for (n = t->root[c & 0xff], j = i + 1; n != 0; j++)
+    {
+        const syntax_trie_edge_t *e;
+        guint lo, hi;
 
-    return (const char *) s;
+        node = SYNTAX_TRIE_NODE (t, n);
+        e = &g_array_index (t->edges, syntax_trie_edge_t, node->edges);
+        c = xx_tolower (edit, edit_buffer_get_byte (&edit->buffer, j));
+
+        for (lo = 0, hi = node->n_edges; lo < hi;)
+        {
+            guint mid = (lo + hi) / 2;
+
+            if (e[mid].c < c)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        n = (lo < node->n_edges && e[lo].c == c) ? e[lo].node : 0;
+    }
+
+    /* try candidates in order of definition */
+    wild = SYNTAX_TRIE_NODE (t, 0);
+    while (a < wild->n_keywords || (node != NULL && b < node->n_keywords))
+    {
+        const syntax_keyword_t *k;
+        guint count;
+        off_t e;
+
+        if (node == NULL || b >= node->n_keywords
+            || (a < wild->n_keywords
+                && g_array_index (t->keywords, guint, wild->keywords + a)
+                < g_array_index (t->keywords, guint, node->keywords + b)))
+            count = g_array_index (t->keywords, guint, wild->keywords + a++);
+        else
+            count = g_array_index (t->keywords, guint, node->keywords + b++);
+
+        k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
+        e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
+                                   k->whole_word_chars_right, k->line_start);
+        if (e > 0)
+        {
+            *end = e;
+            return (int) count;
+        }
+    }
+
+    return 0;
 }
 
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -428,31 +746,18 @@ apply_rules_going_right (WEdit * edit, off_t i)
     /* check to turn on a keyword */
     if (_rule.keyword == 0)
     {
-        const char *p;
+        off_t e;
+        int count;
 
         r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule.context));
-        p = r->keyword_first_chars;
-
-        if (p != NULL)
-            while (*(p = xx_strchr (edit, (const unsigned char *) p + 1, c)) != '\0')
-            {
-                syntax_keyword_t *k;
-                int count;
-                off_t e;
-
-                count = p - r->keyword_first_chars;
-                k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
-                e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                           k->whole_word_chars_right, k->line_start);
-                if (e > 0)
-                {
-                    end = e;
-                    _rule.end = e;
-                    _rule.keyword = count;
-                    keyword_foundright = TRUE;
-                    break;
-                }
-            }
+        count = syntax_keyword_match (edit, r, i, c, &e);
+        if (count != 0)
+        {
+            end = e;
+            _rule.end = e;
+            _rule.keyword = count;
+            keyword_foundright = TRUE;
+        }
     }
 
     /* check to turn on a context */
@@ -530,27 +835,15 @@ apply_rules_going_right (WEdit * edit, off_t i)
     /* check again to turn on a keyword if the context switched */
     if (contextchanged && _rule.keyword == 0)
     {
-        const char *p;
+        off_t e;
+        int count;
 
         r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule.context));
-        p = r->keyword_first_chars;
-
-        while (*(p = xx_strchr (edit, (const unsigned char *) p + 1, c)) != '\0')
+        count = syntax_keyword_match (edit, r, i, c, &e);
+        if (count != 0)
         {
-            syntax_keyword_t *k;
-            int count;
-            off_t e;
-
-            count = p - r->keyword_first_chars;
-            k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
-            e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                       k->whole_word_chars_right, k->line_start);
-            if (e > 0)
-            {
-                _rule.end = e;
-                _rule.keyword = count;
-                break;
-            }
+            _rule.end = e;
+            _rule.keyword = count;
         }
     }
 
@@ -558,62 +851,136 @@ apply_rules_going_right (WEdit * edit, off_t i)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last up-to-date checkpoint before or at specified position.
+ *
+ * @return index of checkpoint, -1 if there is no such checkpoint
+ */
 
-static void
-edit_get_rule (WEdit * edit, off_t byte_index)
+static gssize
+syntax_marker_find (const WEdit * edit, off_t byte_index)
 {
-    off_t i;
+    gssize lo = 0, hi = (gssize) edit->syntax_marker->len - 1;
 
-    if (byte_index > edit->last_get_rule)
+    while (lo <= hi)
     {
-        for (i = edit->last_get_rule + 1; i <= byte_index; i++)
-        {
-            off_t d = SYNTAX_MARKER_DENSITY;
+        gssize mid = lo + (hi - lo) / 2;
 
-            apply_rules_going_right (edit, i);
+        if (SYNTAX_MARKER (edit->syntax_marker, mid)->offset <= byte_index)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
 
-            if (edit->syntax_marker != NULL)
-                d += ((syntax_marker_t *) edit->syntax_marker->data)->offset;
+    return hi;
+}
 
-            if (i > d)
-            {
-                syntax_marker_t *s;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Save highlighting state after byte at offset i as checkpoint, or check old checkpoint
+ * computed before the last text change.
+ */
+
+static void
+syntax_marker_update (WEdit * edit, off_t i)
+{
+    GArray *markers = edit->syntax_marker;
+    GArray *old = edit->syntax_marker_old;
+    syntax_marker_t *m;
+
+    if (old->len != 0)
+    {
+        m = SYNTAX_MARKER (old, old->len - 1);
 
-                s = g_new (syntax_marker_t, 1);
-                s->offset = i;
-                s->rule = edit->rule;
-                edit->syntax_marker = g_slist_prepend (edit->syntax_marker, s);
+        if (m->offset + edit->syntax_marker_shift == i
+            && edit_syntax_rule_equal (&edit->rule, &m->rule, edit->syntax_marker_shift, i))
+        {
+            /* state is re-converged: checkpoints up to the next changed text are valid */
+            do
+            {
+                syntax_marker_t s = *m;
+
+                s.offset += edit->syntax_marker_shift;
+                s.rule.end += edit->syntax_marker_shift;
+                s.stale = FALSE;
+                /* deleted text could bring checkpoints too close to each other */
+                if (markers->len == 0
+                    || s.offset > SYNTAX_MARKER (markers, markers->len - 1)->offset
+                    + SYNTAX_MARKER_DENSITY / 2)
+                    g_array_append_val (markers, s);
+                g_array_set_size (old, old->len - 1);
+                m = old->len == 0 ? NULL : SYNTAX_MARKER (old, old->len - 1);
             }
+            while (m != NULL && !m->stale);
+
+            return;
+        }
+
+        if (m->offset + edit->syntax_marker_shift <= i)
+        {
+            /* checkpoint is wrong or was skipped: forget it */
+            g_array_set_size (old, old->len - 1);
+            if (old->len != 0)
+                SYNTAX_MARKER (old, old->len - 1)->stale = TRUE;
         }
     }
-    else if (byte_index < edit->last_get_rule)
+
+    if (markers->len == 0 || i > SYNTAX_MARKER (markers, markers->len - 1)->offset
+        + SYNTAX_MARKER_DENSITY)
     {
-        while (TRUE)
-        {
-            syntax_marker_t *s;
+        syntax_marker_t s;
 
-            if (edit->syntax_marker == NULL)
-            {
-                memset (&edit->rule, 0, sizeof (edit->rule));
-                for (i = -1; i <= byte_index; i++)
-                    apply_rules_going_right (edit, i);
-                break;
-            }
+        s.offset = i;
+        s.rule = edit->rule;
+        s.stale = FALSE;
+        g_array_append_val (markers, s);
+    }
+}
 
-            s = (syntax_marker_t *) edit->syntax_marker->data;
+/* --------------------------------------------------------------------------------------------- */
 
-            if (byte_index >= s->offset)
-            {
-                edit->rule = s->rule;
-                for (i = s->offset + 1; i <= byte_index; i++)
-                    apply_rules_going_right (edit, i);
-                break;
-            }
+static void
+edit_get_rule (WEdit * edit, off_t byte_index)
+{
+    off_t i;
+    gssize m;
+
+    if (edit->syntax_marker == NULL)
+    {
+        edit->syntax_marker = g_array_new (FALSE, FALSE, sizeof (syntax_marker_t));
+        edit->syntax_marker_old = g_array_new (FALSE, FALSE, sizeof (syntax_marker_t));
+        edit->syntax_marker_shift = 0;
+    }
 
-            g_free (s);
-            edit->syntax_marker = g_slist_delete_link (edit->syntax_marker, edit->syntax_marker);
+    /* start from the nearest checkpoint if it is closer than the current state */
+    if (byte_index < edit->last_get_rule
+        || byte_index > edit->last_get_rule + SYNTAX_MARKER_DENSITY)
+        m = syntax_marker_find (edit, byte_index);
+    else
+        m = -1;
+
+    if (byte_index < edit->last_get_rule
+        || (m >= 0 && SYNTAX_MARKER (edit->syntax_marker, m)->offset > edit->last_get_rule))
+    {
+        if (m < 0)
+        {
+            memset (&edit->rule, 0, sizeof (edit->rule));
+            edit->last_get_rule = -2;
+        }
+        else
+        {
+            edit->rule = SYNTAX_MARKER (edit->syntax_marker, m)->rule;
+            edit->last_get_rule = SYNTAX_MARKER (edit->syntax_marker, m)->offset;
         }
     }
+
+    for (i = edit->last_get_rule + 1; i <= byte_index; i++)
+    {
+        apply_rules_going_right (edit, i);
+        if (i >= 0)
+            syntax_marker_update (edit, i);
+    }
+
     edit->last_get_rule = byte_index;
 }
 
@@ -862,6 +1229,61 @@ this_try_alloc_color_pair (const char *fg, const char *bg, const char *attrs)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static void
+syntax_keyword_set_color (syntax_keyword_t * k, const char *fg, const char *bg, const char *attrs)
+{
+    /* keep color description for the cache: color pair depends on skin */
+    k->fg = g_intern_string (fg);
+    k->bg = g_intern_string (bg);
+    k->attrs = g_intern_string (attrs);
+    k->color = this_try_alloc_color_pair (fg, bg, attrs);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_source_free (gpointer source)
+{
+    syntax_source_t *s = (syntax_source_t *) source;
+
+    g_free (s->path);
+    g_free (s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember file which rules are read from.
+ *
+ * @param path file name
+ * @param exists FALSE if the file was looked for but not found
+ */
+
+static void
+syntax_source_add (const char *path, gboolean exists)
+{
+    syntax_source_t *s;
+    struct stat st;
+
+    if (syntax_sources == NULL)
+        return;
+
+    if (exists && stat (path, &st) != 0)
+    {
+        /* rules can't be validated later */
+        g_ptr_array_free (syntax_sources, TRUE);
+        syntax_sources = NULL;
+        return;
+    }
+
+    s = g_new (syntax_source_t, 1);
+    s->path = g_strdup (path);
+    s->mtime = exists ? (gint64) st.st_mtime : -1;
+    s->size = exists ? (gint64) st.st_size : -1;
+    g_ptr_array_add (syntax_sources, s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static FILE *
 open_include_file (const char *filename)
 {
@@ -878,12 +1300,17 @@ open_include_file (const char *filename)
     f = fopen (error_file_name, "r");
     if (f != NULL)
         return f;
+    /* rules become outdated if user creates this file */
+    if (errno == ENOENT)
+        syntax_source_add (error_file_name, FALSE);
 
     g_free (error_file_name);
     error_file_name = g_build_filename (mc_global.sysconfig_dir, "syntax", filename, (char *) NULL);
     f = fopen (error_file_name, "r");
     if (f != NULL)
         return f;
+    if (errno == ENOENT)
+        syntax_source_add (error_file_name, FALSE);
 
     g_free (error_file_name);
     error_file_name =
@@ -983,6 +1410,7 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
                 result = line;
                 break;
             }
+            syntax_source_add (error_file_name, TRUE);
             save_line = line;
             line = 0;
         }
@@ -1091,7 +1519,7 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
             g_strlcpy (last_fg, fg != NULL ? fg : "", sizeof (last_fg));
             g_strlcpy (last_bg, bg != NULL ? bg : "", sizeof (last_bg));
             g_strlcpy (last_attrs, attrs != NULL ? attrs : "", sizeof (last_attrs));
-            k->color = this_try_alloc_color_pair (fg, bg, attrs);
+            syntax_keyword_set_color (k, fg, bg, attrs);
             k->keyword = g_strdup (" ");
             check_not_a;
         }
@@ -1159,7 +1587,7 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
                 bg = last_bg;
             if (attrs == NULL)
                 attrs = last_attrs;
-            k->color = this_try_alloc_color_pair (fg, bg, attrs);
+            syntax_keyword_set_color (k, fg, bg, attrs);
             check_not_a;
         }
         else if (*(args[0]) == '#')
@@ -1208,37 +1636,488 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
     if (result == 0)
     {
         size_t i;
-        GString *first_chars;
 
         if (edit->rules == NULL)
             return line;
 
-        first_chars = g_string_sized_new (32);
-
-        /* collect first character of keywords */
+        /* compile keywords */
         for (i = 0; i < edit->rules->len; i++)
         {
-            size_t j;
-
-            g_string_set_size (first_chars, 0);
             c = CONTEXT_RULE (g_ptr_array_index (edit->rules, i));
+            c->keyword_trie = syntax_trie_new (c->keyword);
+        }
+    }
 
-            g_string_append_c (first_chars, (char) 1);
-            for (j = 1; j < c->keyword->len; j++)
-            {
-                syntax_keyword_t *k;
+    return result;
+}
 
-                k = SYNTAX_KEYWORD (g_ptr_array_index (c->keyword, j));
-                g_string_append_c (first_chars, k->keyword[0]);
-            }
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+syntax_sources_are_valid (const GPtrArray * sources)
+{
+    guint i;
 
-            c->keyword_first_chars = g_strndup (first_chars->str, first_chars->len);
+    for (i = 0; i < sources->len; i++)
+    {
+        const syntax_source_t *s = (const syntax_source_t *) g_ptr_array_index (sources, i);
+        struct stat st;
+
+        if (stat (s->path, &st) != 0)
+        {
+            if (s->mtime != -1)
+                return FALSE;
         }
+        else if (s->mtime == -1 || (gint64) st.st_mtime != s->mtime
+                 || (gint64) st.st_size != s->size)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_rule_set_unref (syntax_rule_set_t * set)
+{
+    if (--set->ref_count > 0)
+        return;
 
-        g_string_free (first_chars, TRUE);
+    g_ptr_array_remove (syntax_rule_sets, set);
+    if (syntax_rule_sets->len == 0)
+    {
+        g_ptr_array_free (syntax_rule_sets, TRUE);
+        syntax_rule_sets = NULL;
     }
 
-    return result;
+    g_ptr_array_foreach (set->rules, (GFunc) context_rule_free, NULL);
+    g_ptr_array_free (set->rules, TRUE);
+    g_ptr_array_free (set->sources, TRUE);
+    g_free (set->key);
+    g_free (set);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Register new rule set.
+ *
+ * @param key path to Syntax file and syntax type
+ * @param rules parsed rules, the set takes them over
+ * @param is_case_insensitive case sensitivity of rules
+ * @param sources files of rules, the set takes them over
+ *
+ * @return rule set with one reference
+ */
+
+static syntax_rule_set_t *
+syntax_rule_set_new (const char *key, GPtrArray * rules, gboolean is_case_insensitive,
+                     GPtrArray * sources)
+{
+    syntax_rule_set_t *set;
+
+    set = g_new (syntax_rule_set_t, 1);
+    set->ref_count = 1;
+    set->key = g_strdup (key);
+    set->rules = rules;
+    set->is_case_insensitive = is_case_insensitive;
+    set->sources = sources;
+
+    if (syntax_rule_sets == NULL)
+        syntax_rule_sets = g_ptr_array_new ();
+    g_ptr_array_add (syntax_rule_sets, set);
+
+    return set;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find up-to-date rule set used by other editor.
+ *
+ * @return rule set with new reference, NULL if not found
+ */
+
+static syntax_rule_set_t *
+syntax_rule_set_find (const char *key)
+{
+    guint i;
+
+    if (syntax_rule_sets == NULL)
+        return NULL;
+
+    for (i = 0; i < syntax_rule_sets->len; i++)
+    {
+        syntax_rule_set_t *set = (syntax_rule_set_t *) g_ptr_array_index (syntax_rule_sets, i);
+
+        if (strcmp (set->key, key) == 0 && syntax_sources_are_valid (set->sources))
+        {
+            set->ref_count++;
+            return set;
+        }
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_rule_set_attach (WEdit * edit, syntax_rule_set_t * set)
+{
+    edit->rule_set = set;
+    edit->rules = set->rules;
+    edit->is_case_insensitive = set->is_case_insensitive;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+syntax_cache_get_path (const char *key)
+{
+    char *name, *path;
+
+    name = g_compute_checksum_for_string (G_CHECKSUM_MD5, key, -1);
+    path = mc_build_filename (mc_config_get_cache_path (), EDIT_SYNTAX_CACHE_DIR, name,
+                              (char *) NULL);
+    g_free (name);
+
+    return path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_cache_put_u32 (syntax_cache_writer_t * w, guint32 value)
+{
+    g_byte_array_append (w->buf, (const guint8 *) &value, sizeof (value));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_cache_put_i64 (syntax_cache_writer_t * w, gint64 value)
+{
+    g_byte_array_append (w->buf, (const guint8 *) &value, sizeof (value));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write string to cache. Repeated strings (word characters, colors) are written once
+ * and referred by index later.
+ */
+
+static void
+syntax_cache_put_str (syntax_cache_writer_t * w, const char *str)
+{
+    gpointer index;
+
+    if (str == NULL)
+        syntax_cache_put_u32 (w, SYNTAX_CACHE_NULL_STR);
+    else if (g_hash_table_lookup_extended (w->strings, str, NULL, &index))
+        syntax_cache_put_u32 (w, SYNTAX_CACHE_STR_REF | GPOINTER_TO_UINT (index));
+    else
+    {
+        guint32 len = (guint32) strlen (str);
+
+        g_hash_table_insert (w->strings, (gpointer) str,
+                             GUINT_TO_POINTER (g_hash_table_size (w->strings)));
+        syntax_cache_put_u32 (w, len);
+        g_byte_array_append (w->buf, (const guint8 *) str, len + 1);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint32
+syntax_cache_get_u32 (syntax_cache_reader_t * r)
+{
+    guint32 value = 0;
+
+    if (r->error || r->end - r->p < (ptrdiff_t) sizeof (value))
+        r->error = TRUE;
+    else
+    {
+        memcpy (&value, r->p, sizeof (value));
+        r->p += sizeof (value);
+    }
+
+    return value;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gint64
+syntax_cache_get_i64 (syntax_cache_reader_t * r)
+{
+    gint64 value = 0;
+
+    if (r->error || r->end - r->p < (ptrdiff_t) sizeof (value))
+        r->error = TRUE;
+    else
+    {
+        memcpy (&value, r->p, sizeof (value));
+        r->p += sizeof (value);
+    }
+
+    return value;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+syntax_cache_get_str (syntax_cache_reader_t * r)
+{
+    guint32 len;
+    const char *str;
+
+    len = syntax_cache_get_u32 (r);
+    if (r->error || len == SYNTAX_CACHE_NULL_STR)
+        return NULL;
+
+    if ((len & SYNTAX_CACHE_STR_REF) != 0)
+    {
+        len &= ~SYNTAX_CACHE_STR_REF;
+        if (len >= r->strings->len)
+        {
+            r->error = TRUE;
+            return NULL;
+        }
+        return g_strdup ((const char *) g_ptr_array_index (r->strings, len));
+    }
+
+    /* string is stored with terminating zero */
+    if ((guint32) (r->end - r->p) <= len || r->p[len] != '\0' || memchr (r->p, '\0', len) != NULL)
+    {
+        r->error = TRUE;
+        return NULL;
+    }
+
+    str = (const char *) r->p;
+    r->p += len + 1;
+    g_ptr_array_add (r->strings, (gpointer) str);
+
+    return g_strdup (str);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Save rule set to binary cache. Errors are ignored: rules will be read from syntax file again.
+ */
+
+static void
+syntax_cache_save (const syntax_rule_set_t * set)
+{
+    syntax_cache_writer_t w;
+    char *path, *dir;
+    guint i, j;
+
+    w.buf = g_byte_array_new ();
+    w.strings = g_hash_table_new (g_str_hash, g_str_equal);
+
+    g_byte_array_append (w.buf, (const guint8 *) SYNTAX_CACHE_MAGIC, strlen (SYNTAX_CACHE_MAGIC));
+    syntax_cache_put_u32 (&w, SYNTAX_CACHE_VERSION);
+    syntax_cache_put_str (&w, set->key);
+
+    syntax_cache_put_u32 (&w, set->sources->len);
+    for (i = 0; i < set->sources->len; i++)
+    {
+        const syntax_source_t *s = (const syntax_source_t *) g_ptr_array_index (set->sources, i);
+
+        syntax_cache_put_str (&w, s->path);
+        syntax_cache_put_i64 (&w, s->mtime);
+        syntax_cache_put_i64 (&w, s->size);
+    }
+
+    syntax_cache_put_u32 (&w, set->is_case_insensitive ? 1 : 0);
+
+    syntax_cache_put_u32 (&w, set->rules->len);
+    for (i = 0; i < set->rules->len; i++)
+    {
+        const context_rule_t *c = CONTEXT_RULE (g_ptr_array_index (set->rules, i));
+
+        syntax_cache_put_str (&w, c->left);
+        syntax_cache_put_u32 (&w, c->first_left);
+        syntax_cache_put_u32 (&w, c->line_start_left);
+        syntax_cache_put_str (&w, c->right);
+        syntax_cache_put_u32 (&w, c->first_right);
+        syntax_cache_put_u32 (&w, c->line_start_right);
+        syntax_cache_put_u32 (&w, c->between_delimiters);
+        syntax_cache_put_str (&w, c->whole_word_chars_left);
+        syntax_cache_put_str (&w, c->whole_word_chars_right);
+        syntax_cache_put_u32 (&w, c->spelling ? 1 : 0);
+
+        syntax_cache_put_u32 (&w, c->keyword->len);
+        for (j = 0; j < c->keyword->len; j++)
+        {
+            const syntax_keyword_t *k = SYNTAX_KEYWORD (g_ptr_array_index (c->keyword, j));
+
+            syntax_cache_put_str (&w, k->keyword);
+            syntax_cache_put_str (&w, k->whole_word_chars_left);
+            syntax_cache_put_str (&w, k->whole_word_chars_right);
+            syntax_cache_put_u32 (&w, (guint32) k->line_start);
+            syntax_cache_put_str (&w, k->fg);
+            syntax_cache_put_str (&w, k->bg);
+            syntax_cache_put_str (&w, k->attrs);
+        }
+    }
+
+    dir = mc_build_filename (mc_config_get_cache_path (), EDIT_SYNTAX_CACHE_DIR, (char *) NULL);
+    path = syntax_cache_get_path (set->key);
+
+    if (g_mkdir_with_parents (dir, 0700) == 0)
+        (void) g_file_set_contents (path, (const char *) w.buf->data, w.buf->len, NULL);
+
+    g_free (path);
+    g_free (dir);
+    g_hash_table_destroy (w.strings);
+    g_byte_array_free (w.buf, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load rule set from binary cache.
+ *
+ * @param key path to Syntax file and syntax type
+ *
+ * @return rule set with one reference, NULL if there is no valid cache
+ */
+
+static syntax_rule_set_t *
+syntax_cache_load (const char *key)
+{
+    char *path, *data = NULL, *str;
+    gsize len;
+    syntax_cache_reader_t r;
+    GPtrArray *sources = NULL, *rules = NULL;
+    gboolean is_case_insensitive;
+    guint32 i, j, n;
+
+    path = syntax_cache_get_path (key);
+    if (!g_file_get_contents (path, &data, &len, NULL))
+    {
+        g_free (path);
+        return NULL;
+    }
+    g_free (path);
+
+    r.p = (const guint8 *) data;
+    r.end = r.p + len;
+    r.strings = g_ptr_array_new ();
+    r.error = FALSE;
+
+    if (len < strlen (SYNTAX_CACHE_MAGIC)
+        || memcmp (r.p, SYNTAX_CACHE_MAGIC, strlen (SYNTAX_CACHE_MAGIC)) != 0)
+        goto fail;
+    r.p += strlen (SYNTAX_CACHE_MAGIC);
+
+    if (syntax_cache_get_u32 (&r) != SYNTAX_CACHE_VERSION)
+        goto fail;
+
+    str = syntax_cache_get_str (&r);
+    if (str == NULL || strcmp (str, key) != 0)
+    {
+        g_free (str);
+        goto fail;
+    }
+    g_free (str);
+
+    sources = g_ptr_array_new_with_free_func (syntax_source_free);
+    n = syntax_cache_get_u32 (&r);
+    for (i = 0; i < n && !r.error; i++)
+    {
+        syntax_source_t *s;
+
+        s = g_new (syntax_source_t, 1);
+        s->path = syntax_cache_get_str (&r);
+        s->mtime = syntax_cache_get_i64 (&r);
+        s->size = syntax_cache_get_i64 (&r);
+        g_ptr_array_add (sources, s);
+        if (s->path == NULL)
+            r.error = TRUE;
+    }
+
+    if (r.error || !syntax_sources_are_valid (sources))
+        goto fail;
+
+    is_case_insensitive = syntax_cache_get_u32 (&r) != 0;
+
+    rules = g_ptr_array_new ();
+    n = syntax_cache_get_u32 (&r);
+    for (i = 0; i < n && !r.error; i++)
+    {
+        context_rule_t *c;
+        guint32 m;
+
+        c = g_new0 (context_rule_t, 1);
+        g_ptr_array_add (rules, c);
+
+        c->left = syntax_cache_get_str (&r);
+        c->first_left = (unsigned char) syntax_cache_get_u32 (&r);
+        c->line_start_left = (char) syntax_cache_get_u32 (&r);
+        c->right = syntax_cache_get_str (&r);
+        c->first_right = (unsigned char) syntax_cache_get_u32 (&r);
+        c->line_start_right = (char) syntax_cache_get_u32 (&r);
+        c->between_delimiters = (int) syntax_cache_get_u32 (&r);
+        c->whole_word_chars_left = syntax_cache_get_str (&r);
+        c->whole_word_chars_right = syntax_cache_get_str (&r);
+        c->spelling = syntax_cache_get_u32 (&r) != 0;
+
+        c->keyword = g_ptr_array_new ();
+        m = syntax_cache_get_u32 (&r);
+        for (j = 0; j < m && !r.error; j++)
+        {
+            syntax_keyword_t *k;
+            char *fg, *bg, *attrs;
+
+            k = g_new0 (syntax_keyword_t, 1);
+            g_ptr_array_add (c->keyword, k);
+
+            k->keyword = syntax_cache_get_str (&r);
+            k->whole_word_chars_left = syntax_cache_get_str (&r);
+            k->whole_word_chars_right = syntax_cache_get_str (&r);
+            k->line_start = (long) syntax_cache_get_u32 (&r);
+            fg = syntax_cache_get_str (&r);
+            bg = syntax_cache_get_str (&r);
+            attrs = syntax_cache_get_str (&r);
+            if (k->keyword == NULL || c->left == NULL || c->right == NULL)
+                r.error = TRUE;
+            else
+                syntax_keyword_set_color (k, fg, bg, attrs);
+            g_free (fg);
+            g_free (bg);
+            g_free (attrs);
+        }
+
+        if (c->keyword->len == 0)
+            r.error = TRUE;
+    }
+
+    if (r.error || rules->len == 0)
+        goto fail;
+
+    g_ptr_array_free (r.strings, TRUE);
+    g_free (data);
+
+    for (i = 0; i < rules->len; i++)
+    {
+        context_rule_t *c = CONTEXT_RULE (g_ptr_array_index (rules, i));
+
+        c->keyword_trie = syntax_trie_new (c->keyword);
+    }
+
+    return syntax_rule_set_new (key, rules, is_case_insensitive, sources);
+
+  fail:
+    if (rules != NULL)
+    {
+        g_ptr_array_foreach (rules, (GFunc) context_rule_free, NULL);
+        g_ptr_array_free (rules, TRUE);
+    }
+    if (sources != NULL)
+        g_ptr_array_free (sources, TRUE);
+    g_ptr_array_free (r.strings, TRUE);
+    g_free (data);
+    return NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1255,14 +2134,18 @@ edit_read_syntax_file (WEdit * edit, GPtrArray * pnames, const char *syntax_file
     char *lib_file;
     gboolean found = FALSE;
 
-    f = fopen (syntax_file, "r");
+    lib_file = g_strdup (syntax_file);
+    f = fopen (lib_file, "r");
     if (f == NULL)
     {
+        g_free (lib_file);
         lib_file = g_build_filename (mc_global.share_data_dir, "syntax", "Syntax", (char *) NULL);
         f = fopen (lib_file, "r");
-        g_free (lib_file);
         if (f == NULL)
+        {
+            g_free (lib_file);
             return -1;
+        }
     }
 
     args[0] = NULL;
@@ -1328,11 +2211,46 @@ edit_read_syntax_file (WEdit * edit, GPtrArray * pnames, const char *syntax_file
             }
             if (q)
             {
-                int line_error;
+                int line_error = 0;
                 char *syntax_type;
+                char *key = NULL;
+                syntax_rule_set_t *set = NULL;
               found_type:
                 syntax_type = args[2];
-                line_error = edit_read_syntax_rules (edit, g ? g : f, args, 1023);
+
+                /* rules of the same type are shared and cached */
+                if (g == NULL && syntax_type != NULL)
+                {
+                    key = g_strconcat (lib_file, "\n", syntax_type, (char *) NULL);
+                    set = syntax_rule_set_find (key);
+                    if (set == NULL)
+                        set = syntax_cache_load (key);
+                }
+
+                if (set != NULL)
+                    syntax_rule_set_attach (edit, set);
+                else
+                {
+                    syntax_sources = g_ptr_array_new_with_free_func (syntax_source_free);
+                    syntax_source_add (lib_file, TRUE);
+                    line_error = edit_read_syntax_rules (edit, g ? g : f, args, 1023);
+
+                    if (line_error == 0 && key != NULL && edit->rules != NULL
+                        && syntax_sources != NULL)
+                    {
+                        set = syntax_rule_set_new (key, edit->rules, edit->is_case_insensitive,
+                                                   syntax_sources);
+                        syntax_sources = NULL;
+                        syntax_rule_set_attach (edit, set);
+                        syntax_cache_save (set);
+                    }
+
+                    if (syntax_sources != NULL)
+                        g_ptr_array_free (syntax_sources, TRUE);
+                    syntax_sources = NULL;
+                }
+                g_free (key);
+
                 if (line_error)
                 {
                     if (!error_file_name)       /* an included file */
@@ -1368,6 +2286,7 @@ edit_read_syntax_file (WEdit * edit, GPtrArray * pnames, const char *syntax_file
     }
     g_free (l);
     fclose (f);
+    g_free (lib_file);
     return result;
 }
 
@@ -1419,6 +2338,157 @@ edit_get_syntax_color (WEdit * edit, off_t byte_index)
     return EDITOR_NORMAL_COLOR;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get state of highlighting after byte.
+ *
+ * @param edit editor object
+ * @param byte_index offset of byte
+ * @param rule where to store state, it's zeroed if highlighting is off
+ */
+
+void
+edit_get_syntax_rule (WEdit * edit, off_t byte_index, edit_syntax_rule_t * rule)
+{
+    if (edit->rules != NULL && byte_index < edit->buffer.size && option_syntax_highlighting)
+    {
+        edit_get_rule (edit, byte_index);
+        *rule = edit->rule;
+    }
+    else
+        memset (rule, 0, sizeof (*rule));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check if spelling of text is checked at byte.
+ *
+ * @param edit editor object
+ * @param byte_index offset of byte
+ *
+ * @return TRUE if there are no highlighting rules or the byte is in context with spell checking
+ */
+
+gboolean
+edit_get_syntax_spelling (WEdit * edit, off_t byte_index)
+{
+    if (edit->rules == NULL)
+        return TRUE;
+
+    if (!option_syntax_highlighting || byte_index >= edit->buffer.size)
+        return FALSE;
+
+    edit_get_rule (edit, byte_index);
+    return CONTEXT_RULE (g_ptr_array_index (edit->rules, edit->rule.context))->spelling;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare states of highlighting after the same byte.
+ * Ends of keywords and delimiters before the byte don't affect highlighting of following bytes.
+ *
+ * @param r1 state
+ * @param r2 state saved before the text was changed
+ * @param end_shift shift of r2->end due to change of text
+ * @param offset offset of byte
+ *
+ * @return TRUE if highlighting of following bytes is the same with both states
+ */
+
+gboolean
+edit_syntax_rule_equal (const edit_syntax_rule_t * r1, const edit_syntax_rule_t * r2,
+                        off_t end_shift, off_t offset)
+{
+    off_t end1, end2;
+
+    end1 = r1->end > offset ? r1->end : -1;
+    end2 = r2->end + end_shift > offset ? r2->end + end_shift : -1;
+
+    return (r1->keyword == r2->keyword && r1->context == r2->context
+            && r1->_context == r2->_context && r1->border == r2->border && end1 == end2);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget highlighting states which depend on changed text. Checkpoints after the change are kept
+ * to be verified: when highlighting state after the change becomes equal to the old one, the
+ * following checkpoints are valid again.
+ *
+ * @param edit editor object
+ * @param offset position of change
+ * @param len number of inserted (if positive) or deleted (if negative) bytes
+ */
+
+void
+edit_syntax_text_changed (WEdit * edit, off_t offset, off_t len)
+{
+    GArray *markers = edit->syntax_marker;
+    GArray *old = edit->syntax_marker_old;
+    off_t bol, end;
+    guint i, n;
+    syntax_marker_t *m;
+
+    /* keywords are matched within line mostly: look from the newline before the change */
+    bol = edit_buffer_get_bol (&edit->buffer, offset) - 1;
+    /* end of deleted text */
+    end = len < 0 ? offset - len : offset;
+
+    if (edit->last_get_rule >= bol || edit->rule.end >= offset - 1)
+    {
+        /* current state is unknown now */
+        memset (&edit->rule, 0, sizeof (edit->rule));
+        edit->last_get_rule = -2;
+    }
+
+    if (markers == NULL)
+        return;
+
+    /* old checkpoints before the change: drop the rest, they can't be shifted by other value */
+    for (n = 0; n < old->len; n++)
+    {
+        m = SYNTAX_MARKER (old, n);
+        if (m->offset + edit->syntax_marker_shift < bol
+            && m->rule.end + edit->syntax_marker_shift < offset - 1)
+            break;
+    }
+
+    if (n < old->len)
+    {
+        g_array_remove_range (old, 0, n);
+        return;
+    }
+
+    /* all old checkpoints are after the change */
+    while (old->len != 0
+           && SYNTAX_MARKER (old, old->len - 1)->offset + edit->syntax_marker_shift < end)
+        g_array_set_size (old, old->len - 1);
+
+    edit->syntax_marker_shift += len;
+
+    /* checkpoints after the change become old */
+    for (i = markers->len; i != 0; i--)
+    {
+        m = SYNTAX_MARKER (markers, i - 1);
+
+        if (m->offset >= end)
+        {
+            syntax_marker_t s = *m;
+
+            s.offset += len - edit->syntax_marker_shift;
+            s.rule.end += len - edit->syntax_marker_shift;
+            s.stale = FALSE;
+            g_array_append_val (old, s);
+        }
+        else if (m->offset < bol && m->rule.end < offset - 1)
+            break;
+    }
+
+    g_array_set_size (markers, i);
+
+    if (old->len != 0)
+        SYNTAX_MARKER (old, old->len - 1)->stale = TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -1436,12 +2506,27 @@ edit_free_syntax_rules (WEdit * edit)
     edit_get_rule (edit, -1);
     MC_PTR_FREE (edit->syntax_type);
 
-    g_ptr_array_foreach (edit->rules, (GFunc) context_rule_free, NULL);
-    g_ptr_array_free (edit->rules, TRUE);
+    if (edit->rule_set != NULL)
+    {
+        syntax_rule_set_unref (edit->rule_set);
+        edit->rule_set = NULL;
+    }
+    else
+    {
+        g_ptr_array_foreach (edit->rules, (GFunc) context_rule_free, NULL);
+        g_ptr_array_free (edit->rules, TRUE);
+    }
     edit->rules = NULL;
-    g_slist_free_full (edit->syntax_marker, g_free);
-    edit->syntax_marker = NULL;
-    tty_color_free_all_tmp ();
+    if (edit->syntax_marker != NULL)
+    {
+        g_array_free (edit->syntax_marker, TRUE);
+        g_array_free (edit->syntax_marker_old, TRUE);
+        edit->syntax_marker = NULL;
+        edit->syntax_marker_old = NULL;
+    }
+    /* colors are allocated for rules, other editors can use them yet */
+    if (syntax_rule_sets == NULL)
+        tty_color_free_all_tmp ();
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1467,6 +2552,8 @@ edit_load_syntax (WEdit * edit, GPtrArray * pnames, const char *type)
         saved_type = g_strdup (type);   /* save edit->syntax_type */
         edit_free_syntax_rules (edit);
         edit->syntax_type = saved_type; /* restore edit->syntax_type */
+        /* brackets in strings and comments depend on rules */
+        edit_bracket_index_reset (&edit->bracket_index);
     }
 
     if (!tty_use_colors ())
@@ -100,6 +100,7 @@ typedef struct
     /* file content options */
     gboolean content_case_sens;
     gboolean content_regexp;
+    gboolean content_any_word;
     gboolean content_first_hit;
     gboolean content_whole_words;
     gboolean content_all_charsets;
@@ -117,6 +118,24 @@ typedef struct
     gsize end;
 } find_match_location_t;
 
+/* node of tree of absolute ignored paths */
+typedef struct find_ignore_node_t
+{
+    GHashTable *children;       /* path component -> node */
+    gboolean is_end;            /* path ending here is ignored with all subdirectories */
+} find_ignore_node_t;
+
+/* list of ignored directories compiled for fast lookup */
+typedef struct
+{
+    GHashTable *names;          /* relative names without path separator */
+    GPtrArray *paths;           /* relative paths with path separator */
+    find_ignore_node_t *root;   /* absolute paths */
+    GPtrArray *globs;           /* mc_search_t: shell patterns without path separator, ones with
+                                   '*' and '?' only are searched by single multi-pattern search */
+    GPtrArray *path_globs;      /* mc_search_t: shell patterns with path separator */
+} find_ignore_dirs_t;
+
 /*** file scope variables ************************************************************************/
 
 /* button callbacks */
@@ -125,7 +144,7 @@ static int find_do_view_file (WButton * button, int action);
 static int find_do_edit_file (WButton * button, int action);
 
 /* Parsed ignore dirs */
-static char **find_ignore_dirs = NULL;
+static find_ignore_dirs_t *find_ignore_dirs = NULL;
 
 /* static variables to remember find parameters */
 static WInput *in_start;        /* Start path */
@@ -139,6 +158,7 @@ static WCheck *recursively_cbox;
 static WCheck *skip_hidden_cbox;
 static WCheck *content_case_sens_cbox;  /* "case sensitive" checkbox */
 static WCheck *content_regexp_cbox;     /* "find regular expression" checkbox */
+static WCheck *content_any_word_cbox;   /* "any of these words" checkbox */
 static WCheck *content_first_hit_cbox;  /* "First hit" checkbox" */
 static WCheck *content_whole_words_cbox;        /* "whole words" checkbox */
 #ifdef HAVE_CHARSET
@@ -205,9 +225,21 @@ static const size_t quit_button = 4;    /* index of "Quit" button */
 static WListbox *find_list;     /* Listbox with the file list */
 
 static find_file_options_t options = {
-    TRUE, TRUE, TRUE, FALSE, FALSE,
-    TRUE, FALSE, FALSE, FALSE, FALSE,
-    FALSE, NULL
+    .file_case_sens = TRUE,
+    .file_pattern = TRUE,
+    .find_recurs = TRUE,
+    .skip_hidden = FALSE,
+    .file_all_charsets = FALSE,
+
+    .content_case_sens = TRUE,
+    .content_regexp = FALSE,
+    .content_any_word = FALSE,
+    .content_first_hit = FALSE,
+    .content_whole_words = FALSE,
+    .content_all_charsets = TRUE,
+
+    .ignore_dirs_enable = FALSE,
+    .ignore_dirs = NULL
 };
 
 static char *in_start_dir = INPUT_LAST_TEXT;
@@ -230,50 +262,280 @@ max (int a, int b)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static find_ignore_node_t *
+find_ignore_node_new (void)
+{
+    find_ignore_node_t *node;
+
+    node = g_new (find_ignore_node_t, 1);
+    node->children = NULL;
+    node->is_end = FALSE;
+
+    return node;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
-parse_ignore_dirs (const char *ignore_dirs)
+find_ignore_node_free (find_ignore_node_t * node)
 {
-    size_t r = 0, w = 0;        /* read and write iterators */
+    if (node->children != NULL)
+        g_hash_table_destroy (node->children);
+    g_free (node);
+}
 
-    if (!options.ignore_dirs_enable || ignore_dirs == NULL || ignore_dirs[0] == '\0')
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_ignore_dirs_free (find_ignore_dirs_t * ignore_dirs)
+{
+    if (ignore_dirs == NULL)
         return;
 
-    find_ignore_dirs = g_strsplit (ignore_dirs, ":", -1);
+    g_hash_table_destroy (ignore_dirs->names);
+    g_ptr_array_free (ignore_dirs->paths, TRUE);
+    find_ignore_node_free (ignore_dirs->root);
+    g_ptr_array_free (ignore_dirs->globs, TRUE);
+    g_ptr_array_free (ignore_dirs->path_globs, TRUE);
+    g_free (ignore_dirs);
+}
 
-    /* Values like '/foo::/bar: produce holes in list.
-     * Find and remove them */
-    for (; find_ignore_dirs[r] != NULL; r++)
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get next component of path.
+ *
+ * @param path path, is updated to point to the rest of path
+ * @param len length of component (output)
+ *
+ * @return pointer to the component, NULL if there are no more components
+ */
+
+static const char *
+find_ignore_next_component (const char **path, size_t * len)
+{
+    const char *p = *path;
+    const char *start;
+
+    while (IS_PATH_SEP (*p))
+        p++;
+
+    if (*p == '\0')
+        return NULL;
+
+    start = p;
+    while (*p != '\0' && !IS_PATH_SEP (*p))
+        p++;
+
+    *len = p - start;
+    *path = p;
+
+    return start;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_ignore_dirs_add_absolute (find_ignore_dirs_t * ignore_dirs, const char *dir)
+{
+    find_ignore_node_t *node = ignore_dirs->root;
+    const char *component;
+    size_t len;
+
+    while ((component = find_ignore_next_component (&dir, &len)) != NULL)
     {
-        if (find_ignore_dirs[r][0] == '\0')
-        {
-            /* empty entry -- skip it */
-            MC_PTR_FREE (find_ignore_dirs[r]);
-            continue;
-        }
+        find_ignore_node_t *child = NULL;
+        char *name;
 
-        if (r != w)
+        name = g_strndup (component, len);
+
+        if (node->children == NULL)
+            node->children =
+                g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify) find_ignore_node_free);
+        else
+            child = (find_ignore_node_t *) g_hash_table_lookup (node->children, name);
+
+        if (child != NULL)
+            g_free (name);
+        else
         {
-            /* copy entry to the previous free array cell */
-            find_ignore_dirs[w] = find_ignore_dirs[r];
-            find_ignore_dirs[r] = NULL;
+            child = find_ignore_node_new ();
+            g_hash_table_insert (node->children, name, child);
         }
 
-        canonicalize_pathname (find_ignore_dirs[w]);
-        if (find_ignore_dirs[w][0] != '\0')
-            w++;
+        node = child;
+    }
+
+    node->is_end = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add shell pattern to the list of patterns of multi-pattern search.
+ */
+
+static void
+find_ignore_multi_glob_add (GString * multi_globs, const char *dir)
+{
+    const char *p;
+
+    if (multi_globs->len != 0)
+        g_string_append_c (multi_globs, ' ');
+
+    for (p = dir; *p != '\0'; p++)
+    {
+        if (*p == '\\' || g_ascii_isspace (*p))
+            g_string_append_c (multi_globs, '\\');
+        g_string_append_c (multi_globs, *p);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_ignore_dirs_add (find_ignore_dirs_t * ignore_dirs, char *dir, GString * multi_globs)
+{
+    gboolean has_sep;
+
+    has_sep = strchr (dir, PATH_SEP) != NULL;
+#ifdef PATH_SEP2
+    has_sep = has_sep || strchr (dir, PATH_SEP2) != NULL;
+#endif
+
+    if (!has_sep && strpbrk (dir, "*?") != NULL && strpbrk (dir, "[{") == NULL)
+    {
+        /* all such patterns are matched at once */
+        find_ignore_multi_glob_add (multi_globs, dir);
+        g_free (dir);
+    }
+    else if (strpbrk (dir, "*?[{") != NULL)
+    {
+        mc_search_t *search;
+
+        search = mc_search_new (dir, NULL);
+        search->search_type = MC_SEARCH_T_GLOB;
+        search->is_entire_line = TRUE;
+        search->is_case_sensitive = TRUE;
+
+        if (!mc_search_prepare (search))
+            mc_search_free (search);
+        else if (has_sep)
+            g_ptr_array_add (ignore_dirs->path_globs, search);
+        else
+            g_ptr_array_add (ignore_dirs->globs, search);
+
+        g_free (dir);
+    }
+    else if (g_path_is_absolute (dir))
+    {
+        find_ignore_dirs_add_absolute (ignore_dirs, dir);
+        g_free (dir);
+    }
+    else if (has_sep)
+        g_ptr_array_add (ignore_dirs->paths, dir);
+    else
+        g_hash_table_replace (ignore_dirs->names, dir, dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compile list of ignored directories. Shell patterns are supported.
+ */
+
+static void
+parse_ignore_dirs (const char *ignore_dirs)
+{
+    char **dirs;
+    size_t i;
+    GString *multi_globs;
+
+    if (!options.ignore_dirs_enable || ignore_dirs == NULL || ignore_dirs[0] == '\0')
+        return;
+
+    find_ignore_dirs = g_new (find_ignore_dirs_t, 1);
+    find_ignore_dirs->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    find_ignore_dirs->paths = g_ptr_array_new_with_free_func (g_free);
+    find_ignore_dirs->root = find_ignore_node_new ();
+    find_ignore_dirs->globs = g_ptr_array_new_with_free_func ((GDestroyNotify) mc_search_free);
+    find_ignore_dirs->path_globs =
+        g_ptr_array_new_with_free_func ((GDestroyNotify) mc_search_free);
+
+    dirs = g_strsplit (ignore_dirs, ":", -1);
+    multi_globs = g_string_new (NULL);
+
+    for (i = 0; dirs[i] != NULL; i++)
+    {
+        /* Values like '/foo::/bar: produce holes in list. Skip them */
+        if (dirs[i][0] != '\0')
+            canonicalize_pathname (dirs[i]);
+
+        if (dirs[i][0] == '\0')
+            g_free (dirs[i]);
         else
-            MC_PTR_FREE (find_ignore_dirs[w]);
+            find_ignore_dirs_add (find_ignore_dirs, dirs[i], multi_globs);
     }
 
-    if (find_ignore_dirs[0] == NULL)
+    /* strings are owned by find_ignore_dirs now */
+    g_free (dirs);
+
+    if (multi_globs->len != 0)
     {
-        g_strfreev (find_ignore_dirs);
+        mc_search_t *search;
+
+        search = mc_search_new_len (multi_globs->str, multi_globs->len, NULL);
+        search->search_type = MC_SEARCH_T_MULTI;
+        search->is_entire_line = TRUE;
+        search->is_case_sensitive = TRUE;
+
+        if (mc_search_prepare (search))
+            g_ptr_array_add (find_ignore_dirs->globs, search);
+        else
+            mc_search_free (search);
+    }
+
+    g_string_free (multi_globs, TRUE);
+
+    if (g_hash_table_size (find_ignore_dirs->names) == 0 && find_ignore_dirs->paths->len == 0
+        && find_ignore_dirs->root->children == NULL && !find_ignore_dirs->root->is_end
+        && find_ignore_dirs->globs->len == 0 && find_ignore_dirs->path_globs->len == 0)
+    {
+        find_ignore_dirs_free (find_ignore_dirs);
         find_ignore_dirs = NULL;
     }
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
+static gboolean
+find_ignore_globs_match (GPtrArray * globs, const char *str)
+{
+    guint i;
+
+    for (i = 0; i < globs->len; i++)
+    {
+        mc_search_t *search = (mc_search_t *) g_ptr_array_index (globs, i);
+
+        if (mc_search_run (search, str, 0, strlen (str), NULL))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check one component of directory path against relative names.
+ */
+
+static gboolean
+find_ignore_name_search (const char *name)
+{
+    return (g_hash_table_lookup (find_ignore_dirs->names, name) != NULL
+            || find_ignore_globs_match (find_ignore_dirs->globs, name));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
 find_load_options (void)
 {
@@ -298,12 +560,14 @@ find_load_options (void)
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_case_sens", TRUE);
     options.content_regexp =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_regexp", FALSE);
+    options.content_any_word =
+        mc_config_get_bool (mc_global.main_config, "FindFile", "content_any_word", FALSE);
     options.content_first_hit =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_first_hit", FALSE);
     options.content_whole_words =
         mc_config_get_bool (mc_global.main_config, "FindFile", "content_whole_words", FALSE);
     options.content_all_charsets =
-        mc_config_get_bool (mc_global.main_config, "FindFile", "content_all_charsets", FALSE);
+        mc_config_get_bool (mc_global.main_config, "FindFile", "content_all_charsets", TRUE);
     options.ignore_dirs_enable =
         mc_config_get_bool (mc_global.main_config, "FindFile", "ignore_dirs_enable", TRUE);
     options.ignore_dirs =
@@ -330,6 +594,8 @@ find_save_options (void)
                         options.content_case_sens);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_regexp",
                         options.content_regexp);
+    mc_config_set_bool (mc_global.main_config, "FindFile", "content_any_word",
+                        options.content_any_word);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_first_hit",
                         options.content_first_hit);
     mc_config_set_bool (mc_global.main_config, "FindFile", "content_whole_words",
@@ -449,6 +715,7 @@ static void
 find_toggle_enable_content (void)
 {
     widget_disable (WIDGET (content_regexp_cbox), content_is_empty);
+    widget_disable (WIDGET (content_any_word_cbox), content_is_empty);
     widget_disable (WIDGET (content_case_sens_cbox), content_is_empty);
 #ifdef HAVE_CHARSET
     widget_disable (WIDGET (content_all_charsets_cbox), content_is_empty);
@@ -511,7 +778,8 @@ find_parm_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, voi
         }
 
         /* check content regexp */
-        if (content_regexp_cbox->state && !content_is_empty && !find_check_regexp (in_with->buffer))
+        if (content_regexp_cbox->state && !content_any_word_cbox->state && !content_is_empty
+            && !find_check_regexp (in_with->buffer))
         {
             /* Don't stop the dialog */
             widget_set_state (WIDGET (h), WST_ACTIVE, TRUE);
@@ -567,9 +835,9 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
 {
     /* Size of the find parameters window */
 #ifdef HAVE_CHARSET
-    const int lines = 18;
+    const int lines = 19;
 #else
-    const int lines = 17;
+    const int lines = 18;
 #endif
     int cols = 68;
 
@@ -589,6 +857,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
     const char *content_content_label = N_("Content:");
     const char *content_use_label = N_("Sea&rch for content");
     const char *content_regexp_label = N_("Re&gular expression");
+    const char *content_any_word_label = N_("Any of these wor&ds");
     const char *content_case_label = N_("Case sens&itive");
 #ifdef HAVE_CHARSET
     const char *content_all_charsets_label = N_("A&ll charsets");
@@ -621,6 +890,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
         content_content_label = _(content_content_label);
         content_use_label = _(content_use_label);
         content_regexp_label = _(content_regexp_label);
+        content_any_word_label = _(content_any_word_label);
         content_case_label = _(content_case_label);
 #ifdef HAVE_CHARSET
         content_all_charsets_label = _(content_all_charsets_label);
@@ -648,6 +918,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
     cw = max (cw, str_term_width1 (content_content_label) + 4);
     cw = max (cw, str_term_width1 (content_use_label) + 4);
     cw = max (cw, str_term_width1 (content_regexp_label) + 4);
+    cw = max (cw, str_term_width1 (content_any_word_label) + 4);
     cw = max (cw, str_term_width1 (content_case_label) + 4);
 #ifdef HAVE_CHARSET
     cw = max (cw, str_term_width1 (content_all_charsets_label) + 4);
@@ -742,6 +1013,10 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
     content_regexp_cbox = check_new (y2++, x2, options.content_regexp, content_regexp_label);
     add_widget (find_dlg, content_regexp_cbox);
 
+    content_any_word_cbox =
+        check_new (y2++, x2, options.content_any_word, content_any_word_label);
+    add_widget (find_dlg, content_any_word_cbox);
+
     content_case_sens_cbox = check_new (y2++, x2, options.content_case_sens, content_case_label);
     add_widget (find_dlg, content_case_sens_cbox);
 
@@ -805,6 +1080,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
 #endif
             options.content_case_sens = content_case_sens_cbox->state;
             options.content_regexp = content_regexp_cbox->state;
+            options.content_any_word = content_any_word_cbox->state;
             options.content_first_hit = content_first_hit_cbox->state;
             options.content_whole_words = content_whole_words_cbox->state;
             options.find_recurs = recursively_cbox->state;
@@ -1187,53 +1463,89 @@ search_content (WDialog * h, const char *directory, const char *filename)
 static gboolean
 find_ignore_dir_search (const char *dir)
 {
-    if (find_ignore_dirs != NULL)
+    const find_ignore_node_t *node;
+    const char *p;
+    const char *component;
+    size_t len;
+    guint i;
+
+    if (find_ignore_dirs == NULL)
+        return FALSE;
+
+    if (!g_path_is_absolute (dir))
     {
-        const size_t dlen = strlen (dir);
-        const unsigned char dabs = g_path_is_absolute (dir) ? 1 : 0;
+        /* name of directory entry */
+        if (find_ignore_name_search (dir))
+            return TRUE;
 
-        char **ignore_dir;
+        for (i = 0; i < find_ignore_dirs->paths->len; i++)
+        {
+            const char *ignore_dir = (const char *) g_ptr_array_index (find_ignore_dirs->paths, i);
+            const size_t ilen = strlen (ignore_dir);
 
-        for (ignore_dir = find_ignore_dirs; *ignore_dir != NULL; ignore_dir++)
+            if (strncmp (dir, ignore_dir, ilen) == 0
+                && (dir[ilen] == '\0' || IS_PATH_SEP (dir[ilen])))
+                return TRUE;
+        }
+
+        return FALSE;
+    }
+
+    /* walk along absolute path: check tree of absolute ignore dirs and relative names */
+    node = find_ignore_dirs->root;
+    p = dir;
+
+    while ((component = find_ignore_next_component (&p, &len)) != NULL)
+    {
+        char *name;
+        gboolean found;
+
+        name = g_strndup (component, len);
+
+        if (node != NULL)
         {
-            const size_t ilen = strlen (*ignore_dir);
-            const unsigned char iabs = g_path_is_absolute (*ignore_dir) ? 2 : 0;
+            node = node->children == NULL ? NULL :
+                (const find_ignore_node_t *) g_hash_table_lookup (node->children, name);
+            found = node != NULL && node->is_end;
+        }
+        else
+            found = FALSE;
 
-            /* ignore dir is too long -- skip it */
-            if (dlen < ilen)
-                continue;
+        found = found || find_ignore_name_search (name);
+        g_free (name);
 
-            /* handle absolute and relative paths */
-            switch (iabs | dabs)
-            {
-            case 0:            /* both paths are relative */
-            case 3:            /* both paths are abolute */
-                /* if ignore dir is not a path  of dir -- skip it */
-                if (strncmp (dir, *ignore_dir, ilen) == 0)
-                {
-                    /* be sure that ignore dir is not a part of dir like:
-                       ignore dir is "h", dir is "home" */
-                    if (dir[ilen] == '\0' || IS_PATH_SEP (dir[ilen]))
-                        return TRUE;
-                }
-                break;
-            case 1:            /* dir is absolute, ignore_dir is relative */
-                {
-                    char *d;
+        if (found)
+            return TRUE;
+    }
 
-                    d = strstr (dir, *ignore_dir);
-                    if (d != NULL && IS_PATH_SEP (d[-1])
-                        && (d[ilen] == '\0' || IS_PATH_SEP (d[ilen])))
-                        return TRUE;
-                }
-                break;
-            case 2:            /* dir is relative, ignore_dir is absolute */
-                /* FIXME: skip this case */
-                break;
-            default:           /* this cannot occurs */
-                return FALSE;
-            }
+    /* relative paths: ignore dir shall be a part of dir like "/home/user/foo/bar" for "foo/bar" */
+    for (i = 0; i < find_ignore_dirs->paths->len; i++)
+    {
+        const char *ignore_dir = (const char *) g_ptr_array_index (find_ignore_dirs->paths, i);
+        const size_t ilen = strlen (ignore_dir);
+        const char *d;
+
+        for (d = strstr (dir, ignore_dir); d != NULL; d = strstr (d + 1, ignore_dir))
+            if (d != dir && IS_PATH_SEP (d[-1]) && (d[ilen] == '\0' || IS_PATH_SEP (d[ilen])))
+                return TRUE;
+    }
+
+    /* shell patterns with path separator: absolute ones are matched against the whole path,
+       relative ones are matched against every tail of path */
+    for (i = 0; i < find_ignore_dirs->path_globs->len; i++)
+    {
+        mc_search_t *search = (mc_search_t *) g_ptr_array_index (find_ignore_dirs->path_globs, i);
+
+        if (g_path_is_absolute (search->original))
+        {
+            if (mc_search_run (search, dir, 0, strlen (dir), NULL))
+                return TRUE;
         }
+        else
+            for (p = dir; *p != '\0'; p++)
+                if (IS_PATH_SEP (*p) && !IS_PATH_SEP (p[1]) && p[1] != '\0'
+                    && mc_search_run (search, p + 1, 0, strlen (p + 1), NULL))
+                    return TRUE;
     }
 
     return FALSE;
@@ -1419,7 +1731,7 @@ init_find_vars (void)
     /* Remove all the items from the stack */
     clear_stack ();
 
-    g_strfreev (find_ignore_dirs);
+    find_ignore_dirs_free (find_ignore_dirs);
     find_ignore_dirs = NULL;
 }
 
@@ -1708,8 +2020,11 @@ run_process (void)
     search_content_handle = mc_search_new (content_pattern, NULL);
     if (search_content_handle)
     {
-        search_content_handle->search_type =
-            options.content_regexp ? MC_SEARCH_T_REGEX : MC_SEARCH_T_NORMAL;
+        if (options.content_any_word)
+            search_content_handle->search_type = MC_SEARCH_T_MULTI;
+        else
+            search_content_handle->search_type =
+                options.content_regexp ? MC_SEARCH_T_REGEX : MC_SEARCH_T_NORMAL;
         search_content_handle->is_case_sensitive = options.content_case_sens;
         search_content_handle->whole_words = options.content_whole_words;
 #ifdef HAVE_CHARSET
@@ -53,6 +53,7 @@
 #include "lib/fileloc.h"
 #include "lib/strutil.h"
 #include "lib/util.h"
+#include "lib/search.h"         /* mc_search_cache_free(), mc_search_log_stats() */
 #include "lib/vfs/vfs.h"        /* vfs_init(), vfs_shut() */
 
 #include "filemanager/midnight.h"       /* current_panel */
@@ -424,6 +425,8 @@ main (int argc, char *argv[])
     else
         exit_code = do_nc ()? EXIT_SUCCESS : EXIT_FAILURE;
 
+    mc_search_log_stats ();
+
     disable_bracketed_paste ();
 
     disable_mouse ();
@@ -495,6 +498,8 @@ main (int argc, char *argv[])
     }
 #endif /* USE_INTERNAL_EDIT */
 
+    mc_search_cache_free ();
+
     str_uninit_strings ();
 
     if (mc_global.mc_run_mode != MC_RUN_EDITOR)
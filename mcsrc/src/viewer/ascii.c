@@ -282,7 +282,7 @@ mcview_isprint (const WView * view, int c)
 {
 #ifdef HAVE_CHARSET
     if (!view->utf8)
-        c = convert_from_8bit_to_utf_c ((unsigned char) c, view->converter);
+        c = view->utf_table[(unsigned char) c];
     return g_unichar_isprint (c);
 #else
     (void) view;
@@ -300,7 +300,7 @@ mcview_char_display (const WView * view, int c, char *s)
     if (mc_global.utf8_display)
     {
         if (!view->utf8)
-            c = convert_from_8bit_to_utf_c ((unsigned char) c, view->converter);
+            c = view->utf_table[(unsigned char) c];
         if (!g_unichar_isprint (c))
             c = '.';
         return g_unichar_to_utf8 (c, s);
@@ -231,6 +231,48 @@ mcview_get_ptr_string (WView * view, off_t byte_index)
     return NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to contiguous block of data started at specified offset.
+ *
+ * @param view viewer object
+ * @param byte_index offset of the first byte
+ * @param len length of contiguous block
+ *
+ * @return pointer to byte at byte_index, NULL if there are no data at that offset
+ */
+
+char *
+mcview_get_span (WView * view, off_t byte_index, size_t * len)
+{
+    char *p = NULL;
+
+    *len = 0;
+
+    switch (view->datasource)
+    {
+    case DS_STDIO_PIPE:
+    case DS_VFS_PIPE:
+        p = mcview_get_span_growing_buffer (view, byte_index, len);
+        break;
+    case DS_FILE:
+        p = mcview_get_ptr_file (view, byte_index);
+        if (p != NULL)
+            *len = view->ds_file_offset + view->ds_file_datalen - byte_index;
+        break;
+    case DS_STRING:
+        p = mcview_get_ptr_string (view, byte_index);
+        if (p != NULL)
+            *len = view->ds_string_len - byte_index;
+        break;
+    case DS_NONE:
+    default:
+        break;
+    }
+
+    return p;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
@@ -289,3 +289,31 @@ mcview_get_ptr_growing_buffer (WView * view, off_t byte_index)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to the contiguous part of the growing buffer page started at specified offset.
+ */
+
+char *
+mcview_get_span_growing_buffer (WView * view, off_t byte_index, size_t * len)
+{
+    char *p;
+    off_t pageno, pageindex;
+
+    *len = 0;
+
+    p = mcview_get_ptr_growing_buffer (view, byte_index);
+    if (p == NULL)
+        return NULL;
+
+    pageno = byte_index / VIEW_PAGE_SIZE;
+    pageindex = byte_index % VIEW_PAGE_SIZE;
+
+    if (pageno < (off_t) view->growbuf_blockptr->len - 1)
+        *len = VIEW_PAGE_SIZE - pageindex;
+    else
+        *len = view->growbuf_lastindex - pageindex;
+
+    return p;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -327,7 +327,7 @@ mcview_display_hex (WView * view)
             {
                 if (!view->utf8)
                 {
-                    c = convert_from_8bit_to_utf_c ((unsigned char) c, view->converter);
+                    c = view->utf_table[(unsigned char) c];
                 }
                 if (!g_unichar_isprint (c))
                     c = '.';
@@ -190,6 +190,9 @@ struct WView
 
     /* converter for translation of text */
     GIConv converter;
+#ifdef HAVE_CHARSET
+    int utf_table[256];         /* 8-bit codepage of file -> Unicode */
+#endif
 
     GArray *saved_bookmarks;
 
@@ -254,6 +257,7 @@ off_t mcview_get_filesize (WView *);
 void mcview_update_filesize (WView * view);
 char *mcview_get_ptr_file (WView *, off_t);
 char *mcview_get_ptr_string (WView *, off_t);
+char *mcview_get_span (WView * view, off_t byte_index, size_t * len);
 gboolean mcview_get_utf (WView * view, off_t byte_index, int *ch, int *ch_len);
 gboolean mcview_get_byte_string (WView *, off_t, int *);
 gboolean mcview_get_byte_none (WView *, off_t, int *);
@@ -286,6 +290,7 @@ off_t mcview_growbuf_filesize (WView * view);
 void mcview_growbuf_read_until (WView * view, off_t p);
 gboolean mcview_get_byte_growing_buffer (WView * view, off_t p, int *);
 char *mcview_get_ptr_growing_buffer (WView * view, off_t p);
+char *mcview_get_span_growing_buffer (WView * view, off_t byte_index, size_t * len);
 
 /* hex.c: */
 void mcview_display_hex (WView * view);
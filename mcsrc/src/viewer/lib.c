@@ -281,6 +281,8 @@ mcview_set_codeset (WView * view)
         view->utf8 = (gboolean) str_isutf8 (cp_id);
         view->dpy_wrap_dirty = TRUE;
     }
+
+    convert_from_8bit_to_utf_table (view->utf_table, view->converter);
 #else
     (void) view;
 #endif
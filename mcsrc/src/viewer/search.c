@@ -123,6 +123,21 @@ mcview_search_update_steps (WView * view)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static mc_search_cbret_t
+mcview_search_span_callback (const void *user_data, gsize char_offset, const char **span,
+                             gsize * span_len)
+{
+    WView *view = ((const mcview_search_status_msg_t *) user_data)->view;
+    size_t len = 0;
+
+    *span = mcview_get_span (view, (off_t) char_offset, &len);
+    *span_len = (gsize) len;
+
+    return (*span != NULL ? MC_SEARCH_CB_OK : MC_SEARCH_CB_NOTFOUND);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static gboolean
 mcview_find (mcview_search_status_msg_t * ssm, off_t search_start, off_t search_end, gsize * len)
 {
@@ -131,6 +146,9 @@ mcview_find (mcview_search_status_msg_t * ssm, off_t search_start, off_t search_
     view->search_numNeedSkipChar = 0;
     search_cb_char_curr_index = -1;
 
+    /* nroff sequences should be decoded byte by byte */
+    view->search->span_fn = view->mode_flags.nroff ? NULL : mcview_search_span_callback;
+
     if (mcview_search_options.backwards)
     {
         search_end = mcview_get_filesize (view);
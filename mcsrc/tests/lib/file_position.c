@@ -0,0 +1,343 @@
+/*
+   lib - load_file_position() and save_file_position() functions testing
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib"
+
+#include "tests/mctest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "lib/strutil.h"
+#include "lib/vfs/vfs.h"
+#include "lib/fileloc.h"
+#include "lib/mcconfig.h"
+#include "lib/util.h"
+#include "src/vfs/local/local.c"
+
+#define PROFILE_ROOT WORKDIR PATH_SEP_STR "file_position"
+
+static char *filepos_path = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    g_setenv ("MC_PROFILE_ROOT", PROFILE_ROOT, TRUE);
+    str_init_strings ("UTF-8");
+    vfs_init ();
+    init_localfs ();
+    mc_config_init_config_paths (NULL);
+
+    filepos_path = mc_config_get_full_path (MC_FILEPOS_FILE);
+    unlink (filepos_path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    unlink (filepos_path);
+    g_free (filepos_path);
+    mc_config_deinit_config_paths ();
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+save_position (const char *name, long line, long column, off_t offset, size_t bookmark)
+{
+    vfs_path_t *vpath;
+    GArray *bookmarks;
+
+    vpath = vfs_path_from_str (name);
+    bookmarks = g_array_new (FALSE, FALSE, sizeof (size_t));
+    g_array_append_val (bookmarks, bookmark);
+    save_file_position (vpath, line, column, offset, bookmarks);
+    vfs_path_free (vpath);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static long
+load_position (const char *name, long *column, off_t * offset, size_t * bookmark)
+{
+    vfs_path_t *vpath;
+    GArray *bookmarks = NULL;
+    long line;
+
+    vpath = vfs_path_from_str (name);
+    load_file_position (vpath, &line, column, offset, &bookmarks);
+    vfs_path_free (vpath);
+
+    *bookmark = 0;
+    if (bookmarks != NULL)
+    {
+        if (bookmarks->len != 0)
+            *bookmark = g_array_index (bookmarks, size_t, 0);
+        g_array_free (bookmarks, TRUE);
+    }
+
+    return line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static size_t
+count_lines (void)
+{
+    char *contents;
+    size_t i, n = 0;
+    gsize len;
+
+    if (!g_file_get_contents (filepos_path, &contents, &len, NULL))
+        return 0;
+
+    for (i = 0; i < len; i++)
+        if (contents[i] == '\n')
+            n++;
+
+    g_free (contents);
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_file_position_save_load)
+/* *INDENT-ON* */
+{
+    long column;
+    off_t offset;
+    size_t bookmark;
+
+    /* given */
+    save_position ("/some/file name", 10, 2, 300, 7);
+    save_position ("/other/file", 20, 4, 500, 9);
+    save_position ("/some/file name", 11, 3, 310, 8);
+
+    /* when */
+    /* then */
+    mctest_assert_int_eq (load_position ("/some/file name", &column, &offset, &bookmark), 11);
+    mctest_assert_int_eq (column, 3);
+    mctest_assert_int_eq (offset, 310);
+    mctest_assert_int_eq (bookmark, 8);
+    mctest_assert_int_eq (load_position ("/other/file", &column, &offset, &bookmark), 20);
+    mctest_assert_int_eq (load_position ("/unknown", &column, &offset, &bookmark), 1);
+    mctest_assert_int_eq (column, 0);
+    mctest_assert_int_eq (offset, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_file_position_forget)
+/* *INDENT-ON* */
+{
+    vfs_path_t *vpath;
+    long column;
+    off_t offset;
+    size_t bookmark, lines;
+
+    /* given */
+    save_position ("/some/file", 10, 2, 300, 7);
+
+    /* when */
+    vpath = vfs_path_from_str ("/some/file");
+    save_file_position (vpath, 1, 0, 0, NULL);
+    vfs_path_free (vpath);
+
+    lines = count_lines ();
+    vpath = vfs_path_from_str ("/unknown");
+    save_file_position (vpath, 1, 0, 0, NULL);
+    vfs_path_free (vpath);
+
+    /* then */
+    mctest_assert_int_eq (load_position ("/some/file", &column, &offset, &bookmark), 1);
+    mctest_assert_int_eq (column, 0);
+    /* default position of unknown file isn't saved */
+    mctest_assert_int_eq (count_lines (), lines);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_file_position_other_instance)
+/* *INDENT-ON* */
+{
+    FILE *f;
+    long column;
+    off_t offset;
+    size_t bookmark;
+
+    /* given */
+    save_position ("/some/file", 10, 2, 300, 7);
+    mctest_assert_int_eq (load_position ("/some/file", &column, &offset, &bookmark), 10);
+
+    /* when: other instance appends record */
+    f = fopen (filepos_path, "a");
+    fprintf (f, "/some/file 12;1;100\n");
+    fclose (f);
+
+    /* then */
+    mctest_assert_int_eq (load_position ("/some/file", &column, &offset, &bookmark), 12);
+
+    /* when: other instance replaces file */
+    f = fopen (filepos_path, "w");
+    fprintf (f, "/new/file 30;1;100\n");
+    fclose (f);
+
+    /* then */
+    mctest_assert_int_eq (load_position ("/new/file", &column, &offset, &bookmark), 30);
+    mctest_assert_int_eq (load_position ("/some/file", &column, &offset, &bookmark), 1);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_file_position_compaction)
+/* *INDENT-ON* */
+{
+    char name[32];
+    long column;
+    off_t offset;
+    size_t bookmark;
+    gboolean compacted;
+    int i;
+
+    /* given: default filepos_max_saved_entries is 1024 */
+
+    /* when */
+    for (i = 0; i < 3000; i++)
+    {
+        g_snprintf (name, sizeof (name), "/file%d", i);
+        save_position (name, 100 + i, 1, 1, 1);
+    }
+
+    /* then: outdated records are removed, file starts with header line */
+    compacted = count_lines () <= 2 * 1024 + 2;
+    mctest_assert_true (compacted);
+    mctest_assert_int_eq (load_position ("/file0", &column, &offset, &bookmark), 1);
+    for (i = 3000 - 1024; i < 3000; i++)
+    {
+        g_snprintf (name, sizeof (name), "/file%d", i);
+        mctest_assert_int_eq (load_position (name, &column, &offset, &bookmark), 100 + i);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_file_position_legacy)
+/* *INDENT-ON* */
+{
+    FILE *f;
+    char name[32];
+    long column;
+    off_t offset;
+    size_t bookmark;
+    int i;
+
+    /* given: file of older version, the most recent record is the first one */
+    f = fopen (filepos_path, "w");
+    for (i = 1500 - 1; i >= 0; i--)
+        fprintf (f, "/old%d %d;1;1\n", i, 100 + i);
+    fclose (f);
+
+    /* when */
+    for (i = 0; i < 3000; i++)
+    {
+        g_snprintf (name, sizeof (name), "/new%d", i % 100);
+        save_position (name, 100 + i, 1, 1, 1);
+    }
+
+    /* then: the most recent records of old file are kept */
+    mctest_assert_int_eq (load_position ("/old0", &column, &offset, &bookmark), 1);
+    for (i = 1500 - (1024 - 100); i < 1500; i++)
+    {
+        g_snprintf (name, sizeof (name), "/old%d", i);
+        mctest_assert_int_eq (load_position (name, &column, &offset, &bookmark), 100 + i);
+    }
+    for (i = 3000 - 100; i < 3000; i++)
+    {
+        g_snprintf (name, sizeof (name), "/new%d", i % 100);
+        mctest_assert_int_eq (load_position (name, &column, &offset, &bookmark), 100 + i);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_file_position_save_load);
+    tcase_add_test (tc_core, test_file_position_forget);
+    tcase_add_test (tc_core, test_file_position_other_instance);
+    tcase_add_test (tc_core, test_file_position_compaction);
+    tcase_add_test (tc_core, test_file_position_legacy);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "file_position.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,104 @@
+/*
+   libmc - checks for reuse of prepared search conditions
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/cache"
+
+#include "tests/mctest.h"
+
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+test_search (const char *pattern, gboolean case_sens, const char *str)
+{
+    mc_search_t *search;
+    gboolean ret;
+
+    search = mc_search_new (pattern, "UTF-8");
+    search->search_type = MC_SEARCH_T_REGEX;
+    search->is_case_sensitive = case_sens;
+    ret = mc_search_run (search, str, 0, strlen (str), NULL);
+    mc_search_free (search);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_mc_search_cache)
+/* *INDENT-ON* */
+{
+    const mc_search_stats_t *stats;
+
+    /* given */
+    mc_search_cache_free ();
+    mc_search_reset_stats ();
+    stats = mc_search_get_stats ();
+
+    /* when */
+    mctest_assert_true (test_search ("a[0-9]+", TRUE, "xa12"));
+    mctest_assert_true (test_search ("a[0-9]+", TRUE, "a3"));
+    mctest_assert_false (test_search ("a[0-9]+", TRUE, "A3"));
+    /* another flags: another conditions */
+    mctest_assert_true (test_search ("a[0-9]+", FALSE, "A3"));
+    /* invalid pattern is not cached */
+    mctest_assert_false (test_search ("a(", TRUE, "a("));
+    mctest_assert_false (test_search ("a(", TRUE, "a("));
+
+    /* then */
+    mctest_assert_int_eq (stats->compile_count, 4);
+    mctest_assert_int_eq (stats->cache_hits, 2);
+    mctest_assert_int_eq (stats->match_count, 4);
+
+    mc_search_cache_free ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_mc_search_cache);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "mc_search_cache.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,177 @@
+/*
+   libmc - checks for multi-pattern search
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/multi"
+
+#include "tests/mctest.h"
+
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_mc_search_run_multi_ds") */
+/* *INDENT-OFF* */
+static const struct test_mc_search_run_multi_ds
+{
+    const char *data;
+    const char *pattern;
+    gboolean case_sens;
+    gboolean whole_words;
+    gboolean expected_result;
+    off_t expected_offset;
+    gsize expected_len;
+    guint expected_matches;
+} test_mc_search_run_multi_ds[] =
+{
+    { /* 0. leftmost of several patterns */
+        "xx bar yy foo",
+        "foo bar",
+        TRUE,
+        FALSE,
+        TRUE,
+        3,
+        3,
+        2
+    },
+    { /* 1. overlapped patterns */
+        "ushers",
+        "he she his hers",
+        TRUE,
+        FALSE,
+        TRUE,
+        1,
+        3,
+        3
+    },
+    { /* 2. case insensitive */
+        "a Foo b",
+        "foo",
+        FALSE,
+        FALSE,
+        TRUE,
+        2,
+        3,
+        1
+    },
+    { /* 3. whole words */
+        "afoo foo",
+        "foo",
+        TRUE,
+        TRUE,
+        TRUE,
+        5,
+        3,
+        1
+    },
+    { /* 4. wildcard pattern */
+        "zz abbbc xyz",
+        "a*c",
+        TRUE,
+        FALSE,
+        TRUE,
+        3,
+        5,
+        1
+    },
+    { /* 5. escaped space */
+        "say hello world",
+        "hello\\ world",
+        TRUE,
+        FALSE,
+        TRUE,
+        4,
+        11,
+        1
+    },
+    { /* 6. not found */
+        "abcdefgh",
+        "gha xyz",
+        TRUE,
+        FALSE,
+        FALSE,
+        0,
+        0,
+        0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_mc_search_run_multi_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_mc_search_run_multi, test_mc_search_run_multi_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *search;
+    gsize actual_len = 0;
+    gboolean actual_result;
+
+    search = mc_search_new (data->pattern, "UTF-8");
+    search->search_type = MC_SEARCH_T_MULTI;
+    search->is_case_sensitive = data->case_sens;
+    search->whole_words = data->whole_words;
+
+    /* when */
+    actual_result = mc_search_run (search, data->data, 0, strlen (data->data), &actual_len);
+
+    /* then */
+    mctest_assert_int_eq (actual_result, data->expected_result);
+    if (data->expected_result)
+    {
+        mctest_assert_int_eq (search->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (actual_len, data->expected_len);
+        mctest_assert_int_eq (search->multi_matches->len, data->expected_matches);
+    }
+    else
+        mctest_assert_int_eq (search->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (search);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_mc_search_run_multi, test_mc_search_run_multi_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "mc_search_run_multi.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,187 @@
+/*
+   libmc - checks for search in data delivered by contiguous spans
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/span"
+
+#include "tests/mctest.h"
+
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* data is delivered by spans of this size */
+#define TEST_SPAN_SIZE 3
+
+static const char *test_data = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_cbret_t
+test_span_callback (const void *user_data, gsize char_offset, const char **span, gsize * span_len)
+{
+    gsize len;
+
+    (void) user_data;
+
+    len = strlen (test_data);
+    if (char_offset >= len)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *span = test_data + char_offset;
+    *span_len = MIN (TEST_SPAN_SIZE - char_offset % TEST_SPAN_SIZE, len - char_offset);
+
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_mc_search_run_span_ds") */
+/* *INDENT-OFF* */
+static const struct test_mc_search_run_span_ds
+{
+    const char *data;
+    const char *pattern;
+    mc_search_type_t type;
+    gsize start;
+    gboolean expected_result;
+    off_t expected_offset;
+    gsize expected_len;
+} test_mc_search_run_span_ds[] =
+{
+    { /* 0. match inside one span */
+        "abcdef",
+        "de",
+        MC_SEARCH_T_NORMAL,
+        0,
+        TRUE,
+        3,
+        2
+    },
+    { /* 1. match crosses span boundary */
+        "abcdefgh",
+        "cdefg",
+        MC_SEARCH_T_NORMAL,
+        0,
+        TRUE,
+        2,
+        5
+    },
+    { /* 2. match on second line */
+        "ab\ncdef\ngh",
+        "ef",
+        MC_SEARCH_T_NORMAL,
+        0,
+        TRUE,
+        5,
+        2
+    },
+    { /* 3. match started before start position is ignored */
+        "xyz xyz",
+        "xyz",
+        MC_SEARCH_T_NORMAL,
+        1,
+        TRUE,
+        4,
+        3
+    },
+    { /* 4. regex */
+        "one two\nthree",
+        "t[a-z]+e",
+        MC_SEARCH_T_REGEX,
+        0,
+        TRUE,
+        8,
+        5
+    },
+    { /* 5. not found */
+        "abcdefgh",
+        "gha",
+        MC_SEARCH_T_NORMAL,
+        0,
+        FALSE,
+        0,
+        0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_mc_search_run_span_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_mc_search_run_span, test_mc_search_run_span_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *search;
+    gsize actual_len = 0;
+    gboolean actual_result;
+
+    test_data = data->data;
+    search = mc_search_new (data->pattern, "UTF-8");
+    search->search_type = data->type;
+    search->is_case_sensitive = TRUE;
+    search->span_fn = test_span_callback;
+
+    /* when */
+    actual_result =
+        mc_search_run (search, test_data, data->start, strlen (test_data), &actual_len);
+
+    /* then */
+    mctest_assert_int_eq (actual_result, data->expected_result);
+    if (data->expected_result)
+    {
+        mctest_assert_int_eq (search->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (actual_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (search->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (search);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_mc_search_run_span, test_mc_search_run_span_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "mc_search_run_span.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
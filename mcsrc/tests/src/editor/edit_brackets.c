@@ -0,0 +1,233 @@
+/*
+   src/editor - tests for bracket index of editor
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "src/editor/edit-impl.h"
+#include "src/editor/editwidget.h"
+#include "src/editor/editbrackets.h"
+
+static WEdit *edit;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    edit = g_new0 (WEdit, 1);
+    edit_buffer_init (&edit->buffer, 0);
+    edit_bracket_index_init (&edit->bracket_index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_bracket_index_clean (&edit->bracket_index);
+    edit_buffer_clean (&edit->buffer);
+    g_free (edit);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+insert_str (off_t offset, const char *s, off_t len)
+{
+    edit_buffer_set_cursor (&edit->buffer, offset);
+    edit_buffer_insert_block (&edit->buffer, s, len);
+    edit_bracket_index_update (&edit->bracket_index, &edit->buffer, offset, 0, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+delete_str (off_t offset, off_t len)
+{
+    edit_buffer_set_cursor (&edit->buffer, offset);
+    edit_buffer_delete_block (&edit->buffer, len);
+    edit_bracket_index_update (&edit->bracket_index, &edit->buffer, offset, len, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** find matching bracket byte by byte */
+
+static off_t
+match_bracket (off_t offset)
+{
+    const char *const b = "{}{[][()(";
+    const char *p;
+    int c, d, inc, depth = 1;
+    off_t q;
+
+    c = edit_buffer_get_byte (&edit->buffer, offset);
+    p = strchr (b, c);
+    if (c == '\0' || p == NULL)
+        return -2;
+
+    d = p[1];
+    inc = strchr ("{[(", c) != NULL ? 1 : -1;
+
+    for (q = offset + inc; q >= 0 && q < edit->buffer.size; q += inc)
+    {
+        int a;
+
+        a = edit_buffer_get_byte (&edit->buffer, q);
+        depth += (a == c) - (a == d);
+        if (depth == 0)
+            return q;
+    }
+
+    return -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_edit_bracket_index_match_ds") */
+/* *INDENT-OFF* */
+static const struct test_edit_bracket_index_match_ds
+{
+    off_t input_offset;
+    off_t expected_offset;
+} test_edit_bracket_index_match_ds[] =
+{
+    /*   0123456789012345678 */
+    /*  "f (a[1], {b}) ) ( [" */
+    { 2, 12 },
+    { 12, 2 },
+    { 4, 6 },
+    { 6, 4 },
+    { 9, 11 },
+    { 14, -1 },
+    { 16, -1 },
+    { 18, -1 },
+    { 0, -2 },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_edit_bracket_index_match_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_edit_bracket_index_match, test_edit_bracket_index_match_ds)
+/* *INDENT-ON* */
+{
+    const char *text = "f (a[1], {b}) ) ( [";
+
+    /* given */
+    insert_str (0, text, strlen (text));
+    mctest_assert_true (edit_bracket_index_build (edit, edit->buffer.size, -1));
+
+    /* when */
+    /* then */
+    mctest_assert_int_eq (edit_bracket_index_match (&edit->bracket_index, &edit->buffer,
+                                                    data->input_offset), data->expected_offset);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_bracket_index_changes)
+/* *INDENT-ON* */
+{
+    static const char chars[] = "()[]{}ab\n";
+    GRand *rand;
+    char text[32];
+    int i;
+
+    /* given: text longer than distance between checkpoints */
+    rand = g_rand_new_with_seed (42);
+    for (i = 0; i < 20000; i++)
+    {
+        text[0] = chars[g_rand_int_range (rand, 0, sizeof (chars) - 1)];
+        insert_str (edit->buffer.size, text, 1);
+    }
+
+    for (i = 0; i < 3000; i++)
+    {
+        off_t offset, len;
+        int j;
+
+        /* when: change text at random and index a part of it */
+        offset = g_rand_int_range (rand, 0, edit->buffer.size + 1);
+        len = g_rand_int_range (rand, 1, sizeof (text));
+        if (g_rand_boolean (rand) || offset + len > edit->buffer.size)
+        {
+            for (j = 0; j < len; j++)
+                text[j] = chars[g_rand_int_range (rand, 0, sizeof (chars) - 1)];
+            insert_str (offset, text, len);
+        }
+        else
+            delete_str (offset, len);
+
+        if (!edit_bracket_index_build (edit, edit->buffer.size, g_rand_int_range (rand, 0, 8192)))
+            continue;
+
+        /* then */
+        for (j = 0; j < 20; j++)
+        {
+            offset = g_rand_int_range (rand, 0, edit->buffer.size);
+            mctest_assert_int_eq (edit_bracket_index_match (&edit->bracket_index, &edit->buffer,
+                                                            offset), match_bracket (offset));
+        }
+    }
+
+    g_rand_free (rand);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_edit_bracket_index_match,
+                                   test_edit_bracket_index_match_ds);
+    tcase_add_test (tc_core, test_edit_bracket_index_changes);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit_brackets.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,537 @@
+/*
+   src/editor - tests for text keep buffer of editor
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/editor/edit-impl.h"
+#include "src/editor/editbuffer.h"
+
+static edit_buffer_t buf;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    edit_buffer_init (&buf, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_buffer_clean (&buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+insert_str (const char *s)
+{
+    for (; *s != '\0'; s++)
+        edit_buffer_insert (&buf, *s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+get_text (void)
+{
+    GString *s;
+    off_t i;
+
+    s = g_string_new ("");
+
+    for (i = 0; i < buf.size;)
+    {
+        const char *p;
+        off_t len;
+
+        p = edit_buffer_get_span (&buf, i, &len);
+        mctest_assert_not_null (p);
+        g_string_append_len (s, p, len);
+        i += len;
+    }
+
+    return g_string_free (s, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_insert_delete)
+/* *INDENT-ON* */
+{
+    char *text;
+
+    /* when */
+    insert_str ("hello world");
+    edit_buffer_set_cursor (&buf, 5);
+    insert_str (",");
+    edit_buffer_insert_ahead (&buf, '!');
+    edit_buffer_set_cursor (&buf, 0);
+    edit_buffer_insert (&buf, '>');
+    edit_buffer_set_cursor (&buf, buf.size);
+    mctest_assert_int_eq (edit_buffer_backspace (&buf), 'd');
+    edit_buffer_set_cursor (&buf, 7);
+    mctest_assert_int_eq (edit_buffer_delete (&buf), '!');
+
+    /* then */
+    text = get_text ();
+    mctest_assert_str_eq (text, ">hello, worl");
+    g_free (text);
+    mctest_assert_int_eq (buf.size, 12);
+    mctest_assert_int_eq (buf.curs1, 7);
+    mctest_assert_int_eq (buf.curs2, 5);
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, 0), '>');
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, 11), 'l');
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, 12), '\n');
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, -1), '\n');
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_random_edit)
+/* *INDENT-ON* */
+{
+    GString *expected;
+    char *text;
+    off_t i;
+    int k;
+
+    /* given */
+    expected = g_string_new ("");
+    srand (1);
+
+    /* when */
+    for (k = 0; k < 20000; k++)
+    {
+        int c = 'a' + rand () % 26;
+
+        switch (rand () % 5)
+        {
+        case 0:
+        case 1:
+            g_string_insert_c (expected, buf.curs1, c);
+            edit_buffer_insert (&buf, c);
+            break;
+        case 2:
+            if (buf.curs2 != 0)
+            {
+                g_string_erase (expected, buf.curs1, 1);
+                edit_buffer_delete (&buf);
+            }
+            break;
+        case 3:
+            if (buf.curs1 != 0)
+            {
+                g_string_erase (expected, buf.curs1 - 1, 1);
+                edit_buffer_backspace (&buf);
+            }
+            break;
+        default:
+            edit_buffer_set_cursor (&buf, rand () % (buf.size + 1));
+            break;
+        }
+    }
+
+    /* then */
+    mctest_assert_int_eq (buf.size, (off_t) expected->len);
+    mctest_assert_int_eq (buf.curs1 + buf.curs2, buf.size);
+    text = get_text ();
+    mctest_assert_str_eq (text, expected->str);
+    g_free (text);
+    for (i = 0; i < buf.size; i++)
+        mctest_assert_int_eq (edit_buffer_get_byte (&buf, i), (unsigned char) expected->str[i]);
+
+    g_string_free (expected, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_line_index)
+/* *INDENT-ON* */
+{
+    /* given */
+    insert_str ("one\ntwo\n\nfour");
+    edit_buffer_set_cursor (&buf, 4);
+    insert_str ("1.5\n");
+
+    /* then */
+    /* "one\n1.5\ntwo\n\nfour" */
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, 0), 0);
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, 4), 1);
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, 9), 2);
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, buf.size), 4);
+    mctest_assert_int_eq (edit_buffer_get_line_offset (&buf, 0), 0);
+    mctest_assert_int_eq (edit_buffer_get_line_offset (&buf, 1), 4);
+    mctest_assert_int_eq (edit_buffer_get_line_offset (&buf, 3), 12);
+    mctest_assert_int_eq (edit_buffer_get_line_offset (&buf, 4), 13);
+    mctest_assert_int_eq (edit_buffer_get_line_offset (&buf, 100), 13);
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, 2, 13), 4);
+    mctest_assert_int_eq (edit_buffer_get_forward_offset (&buf, 5, 2, 0), 12);
+    mctest_assert_int_eq (edit_buffer_get_forward_offset (&buf, 14, 2, 0), 14);
+    mctest_assert_int_eq (edit_buffer_get_backward_offset (&buf, 10, 1), 4);
+
+    /* when */
+    edit_buffer_set_cursor (&buf, 3);
+    edit_buffer_delete (&buf);
+
+    /* then */
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, buf.size), 3);
+    mctest_assert_int_eq (edit_buffer_get_line_offset (&buf, 1), 7);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_block)
+/* *INDENT-ON* */
+{
+    char *big, *text;
+    off_t big_len = 100000;
+
+    /* given */
+    big = g_malloc (big_len);
+    memset (big, 'x', big_len);
+    big[big_len / 2] = '\n';
+    insert_str ("head\ntail");
+    edit_buffer_set_cursor (&buf, 5);
+
+    /* when */
+    edit_buffer_insert_block (&buf, "ab\n", 3);
+    edit_buffer_insert_ahead_block (&buf, big, big_len);
+
+    /* then */
+    mctest_assert_int_eq (buf.curs1, 8);
+    mctest_assert_int_eq (buf.size, 12 + big_len);
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, buf.size), 3);
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, 8 + big_len), 't');
+
+    /* when */
+    edit_buffer_delete_block (&buf, big_len);
+    text = get_text ();
+
+    /* then */
+    mctest_assert_str_eq (text, "head\nab\ntail");
+    mctest_assert_int_eq (buf.curs2, 4);
+    mctest_assert_int_eq (edit_buffer_get_line (&buf, buf.size), 2);
+
+    g_free (text);
+    g_free (big);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_changes)
+/* *INDENT-ON* */
+{
+    struct stat st;
+    GArray *changes;
+    edit_buffer_range_t *r;
+
+    /* given */
+    insert_str ("0123456789abcdefghij");
+    memset (&st, 0, sizeof (st));
+    st.st_size = buf.size;
+
+    /* then: text isn't saved yet */
+    mctest_assert_null (edit_buffer_get_changes (&buf, &st));
+
+    /* when */
+    edit_buffer_set_saved (&buf, TRUE);
+    edit_buffer_set_cursor (&buf, 5);
+    edit_buffer_delete (&buf);
+    edit_buffer_insert (&buf, 'X');
+    edit_buffer_set_cursor (&buf, buf.size);
+    insert_str ("!!");
+    changes = edit_buffer_get_changes (&buf, &st);
+
+    /* then */
+    mctest_assert_not_null (changes);
+    mctest_assert_int_eq (changes->len, 2);
+    r = &g_array_index (changes, edit_buffer_range_t, 0);
+    mctest_assert_int_eq (r->offset, 5);
+    mctest_assert_int_eq (r->len, 1);
+    r = &g_array_index (changes, edit_buffer_range_t, 1);
+    mctest_assert_int_eq (r->offset, 20);
+    mctest_assert_int_eq (r->len, 2);
+    g_array_free (changes, TRUE);
+
+    /* when: text after deleted byte is moved */
+    edit_buffer_set_cursor (&buf, 10);
+    edit_buffer_delete (&buf);
+    changes = edit_buffer_get_changes (&buf, &st);
+
+    /* then */
+    mctest_assert_int_eq (changes->len, 2);
+    r = &g_array_index (changes, edit_buffer_range_t, 1);
+    mctest_assert_int_eq (r->offset, 10);
+    mctest_assert_int_eq (r->len, 11);
+    g_array_free (changes, TRUE);
+
+    /* then: file of other size is not the saved one */
+    st.st_size++;
+    mctest_assert_null (edit_buffer_get_changes (&buf, &st));
+
+    /* when: text was converted while saving */
+    edit_buffer_set_saved (&buf, FALSE);
+    st.st_size = buf.size;
+
+    /* then */
+    mctest_assert_null (edit_buffer_get_changes (&buf, &st));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_write_changes)
+/* *INDENT-ON* */
+{
+    struct stat st;
+    char *name, *text, *contents;
+    gsize len;
+    int fd, k;
+
+    /* given */
+    fd = g_file_open_tmp (NULL, &name, NULL);
+    mctest_assert_true (fd != -1);
+    insert_str ("the quick brown fox\njumps over\nthe lazy dog\n");
+    mctest_assert_int_eq (edit_buffer_write_range (&buf, fd, 0, buf.size), buf.size);
+    edit_buffer_set_saved (&buf, TRUE);
+    memset (&st, 0, sizeof (st));
+    st.st_size = buf.size;
+    srand (2);
+
+    for (k = 0; k < 500; k++)
+    {
+        GArray *changes;
+        guint i;
+
+        /* when */
+        edit_buffer_set_cursor (&buf, rand () % (buf.size + 1));
+        if (rand () % 3 != 0)
+            insert_str (rand () % 2 != 0 ? "a" : "bcd\n");
+        else if (buf.curs2 != 0)
+            edit_buffer_delete (&buf);
+
+        if (k % 10 != 0)
+            continue;
+
+        changes = edit_buffer_get_changes (&buf, &st);
+        mctest_assert_not_null (changes);
+        for (i = 0; i < changes->len; i++)
+        {
+            const edit_buffer_range_t *r = &g_array_index (changes, edit_buffer_range_t, i);
+
+            mctest_assert_int_eq (edit_buffer_write_range (&buf, fd, r->offset, r->len), r->len);
+        }
+        g_array_free (changes, TRUE);
+        mctest_assert_int_eq (ftruncate (fd, buf.size), 0);
+        edit_buffer_set_saved (&buf, TRUE);
+        st.st_size = buf.size;
+
+        /* then: the file contains the text */
+        mctest_assert_true (g_file_get_contents (name, &contents, &len, NULL));
+        text = get_text ();
+        mctest_assert_int_eq (len, buf.size);
+        mctest_assert_str_eq (contents, text);
+        g_free (text);
+        g_free (contents);
+    }
+
+    close (fd);
+    unlink (name);
+    g_free (name);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_MMAP
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_map_truncated)
+/* *INDENT-ON* */
+{
+    const off_t size = 8 * 1024 * 1024;
+    char *name, *data;
+    gboolean aborted;
+    off_t i;
+    long sum = 0;
+    int fd;
+
+    /* given */
+    data = g_malloc (size);
+    for (i = 0; i < size; i++)
+        data[i] = (i % 100 == 99) ? '\n' : 'a' + i % 26;
+    fd = g_file_open_tmp (NULL, &name, NULL);
+    mctest_assert_true (fd != -1);
+    close (fd);
+    mctest_assert_true (g_file_set_contents (name, data, size, NULL));
+    g_free (data);
+    buf.size = size;
+    mctest_assert_int_eq (edit_buffer_map_file (&buf, name, size, NULL, &aborted), size);
+    mctest_assert_false (edit_buffer_unmap_changed (&buf));
+
+    /* when: another program truncates the file */
+    mctest_assert_int_eq (truncate (name, size / 2), 0);
+    for (i = 0; i < buf.size; i += 4096)
+        sum += edit_buffer_get_byte (&buf, i);
+
+    /* then: lost part is read as zeroes, the text is detached from the file */
+    mctest_assert_true (sum > 0);
+    mctest_assert_true (edit_buffer_unmap_changed (&buf));
+    mctest_assert_int_eq (buf.lines, size / 2 / 100);
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, size / 2 - 1), 'a' + (size / 2 - 1) % 26);
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, size - 1), 0);
+    mctest_assert_false (edit_buffer_unmap_changed (&buf));
+
+    unlink (name);
+    g_free (name);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_CHARSET
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_get_utf)
+/* *INDENT-ON* */
+{
+    /* a, U+0416, U+4E2D, U+1F600, overlong NUL, surrogate, b */
+    static const char text[] = "a\xD0\x96\xE4\xB8\xAD\xF0\x9F\x98\x80\xC0\x80\xED\xA0\x80" "b";
+    int len;
+
+    /* given */
+    insert_str (text);
+
+    /* then */
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 0, &len), 'a');
+    mctest_assert_int_eq (len, 1);
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 1, &len), 0x416);
+    mctest_assert_int_eq (len, 2);
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 3, &len), 0x4E2D);
+    mctest_assert_int_eq (len, 3);
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 6, &len), 0x1F600);
+    mctest_assert_int_eq (len, 4);
+    edit_buffer_get_utf (&buf, 10, &len);
+    mctest_assert_int_eq (len, 0);
+    edit_buffer_get_utf (&buf, 12, &len);
+    mctest_assert_int_eq (len, 0);
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 15, &len), 'b');
+    mctest_assert_int_eq (len, 1);
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 16, &len), '\n');
+    mctest_assert_int_eq (len, 0);
+
+    mctest_assert_int_eq (edit_buffer_get_prev_utf (&buf, 1, &len), 'a');
+    mctest_assert_int_eq (len, 1);
+    mctest_assert_int_eq (edit_buffer_get_prev_utf (&buf, 10, &len), 0x1F600);
+    mctest_assert_int_eq (len, 4);
+    mctest_assert_int_eq (edit_buffer_get_prev_utf (&buf, 16, &len), 'b');
+    mctest_assert_int_eq (len, 1);
+
+    /* when: sequence is split between pieces */
+    edit_buffer_set_cursor (&buf, 2);
+    edit_buffer_insert_block (&buf, "\x96\xD0", 2);
+
+    /* then */
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 1, &len), 0x416);
+    mctest_assert_int_eq (len, 2);
+    mctest_assert_int_eq (edit_buffer_get_utf (&buf, 3, &len), 0x416);
+    mctest_assert_int_eq (len, 2);
+    mctest_assert_int_eq (edit_buffer_get_prev_utf (&buf, 5, &len), 0x416);
+    mctest_assert_int_eq (len, 2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_CHARSET */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_edit_buffer_insert_delete);
+    tcase_add_test (tc_core, test_edit_buffer_random_edit);
+    tcase_add_test (tc_core, test_edit_buffer_line_index);
+    tcase_add_test (tc_core, test_edit_buffer_block);
+    tcase_add_test (tc_core, test_edit_buffer_changes);
+    tcase_add_test (tc_core, test_edit_buffer_write_changes);
+#ifdef HAVE_MMAP
+    tcase_add_test (tc_core, test_edit_buffer_map_truncated);
+#endif
+#ifdef HAVE_CHARSET
+    tcase_add_test (tc_core, test_edit_buffer_get_utf);
+#endif
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit_buffer.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,122 @@
+/*
+   src/editor - microbenchmark for newline scanning in text keep buffer of editor
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Usage: edit_buffer_bench [size in MiB]
+ *
+ * Not run by "make check". Build it with "make edit_buffer_bench".
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/global.h"
+#include "lib/timer.h"
+
+#include "src/editor/edit-impl.h"
+#include "src/editor/editbuffer.h"
+
+/*** file scope variables ************************************************************************/
+
+static mc_timer_t *timer;
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+report (const char *name, guint64 start, off_t size, long result)
+{
+    guint64 t;
+
+    t = mc_timer_elapsed (timer) - start;
+    if (size == 0 || t == 0)
+        printf ("%-24s %10.3f ms %17s (%ld)\n", name, t / 1000.0, "", result);
+    else
+        printf ("%-24s %10.3f ms %10.1f MiB/s  (%ld)\n", name, t / 1000.0,
+                (double) size / (1024.0 * 1024.0) / (t / 1000000.0), result);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char **argv)
+{
+    edit_buffer_t buf;
+    off_t size, i;
+    long lines, n;
+    guint64 start;
+
+    size = (argc > 1 ? atol (argv[1]) : 64) * 1024 * 1024;
+
+    timer = mc_timer_new ();
+    edit_buffer_init (&buf, 0);
+
+    /* lines of 0..119 chars */
+    for (i = 0, n = 0; i < size; i++)
+    {
+        if (n == 0)
+        {
+            edit_buffer_insert (&buf, '\n');
+            n = (long) ((i * 7919) % 120);
+        }
+        else
+        {
+            edit_buffer_insert (&buf, 'a' + (int) (n % 26));
+            n--;
+        }
+    }
+
+    start = mc_timer_elapsed (timer);
+    lines = edit_buffer_count_lines (&buf, 0, buf.size);
+    report ("count_lines (all)", start, buf.size, lines);
+
+    start = mc_timer_elapsed (timer);
+    for (i = 0, n = 0; i < buf.size; i += 4096)
+        n += edit_buffer_count_lines (&buf, i, i + 4095);
+    report ("count_lines (4 KiB)", start, buf.size, n);
+
+    start = mc_timer_elapsed (timer);
+    for (i = 0, n = 0; i < buf.size; n++)
+        i = edit_buffer_get_eol (&buf, i) + 1;
+    report ("get_eol (forward)", start, buf.size, n);
+
+    start = mc_timer_elapsed (timer);
+    for (i = buf.size, n = 0; i > 0; n++)
+        i = edit_buffer_get_bol (&buf, i - 1);
+    report ("get_bol (backward)", start, buf.size, n);
+
+    start = mc_timer_elapsed (timer);
+    for (n = 0; n < lines; n += 997)
+        (void) edit_buffer_get_line_offset (&buf, n);
+    report ("get_line_offset", start, 0, n / 997);
+
+    edit_buffer_clean (&buf);
+    mc_timer_destroy (timer);
+
+    return EXIT_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,263 @@
+/*
+   src/editor - tests for built-in sort of editor
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+
+#include "src/editor/editsort.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_edit_sort_text_ds") */
+/* *INDENT-OFF* */
+static const struct test_edit_sort_text_ds
+{
+    const char *input_options;
+    const char *input_text;
+    const char *expected_text;
+} test_edit_sort_text_ds[] =
+{
+    { /* 0. */
+        "",
+        "b\nc\na",
+        "a\nb\nc\n"
+    },
+    { /* 1. */
+        "-r",
+        "b\na\nc\n",
+        "c\nb\na\n"
+    },
+    { /* 2. */
+        "-n",
+        "10\n9\n-1.5\nx\n-2\n",
+        "-2\n-1.5\nx\n9\n10\n"
+    },
+    { /* 3. */
+        "-u",
+        "b\na\nb\na\n",
+        "a\nb\n"
+    },
+    { /* 4. */
+        "-t : -k 2,2",
+        "x:2:b\ny:1:c\nz:2:a\n",
+        "y:1:c\nx:2:b\nz:2:a\n"
+    },
+    { /* 5. */
+        "-k2 -u",
+        "1 b\n2 a\n3 b\n",
+        "2 a\n1 b\n"
+    },
+    { /* 6. */
+        "-b --key=2",
+        "1  b\n2 c\n3   a\n",
+        "3   a\n1  b\n2 c\n"
+    },
+    { /* 7. */
+        "-nr -t,  -k2",
+        "a,5\nb,40\nc,7\n",
+        "b,40\nc,7\na,5\n"
+    },
+    { /* 8. */
+        "-f",
+        "b\nB\na\n",
+        "a\nB\nb\n"
+    },
+    { /* 9. */
+        "",
+        "",
+        ""
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_edit_sort_text_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_edit_sort_text, test_edit_sort_text_ds)
+/* *INDENT-ON* */
+{
+    edit_sort_options_t options;
+    GString *sorted;
+
+    /* given */
+    mctest_assert_true (edit_sort_parse_options (data->input_options, &options));
+
+    /* when */
+    sorted = edit_sort_text (data->input_text, strlen (data->input_text), &options);
+
+    /* then */
+    mctest_assert_str_eq (sorted->str, data->expected_text);
+    g_string_free (sorted, TRUE);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_sort_parse_options)
+/* *INDENT-ON* */
+{
+    static const char *unsupported[] = {
+        "-M", "-k 1.2", "-k2n", "-k1 -k2", "-o out", "file", "-t", "-t ab", "--random-sort",
+        "--reverse=yes", "'-n"
+    };
+    edit_sort_options_t options;
+    size_t i;
+
+    /* when */
+    mctest_assert_true (edit_sort_parse_options ("  -rnu --ignore-case -t'\t' -k 3,4 ", &options));
+
+    /* then */
+    mctest_assert_true (options.reverse);
+    mctest_assert_true (options.numeric);
+    mctest_assert_true (options.unique);
+    mctest_assert_true (options.fold_case);
+    mctest_assert_false (options.ignore_blanks);
+    mctest_assert_int_eq (options.separator, '\t');
+    mctest_assert_int_eq (options.key_start, 3);
+    mctest_assert_int_eq (options.key_end, 4);
+
+    /* then: options which must be passed to sort(1) */
+    for (i = 0; i < G_N_ELEMENTS (unsupported); i++)
+        mctest_assert_false (edit_sort_parse_options (unsupported[i], &options));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+compare_numeric_lines (gconstpointer a, gconstpointer b)
+{
+    const char *s1 = *(const char *const *) a;
+    const char *s2 = *(const char *const *) b;
+    int n1, n2;
+
+    n1 = atoi (s1);
+    n2 = atoi (s2);
+    if (n1 != n2)
+        return (n1 < n2 ? -1 : 1);
+
+    return strcmp (s1, s2);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_sort_large)
+/* *INDENT-ON* */
+{
+    edit_sort_options_t options;
+    GRand *rand;
+    GPtrArray *lines;
+    GString *text, *expected, *sorted;
+    guint i;
+
+    /* given: enough lines to be sorted by several threads */
+    rand = g_rand_new_with_seed (42);
+    lines = g_ptr_array_new_with_free_func (g_free);
+    text = g_string_new ("");
+    for (i = 0; i < 200000; i++)
+    {
+        char *line;
+
+        line = g_strdup_printf ("%d %c", g_rand_int_range (rand, -1000, 1000),
+                                'a' + g_rand_int_range (rand, 0, 26));
+        g_ptr_array_add (lines, line);
+        g_string_append_printf (text, "%s\n", line);
+    }
+
+    g_ptr_array_sort (lines, compare_numeric_lines);
+    expected = g_string_new ("");
+    for (i = 0; i < lines->len; i++)
+        g_string_append_printf (expected, "%s\n", (char *) g_ptr_array_index (lines, i));
+
+    /* when */
+    edit_sort_parse_options ("-n", &options);
+    sorted = edit_sort_text (text->str, text->len, &options);
+
+    /* then */
+    mctest_assert_int_eq (sorted->len, expected->len);
+    mctest_assert_true (strcmp (sorted->str, expected->str) == 0);
+
+    g_string_free (sorted, TRUE);
+    g_string_free (expected, TRUE);
+    g_string_free (text, TRUE);
+    g_ptr_array_free (lines, TRUE);
+    g_rand_free (rand);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_edit_sort_text, test_edit_sort_text_ds);
+    tcase_add_test (tc_core, test_edit_sort_parse_options);
+    tcase_add_test (tc_core, test_edit_sort_large);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit_sort.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,211 @@
+/*
+   src/editor - tests for undo/redo log of editor
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "src/editor/editundo.h"
+
+static edit_undo_log_t ulog;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    edit_undo_log_init (&ulog, 1024 * 1024);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_undo_log_clean (&ulog);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_undo_log_merge)
+/* *INDENT-ON* */
+{
+    edit_undo_record_t r;
+    const char *text;
+
+    /* given */
+    edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, 10);
+    edit_undo_log_push (&ulog, EDIT_UNDO_BACKSPACE, 1);
+    edit_undo_log_push (&ulog, EDIT_UNDO_BACKSPACE, 1);
+    edit_undo_log_push (&ulog, EDIT_UNDO_BACKSPACE, 3);
+    edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, 20);
+    edit_undo_log_push (&ulog, EDIT_UNDO_CURS_LEFT, 2);
+    edit_undo_log_push (&ulog, EDIT_UNDO_CURS_RIGHT, 1);
+
+    /* then */
+    mctest_assert_int_eq (ulog.records->len, 5);
+    mctest_assert_int_eq (edit_undo_log_top (&ulog), EDIT_UNDO_CURS_RIGHT);
+
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_CURS_RIGHT);
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_CURS_LEFT);
+    mctest_assert_int_eq (r.value, 2);
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_KEY_PRESS);
+    mctest_assert_int_eq (r.value, 20);
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_BACKSPACE);
+    mctest_assert_int_eq (r.value, 5);
+    mctest_assert_null (text);
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.value, 10);
+    mctest_assert_false (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (edit_undo_log_top (&ulog), EDIT_UNDO_NONE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_undo_log_text)
+/* *INDENT-ON* */
+{
+    edit_undo_record_t r;
+    const char *text;
+
+    /* given: "abcde|" -> backspace twice, then delete block "ab" before cursor */
+    edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, 0);
+    edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT, "e", 1);
+    edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT, "d", 1);
+    edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT, "bc", 2);
+    /* "|a" -> delete ahead */
+    edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, 0);
+    edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT_AHEAD, "a", 1);
+    edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT_AHEAD, "xyz", 3);
+
+    /* then */
+    mctest_assert_int_eq (ulog.records->len, 4);
+    mctest_assert_int_eq (edit_undo_log_get_size (&ulog), 4 * sizeof (edit_undo_record_t) + 8);
+
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_INSERT_AHEAD);
+    mctest_assert_int_eq (r.value, 4);
+    mctest_assert_true (strncmp (text, "axyz", 4) == 0);
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_true (edit_undo_log_pop (&ulog, &r, &text));
+    mctest_assert_int_eq (r.action, EDIT_UNDO_INSERT);
+    mctest_assert_int_eq (r.value, 4);
+    mctest_assert_true (strncmp (text, "bcde", 4) == 0);
+    mctest_assert_int_eq (ulog.text->len, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_undo_log_limit)
+/* *INDENT-ON* */
+{
+    char block[1000];
+    edit_undo_record_t r;
+    int i;
+
+    /* given */
+    edit_undo_log_clean (&ulog);
+    edit_undo_log_init (&ulog, 4096);
+    memset (block, 'z', sizeof (block));
+
+    /* when */
+    for (i = 0; i < 10; i++)
+    {
+        edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, i);
+        edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT_AHEAD, block, sizeof (block));
+    }
+
+    /* then: the oldest actions are dropped as a whole */
+    mctest_assert_true (edit_undo_log_get_size (&ulog) <= 4096);
+    mctest_assert_int_eq (ulog.text->len, (ulog.records->len / 2) * sizeof (block));
+    r = g_array_index (ulog.records, edit_undo_record_t, 0);
+    mctest_assert_int_eq (r.action, EDIT_UNDO_KEY_PRESS);
+    mctest_assert_true (r.value > 0);
+
+    /* when: single action doesn't fit in limit */
+    edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, 100);
+    for (i = 0; i < 5; i++)
+        edit_undo_log_push_text (&ulog, EDIT_UNDO_INSERT, block, sizeof (block));
+    edit_undo_log_push (&ulog, EDIT_UNDO_CURS_LEFT, 1);
+
+    /* then: it isn't recorded at all */
+    mctest_assert_int_eq (edit_undo_log_top (&ulog), EDIT_UNDO_NONE);
+
+    /* when: next action */
+    edit_undo_log_push (&ulog, EDIT_UNDO_KEY_PRESS, 200);
+    edit_undo_log_push (&ulog, EDIT_UNDO_CURS_LEFT, 1);
+
+    /* then */
+    mctest_assert_int_eq (ulog.records->len, 2);
+
+    /* then: size of deleted block is checked against the same limit */
+    mctest_assert_true (edit_undo_log_can_keep (&ulog, sizeof (block)));
+    mctest_assert_false (edit_undo_log_can_keep (&ulog, 5 * sizeof (block)));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_edit_undo_log_merge);
+    tcase_add_test (tc_core, test_edit_undo_log_text);
+    tcase_add_test (tc_core, test_edit_undo_log_limit);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit_undo.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,325 @@
+/*
+   src/editor - tests for word index of editor
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include "src/editor/edit-impl.h"
+#include "src/editor/editbuffer.h"
+#include "src/editor/editwords.h"
+
+static edit_buffer_t buf;
+static edit_word_index_t words;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    edit_buffer_init (&buf, 0);
+    edit_word_index_init (&words);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_word_index_clean (&words);
+    edit_buffer_clean (&buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+insert_str (off_t offset, const char *s)
+{
+    off_t len;
+
+    len = (off_t) strlen (s);
+    edit_buffer_set_cursor (&buf, offset);
+    edit_buffer_insert_block (&buf, s, len);
+    edit_word_index_update (&words, &buf, offset, NULL, 0, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+delete_str (off_t offset, off_t len)
+{
+    char deleted[64];
+    off_t i;
+
+    for (i = 0; i < len; i++)
+        deleted[i] = (char) edit_buffer_get_byte (&buf, offset + i);
+
+    edit_buffer_set_cursor (&buf, offset);
+    edit_buffer_delete_block (&buf, len);
+    edit_word_index_update (&words, &buf, offset, deleted, len, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static unsigned long
+get_count (const char *word)
+{
+    const edit_word_t *w;
+
+    w = edit_word_index_find (&words, word);
+
+    return (w == NULL ? 0 : w->count);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** insert random piece of text or delete random block */
+
+static void
+change_random (GRand * rand, const char **pieces, int n)
+{
+    off_t offset;
+
+    offset = g_rand_int_range (rand, 0, buf.size + 1);
+
+    if (g_rand_boolean (rand) || buf.size == offset)
+        insert_str (offset, pieces[g_rand_int_range (rand, 0, n)]);
+    else
+    {
+        off_t len;
+
+        len = g_rand_int_range (rand, 1, 8);
+        delete_str (offset, MIN (len, buf.size - offset));
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** check that index is the same as the one built from scratch */
+
+static void
+check_index (void)
+{
+    edit_word_index_t etalon;
+    GHashTableIter iter;
+    gpointer value;
+
+    edit_word_index_init (&etalon);
+    edit_word_index_build (&etalon, &buf, -1);
+
+    mctest_assert_int_eq (g_hash_table_size (words.words), g_hash_table_size (etalon.words));
+
+    g_hash_table_iter_init (&iter, etalon.words);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+        const edit_word_t *w = (const edit_word_t *) value;
+
+        mctest_assert_int_eq (get_count (w->word), w->count);
+    }
+
+    edit_word_index_clean (&etalon);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** check that lookup finds all words of index in sorted array */
+
+static void
+check_lookup (void)
+{
+    GPtrArray *found;
+    guint i;
+
+    found = edit_word_index_lookup (&words, "", 0);
+    mctest_assert_int_eq (found->len, g_hash_table_size (words.words));
+    for (i = 0; i < found->len; i++)
+        mctest_assert_true (((edit_word_t *) g_ptr_array_index (found, i))->count > 0);
+    g_ptr_array_free (found, TRUE);
+
+    for (i = 1; i < words.sorted->len; i++)
+    {
+        const edit_word_t *prev = (const edit_word_t *) g_ptr_array_index (words.sorted, i - 1);
+        const edit_word_t *w = (const edit_word_t *) g_ptr_array_index (words.sorted, i);
+
+        mctest_assert_true (strcmp (prev->word, w->word) < 0);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_word_index_lookup)
+/* *INDENT-ON* */
+{
+    GPtrArray *found;
+
+    /* given */
+    insert_str (0, "foo bar(foo, baz);\nfoobar = bar;\n");
+    mctest_assert_true (edit_word_index_build (&words, &buf, -1));
+
+    /* when */
+    found = edit_word_index_lookup (&words, "ba", 2);
+
+    /* then */
+    mctest_assert_int_eq (found->len, 2);
+    mctest_assert_str_eq (((edit_word_t *) g_ptr_array_index (found, 0))->word, "bar");
+    mctest_assert_int_eq (((edit_word_t *) g_ptr_array_index (found, 0))->count, 2);
+    mctest_assert_str_eq (((edit_word_t *) g_ptr_array_index (found, 1))->word, "baz");
+    g_ptr_array_free (found, TRUE);
+
+    /* when */
+    found = edit_word_index_lookup (&words, "foo", 3);
+
+    /* then: the more frequent words first */
+    mctest_assert_int_eq (found->len, 2);
+    mctest_assert_str_eq (((edit_word_t *) g_ptr_array_index (found, 0))->word, "foo");
+    mctest_assert_str_eq (((edit_word_t *) g_ptr_array_index (found, 1))->word, "foobar");
+    g_ptr_array_free (found, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_word_index_update)
+/* *INDENT-ON* */
+{
+    GPtrArray *found;
+
+    /* given */
+    insert_str (0, "foo bar baz\n");
+    edit_word_index_build (&words, &buf, -1);
+    found = edit_word_index_lookup (&words, "", 0);
+    g_ptr_array_free (found, TRUE);
+
+    /* when: type in the middle of word */
+    insert_str (5, "x");
+
+    /* then */
+    mctest_assert_int_eq (get_count ("bar"), 0);
+    mctest_assert_int_eq (get_count ("bxar"), 1);
+
+    /* when: join words */
+    delete_str (3, 1);
+
+    /* then */
+    mctest_assert_int_eq (get_count ("foo"), 0);
+    mctest_assert_int_eq (get_count ("foobxar"), 1);
+    check_index ();
+
+    /* when: split word */
+    insert_str (3, " ( ");
+
+    /* then */
+    mctest_assert_int_eq (get_count ("foo"), 1);
+    mctest_assert_int_eq (get_count ("bxar"), 1);
+    check_index ();
+
+    /* then: sorted array is kept up to date */
+    found = edit_word_index_lookup (&words, "b", 1);
+    mctest_assert_int_eq (found->len, 2);
+    mctest_assert_str_eq (((edit_word_t *) g_ptr_array_index (found, 0))->word, "baz");
+    mctest_assert_str_eq (((edit_word_t *) g_ptr_array_index (found, 1))->word, "bxar");
+    g_ptr_array_free (found, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_edit_word_index_random)
+/* *INDENT-ON* */
+{
+    static const char *pieces[] = { "a", "b", "ab", " ", "\n", "(", "foo", "bar baz", ";" };
+    GRand *rand;
+    int i;
+
+    /* given */
+    rand = g_rand_new_with_seed (42);
+    for (i = 0; i < 200; i++)
+        insert_str (buf.size, pieces[g_rand_int_range (rand, 0, G_N_ELEMENTS (pieces))]);
+
+    /* when: text is changed while index is being built */
+    for (i = 0; i < 2000; i++)
+    {
+        if (i % 100 == 0)
+            edit_word_index_build (&words, &buf, 16);
+
+        change_random (rand, pieces, G_N_ELEMENTS (pieces));
+    }
+
+    edit_word_index_build (&words, &buf, -1);
+
+    /* then */
+    check_index ();
+
+    /* when: text is changed after index is built and looked up */
+    for (i = 0; i < 2000; i++)
+    {
+        if (i % 100 == 0)
+            check_lookup ();
+
+        change_random (rand, pieces, G_N_ELEMENTS (pieces));
+    }
+
+    /* then */
+    mctest_assert_int_eq (words.indexed, buf.size);
+    check_index ();
+
+    g_rand_free (rand);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_edit_word_index_lookup);
+    tcase_add_test (tc_core, test_edit_word_index_update);
+    tcase_add_test (tc_core, test_edit_word_index_random);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "edit_words.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,178 @@
+/*
+   src/editor - tests for etags_set_definition_hash() function
+
+   Copyright (C) 2018
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+
+#include "src/editor/etags.h"
+
+static const char *tags_1 =
+    "\f\nsrc/a.c,100\n"
+    "int foo (\x7f" "10,200\n"
+    "static int bar;\x7f" "12,300\n"
+    "struct s\x7f" "s_t\x01" "20,400\n"
+    "\f\nb.c,50\n"
+    "void foo(\x7f" "3,20\n";
+
+static const char *tags_2 =
+    "\f\nc.c,10\n"
+    "#define foo\x7f" "7,70\n"
+    "#define bar\x7f" "8,80\n";
+
+static char *tagfile;
+static etags_hash_t def_hash[MAX_DEFINITIONS];
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    tagfile = g_build_filename (g_get_tmp_dir (), "mc-test-etags-TAGS", (char *) NULL);
+    g_file_set_contents (tagfile, tags_1, -1, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    etags_cache_free ();
+    unlink (tagfile);
+    g_free (tagfile);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+find (const char *name, int max_def)
+{
+    int i, num;
+
+    for (i = 0; i < MAX_DEFINITIONS; i++)
+    {
+        g_free (def_hash[i].fullpath);
+        g_free (def_hash[i].filename);
+        g_free (def_hash[i].short_define);
+    }
+    memset (def_hash, 0, sizeof (def_hash));
+
+    num = etags_set_definition_hash (tagfile, "/prj", name, def_hash, max_def);
+
+    return num;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_etags_lookup)
+/* *INDENT-ON* */
+{
+    /* when */
+    mctest_assert_int_eq (find ("foo", MAX_DEFINITIONS), 2);
+
+    /* then: definitions are in order of TAGS file */
+    mctest_assert_str_eq (def_hash[0].filename, "src/a.c");
+    mctest_assert_str_eq (def_hash[0].fullpath, "/prj/src/a.c");
+    mctest_assert_str_eq (def_hash[0].short_define, "foo");
+    mctest_assert_int_eq (def_hash[0].line, 10);
+    mctest_assert_str_eq (def_hash[1].filename, "b.c");
+    mctest_assert_int_eq (def_hash[1].line, 3);
+
+    /* then: implicit and explicit tag names */
+    mctest_assert_int_eq (find ("bar", MAX_DEFINITIONS), 1);
+    mctest_assert_int_eq (def_hash[0].line, 12);
+    mctest_assert_int_eq (find ("s_t", MAX_DEFINITIONS), 1);
+    mctest_assert_int_eq (def_hash[0].line, 20);
+    mctest_assert_int_eq (find ("s", MAX_DEFINITIONS), 0);
+
+    /* then: only whole names match */
+    mctest_assert_int_eq (find ("fo", MAX_DEFINITIONS), 0);
+    mctest_assert_int_eq (find ("int", MAX_DEFINITIONS), 0);
+
+    /* then: number of definitions is limited */
+    mctest_assert_int_eq (find ("foo", 1), 1);
+    mctest_assert_str_eq (def_hash[0].filename, "src/a.c");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+START_TEST (test_etags_changed_file)
+/* *INDENT-ON* */
+{
+    /* given */
+    mctest_assert_int_eq (find ("foo", MAX_DEFINITIONS), 2);
+
+    /* when */
+    g_file_set_contents (tagfile, tags_2, -1, NULL);
+
+    /* then: index is rebuilt */
+    mctest_assert_int_eq (find ("foo", MAX_DEFINITIONS), 1);
+    mctest_assert_str_eq (def_hash[0].filename, "c.c");
+    mctest_assert_int_eq (def_hash[0].line, 7);
+
+    /* when */
+    unlink (tagfile);
+
+    /* then */
+    mctest_assert_int_eq (find ("foo", MAX_DEFINITIONS), 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_etags_lookup);
+    tcase_add_test (tc_core, test_etags_changed_file);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "etags__etags_set_definition_hash.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -118,6 +118,7 @@ extern int                  win32_pclose(FILE *file);
 #undef  HAVE_LIBGPM
 
 #undef  HAVE_REALPATH                           /* FIXME */
+#undef  HAVE_MEMRCHR
 #define HAVE_STRCASECMP 1
 #define HAVE_STRNCASECMP 1
 #define HAVE_GETOPT 1
@@ -507,6 +507,7 @@ LIBW32_API ssize_t      pwrite (int fildes, const void *buf, size_t nbyte, off_t
 #define close(a)        w32_close(a)
 #define link(f,t)       w32_link(f,t)
 #define unlink(p)       w32_unlink(p)
+#define fsync(a)        w32_fsync(a)
 #endif /*WIN32_UNISTD_MAP*/
 
 #if defined(WIN32_UNISTD_MAP) || \